@@ -0,0 +1,237 @@
+#pragma once
+// smartdb_bench 的最小基准框架：自动标定迭代次数、多次重复取中位数，结果输出为 JSON。
+// 输出格式与 Google Benchmark 的 --benchmark_format=json 保持相近，便于复用现有比较脚本
+#include <sqlite3.h>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifndef SMARTDB_BUILD_TYPE
+#define SMARTDB_BUILD_TYPE "unknown"
+#endif
+#ifndef SMARTDB_VERSION
+#define SMARTDB_VERSION "unknown"
+#endif
+
+namespace sdb::bench {
+
+struct State {
+    // 本次调用需要执行的操作次数
+    uint64_t iterations = 0;
+    // 每次操作处理的条目数 / 字节数，用于换算吞吐
+    uint64_t itemsPerOp = 0;
+    uint64_t bytesPerOp = 0;
+    // 自定义计数器，按最后一次测量的值输出
+    std::map<std::string, double> counters;
+    // 非空时本基准被跳过（例如 MySQL 客户端库无法连接替身服务器）
+    std::string skipReason;
+};
+
+using Body = std::function<void(State&)>;
+// setup 在计时之外执行一次，返回被计时的函数体；返回空函数表示跳过
+using Setup = std::function<Body(State&)>;
+
+struct Options {
+    std::string filter;
+    std::chrono::milliseconds minTime{200};
+    int repetitions = 3;
+    bool list = false;
+    std::string out;
+};
+
+struct Result {
+    std::string name;
+    uint64_t iterations = 0;
+    double nsPerOp = 0;
+    double opsPerSec = 0;
+    double itemsPerSec = 0;
+    double bytesPerSec = 0;
+    std::vector<double> samples;
+    std::map<std::string, double> counters;
+    std::string skipReason;
+};
+
+class Registry {
+public:
+    void add(std::string name, Setup setup) { entries_.emplace_back(std::move(name), std::move(setup)); }
+
+    const std::vector<std::pair<std::string, Setup>>& entries() const { return entries_; }
+
+    std::vector<Result> run(const Options& options) const {
+        std::vector<Result> results;
+        for (const auto& [name, setup] : entries_) {
+            if (!options.filter.empty() && name.find(options.filter) == std::string::npos) {
+                continue;
+            }
+            results.push_back(runOne(name, setup, options));
+            report(results.back());
+        }
+        return results;
+    }
+
+    static Options parseArgs(int argc, char** argv) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            auto value = [&](const char* prefix) -> std::optional<std::string> {
+                const std::string p(prefix);
+                if (arg.rfind(p, 0) == 0) {
+                    return arg.substr(p.size());
+                }
+                return std::nullopt;
+            };
+            if (auto v = value("--filter=")) {
+                options.filter = *v;
+            } else if (auto v = value("--min-time-ms=")) {
+                options.minTime = std::chrono::milliseconds(std::stoll(*v));
+            } else if (auto v = value("--repetitions=")) {
+                options.repetitions = std::max(1, std::stoi(*v));
+            } else if (auto v = value("--out=")) {
+                options.out = *v;
+            } else if (arg == "--list") {
+                options.list = true;
+            } else {
+                std::cerr << "usage: " << argv[0]
+                          << " [--filter=substr] [--min-time-ms=200] [--repetitions=3] [--out=results.json] [--list]\n";
+                std::exit(arg == "--help" ? 0 : 2);
+            }
+        }
+        return options;
+    }
+
+    static nlohmann::json context() {
+        char date[32] = {};
+        const std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+        return {
+            {"date", date},
+            {"smartdb_version", SMARTDB_VERSION},
+            {"build_type", SMARTDB_BUILD_TYPE},
+            {"compiler", compiler()},
+            {"sqlite_version", sqlite3_libversion()},
+            {"num_cpus", std::thread::hardware_concurrency()},
+        };
+    }
+
+    static nlohmann::json toJson(const std::vector<Result>& results) {
+        nlohmann::json benchmarks = nlohmann::json::array();
+        for (const auto& r : results) {
+            nlohmann::json entry = {{"name", r.name}};
+            if (!r.skipReason.empty()) {
+                entry["skipped"] = r.skipReason;
+                benchmarks.push_back(std::move(entry));
+                continue;
+            }
+            entry["iterations"] = r.iterations;
+            entry["real_time"] = r.nsPerOp;
+            entry["time_unit"] = "ns";
+            entry["ops_per_second"] = r.opsPerSec;
+            if (r.itemsPerSec > 0) {
+                entry["items_per_second"] = r.itemsPerSec;
+            }
+            if (r.bytesPerSec > 0) {
+                entry["bytes_per_second"] = r.bytesPerSec;
+            }
+            entry["samples_ns"] = r.samples;
+            for (const auto& [key, value] : r.counters) {
+                entry[key] = value;
+            }
+            benchmarks.push_back(std::move(entry));
+        }
+        return {{"context", context()}, {"benchmarks", std::move(benchmarks)}};
+    }
+
+    // 按选项把 JSON 写到文件或标准输出；人类可读的摘要始终写到标准错误
+    static bool write(const Options& options, const std::vector<Result>& results) {
+        const auto doc = toJson(results).dump(2);
+        if (options.out.empty()) {
+            std::cout << doc << std::endl;
+            return true;
+        }
+        std::ofstream f(options.out);
+        f << doc << '\n';
+        return static_cast<bool>(f);
+    }
+
+private:
+    static std::string compiler() {
+#if defined(__clang__)
+        return std::string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+        return std::string("gcc ") + __VERSION__;
+#elif defined(_MSC_VER)
+        return "msvc " + std::to_string(_MSC_VER);
+#else
+        return "unknown";
+#endif
+    }
+
+    static Result runOne(const std::string& name, const Setup& setup, const Options& options) {
+        Result result;
+        result.name = name;
+        State state;
+        Body body = setup(state);
+        if (!body) {
+            result.skipReason = state.skipReason.empty() ? "setup failed" : state.skipReason;
+            return result;
+        }
+
+        // 标定：迭代次数按 10 倍增长，直到单次测量超过 minTime 的十分之一，再按比例外推
+        using Clock = std::chrono::steady_clock;
+        auto measure = [&](uint64_t iterations) {
+            state.iterations = iterations;
+            const auto start = Clock::now();
+            body(state);
+            return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        };
+        const double target = std::chrono::duration<double, std::nano>(options.minTime).count();
+        uint64_t iterations = 1;
+        double elapsed = measure(iterations);
+        while (elapsed < target / 10 && iterations < (uint64_t{1} << 40)) {
+            iterations *= 10;
+            elapsed = measure(iterations);
+        }
+        if (elapsed < target && elapsed > 0) {
+            iterations = std::max<uint64_t>(1, static_cast<uint64_t>(static_cast<double>(iterations) * target / elapsed));
+        }
+
+        for (int rep = 0; rep < options.repetitions; ++rep) {
+            result.samples.push_back(measure(iterations) / static_cast<double>(iterations));
+        }
+        auto sorted = result.samples;
+        std::sort(sorted.begin(), sorted.end());
+        result.iterations = iterations;
+        result.nsPerOp = sorted[sorted.size() / 2];
+        result.opsPerSec = result.nsPerOp > 0 ? 1e9 / result.nsPerOp : 0;
+        result.itemsPerSec = static_cast<double>(state.itemsPerOp) * result.opsPerSec;
+        result.bytesPerSec = static_cast<double>(state.bytesPerOp) * result.opsPerSec;
+        result.counters = state.counters;
+        return result;
+    }
+
+    static void report(const Result& r) {
+        if (!r.skipReason.empty()) {
+            std::fprintf(stderr, "%-56s skipped: %s\n", r.name.c_str(), r.skipReason.c_str());
+            return;
+        }
+        std::fprintf(stderr, "%-56s %14.1f ns/op %14.0f op/s %12llu it\n", r.name.c_str(), r.nsPerOp, r.opsPerSec,
+                     static_cast<unsigned long long>(r.iterations));
+    }
+
+    std::vector<std::pair<std::string, Setup>> entries_;
+};
+
+} // namespace sdb::bench
@@ -0,0 +1,733 @@
+// smartdb_bench：核心热路径的微基准
+// 用法：smartdb_bench [--filter=sqlite/] [--min-time-ms=200] [--repetitions=3] [--out=results.json]
+#include "bench_harness.hpp"
+
+#include "sdb/connection_pool.hpp"
+#include "sdb/db.hpp"
+#include "sdb/instrumented_connection.hpp"
+#include "sdb/query_stats.hpp"
+#include "sdb/sql_normalize.hpp"
+#include "sdb/tracing.hpp"
+#include "sdb/drivers/mysql_driver.hpp"
+#include "sdb/drivers/sqlite_driver.hpp"
+#include "sdb/types.hpp"
+
+#ifndef _WIN32
+#include "mysql_wire_server.hpp"
+#endif
+
+#include <spdlog/spdlog.h>
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using sdb::bench::Body;
+using sdb::bench::Registry;
+using sdb::bench::State;
+
+// 防止编译器把被测调用优化掉
+template <typename T>
+void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+std::filesystem::path tempPath(const std::string& name) {
+    return std::filesystem::temp_directory_path() / ("smartdb_bench_" + name);
+}
+
+void removeDatabaseFiles(const std::filesystem::path& path) {
+    std::error_code ec;
+    for (const char* suffix : {"", "-wal", "-shm", "-journal"}) {
+        std::filesystem::remove(path.string() + suffix, ec);
+    }
+}
+
+std::shared_ptr<sdb::drivers::SqliteConnection> openSqlite(const nlohmann::json& config, State& state) {
+    sdb::drivers::SqliteDriver driver;
+    std::shared_ptr<sdb::IConnection> conn = driver.createConnection(config);
+    auto res = conn->open();
+    if (!res) {
+        state.skipReason = res.error().message;
+        return nullptr;
+    }
+    return std::static_pointer_cast<sdb::drivers::SqliteConnection>(conn);
+}
+
+bool seedTable(sdb::IConnection& conn, int rows, State& state) {
+    auto res = conn.execute("CREATE TABLE IF NOT EXISTS kv (id INTEGER PRIMARY KEY, v TEXT, n REAL)");
+    if (res && rows > 0) {
+        res = conn.execute("WITH RECURSIVE s(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM s WHERE i < " +
+                           std::to_string(rows) + ") INSERT INTO kv SELECT i, printf('value-%08d', i), i * 0.5 FROM s");
+    }
+    if (!res) {
+        state.skipReason = res.error().message;
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------- ConnectionPool
+
+void registerPool(Registry& registry) {
+    for (int threads : {1, 2, 4, 8}) {
+        // 池容量固定为 4，8 线程时会出现等待
+        registry.add("pool/acquire_release/threads:" + std::to_string(threads), [threads](State& state) -> Body {
+            sdb::ConnectionPool::Options options;
+            options.minSize = 4;
+            options.maxSize = 4;
+            auto poolRes = sdb::ConnectionPool::createWithFactory(
+                []() -> sdb::DbResult<std::unique_ptr<sdb::IConnection>> {
+                    return sdb::DbResult<std::unique_ptr<sdb::IConnection>>::success(
+                        std::make_unique<sdb::drivers::SqliteConnection>(":memory:"));
+                },
+                options);
+            if (!poolRes) {
+                state.skipReason = poolRes.error().message;
+                return {};
+            }
+            std::shared_ptr<sdb::ConnectionPool> pool = std::move(poolRes.value());
+            return [pool, threads](State& s) {
+                const uint64_t perThread = std::max<uint64_t>(1, s.iterations / static_cast<uint64_t>(threads));
+                const auto before = pool->metrics();
+                std::vector<std::thread> workers;
+                workers.reserve(static_cast<size_t>(threads));
+                for (int t = 0; t < threads; ++t) {
+                    workers.emplace_back([&pool, perThread]() {
+                        for (uint64_t i = 0; i < perThread; ++i) {
+                            auto handle = pool->acquire();
+                            doNotOptimize(handle);
+                        }
+                    });
+                }
+                for (auto& w : workers) {
+                    w.join();
+                }
+                const auto after = pool->metrics();
+                s.counters["wait_events_per_op"] =
+                    static_cast<double>(after.waitEvents - before.waitEvents) / static_cast<double>(s.iterations);
+            };
+        });
+    }
+}
+
+// ---------------------------------------------------------------- SqliteConnection
+
+void registerSqlite(Registry& registry) {
+    registry.add("sqlite/insert/literal", [](State& state) -> Body {
+        auto conn = openSqlite({{"path", ":memory:"}}, state);
+        if (!conn || !seedTable(*conn, 0, state)) {
+            return {};
+        }
+        auto id = std::make_shared<int64_t>(0);
+        return [conn, id](State& s) {
+            for (uint64_t i = 0; i < s.iterations; ++i) {
+                const auto n = ++*id;
+                auto res = conn->execute("INSERT INTO kv VALUES (" + std::to_string(n) + ", 'value', 0.5)");
+                doNotOptimize(res);
+            }
+        };
+    });
+
+    registry.add("sqlite/insert/params", [](State& state) -> Body {
+        auto conn = openSqlite({{"path", ":memory:"}}, state);
+        if (!conn || !seedTable(*conn, 0, state)) {
+            return {};
+        }
+        auto id = std::make_shared<int64_t>(0);
+        return [conn, id](State& s) {
+            std::vector<sdb::DbValue> params(3);
+            for (uint64_t i = 0; i < s.iterations; ++i) {
+                params[0] = ++*id;
+                params[1] = std::string("value");
+                params[2] = 0.5;
+                auto res = conn->execute("INSERT INTO kv VALUES (?, ?, ?)", params);
+                doNotOptimize(res);
+            }
+        };
+    });
+
+    registry.add("sqlite/update/params", [](State& state) -> Body {
+        auto conn = openSqlite({{"path", ":memory:"}}, state);
+        if (!conn || !seedTable(*conn, 1000, state)) {
+            return {};
+        }
+        return [conn](State& s) {
+            std::vector<sdb::DbValue> params(2);
+            for (uint64_t i = 0; i < s.iterations; ++i) {
+                params[0] = std::string("updated");
+                params[1] = static_cast<int64_t>(i % 1000 + 1);
+                auto res = conn->execute("UPDATE kv SET v = ? WHERE id = ?", params);
+                doNotOptimize(res);
+            }
+        };
+    });
+
+    registry.add("sqlite/select/point_literal", [](State& state) -> Body {
+        auto conn = openSqlite({{"path", ":memory:"}}, state);
+        if (!conn || !seedTable(*conn, 1000, state)) {
+            return {};
+        }
+        return [conn](State& s) {
+            for (uint64_t i = 0; i < s.iterations; ++i) {
+                auto rs = conn->query("SELECT v FROM kv WHERE id = " + std::to_string(i % 1000 + 1));
+                if (rs && rs.value()->next()) {
+                    doNotOptimize(rs.value()->get(0));
+                }
+            }
+        };
+    });
+
+    registry.add("sqlite/select/scan_1000", [](State& state) -> Body {
+        auto conn = openSqlite({{"path", ":memory:"}}, state);
+        if (!conn || !seedTable(*conn, 1000, state)) {
+            return {};
+        }
+        state.itemsPerOp = 1000;
+        return [conn](State& s) {
+            for (uint64_t i = 0; i < s.iterations; ++i) {
+                auto rs = conn->query("SELECT id, v, n FROM kv");
+                if (!rs) {
+                    continue;
+                }
+                auto& set = *rs.value();
+                while (set.next()) {
+                    doNotOptimize(set.get(1));
+                }
+            }
+        };
+    });
+
+    // user-077：各 PRAGMA 模板在文件库上的写事务与扫描
+    for (const char* profile : {"default", "fast-durable", "bulk-load"}) {
+        registry.add(std::string("sqlite/profile/") + profile + "/insert_txn100", [profile](State& state) -> Body {
+            const auto path = tempPath(std::string("profile_") + profile + ".db");
+            removeDatabaseFiles(path);
+            nlohmann::json config = {{"path", path.string()}};
+            if (std::string(profile) != "default") {
+                config["sqlite"] = {{"profile", profile}};
+            }
+            auto conn = openSqlite(config, state);
+            if (!conn || !seedTable(*conn, 0, state)) {
+                return {};
+            }
+            state.itemsPerOp = 100;
+            auto id = std::make_shared<int64_t>(0);
+            std::shared_ptr<void> cleanup(nullptr, [path](void*) { removeDatabaseFiles(path); });
+            return [conn, id, cleanup](State& s) {
+                std::vector<sdb::DbValue> params(3);
+                for (uint64_t i = 0; i < s.iterations; ++i) {
+                    (void)conn->begin();
+                    for (int r = 0; r < 100; ++r) {
+                        params[0] = ++*id;
+                        params[1] = std::string("value");
+                        params[2] = 0.5;
+                        (void)conn->execute("INSERT INTO kv VALUES (?, ?, ?)", params);
+                    }
+                    (void)conn->commit();
+                }
+            };
+        });
+    }
+
+    for (const char* profile : {"default", "read-only-analytics"}) {
+        registry.add(std::string("sqlite/profile/") + profile + "/aggregate_10000", [profile](State& state) -> Body {
+            const auto path = tempPath(std::string("analytics_") + profile + ".db");
+            removeDatabaseFiles(path);
+            {
+                auto writer = openSqlite({{"path", path.string()}}, state);
+                if (!writer || !seedTable(*writer, 10000, state)) {
+                    return {};
+                }
+            }
+            nlohmann::json config = {{"path", path.string()}};
+            if (std::string(profile) != "default") {
+                config["sqlite"] = {{"profile", profile}};
+            }
+            auto conn = openSqlite(config, state);
+            if (!conn) {
+                return {};
+            }
+            state.itemsPerOp = 10000;
+            std::shared_ptr<void> cleanup(nullptr, [path](void*) { removeDatabaseFiles(path); });
+            return [conn, cleanup](State& s) {
+                for (uint64_t i = 0; i < s.iterations; ++i) {
+                    auto rs = conn->query("SELECT count(*), sum(n), max(length(v)) FROM kv");
+                    if (rs && rs.value()->next()) {
+                        doNotOptimize(rs.value()->get(1));
+                    }
+                }
+            };
+        });
+    }
+
+    // user-078：NOMUTEX 对单条语句与打开/关闭开销的影响
+    for (bool noMutex : {false, true}) {
+        const std::string mode = noMutex ? "nomutex" : "serialized";
+        registry.add("sqlite/open_mode/" + mode + "/select_point", [noMutex](State& state) -> Body {
+            auto conn = openSqlite({{"path", ":memory:"}, {"sqlite", {{"nomutex", noMutex}}}}, state);
+            if (!conn || !seedTable(*conn, 1000, state)) {
+                return {};
+            }
+            return [conn](State& s) {
+                for (uint64_t i = 0; i < s.iterations; ++i) {
+                    auto rs = conn->query("SELECT v FROM kv WHERE id = " + std::to_string(i % 1000 + 1));
+                    if (rs && rs.value()->next()) {
+                        doNotOptimize(rs.value()->get(0));
+                    }
+                }
+            };
+        });
+        registry.add("sqlite/open_mode/" + mode + "/open_close", [noMutex](State& state) -> Body {
+            const nlohmann::json config = {{"path", ":memory:"}, {"sqlite", {{"nomutex", noMutex}}}};
+            return [config](State& s) {
+                sdb::drivers::SqliteDriver driver;
+                for (uint64_t i = 0; i < s.iterations; ++i) {
+                    auto conn = driver.createConnection(config);
+                    auto res = conn->open();
+                    doNotOptimize(res);
+                    conn->close();
+                }
+            };
+        });
+    }
+}
+
+// ---------------------------------------------------------------- SqliteResultSet::get
+
+void registerResultSet(Registry& registry) {
+    struct Column {
+        const char* name;
+        int index;
+    };
+    static const Column columns[] = {{"int64", 0}, {"double", 1}, {"text", 2}, {"blob", 3}, {"null", 4}};
+    for (const auto& column : columns) {
+        const int index = column.index;
+        registry.add(std::string("resultset/get/") + column.name, [index](State& state) -> Body {
+            auto conn = openSqlite({{"path", ":memory:"}}, state);
+            if (!conn) {
+                return {};
+            }
+            auto rsRes = conn->query("SELECT 42, 3.5, 'a text value of 32 bytes........', zeroblob(64), NULL");
+            if (!rsRes || !rsRes.value()->next()) {
+                state.skipReason = rsRes ? "empty result" : rsRes.error().message;
+                return {};
+            }
+            auto rs = rsRes.value();
+            return [conn, rs, index](State& s) {
+                for (uint64_t i = 0; i < s.iterations; ++i) {
+                    auto v = rs->get(index);
+                    doNotOptimize(v);
+                }
+            };
+        });
+    }
+
+    registry.add("resultset/get/by_name", [](State& state) -> Body {
+        auto conn = openSqlite({{"path", ":memory:"}}, state);
+        if (!conn) {
+            return {};
+        }
+        auto rsRes = conn->query("SELECT 1 AS id, 2 AS a, 3 AS b, 4 AS c, 5 AS payload");
+        if (!rsRes || !rsRes.value()->next()) {
+            state.skipReason = rsRes ? "empty result" : rsRes.error().message;
+            return {};
+        }
+        auto rs = rsRes.value();
+        return [conn, rs](State& s) {
+            const std::string name = "payload";
+            for (uint64_t i = 0; i < s.iterations; ++i) {
+                auto v = rs->get(name);
+                doNotOptimize(v);
+            }
+        };
+    });
+}
+
+// ---------------------------------------------------------------- DbValue
+
+void registerDbValue(Registry& registry) {
+    const std::vector<std::pair<std::string, sdb::DbValue>> values = {
+        {"null", std::monostate{}},
+        {"int", 42},
+        {"int64", int64_t{1} << 40},
+        {"double", 3.14159},
+        {"bool", true},
+        {"text", std::string("a text value of 32 bytes........")},
+        {"blob", std::vector<uint8_t>(64, 0x5a)},
+    };
+    for (const auto& [name, value] : values) {
+        registry.add("dbvalue/toString/" + name, [value = value](State&) -> Body {
+            return [value](State& s) {
+                for (uint64_t i = 0; i < s.iterations; ++i) {
+                    auto text = sdb::toString(value);
+                    doNotOptimize(text);
+                }
+            };
+        });
+    }
+    registry.add("dbvalue/copy/text", [](State&) -> Body {
+        const sdb::DbValue value = std::string("a text value of 32 bytes........");
+        return [value](State& s) {
+            for (uint64_t i = 0; i < s.iterations; ++i) {
+                sdb::DbValue copy = value;
+                doNotOptimize(copy);
+            }
+        };
+    });
+}
+
+// ---------------------------------------------------------------- DatabaseManager
+
+void registerManager(Registry& registry) {
+    registry.add("manager/createPool/cached", [](State& state) -> Body {
+        const auto path = tempPath("manager_config.json");
+        {
+            std::ofstream f(path);
+            f << R"({"connections": {"bench": {"driver": "sqlite", "path": ":memory:"}}})";
+        }
+        auto manager = std::make_shared<sdb::DatabaseManager>();
+        (void)manager->registerDriver(std::make_shared<sdb::drivers::SqliteDriver>());
+        auto loadRes = manager->loadConfig(path.string());
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        if (!loadRes) {
+            state.skipReason = loadRes.error().message;
+            return {};
+        }
+        auto first = manager->createPool("bench");
+        if (!first) {
+            state.skipReason = first.error().message;
+            return {};
+        }
+        return [manager](State& s) {
+            for (uint64_t i = 0; i < s.iterations; ++i) {
+                auto pool = manager->createPool("bench");
+                doNotOptimize(pool);
+            }
+        };
+    });
+
+    registry.add("manager/createPoolRaw/cached", [](State& state) -> Body {
+        auto manager = std::make_shared<sdb::DatabaseManager>();
+        (void)manager->registerDriver(std::make_shared<sdb::drivers::SqliteDriver>());
+        const nlohmann::json config = {{"path", ":memory:"}, {"sqlite", {{"profile", "fast-durable"}}}};
+        auto first = manager->createPoolRaw("sqlite", config);
+        if (!first) {
+            state.skipReason = first.error().message;
+            return {};
+        }
+        return [manager, config](State& s) {
+            for (uint64_t i = 0; i < s.iterations; ++i) {
+                auto pool = manager->createPoolRaw("sqlite", config);
+                doNotOptimize(pool);
+            }
+        };
+    });
+}
+
+// ---------------------------------------------------------------- QueryStats
+
+// user-094：单次 record 的开销。100k 次/秒时每次调用约 10 µs，1% 的预算即 100 ns（含两次取时钟）
+void registerQueryStats(Registry& registry) {
+    registry.add("querystats/record/repeated_sql", [](State&) -> Body {
+        auto stats = std::make_shared<sdb::QueryStats>();
+        const std::string sql = "SELECT field0 FROM usertable WHERE ycsb_key = ?";
+        return [stats, sql](State& s) {
+            for (uint64_t i = 0; i < s.iterations; ++i) {
+                const auto start = std::chrono::steady_clock::now();
+                stats->record(sql, std::chrono::steady_clock::now() - start, 1, 100);
+            }
+        };
+    });
+
+    // 反复执行的同一条字面量 SQL：命中线程本地的最近字面量 SQL 缓存，不再规范化
+    registry.add("querystats/record/repeated_literal_sql", [](State&) -> Body {
+        auto stats = std::make_shared<sdb::QueryStats>();
+        const std::string sql = "SELECT field0 FROM usertable WHERE ycsb_key = 'user4711'";
+        return [stats, sql](State& s) {
+            for (uint64_t i = 0; i < s.iterations; ++i) {
+                stats->record(sql, std::chrono::microseconds(10), 1, 100);
+            }
+        };
+    });
+
+    registry.add("querystats/record/inlined_literals", [](State&) -> Body {
+        auto stats = std::make_shared<sdb::QueryStats>();
+        std::vector<std::string> sqls;
+        for (int i = 0; i < 4096; ++i) {
+            sqls.push_back("SELECT field0 FROM usertable WHERE ycsb_key = 'user" + std::to_string(i * 7919) + "'");
+        }
+        return [stats, sqls](State& s) {
+            for (uint64_t i = 0; i < s.iterations; ++i) {
+                stats->record(sqls[i % sqls.size()], std::chrono::microseconds(10), 1, 100);
+            }
+        };
+    });
+
+    for (bool instrumented : {false, true}) {
+        registry.add(std::string("querystats/sqlite_point_select/") + (instrumented ? "recorded" : "plain"),
+                     [instrumented](State& state) -> Body {
+                         auto conn = openSqlite({{"path", ":memory:"}}, state);
+                         if (!conn || !seedTable(*conn, 1000, state)) {
+                             return {};
+                         }
+                         auto stats = std::make_shared<sdb::QueryStats>();
+                         return [conn, stats, instrumented](State& s) {
+                             const std::string sql = "SELECT v FROM kv WHERE id = 500";
+                             for (uint64_t i = 0; i < s.iterations; ++i) {
+                                 const auto start = std::chrono::steady_clock::now();
+                                 uint64_t rows = 0;
+                                 auto rs = conn->query(sql);
+                                 if (rs) {
+                                     while (rs.value()->next()) {
+                                         ++rows;
+                                     }
+                                 }
+                                 if (instrumented) {
+                                     stats->record(sql, std::chrono::steady_clock::now() - start, rows, 0);
+                                 }
+                             }
+                         };
+                     });
+    }
+}
+
+// user-100：规范化与指纹在语句统计未命中原始 SQL 缓存时运行，目标每秒数百万条
+void registerSqlNormalize(Registry& registry) {
+    const std::vector<std::pair<std::string, std::string>> statements = {
+        {"point_select", "SELECT field0 FROM usertable WHERE ycsb_key = 'user4711'"},
+        {"in_list", "SELECT id, name FROM users WHERE id IN (1, 2, 3, 4, 5, 6, 7, 8, 9, 10) AND status = 'active'"},
+        {"multi_row_insert", "INSERT INTO kv (id, v) VALUES (1, 'a'), (2, 'b'), (3, 'c'), (4, 'd')"},
+    };
+    for (const auto& [name, sql] : statements) {
+        registry.add("sqlnormalize/normalize/" + name, [sql = sql](State&) -> Body {
+            return [sql](State& s) {
+                sdb::SqlNormalizer normalizer;
+                for (uint64_t i = 0; i < s.iterations; ++i) {
+                    auto text = normalizer.normalize(sql);
+                    doNotOptimize(text);
+                }
+            };
+        });
+        registry.add("sqlnormalize/fingerprint/" + name, [sql = sql](State&) -> Body {
+            return [sql](State& s) {
+                for (uint64_t i = 0; i < s.iterations; ++i) {
+                    auto fingerprint = sdb::sqlFingerprint(sql);
+                    doNotOptimize(fingerprint);
+                }
+            };
+        });
+    }
+}
+
+// user-099：InstrumentedConnection 默认只量墙钟；开启阶段计时后每次阶段切换多一次线程 CPU 时钟读取
+void registerPhaseTiming(Registry& registry) {
+    for (bool phased : {false, true}) {
+        registry.add(std::string("instrumented/sqlite_point_select/") + (phased ? "phases" : "wall"),
+                     [phased](State& state) -> Body {
+                         sdb::drivers::SqliteDriver driver;
+                         auto instrumentation = std::make_shared<sdb::ConnectionInstrumentation>("bench");
+                         instrumentation->setPhaseTiming(phased);
+                         auto conn = std::make_shared<sdb::InstrumentedConnection>(
+                             driver.createConnection({{"path", ":memory:"}}), instrumentation);
+                         auto openRes = conn->open();
+                         if (!openRes) {
+                             state.skipReason = openRes.error().message;
+                             return {};
+                         }
+                         if (!seedTable(*conn, 1000, state)) {
+                             return {};
+                         }
+                         return [conn](State& s) {
+                             for (uint64_t i = 0; i < s.iterations; ++i) {
+                                 auto rs = conn->query("SELECT v FROM kv WHERE id = 500");
+                                 if (rs) {
+                                     while (rs.value()->next()) {
+                                         doNotOptimize(rs.value()->get(0));
+                                     }
+                                 }
+                             }
+                         };
+                     });
+    }
+}
+
+// ---------------------------------------------------------------- Tracing
+
+// user-096：未启用时 span 只是一次原子读；启用后每个 span 一次加锁追加。缓冲区设上限，超出后走丢弃路径
+void registerTracing(Registry& registry) {
+    for (bool enabled : {false, true}) {
+        const std::string suffix = enabled ? "enabled" : "disabled";
+        registry.add("tracing/span/" + suffix, [enabled](State&) -> Body {
+            return [enabled](State& s) {
+                if (enabled) {
+                    sdb::Tracer::Options options;
+                    options.maxEvents = 1 << 16;
+                    sdb::Tracer::global().start(options);
+                }
+                for (uint64_t i = 0; i < s.iterations; ++i) {
+                    sdb::TraceSpan span("bench.span", "bench");
+                    doNotOptimize(span);
+                }
+                if (enabled) {
+                    (void)sdb::Tracer::global().stop();
+                }
+            };
+        });
+
+        registry.add("tracing/sqlite_point_select/" + suffix, [enabled](State& state) -> Body {
+            auto conn = openSqlite({{"path", ":memory:"}}, state);
+            if (!conn || !seedTable(*conn, 1000, state)) {
+                return {};
+            }
+            return [conn, enabled](State& s) {
+                if (enabled) {
+                    sdb::Tracer::Options options;
+                    options.maxEvents = 1 << 16;
+                    sdb::Tracer::global().start(options);
+                }
+                for (uint64_t i = 0; i < s.iterations; ++i) {
+                    auto rs = conn->query("SELECT v FROM kv WHERE id = 500");
+                    if (rs) {
+                        while (rs.value()->next()) {
+                        }
+                    }
+                }
+                if (enabled) {
+                    (void)sdb::Tracer::global().stop();
+                }
+            };
+        });
+    }
+}
+
+// ---------------------------------------------------------------- MySQL（线协议替身）
+
+#ifndef _WIN32
+// user-088：TCP 与 Unix 套接字的往返开销，结果行数可调。替身不支持协议压缩，压缩收益需对真实服务器测量
+void registerMysqlFixture(Registry& registry) {
+    for (bool unixSocket : {false, true}) {
+        const std::string transport = unixSocket ? "unix" : "tcp";
+        struct Case {
+            const char* name;
+            const char* sql;
+            uint64_t rows;
+        };
+        static const Case cases[] = {{"select_1", "SELECT 1", 1}, {"rows_1000", "SELECT * FROM wide", 1000}};
+        for (const auto& c : cases) {
+            registry.add("mysql/fixture/" + transport + "/" + c.name, [unixSocket, c](State& state) -> Body {
+                sdb::test::MysqlWireServer::Options options;
+                options.rows = c.rows;
+                options.columns = 4;
+                options.valueBytes = 32;
+                if (unixSocket) {
+                    options.unixSocket = tempPath("mysql_fixture.sock").string();
+                }
+                auto server = std::make_shared<sdb::test::MysqlWireServer>(options);
+                if (!server->start()) {
+                    state.skipReason = "fixture failed to start";
+                    return {};
+                }
+                auto config = server->connectionConfig<nlohmann::json>();
+                if (unixSocket) {
+                    config["mysql"] = {{"unix_socket", server->unixSocket()}};
+                }
+                sdb::drivers::MysqlDriver driver;
+                std::shared_ptr<sdb::IConnection> conn = driver.createConnection(config);
+                auto openRes = conn->open();
+                if (!openRes) {
+                    state.skipReason = "MySQL client cannot reach the fixture: " + openRes.error().message;
+                    return {};
+                }
+                state.itemsPerOp = c.rows;
+                const std::string sql = c.sql;
+                return [server, conn, sql](State& s) {
+                    for (uint64_t i = 0; i < s.iterations; ++i) {
+                        auto rs = conn->query(sql);
+                        if (!rs) {
+                            continue;
+                        }
+                        while (rs.value()->next()) {
+                            doNotOptimize(rs.value()->get(1));
+                        }
+                    }
+                };
+            });
+        }
+
+        registry.add("mysql/fixture/" + transport + "/execute_params", [unixSocket](State& state) -> Body {
+            sdb::test::MysqlWireServer::Options options;
+            if (unixSocket) {
+                options.unixSocket = tempPath("mysql_fixture.sock").string();
+            }
+            auto server = std::make_shared<sdb::test::MysqlWireServer>(options);
+            if (!server->start()) {
+                state.skipReason = "fixture failed to start";
+                return {};
+            }
+            auto config = server->connectionConfig<nlohmann::json>();
+            if (unixSocket) {
+                config["mysql"] = {{"unix_socket", server->unixSocket()}};
+            }
+            sdb::drivers::MysqlDriver driver;
+            std::shared_ptr<sdb::IConnection> conn = driver.createConnection(config);
+            auto openRes = conn->open();
+            if (!openRes) {
+                state.skipReason = "MySQL client cannot reach the fixture: " + openRes.error().message;
+                return {};
+            }
+            return [server, conn](State& s) {
+                std::vector<sdb::DbValue> params(3);
+                for (uint64_t i = 0; i < s.iterations; ++i) {
+                    params[0] = static_cast<int64_t>(i);
+                    params[1] = std::string("value");
+                    params[2] = 0.5;
+                    auto res = conn->execute("INSERT INTO kv VALUES (?, ?, ?)", params);
+                    doNotOptimize(res);
+                }
+            };
+        });
+    }
+}
+#endif
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const auto options = Registry::parseArgs(argc, argv);
+    spdlog::set_level(spdlog::level::warn);
+
+    Registry registry;
+    registerPool(registry);
+    registerSqlite(registry);
+    registerResultSet(registry);
+    registerDbValue(registry);
+    registerManager(registry);
+    registerQueryStats(registry);
+    registerSqlNormalize(registry);
+    registerPhaseTiming(registry);
+    registerTracing(registry);
+#ifndef _WIN32
+    registerMysqlFixture(registry);
+#endif
+
+    if (options.list) {
+        for (const auto& entry : registry.entries()) {
+            std::cout << entry.first << '\n';
+        }
+        return 0;
+    }
+    const auto results = registry.run(options);
+    return Registry::write(options, results) ? 0 : 1;
+}
@@ -0,0 +1,432 @@
+// smartdb_load：YCSB 风格的负载生成器，通过连接池对 db_config.json 中的任意连接施压
+// 用法：smartdb_load --connection=file_db --workload=read-heavy --threads=8 --distribution=zipfian
+//                   --records=100000 --warmup=2 --duration=10 [--out=load.json] [--trace=trace.json]
+#include "bench_harness.hpp"
+#include "load_workload.hpp"
+
+#include "sdb/connection_pool.hpp"
+#include "sdb/db.hpp"
+#include "sdb/tracing.hpp"
+#include "sdb/drivers/mysql_driver.hpp"
+#include "sdb/drivers/sqlite_driver.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using sdb::bench::KeyChooser;
+using sdb::bench::kLoadOpCount;
+using sdb::bench::LatencyHistogram;
+using sdb::bench::LoadOp;
+using sdb::bench::WorkloadMix;
+
+struct LoadOptions {
+    std::string config = "db_config.json";
+    std::string connection = "file_db";
+    std::string workload = "read-heavy";
+    std::string distribution = "zipfian";
+    std::string table = "usertable";
+    int threads = 4;
+    uint64_t records = 10000;
+    uint64_t scanLength = 100;
+    size_t valueBytes = 100;
+    double warmupSeconds = 2;
+    double durationSeconds = 10;
+    bool reload = false;
+    std::string out;
+    // 非空时在测量期间收集 span，结束后写出 Chrome trace-event JSON
+    std::string trace;
+};
+
+[[noreturn]] void usage(const char* argv0, int code) {
+    std::cerr << "usage: " << argv0
+              << " [--config=db_config.json] [--connection=file_db] [--table=usertable]\n"
+                 "       [--workload=read-heavy|update-heavy|read-only|scan|insert-only]\n"
+                 "       [--distribution=zipfian|uniform] [--threads=4] [--records=10000]\n"
+                 "       [--scan-length=100] [--value-bytes=100] [--warmup=2] [--duration=10]\n"
+                 "       [--reload] [--out=load.json] [--trace=trace.json]\n";
+    std::exit(code);
+}
+
+LoadOptions parseArgs(int argc, char** argv) {
+    LoadOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--help") {
+            usage(argv[0], 0);
+        }
+        if (arg == "--reload") {
+            options.reload = true;
+            continue;
+        }
+        const auto eq = arg.find('=');
+        if (arg.rfind("--", 0) != 0 || eq == std::string::npos) {
+            usage(argv[0], 2);
+        }
+        const std::string key = arg.substr(2, eq - 2);
+        const std::string value = arg.substr(eq + 1);
+        try {
+            if (key == "config") {
+                options.config = value;
+            } else if (key == "connection") {
+                options.connection = value;
+            } else if (key == "workload") {
+                options.workload = value;
+            } else if (key == "distribution") {
+                options.distribution = value;
+            } else if (key == "table") {
+                options.table = value;
+            } else if (key == "threads") {
+                options.threads = std::max(1, std::stoi(value));
+            } else if (key == "records") {
+                options.records = std::max<uint64_t>(1, std::stoull(value));
+            } else if (key == "scan-length") {
+                options.scanLength = std::max<uint64_t>(1, std::stoull(value));
+            } else if (key == "value-bytes") {
+                options.valueBytes = std::stoul(value);
+            } else if (key == "warmup") {
+                options.warmupSeconds = std::stod(value);
+            } else if (key == "duration") {
+                options.durationSeconds = std::stod(value);
+            } else if (key == "out") {
+                options.out = value;
+            } else if (key == "trace") {
+                options.trace = value;
+            } else {
+                usage(argv[0], 2);
+            }
+        } catch (const std::exception&) {
+            usage(argv[0], 2);
+        }
+    }
+    return options;
+}
+
+// 键按编号补零，scan 的范围顺序与编号一致
+std::string keyFor(uint64_t id) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "user%012llu", static_cast<unsigned long long>(id));
+    return buf;
+}
+
+struct ThreadStats {
+    std::array<LatencyHistogram, kLoadOpCount> latency;
+    std::array<uint64_t, kLoadOpCount> errors{};
+    uint64_t rows = 0;
+};
+
+class LoadRunner {
+public:
+    LoadRunner(LoadOptions options, WorkloadMix mix, std::shared_ptr<sdb::ConnectionPool> pool)
+        : options_(std::move(options)), mix_(std::move(mix)), pool_(std::move(pool)),
+          keys_(options_.distribution == "uniform" ? KeyChooser::Distribution::Uniform
+                                                   : KeyChooser::Distribution::Zipfian,
+                options_.records),
+          value_(options_.valueBytes, 'v') {}
+
+    // 建表并补齐到 records 行；--reload 时先删表
+    sdb::DbResult<void> prepare() {
+        auto handleRes = pool_->acquire();
+        if (!handleRes) {
+            return sdb::DbResult<void>::failure(handleRes.error().message, handleRes.error().code);
+        }
+        auto& conn = *handleRes.value();
+        if (options_.reload) {
+            auto res = conn.execute("DROP TABLE IF EXISTS " + options_.table);
+            if (!res) {
+                return sdb::DbResult<void>::failure(res.error().message, res.error().code);
+            }
+        }
+        auto res = conn.execute("CREATE TABLE IF NOT EXISTS " + options_.table +
+                                " (ycsb_key VARCHAR(64) PRIMARY KEY, field0 VARCHAR(4096))");
+        if (!res) {
+            return sdb::DbResult<void>::failure(res.error().message, res.error().code);
+        }
+        uint64_t existing = 0;
+        auto countRes = conn.query("SELECT COUNT(*) FROM " + options_.table);
+        if (countRes && countRes.value()->next()) {
+            const auto v = countRes.value()->get(0);
+            if (const auto* n = std::get_if<int64_t>(&v)) {
+                existing = static_cast<uint64_t>(*n);
+            }
+        }
+        if (existing < options_.records) {
+            std::cerr << "loading " << (options_.records - existing) << " records into " << options_.table << "\n";
+        }
+        const std::string insert = "INSERT INTO " + options_.table + " (ycsb_key, field0) VALUES (?, ?)";
+        std::vector<sdb::DbValue> params(2);
+        for (uint64_t id = existing; id < options_.records;) {
+            auto txn = sdb::TransactionGuard::begin(conn);
+            if (!txn) {
+                return sdb::DbResult<void>::failure(txn.error().message, txn.error().code);
+            }
+            for (const uint64_t end = std::min(options_.records, id + 1000); id < end; ++id) {
+                params[0] = keyFor(id);
+                params[1] = value_;
+                auto insRes = conn.execute(insert, params);
+                if (!insRes) {
+                    return sdb::DbResult<void>::failure(insRes.error().message, insRes.error().code);
+                }
+            }
+            auto commitRes = txn.value().commit();
+            if (!commitRes) {
+                return commitRes;
+            }
+        }
+        nextInsert_ = std::max(existing, options_.records);
+        return sdb::DbResult<void>::success();
+    }
+
+    nlohmann::json run() {
+        using Clock = std::chrono::steady_clock;
+        std::vector<ThreadStats> stats(static_cast<size_t>(options_.threads));
+        std::vector<std::thread> workers;
+        const auto start = Clock::now();
+        const auto measureStart = start + toDuration(options_.warmupSeconds);
+        const auto end = measureStart + toDuration(options_.durationSeconds);
+        for (int t = 0; t < options_.threads; ++t) {
+            workers.emplace_back([this, t, measureStart, end, &stats]() {
+                std::mt19937_64 rng(0x5eed + static_cast<uint64_t>(t));
+                std::uniform_real_distribution<double> uniform(0.0, 1.0);
+                auto& local = stats[static_cast<size_t>(t)];
+                for (;;) {
+                    const auto opStart = Clock::now();
+                    if (opStart >= end) {
+                        break;
+                    }
+                    const LoadOp op = mix_.choose(uniform(rng));
+                    uint64_t rows = 0;
+                    const bool ok = execute(op, rng, rows);
+                    if (opStart < measureStart) {
+                        continue;
+                    }
+                    const auto idx = static_cast<size_t>(op);
+                    if (!ok) {
+                        ++local.errors[idx];
+                        continue;
+                    }
+                    local.latency[idx].record(static_cast<uint64_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - opStart).count()));
+                    local.rows += rows;
+                }
+            });
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+        const double elapsed = std::chrono::duration<double>(Clock::now() - measureStart).count();
+        return report(stats, elapsed);
+    }
+
+private:
+    static std::chrono::steady_clock::duration toDuration(double seconds) {
+        return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+    }
+
+    // 每个操作都经由连接池取还连接，延迟包含池等待
+    bool execute(LoadOp op, std::mt19937_64& rng, uint64_t& rows) {
+        sdb::TraceSpan span(sdb::bench::loadOpName(op), "load");
+        auto handleRes = pool_->acquire();
+        if (!handleRes) {
+            return false;
+        }
+        auto& conn = *handleRes.value();
+        switch (op) {
+            case LoadOp::Read: {
+                auto rs = conn.query("SELECT field0 FROM " + options_.table + " WHERE ycsb_key = '" +
+                                     keyFor(keys_.next(rng)) + "'");
+                if (!rs) {
+                    return false;
+                }
+                while (rs.value()->next()) {
+                    ++rows;
+                }
+                return true;
+            }
+            case LoadOp::Update: {
+                std::vector<sdb::DbValue> params{value_, keyFor(keys_.next(rng))};
+                return static_cast<bool>(
+                    conn.execute("UPDATE " + options_.table + " SET field0 = ? WHERE ycsb_key = ?", params));
+            }
+            case LoadOp::Insert: {
+                std::vector<sdb::DbValue> params{keyFor(nextInsert_.fetch_add(1)), value_};
+                return static_cast<bool>(
+                    conn.execute("INSERT INTO " + options_.table + " (ycsb_key, field0) VALUES (?, ?)", params));
+            }
+            case LoadOp::Scan: {
+                const uint64_t length = 1 + rng() % options_.scanLength;
+                auto rs = conn.query("SELECT ycsb_key, field0 FROM " + options_.table + " WHERE ycsb_key >= '" +
+                                     keyFor(keys_.next(rng)) + "' ORDER BY ycsb_key LIMIT " + std::to_string(length));
+                if (!rs) {
+                    return false;
+                }
+                while (rs.value()->next()) {
+                    ++rows;
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    nlohmann::json report(const std::vector<ThreadStats>& stats, double elapsed) const {
+        nlohmann::json ops = nlohmann::json::object();
+        LatencyHistogram total;
+        uint64_t totalErrors = 0;
+        uint64_t totalRows = 0;
+        for (size_t i = 0; i < kLoadOpCount; ++i) {
+            LatencyHistogram merged;
+            uint64_t errors = 0;
+            for (const auto& s : stats) {
+                merged.merge(s.latency[i]);
+                errors += s.errors[i];
+            }
+            total.merge(merged);
+            totalErrors += errors;
+            if (merged.count() == 0 && errors == 0) {
+                continue;
+            }
+            ops[sdb::bench::loadOpName(static_cast<LoadOp>(i))] = summarize(merged, errors, elapsed);
+        }
+        for (const auto& s : stats) {
+            totalRows += s.rows;
+        }
+        const auto poolMetrics = pool_->metrics();
+        return {
+            {"elapsed_seconds", elapsed},
+            {"operations", summarize(total, totalErrors, elapsed)},
+            {"by_operation", std::move(ops)},
+            {"rows_read", totalRows},
+            {"pool",
+             {{"acquire_successes", poolMetrics.acquireSuccesses},
+              {"acquire_timeouts", poolMetrics.acquireTimeouts},
+              {"wait_events", poolMetrics.waitEvents},
+              {"average_acquire_wait_us", poolMetrics.averageAcquireWaitMicros}}},
+        };
+    }
+
+    static nlohmann::json summarize(const LatencyHistogram& h, uint64_t errors, double elapsed) {
+        auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+        return {
+            {"count", h.count()},
+            {"errors", errors},
+            {"ops_per_second", elapsed > 0 ? static_cast<double>(h.count()) / elapsed : 0},
+            {"latency_us",
+             {{"mean", h.mean() / 1000.0},
+              {"p50", us(h.percentile(0.50))},
+              {"p90", us(h.percentile(0.90))},
+              {"p95", us(h.percentile(0.95))},
+              {"p99", us(h.percentile(0.99))},
+              {"p999", us(h.percentile(0.999))},
+              {"max", us(h.max())}}},
+        };
+    }
+
+    LoadOptions options_;
+    WorkloadMix mix_;
+    std::shared_ptr<sdb::ConnectionPool> pool_;
+    KeyChooser keys_;
+    std::string value_;
+    std::atomic<uint64_t> nextInsert_{0};
+};
+
+void printSummary(const nlohmann::json& result) {
+    std::fprintf(stderr, "%-10s %12s %10s %12s %10s %10s %10s %10s\n", "op", "count", "errors", "ops/s", "p50 us",
+                 "p99 us", "p999 us", "max us");
+    auto line = [](const std::string& name, const nlohmann::json& s) {
+        const auto& l = s["latency_us"];
+        std::fprintf(stderr, "%-10s %12llu %10llu %12.0f %10.1f %10.1f %10.1f %10.1f\n", name.c_str(),
+                     s["count"].get<unsigned long long>(), s["errors"].get<unsigned long long>(),
+                     s["ops_per_second"].get<double>(), l["p50"].get<double>(), l["p99"].get<double>(),
+                     l["p999"].get<double>(), l["max"].get<double>());
+    };
+    for (const auto& [name, s] : result["by_operation"].items()) {
+        line(name, s);
+    }
+    line("total", result["operations"]);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const auto options = parseArgs(argc, argv);
+    spdlog::set_level(spdlog::level::warn);
+
+    const auto mix = WorkloadMix::named(options.workload);
+    if (!mix) {
+        std::cerr << "unknown workload: " << options.workload << "\n";
+        return 2;
+    }
+    if (options.distribution != "zipfian" && options.distribution != "uniform") {
+        std::cerr << "unknown distribution: " << options.distribution << "\n";
+        return 2;
+    }
+
+    sdb::DatabaseManager manager;
+    (void)manager.registerDriver(std::make_shared<sdb::drivers::SqliteDriver>());
+    (void)manager.registerDriver(std::make_shared<sdb::drivers::MysqlDriver>());
+    auto loadRes = manager.loadConfig(options.config);
+    if (!loadRes) {
+        std::cerr << loadRes.error().message << "\n";
+        return 1;
+    }
+
+    sdb::ConnectionPool::Options poolOptions;
+    poolOptions.maxSize = static_cast<size_t>(options.threads);
+    auto poolRes = manager.createPool(options.connection, poolOptions);
+    if (!poolRes) {
+        std::cerr << poolRes.error().message << "\n";
+        return 1;
+    }
+
+    LoadRunner runner(options, *mix, poolRes.value());
+    auto prepRes = runner.prepare();
+    if (!prepRes) {
+        std::cerr << "prepare failed: " << prepRes.error().message << "\n";
+        return 1;
+    }
+
+    if (!options.trace.empty()) {
+        sdb::Tracer::Options traceOptions;
+        traceOptions.path = options.trace;
+        sdb::Tracer::global().start(traceOptions);
+    }
+    auto result = runner.run();
+    if (!options.trace.empty()) {
+        auto traceRes = sdb::Tracer::global().stop();
+        if (!traceRes) {
+            std::cerr << traceRes.error().message << "\n";
+        }
+        result["trace"] = {{"path", options.trace}, {"dropped_spans", sdb::Tracer::global().droppedEvents()}};
+    }
+    auto context = sdb::bench::Registry::context();
+    context["connection"] = options.connection;
+    context["workload"] = options.workload;
+    context["distribution"] = options.distribution;
+    context["threads"] = options.threads;
+    context["records"] = options.records;
+    context["warmup_seconds"] = options.warmupSeconds;
+    context["duration_seconds"] = options.durationSeconds;
+    result["context"] = std::move(context);
+
+    printSummary(result);
+    const auto doc = result.dump(2);
+    if (options.out.empty()) {
+        std::cout << doc << std::endl;
+        return 0;
+    }
+    std::ofstream f(options.out);
+    f << doc << '\n';
+    return f ? 0 : 1;
+}
@@ -0,0 +1,216 @@
+#pragma once
+// smartdb_load 的工作负载组件：YCSB 风格的操作比例、键分布与延迟直方图
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <string>
+
+namespace sdb::bench {
+
+enum class LoadOp { Read = 0, Update, Insert, Scan };
+constexpr size_t kLoadOpCount = 4;
+
+inline const char* loadOpName(LoadOp op) {
+    switch (op) {
+        case LoadOp::Read: return "read";
+        case LoadOp::Update: return "update";
+        case LoadOp::Insert: return "insert";
+        case LoadOp::Scan: return "scan";
+    }
+    return "unknown";
+}
+
+// 操作比例，与 YCSB core workloads 对应：A = update-heavy，B = read-heavy，C = read-only，E = scan
+struct WorkloadMix {
+    std::string name;
+    std::array<double, kLoadOpCount> proportions{};
+
+    static std::optional<WorkloadMix> named(const std::string& name) {
+        WorkloadMix mix;
+        mix.name = name;
+        if (name == "read-heavy") {
+            mix.proportions = {0.95, 0.05, 0, 0};
+        } else if (name == "update-heavy") {
+            mix.proportions = {0.5, 0.5, 0, 0};
+        } else if (name == "read-only") {
+            mix.proportions = {1, 0, 0, 0};
+        } else if (name == "scan") {
+            mix.proportions = {0, 0, 0.05, 0.95};
+        } else if (name == "insert-only") {
+            mix.proportions = {0, 0, 1, 0};
+        } else {
+            return std::nullopt;
+        }
+        return mix;
+    }
+
+    LoadOp choose(double u) const {
+        double acc = 0;
+        for (size_t i = 0; i < kLoadOpCount; ++i) {
+            acc += proportions[i];
+            if (u < acc) {
+                return static_cast<LoadOp>(i);
+            }
+        }
+        return LoadOp::Read;
+    }
+};
+
+// 在 [0, n) 中选键。zipfian 采用 Gray 等人的算法（与 YCSB ZipfianGenerator 相同，theta = 0.99），
+// 再对排名做 FNV 散列，热点键分散在整个键空间而不是集中在最小的键上
+class KeyChooser {
+public:
+    enum class Distribution { Uniform, Zipfian };
+
+    KeyChooser(Distribution distribution, uint64_t n, double theta = 0.99)
+        : distribution_(distribution), n_(n == 0 ? 1 : n), theta_(theta) {
+        if (distribution_ == Distribution::Zipfian) {
+            zetaN_ = zeta(n_, theta_);
+            const double zeta2 = zeta(2, theta_);
+            alpha_ = 1.0 / (1.0 - theta_);
+            eta_ = (1 - std::pow(2.0 / static_cast<double>(n_), 1 - theta_)) / (1 - zeta2 / zetaN_);
+            halfPowTheta_ = 1 + std::pow(0.5, theta_);
+        }
+    }
+
+    uint64_t next(std::mt19937_64& rng) const {
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        if (distribution_ == Distribution::Uniform) {
+            return static_cast<uint64_t>(uniform(rng) * static_cast<double>(n_)) % n_;
+        }
+        const double u = uniform(rng);
+        const double uz = u * zetaN_;
+        uint64_t rank = 0;
+        if (uz < 1.0) {
+            rank = 0;
+        } else if (uz < halfPowTheta_) {
+            rank = 1;
+        } else {
+            rank = static_cast<uint64_t>(static_cast<double>(n_) * std::pow(eta_ * u - eta_ + 1, alpha_));
+        }
+        return fnv64(rank) % n_;
+    }
+
+    uint64_t size() const { return n_; }
+
+private:
+    static double zeta(uint64_t n, double theta) {
+        double sum = 0;
+        for (uint64_t i = 1; i <= n; ++i) {
+            sum += 1.0 / std::pow(static_cast<double>(i), theta);
+        }
+        return sum;
+    }
+
+    static uint64_t fnv64(uint64_t v) {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (int i = 0; i < 8; ++i) {
+            hash ^= v & 0xff;
+            hash *= 0x100000001b3ULL;
+            v >>= 8;
+        }
+        return hash;
+    }
+
+    Distribution distribution_;
+    uint64_t n_;
+    double theta_;
+    double zetaN_ = 0;
+    double alpha_ = 0;
+    double eta_ = 0;
+    double halfPowTheta_ = 0;
+};
+
+// 对数-线性桶的延迟直方图（纳秒），每个 2 的幂区间分 32 个子桶，相对误差约 3%。
+// 每个工作线程各持一份，结束后合并，记录路径上没有锁和分配
+class LatencyHistogram {
+public:
+    void record(uint64_t ns) {
+        ++counts_[bucketOf(ns)];
+        ++count_;
+        sum_ += ns;
+        max_ = ns > max_ ? ns : max_;
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < kBuckets; ++i) {
+            counts_[i] += other.counts_[i];
+        }
+        count_ += other.count_;
+        sum_ += other.sum_;
+        max_ = other.max_ > max_ ? other.max_ : max_;
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t max() const { return max_; }
+    double mean() const { return count_ ? static_cast<double>(sum_) / static_cast<double>(count_) : 0; }
+
+    // q 取 [0, 1]，返回所在桶的中点
+    uint64_t percentile(double q) const {
+        if (count_ == 0) {
+            return 0;
+        }
+        const auto target = static_cast<uint64_t>(std::ceil(q * static_cast<double>(count_)));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            seen += counts_[i];
+            if (seen >= target && counts_[i] > 0) {
+                const uint64_t mid = bucketLow(i) + bucketWidth(i) / 2;
+                return mid < max_ ? mid : max_;
+            }
+        }
+        return max_;
+    }
+
+private:
+    static constexpr unsigned kSubBits = 5;
+    static constexpr uint64_t kSub = uint64_t{1} << kSubBits;
+    static constexpr size_t kBuckets = 2 * kSub + (63 - kSubBits) * kSub;
+
+    static unsigned log2Floor(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+        return 63u - static_cast<unsigned>(__builtin_clzll(v));
+#else
+        unsigned e = 0;
+        while (v >>= 1) {
+            ++e;
+        }
+        return e;
+#endif
+    }
+
+    static size_t bucketOf(uint64_t v) {
+        if (v < 2 * kSub) {
+            return static_cast<size_t>(v);
+        }
+        const unsigned e = log2Floor(v);
+        const uint64_t sub = (v >> (e - kSubBits)) & (kSub - 1);
+        return static_cast<size_t>(2 * kSub + (e - kSubBits - 1) * kSub + sub);
+    }
+
+    static uint64_t bucketLow(size_t index) {
+        if (index < 2 * kSub) {
+            return index;
+        }
+        const uint64_t e = (index - 2 * kSub) / kSub + kSubBits + 1;
+        const uint64_t sub = (index - 2 * kSub) % kSub;
+        return (kSub + sub) << (e - kSubBits);
+    }
+
+    static uint64_t bucketWidth(size_t index) {
+        if (index < 2 * kSub) {
+            return 1;
+        }
+        const uint64_t e = (index - 2 * kSub) / kSub + kSubBits + 1;
+        return uint64_t{1} << (e - kSubBits);
+    }
+
+    std::array<uint64_t, kBuckets> counts_{};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t max_ = 0;
+};
+
+} // namespace sdb::bench
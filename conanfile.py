@@ -58,6 +58,7 @@ class MyProjectConan(ConanFile):
         "src/*",
         "cmake/*",
         "tests/*",
+        "bench/*",
         "assets/*",
         "LICENSE",
         "README.md",
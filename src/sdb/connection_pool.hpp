@@ -1,5 +1,9 @@
 #pragma once
 #include "idb.hpp"
+#include "probes.hpp"
+#include "query_stats.hpp"
+#include "tracing.hpp"
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <functional>
@@ -31,6 +35,10 @@ public:
         uint64_t totalAcquireWaitMicros = 0;
         uint64_t averageAcquireWaitMicros = 0;
         size_t peakInUse = 0;
+        size_t totalConnections = 0;
+        size_t idleConnections = 0;
+        size_t inUse = 0;
+        size_t maxSize = 0;
     };
 
     struct ReturnToPool {
@@ -70,14 +78,17 @@ public:
     }
 
     DbResult<Handle> acquire() {
+        TraceSpan span("pool.acquire", "pool");
+        SDB_PROBE(acquire__start, this);
         std::unique_lock<std::mutex> lock(mtx_);
-        ++acquireAttempts_;
+        acquireAttempts_.fetch_add(1, std::memory_order_relaxed);
         const auto acquireStart = std::chrono::steady_clock::now();
 
         if (closed_) {
             const std::string error = "Connection pool is closed";
             lastError_ = error;
             recordFailureLocked(acquireStart, false);
+            span.setError(error);
             return DbResult<Handle>::failure(error);
         }
 
@@ -87,18 +98,21 @@ public:
             if (!idle_.empty()) {
                 auto conn = std::move(idle_.back());
                 idle_.pop_back();
+                publishSizesLocked();
                 lock.unlock();
 
                 if (options_.testOnBorrow && !ensureOpen(*conn)) {
-                    conn->close();
+                    closeConnection(*conn);
                     lock.lock();
                     if (total_ > 0) {
                         --total_;
                     }
+                    publishSizesLocked();
                     cv_.notify_one();
                     if (options_.waitTimeout.count() == 0 ||
                         std::chrono::steady_clock::now() >= deadline) {
                         recordFailureLocked(acquireStart, false);
+                        span.setError(lastError_);
                         return DbResult<Handle>::failure(lastError_);
                     }
                     continue;
@@ -107,11 +121,13 @@ public:
                 lock.lock();
                 recordSuccessLocked(acquireStart);
                 lock.unlock();
+                span.setArg("source", "idle");
                 return DbResult<Handle>::success(wrap(std::move(conn)));
             }
 
             if (total_ < options_.maxSize) {
                 ++total_;
+                publishSizesLocked();
                 lock.unlock();
 
                 auto connRes = createConnection();
@@ -120,25 +136,29 @@ public:
                     if (total_ > 0) {
                         --total_;
                     }
+                    publishSizesLocked();
                     if (lastError_.empty()) {
                         lastError_ = "Connection factory returned null";
                     }
                     cv_.notify_one();
                     recordFailureLocked(acquireStart, false);
+                    span.setError(lastError_);
                     return DbResult<Handle>::failure(lastError_);
                 }
 
                 auto conn = std::move(connRes.value());
                 if (options_.testOnBorrow && !ensureOpen(*conn)) {
-                    conn->close();
+                    closeConnection(*conn);
                     lock.lock();
                     if (total_ > 0) {
                         --total_;
                     }
+                    publishSizesLocked();
                     cv_.notify_one();
                     if (options_.waitTimeout.count() == 0 ||
                         std::chrono::steady_clock::now() >= deadline) {
                         recordFailureLocked(acquireStart, false);
+                        span.setError(lastError_);
                         return DbResult<Handle>::failure(lastError_);
                     }
                     continue;
@@ -147,6 +167,7 @@ public:
                 lock.lock();
                 recordSuccessLocked(acquireStart);
                 lock.unlock();
+                span.setArg("source", "created");
                 return DbResult<Handle>::success(wrap(std::move(conn)));
             }
 
@@ -154,14 +175,21 @@ public:
                 const std::string error = "Connection pool exhausted";
                 lastError_ = error;
                 recordFailureLocked(acquireStart, false);
+                span.setError(error);
                 return DbResult<Handle>::failure(error);
             }
 
-            ++waitEvents_;
-            if (cv_.wait_until(lock, deadline) == std::cv_status::timeout) {
+            waitEvents_.fetch_add(1, std::memory_order_relaxed);
+            TraceSpan waitSpan("pool.wait", "pool");
+            SDB_PROBE(wait__start, this);
+            const bool timedOut = cv_.wait_until(lock, deadline) == std::cv_status::timeout;
+            SDB_PROBE(wait__end, this, timedOut ? 1 : 0);
+            if (timedOut) {
                 const std::string error = "Connection pool acquire timed out";
                 lastError_ = error;
                 recordFailureLocked(acquireStart, true);
+                waitSpan.end();
+                span.setError(error);
                 return DbResult<Handle>::failure(error);
             }
         }
@@ -181,11 +209,12 @@ public:
             } else {
                 total_ = 0;
             }
+            publishSizesLocked();
         }
 
         for (auto& conn : toClose) {
             if (conn) {
-                conn->close();
+                closeConnection(*conn);
             }
         }
         cv_.notify_all();
@@ -211,32 +240,42 @@ public:
         return lastError_;
     }
 
+    // 只读原子计数，不获取池锁，可在抓取指标时随意调用；各字段之间不保证是同一时刻的一致快照
     MetricsSnapshot metrics() const {
-        std::lock_guard<std::mutex> lock(mtx_);
         MetricsSnapshot snapshot;
-        snapshot.acquireAttempts = acquireAttempts_;
-        snapshot.acquireSuccesses = acquireSuccesses_;
-        snapshot.acquireFailures = acquireFailures_;
-        snapshot.acquireTimeouts = acquireTimeouts_;
-        snapshot.waitEvents = waitEvents_;
-        snapshot.factoryFailures = factoryFailures_;
-        snapshot.totalAcquireWaitMicros = totalAcquireWaitMicros_;
-        snapshot.peakInUse = peakInUse_;
-        const uint64_t completed = acquireSuccesses_ + acquireFailures_;
-        snapshot.averageAcquireWaitMicros = completed == 0 ? 0 : (totalAcquireWaitMicros_ / completed);
+        snapshot.acquireAttempts = acquireAttempts_.load(std::memory_order_relaxed);
+        snapshot.acquireSuccesses = acquireSuccesses_.load(std::memory_order_relaxed);
+        snapshot.acquireFailures = acquireFailures_.load(std::memory_order_relaxed);
+        snapshot.acquireTimeouts = acquireTimeouts_.load(std::memory_order_relaxed);
+        snapshot.waitEvents = waitEvents_.load(std::memory_order_relaxed);
+        snapshot.factoryFailures = factoryFailures_.load(std::memory_order_relaxed);
+        snapshot.totalAcquireWaitMicros = totalAcquireWaitMicros_.load(std::memory_order_relaxed);
+        snapshot.peakInUse = peakInUse_.load(std::memory_order_relaxed);
+        const uint64_t completed = snapshot.acquireSuccesses + snapshot.acquireFailures;
+        snapshot.averageAcquireWaitMicros = completed == 0 ? 0 : (snapshot.totalAcquireWaitMicros / completed);
+        snapshot.totalConnections = totalGauge_.load(std::memory_order_relaxed);
+        snapshot.idleConnections = idleGauge_.load(std::memory_order_relaxed);
+        snapshot.inUse = snapshot.totalConnections > snapshot.idleConnections
+                             ? snapshot.totalConnections - snapshot.idleConnections
+                             : 0;
+        snapshot.maxSize = options_.maxSize;
         return snapshot;
     }
 
+    // acquire() 从进入到返回的耗时分布（成功与失败都计入）
+    LatencyHistogram::Snapshot acquireWaitHistogram() const { return acquireWait_.snapshot(); }
+
     void resetMetrics() {
         std::lock_guard<std::mutex> lock(mtx_);
-        acquireAttempts_ = 0;
-        acquireSuccesses_ = 0;
-        acquireFailures_ = 0;
-        acquireTimeouts_ = 0;
-        waitEvents_ = 0;
-        factoryFailures_ = 0;
-        totalAcquireWaitMicros_ = 0;
-        peakInUse_ = inUseSizeLocked();
+        acquireAttempts_.store(0, std::memory_order_relaxed);
+        acquireSuccesses_.store(0, std::memory_order_relaxed);
+        acquireFailures_.store(0, std::memory_order_relaxed);
+        acquireTimeouts_.store(0, std::memory_order_relaxed);
+        waitEvents_.store(0, std::memory_order_relaxed);
+        factoryFailures_.store(0, std::memory_order_relaxed);
+        totalAcquireWaitMicros_.store(0, std::memory_order_relaxed);
+        peakInUse_.store(inUseSizeLocked(), std::memory_order_relaxed);
+        acquireWait_.reset();
     }
 
     ~ConnectionPool() { shutdown(); }
@@ -252,12 +291,13 @@ private:
             }
             auto conn = std::move(connRes.value());
             if (options_.testOnBorrow && !ensureOpen(*conn)) {
-                conn->close();
+                closeConnection(*conn);
                 continue;
             }
             idle_.push_back(std::move(conn));
             ++total_;
         }
+        publishSizesLocked();
     }
 
     Handle wrap(std::unique_ptr<IConnection> conn) {
@@ -268,34 +308,39 @@ private:
         if (!conn) {
             return;
         }
+        // 在归还线程上清理，连接进入空闲队列后不再被上一位借用者的对象访问
+        conn->resetForReuse();
 
         std::unique_lock<std::mutex> lock(mtx_);
         const bool shouldDrop = closed_ || (options_.testOnReturn && !conn->isOpen());
         if (!shouldDrop) {
             idle_.push_back(std::move(conn));
+            publishSizesLocked();
             lock.unlock();
             cv_.notify_one();
             return;
         }
 
         lock.unlock();
-        conn->close();
+        closeConnection(*conn);
         lock.lock();
         if (total_ > 0) {
             --total_;
         }
+        publishSizesLocked();
         lock.unlock();
         cv_.notify_one();
     }
 
     DbResult<std::unique_ptr<IConnection>> createConnection() {
+        TraceSpan span("pool.create", "pool");
         try {
             auto connRes = factory_();
             if (!connRes) {
                 const std::string msg = connRes.error().message.empty() ? "Connection factory returned null" : connRes.error().message;
                 setError(msg);
                 std::lock_guard<std::mutex> lock(mtx_);
-                ++factoryFailures_;
+                factoryFailures_.fetch_add(1, std::memory_order_relaxed);
                 return DbResult<std::unique_ptr<IConnection>>::failure(msg, connRes.error().code);
             }
 
@@ -304,32 +349,40 @@ private:
                 const std::string msg = "Connection factory returned null";
                 setError(msg);
                 std::lock_guard<std::mutex> lock(mtx_);
-                ++factoryFailures_;
+                factoryFailures_.fetch_add(1, std::memory_order_relaxed);
                 return DbResult<std::unique_ptr<IConnection>>::failure(msg);
             }
 
+            SDB_PROBE(connection__create, this, conn.get());
             return DbResult<std::unique_ptr<IConnection>>::success(std::move(conn));
         } catch (const std::exception& e) {
             const std::string msg = std::string("Connection factory error: ") + e.what();
             setError(msg);
             std::lock_guard<std::mutex> lock(mtx_);
-            ++factoryFailures_;
+            factoryFailures_.fetch_add(1, std::memory_order_relaxed);
             return DbResult<std::unique_ptr<IConnection>>::failure(msg);
         } catch (...) {
             const std::string msg = "Connection factory error: unknown exception";
             setError(msg);
             std::lock_guard<std::mutex> lock(mtx_);
-            ++factoryFailures_;
+            factoryFailures_.fetch_add(1, std::memory_order_relaxed);
             return DbResult<std::unique_ptr<IConnection>>::failure(msg);
         }
     }
 
+    void closeConnection(IConnection& conn) {
+        SDB_PROBE(connection__destroy, this, &conn);
+        conn.close();
+    }
+
     bool ensureOpen(IConnection& conn) {
         if (conn.isOpen()) {
             return true;
         }
+        TraceSpan span("pool.connect", "pool");
         auto openRes = conn.open();
         if (!openRes) {
+            span.setError(openRes.error().message);
             setError(openRes.error().message);
             return false;
         }
@@ -349,25 +402,36 @@ private:
     }
 
     void recordSuccessLocked(const std::chrono::steady_clock::time_point& acquireStart) {
-        ++acquireSuccesses_;
-        const auto waitMicros = std::chrono::duration_cast<std::chrono::microseconds>(
-            std::chrono::steady_clock::now() - acquireStart).count();
-        totalAcquireWaitMicros_ += static_cast<uint64_t>(waitMicros < 0 ? 0 : waitMicros);
+        acquireSuccesses_.fetch_add(1, std::memory_order_relaxed);
+        recordWait(acquireStart, true);
 
         const auto inUse = inUseSizeLocked();
-        if (inUse > peakInUse_) {
-            peakInUse_ = inUse;
+        if (inUse > peakInUse_.load(std::memory_order_relaxed)) {
+            peakInUse_.store(inUse, std::memory_order_relaxed);
         }
     }
 
     void recordFailureLocked(const std::chrono::steady_clock::time_point& acquireStart, bool timedOut) {
-        ++acquireFailures_;
+        acquireFailures_.fetch_add(1, std::memory_order_relaxed);
         if (timedOut) {
-            ++acquireTimeouts_;
+            acquireTimeouts_.fetch_add(1, std::memory_order_relaxed);
         }
-        const auto waitMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+        recordWait(acquireStart, false);
+    }
+
+    void recordWait(const std::chrono::steady_clock::time_point& acquireStart, bool ok) {
+        const auto waitNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
             std::chrono::steady_clock::now() - acquireStart).count();
-        totalAcquireWaitMicros_ += static_cast<uint64_t>(waitMicros < 0 ? 0 : waitMicros);
+        const auto nanos = static_cast<uint64_t>(waitNanos < 0 ? 0 : waitNanos);
+        totalAcquireWaitMicros_.fetch_add(nanos / 1000, std::memory_order_relaxed);
+        acquireWait_.record(nanos);
+        SDB_PROBE(acquire__end, this, ok ? 1 : 0, nanos);
+    }
+
+    // total_ / idle_ 变化后在持锁状态下调用，供 metrics() 无锁读取
+    void publishSizesLocked() {
+        totalGauge_.store(total_, std::memory_order_relaxed);
+        idleGauge_.store(idle_.size(), std::memory_order_relaxed);
     }
 
     Factory factory_;
@@ -379,14 +443,18 @@ private:
     bool closed_ = false;
     std::string lastError_;
 
-    uint64_t acquireAttempts_ = 0;
-    uint64_t acquireSuccesses_ = 0;
-    uint64_t acquireFailures_ = 0;
-    uint64_t acquireTimeouts_ = 0;
-    uint64_t waitEvents_ = 0;
-    uint64_t factoryFailures_ = 0;
-    uint64_t totalAcquireWaitMicros_ = 0;
-    size_t peakInUse_ = 0;
+    // 计数在持锁路径上更新，但以原子存储，metrics() 不需要池锁
+    std::atomic<uint64_t> acquireAttempts_{0};
+    std::atomic<uint64_t> acquireSuccesses_{0};
+    std::atomic<uint64_t> acquireFailures_{0};
+    std::atomic<uint64_t> acquireTimeouts_{0};
+    std::atomic<uint64_t> waitEvents_{0};
+    std::atomic<uint64_t> factoryFailures_{0};
+    std::atomic<uint64_t> totalAcquireWaitMicros_{0};
+    std::atomic<size_t> peakInUse_{0};
+    std::atomic<size_t> totalGauge_{0};
+    std::atomic<size_t> idleGauge_{0};
+    LatencyHistogram acquireWait_;
 };
 
 } // namespace sdb
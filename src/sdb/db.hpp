@@ -1,6 +1,12 @@
 #pragma once
 #include "idb.hpp"
 #include "connection_pool.hpp"
+#include "read_write_pool.hpp"
+#include "instrumented_connection.hpp"
+#include "prometheus.hpp"
+#include "metrics_exporter.hpp"
+#include <algorithm>
+#include <functional>
 #include <unordered_map>
 #include <mutex>
 #include <fstream>
@@ -98,7 +104,7 @@ public:
         }
 
         lastError_.clear();
-        return DbResult<std::unique_ptr<IConnection>>::success(std::move(conn));
+        return instrumentLocked(std::move(conn), connectionName, config);
     }
 
     DbResult<std::unique_ptr<IConnection>> createConnectionRaw(const std::string& driverName, const nlohmann::json& config) {
@@ -115,7 +121,7 @@ public:
         }
 
         lastError_.clear();
-        return DbResult<std::unique_ptr<IConnection>>::success(std::move(conn));
+        return instrumentLocked(std::move(conn), driverName, config);
     }
 
     DbResult<std::shared_ptr<ConnectionPool>> createPool(const std::string& connectionName) {
@@ -160,6 +166,7 @@ public:
                 return DbResult<std::shared_ptr<ConnectionPool>>::success(cached);
             }
             poolCache_[key] = pool;
+            registerPoolLocked(connectionName, "pool", pool);
             lastError_.clear();
         }
         return DbResult<std::shared_ptr<ConnectionPool>>::success(std::move(pool));
@@ -213,17 +220,286 @@ public:
                 return DbResult<std::shared_ptr<ConnectionPool>>::success(cached);
             }
             poolCache_[key] = pool;
+            const auto name = config.find("name");
+            registerPoolLocked(name != config.end() && name->is_string() ? name->get<std::string>() : driverName,
+                               "pool", pool);
             lastError_.clear();
         }
         return DbResult<std::shared_ptr<ConnectionPool>>::success(std::move(pool));
     }
 
+    // 读写分离池：同一配置名只会有一个写连接，因此按配置缓存并复用
+    DbResult<std::shared_ptr<ReadWritePool>> createReadWritePool(const std::string& connectionName) {
+        return createReadWritePool(connectionName, ReadWritePool::Options{});
+    }
+
+    DbResult<std::shared_ptr<ReadWritePool>> createReadWritePool(const std::string& connectionName,
+                                                                 ReadWritePool::Options options) {
+        std::string driverName;
+        nlohmann::json writerConfig;
+        nlohmann::json readerConfig;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            auto cached = rwPoolCache_.find(connectionName);
+            if (cached != rwPoolCache_.end()) {
+                if (auto pool = cached->second.lock()) {
+                    lastError_.clear();
+                    return DbResult<std::shared_ptr<ReadWritePool>>::success(pool);
+                }
+                rwPoolCache_.erase(cached);
+            }
+
+            if (!configs_.contains(connectionName)) {
+                lastError_ = "Connection config not found: " + connectionName;
+                return DbResult<std::shared_ptr<ReadWritePool>>::failure(lastError_);
+            }
+            writerConfig = configs_[connectionName];
+            driverName = writerConfig.value("driver", "");
+            // 读写两侧经 createConnectionRaw 创建，埋点仍按连接名归组
+            if (instrumentEnabled(writerConfig)) {
+                auto& instrument = writerConfig["instrument"];
+                if (!instrument.is_object()) {
+                    instrument = nlohmann::json::object();
+                }
+                if (!instrument.contains("name")) {
+                    instrument["name"] = connectionName;
+                }
+            }
+            auto it = drivers_.find(driverName);
+            if (it == drivers_.end()) {
+                lastError_ = "Driver not supported or registered: " + driverName;
+                return DbResult<std::shared_ptr<ReadWritePool>>::failure(lastError_);
+            }
+            readerConfig = it->second->readOnlyConfig(writerConfig);
+            if (readerConfig.is_null()) {
+                lastError_ = "Driver does not support read/write split pools: " + driverName;
+                return DbResult<std::shared_ptr<ReadWritePool>>::failure(lastError_);
+            }
+            writerConfig = it->second->writerConfig(writerConfig);
+        }
+
+        auto writerFactory = [this, driverName, writerConfig]() {
+            return this->createConnectionRaw(driverName, writerConfig);
+        };
+        auto readerFactory = [this, driverName, readerConfig]() {
+            return this->createConnectionRaw(driverName, readerConfig);
+        };
+        auto poolRes = ReadWritePool::create(std::move(writerFactory), std::move(readerFactory), options);
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!poolRes) {
+            lastError_ = poolRes.error().message;
+            return DbResult<std::shared_ptr<ReadWritePool>>::failure(lastError_);
+        }
+        auto cached = rwPoolCache_.find(connectionName);
+        if (cached != rwPoolCache_.end()) {
+            if (auto pool = cached->second.lock()) {
+                poolRes.value()->shutdown();
+                lastError_.clear();
+                return DbResult<std::shared_ptr<ReadWritePool>>::success(pool);
+            }
+        }
+        rwPoolCache_[connectionName] = poolRes.value();
+        registerPoolLocked(connectionName, "writer", poolRes.value()->writer());
+        registerPoolLocked(connectionName, "reader", poolRes.value()->readers());
+        lastError_.clear();
+        return DbResult<std::shared_ptr<ReadWritePool>>::success(std::move(poolRes.value()));
+    }
+
+    // 配置了 "instrument" 的连接按名称共享一份埋点（读写分离池两侧也归入连接名）；尚未创建过连接时返回空
+    std::shared_ptr<ConnectionInstrumentation> instrumentation(const std::string& name) const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = instrumentations_.find(name);
+        return it == instrumentations_.end() ? nullptr : it->second;
+    }
+
+    std::vector<std::shared_ptr<ConnectionInstrumentation>> instrumentations() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        std::vector<std::shared_ptr<ConnectionInstrumentation>> out;
+        out.reserve(instrumentations_.size());
+        for (const auto& [name, instrumentation] : instrumentations_) {
+            out.push_back(instrumentation);
+        }
+        return out;
+    }
+
+    // 登记不经由本管理器创建的池（如 ConnectionPool::createWithFactory），随 renderPrometheus() 一并导出
+    void registerPool(const std::string& name, const std::shared_ptr<ConnectionPool>& pool,
+                      const std::string& role = "pool") {
+        if (!pool) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mtx_);
+        registerPoolLocked(name, role, pool);
+    }
+
+    // 追加自定义指标（如 SqliteStatementStats），在 renderPrometheus() 中于管理器锁外调用
+    void addMetricsCollector(std::function<void(PrometheusWriter&)> collector) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        collectors_.push_back(std::move(collector));
+    }
+
+    // 所有存活池、埋点连接与语句统计的 Prometheus 文本。只在复制登记表时持有管理器锁，
+    // 读取池指标不获取池锁，抓取不会与 acquire() 争用
+    std::string renderPrometheus() const {
+        std::vector<PoolEntry> pools;
+        std::vector<std::shared_ptr<ConnectionInstrumentation>> instrumentations;
+        std::vector<std::function<void(PrometheusWriter&)>> collectors;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            pools = pools_;
+            collectors = collectors_;
+            for (const auto& [name, instrumentation] : instrumentations_) {
+                instrumentations.push_back(instrumentation);
+            }
+        }
+        PrometheusWriter out;
+        for (const auto& entry : pools) {
+            if (auto pool = entry.pool.lock()) {
+                collectPool(out, {{"pool", entry.name}, {"role", entry.role}}, *pool);
+            }
+        }
+        for (const auto& instrumentation : instrumentations) {
+            collectInstrumentation(out, *instrumentation);
+        }
+        for (const auto& collector : collectors) {
+            collector(out);
+        }
+        return out.str();
+    }
+
+    // 以 renderPrometheus() 为数据源启动导出器；导出器须先于管理器销毁
+    DbResult<std::unique_ptr<MetricsExporter>> startMetricsExporter(MetricsExporter::Options options) {
+        return MetricsExporter::start([this] { return renderPrometheus(); }, std::move(options));
+    }
+
     std::string lastError() const {
         std::lock_guard<std::mutex> lock(mtx_);
         return lastError_;
     }
 
 private:
+    struct PoolEntry {
+        std::string name;
+        std::string role;
+        std::weak_ptr<ConnectionPool> pool;
+    };
+
+    // 同名同角色的不同池（例如同一配置名、不同 Options）依次加后缀 #2、#3
+    void registerPoolLocked(const std::string& name, const std::string& role,
+                            const std::shared_ptr<ConnectionPool>& pool) {
+        pools_.erase(std::remove_if(pools_.begin(), pools_.end(),
+                                    [](const PoolEntry& e) { return e.pool.expired(); }),
+                     pools_.end());
+        std::string unique = name;
+        for (int suffix = 2;; ++suffix) {
+            bool taken = false;
+            for (const auto& e : pools_) {
+                if (e.pool.lock() == pool) {
+                    return;
+                }
+                taken = taken || (e.name == unique && e.role == role);
+            }
+            if (!taken) {
+                break;
+            }
+            unique = name + "#" + std::to_string(suffix);
+        }
+        pools_.push_back({std::move(unique), role, pool});
+    }
+
+    static void collectPool(PrometheusWriter& out, const PrometheusWriter::Labels& labels, const ConnectionPool& pool) {
+        const auto m = pool.metrics();
+        out.counter("smartdb_pool_acquire_attempts_total", "Connection acquire attempts.", labels,
+                    static_cast<double>(m.acquireAttempts));
+        out.counter("smartdb_pool_acquire_failures_total", "Failed connection acquires, including timeouts.", labels,
+                    static_cast<double>(m.acquireFailures));
+        out.counter("smartdb_pool_acquire_timeouts_total", "Connection acquires that timed out waiting.", labels,
+                    static_cast<double>(m.acquireTimeouts));
+        out.counter("smartdb_pool_wait_events_total", "Acquires that had to wait for a connection.", labels,
+                    static_cast<double>(m.waitEvents));
+        out.counter("smartdb_pool_factory_failures_total", "Failed attempts to open a new connection.", labels,
+                    static_cast<double>(m.factoryFailures));
+        auto withState = [&](const char* state) {
+            auto l = labels;
+            l.emplace_back("state", state);
+            return l;
+        };
+        out.gauge("smartdb_pool_connections", "Open connections by state.", withState("idle"),
+                  static_cast<double>(m.idleConnections));
+        out.gauge("smartdb_pool_connections", "Open connections by state.", withState("in_use"),
+                  static_cast<double>(m.inUse));
+        out.gauge("smartdb_pool_max_connections", "Configured pool capacity.", labels, static_cast<double>(m.maxSize));
+        out.gauge("smartdb_pool_peak_in_use", "Highest number of connections in use since the last reset.", labels,
+                  static_cast<double>(m.peakInUse));
+        out.histogram("smartdb_pool_acquire_duration_seconds", "Time spent in acquire().", labels,
+                      pool.acquireWaitHistogram());
+    }
+
+    static constexpr size_t kStatementInfoBytes = 120;
+
+    // 截断到 maxBytes 以内，不切断 UTF-8 多字节字符
+    static std::string truncateUtf8(const std::string& text, size_t maxBytes) {
+        if (text.size() <= maxBytes) {
+            return text;
+        }
+        size_t n = maxBytes;
+        while (n > 0 && (static_cast<unsigned char>(text[n]) & 0xC0) == 0x80) {
+            --n;
+        }
+        return text.substr(0, n) + "...";
+    }
+
+    static void collectInstrumentation(PrometheusWriter& out, const ConnectionInstrumentation& instrumentation) {
+        const auto s = instrumentation.snapshot();
+        const PrometheusWriter::Labels labels = {{"connection", s.name}};
+        out.gauge("smartdb_connections", "Live instrumented connections.", labels, static_cast<double>(s.connections));
+        for (size_t i = 0; i < kConnectionOpCount; ++i) {
+            auto l = labels;
+            l.emplace_back("op", connectionOpName(static_cast<ConnectionOp>(i)));
+            out.histogram("smartdb_connection_operation_duration_seconds", "Driver call latency by operation.", l,
+                          s.ops[i].latency);
+            out.counter("smartdb_connection_operation_errors_total", "Failed driver calls by operation.", l,
+                        static_cast<double>(s.ops[i].errors));
+        }
+        out.counter("smartdb_connection_rows_fetched_total", "Rows read from result sets.", labels,
+                    static_cast<double>(s.rowsFetched));
+        out.counter("smartdb_connection_bytes_fetched_total", "Approximate bytes read from result sets.", labels,
+                    static_cast<double>(s.bytesFetched));
+        out.counter("smartdb_slow_queries_total", "Statements slower than the slow query threshold.", labels,
+                    static_cast<double>(instrumentation.queries().slowQueryCount()));
+        // 语句序列以 16 位十六进制指纹为标签，长度固定；语句文本只出现在每条语句一个的 smartdb_statement_info 中，
+        // 截断到 kStatementInfoBytes 字节，完整文本见 QueryStats::toJson()
+        for (const auto& e : instrumentation.queries().snapshot()) {
+            auto l = labels;
+            l.emplace_back("fingerprint", formatSqlFingerprint(e.fingerprint));
+            auto infoLabels = l;
+            infoLabels.emplace_back("statement", truncateUtf8(e.statement, kStatementInfoBytes));
+            out.gauge("smartdb_statement_info", "Normalized statement text (truncated) per fingerprint.", infoLabels, 1);
+            out.counter("smartdb_statement_calls_total", "Calls per normalized statement.", l,
+                        static_cast<double>(e.calls));
+            out.counter("smartdb_statement_errors_total", "Failed calls per normalized statement.", l,
+                        static_cast<double>(e.errors));
+            out.counter("smartdb_statement_rows_total", "Rows returned or affected per normalized statement.", l,
+                        static_cast<double>(e.rows));
+            out.counter("smartdb_statement_bytes_total", "Bytes fetched per normalized statement.", l,
+                        static_cast<double>(e.bytes));
+            out.histogram("smartdb_statement_duration_seconds", "Latency per normalized statement.", l, e.latency);
+            if (e.phasedCalls == 0) {
+                continue;
+            }
+            for (size_t i = 0; i < kQueryPhaseCount; ++i) {
+                auto phaseLabels = l;
+                phaseLabels.emplace_back("phase", queryPhaseName(static_cast<QueryPhase>(i)));
+                out.counter("smartdb_statement_phase_wall_seconds_total", "Wall time per statement phase.",
+                            phaseLabels, static_cast<double>(e.phases.wallNanos[i]) / 1e9);
+                out.counter("smartdb_statement_phase_cpu_seconds_total", "Thread CPU time per statement phase.",
+                            phaseLabels, static_cast<double>(e.phases.cpuNanos[i]) / 1e9);
+            }
+        }
+    }
+
+
     static ConnectionPool::Options normalizeOptions(ConnectionPool::Options options) {
         if (options.minSize > options.maxSize) {
             options.minSize = options.maxSize;
@@ -251,6 +527,75 @@ private:
         return "raw:" + driverName + "|" + config.dump() + "|" + optionsKey(options);
     }
 
+    static bool instrumentEnabled(const nlohmann::json& config) {
+        auto it = config.find("instrument");
+        if (it == config.end()) {
+            return false;
+        }
+        return it->is_object() || (it->is_boolean() && it->get<bool>());
+    }
+
+    // "instrument": true 或 {"name", "slow_query_ms", "slow_sample_every", "max_statements", "phase_timing"}；
+    // 字段类型不符时返回失败，而不是让 nlohmann::json 抛出 type_error
+    DbResult<std::unique_ptr<IConnection>> instrumentLocked(std::unique_ptr<IConnection> conn,
+                                                            const std::string& defaultName,
+                                                            const nlohmann::json& config) {
+        using Result = DbResult<std::unique_ptr<IConnection>>;
+        if (!instrumentEnabled(config)) {
+            return Result::success(std::move(conn));
+        }
+        const auto& settings = config["instrument"];
+        std::string name = defaultName;
+        QueryStats::Options options;
+        bool phaseTiming = false;
+        if (settings.is_object()) {
+            std::string error;
+            auto readUnsigned = [&](const char* key, auto apply) {
+                if (!error.empty() || !settings.contains(key)) {
+                    return;
+                }
+                if (!settings[key].is_number_integer() || settings[key].get<int64_t>() < 0) {
+                    error = std::string("Instrument option '") + key + "' must be a non-negative integer";
+                    return;
+                }
+                apply(settings[key].get<uint64_t>());
+            };
+            if (settings.contains("name")) {
+                if (settings["name"].is_string()) {
+                    name = settings["name"].get<std::string>();
+                } else {
+                    error = "Instrument option 'name' must be a string";
+                }
+            }
+            readUnsigned("slow_query_ms", [&](uint64_t v) {
+                options.slowThreshold = std::chrono::milliseconds(static_cast<int64_t>(v));
+            });
+            readUnsigned("slow_sample_every", [&](uint64_t v) {
+                options.slowSampleEvery = static_cast<decltype(options.slowSampleEvery)>(v);
+            });
+            readUnsigned("max_statements", [&](uint64_t v) {
+                options.maxStatements = static_cast<decltype(options.maxStatements)>(v);
+            });
+            if (error.empty() && settings.contains("phase_timing")) {
+                if (settings["phase_timing"].is_boolean()) {
+                    phaseTiming = settings["phase_timing"].get<bool>();
+                } else {
+                    error = "Instrument option 'phase_timing' must be a boolean";
+                }
+            }
+            if (!error.empty()) {
+                lastError_ = error;
+                return Result::failure(lastError_);
+            }
+        }
+        auto& instrumentation = instrumentations_[name];
+        if (!instrumentation) {
+            instrumentation = std::make_shared<ConnectionInstrumentation>(name, std::move(options));
+            instrumentation->setPhaseTiming(phaseTiming);
+        }
+        return Result::success(std::make_unique<InstrumentedConnection>(std::move(conn), instrumentation));
+    }
+
     std::shared_ptr<ConnectionPool> getCachedPoolLocked(const std::string& key) {
         auto it = poolCache_.find(key);
         if (it == poolCache_.end()) {
@@ -266,6 +611,10 @@ private:
     std::unordered_map<std::string, std::shared_ptr<IDriver>> drivers_;
     nlohmann::json configs_;
     std::unordered_map<std::string, std::weak_ptr<ConnectionPool>> poolCache_;
+    std::unordered_map<std::string, std::weak_ptr<ReadWritePool>> rwPoolCache_;
+    std::unordered_map<std::string, std::shared_ptr<ConnectionInstrumentation>> instrumentations_;
+    std::vector<PoolEntry> pools_;
+    std::vector<std::function<void(PrometheusWriter&)>> collectors_;
     mutable std::mutex mtx_;
     std::string lastError_;
 };
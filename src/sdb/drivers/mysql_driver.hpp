@@ -1,14 +1,20 @@
 #pragma once
 #include "../idb.hpp"
+#include "../probes.hpp"
+#include "../query_phases.hpp"
+#include "../tracing.hpp"
 
 #include <mysql.h>
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cctype>
 #include <cstdint>
 #include <cstring>
 #include <limits>
 #include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -118,13 +124,153 @@ public:
     std::vector<std::string> columnNames() override { return colNames_; }
 };
 
+// libmysqlclient 8.0.18 起支持 MYSQL_OPT_COMPRESSION_ALGORITHMS（zstd），更早的客户端与 MariaDB 只有 zlib
+#if defined(MYSQL_VERSION_ID) && MYSQL_VERSION_ID >= 80018 && !defined(MARIADB_BASE_VERSION)
+#define SMARTDB_MYSQL_COMPRESSION_ALGORITHMS 1
+#endif
+
+struct MysqlOptions {
+    // 非空时通过 Unix 域套接字连接本机 mysqld，省去 TCP 协议栈开销
+    std::string unixSocket;
+    // 压缩算法，逗号分隔："zlib" / "zstd" / "zlib,zstd"；空表示不压缩。只在传输大结果集且带宽受限时有收益
+    std::string compress;
+    std::optional<unsigned int> zstdLevel;
+    // 单位秒；读写超时每次网络读写各自计时，客户端实际会重试读取，最坏等待约为 3 倍
+    unsigned int connectTimeout = 10;
+    std::optional<unsigned int> readTimeout;
+    std::optional<unsigned int> writeTimeout;
+    // 网络缓冲区初始大小与单个包上限（字节）
+    std::optional<unsigned long> netBufferLength;
+    std::optional<unsigned long> maxAllowedPacket;
+    // CLIENT_MULTI_STATEMENTS：允许一次 query 发送以 ; 分隔的多条语句，结果通过 queryMulti 逐个读取。
+    // 存储过程所需的 CLIENT_MULTI_RESULTS 总是开启
+    bool multiStatements = false;
+    // 配置解析错误会延迟到 open() 时返回
+    std::string configError;
+};
+
+namespace detail {
+// 连接与其未读完的多结果集共享的游标。连接发起新命令、关闭或归还连接池时推进 epoch，旧的多结果集随即失效。
+// epoch 为原子量：归还后多结果集可能在另一个线程上析构，只读取 epoch 判断已失效，不再访问 conn
+struct MysqlResultCursor {
+    MYSQL* conn = nullptr;
+    std::atomic<uint64_t> epoch{0};
+};
+
+// 读出并丢弃当前命令尚未读取的全部结果集，使连接回到可以发送下一条命令的状态。
+// 后续语句执行失败时服务端不再返回结果，连接同样回到空闲状态，错误作为返回值交给调用方
+inline DbResult<void> drainMysqlResults(MYSQL* conn) {
+    while (mysql_more_results(conn)) {
+        const int rc = mysql_next_result(conn);
+        if (rc > 0) {
+            return DbResult<void>::failure(mysql_error(conn), mysql_errno(conn));
+        }
+        if (rc < 0) {
+            break;
+        }
+        MYSQL_RES* res = mysql_store_result(conn);
+        if (res) {
+            mysql_free_result(res);
+        } else if (mysql_field_count(conn) > 0) {
+            return DbResult<void>::failure(mysql_error(conn), mysql_errno(conn));
+        }
+    }
+    return DbResult<void>::success();
+}
+} // namespace detail
+
+// 一条命令（CALL 或多语句）返回的结果序列。第一个结果在创建时已读取，next() 前进到下一个；
+// 每个结果用 mysql_store_result 完整读入，前进后之前取得的结果集仍然可用。析构时读完剩余结果；
+// 连接归还连接池时剩余结果已被丢弃，此后本对象失效，析构不再访问连接
+class MysqlMultiResult {
+public:
+    MysqlMultiResult(std::shared_ptr<detail::MysqlResultCursor> cursor, uint64_t epoch)
+        : cursor_(std::move(cursor)), epoch_(epoch) {}
+
+    ~MysqlMultiResult() { drain(); }
+
+    MysqlMultiResult(const MysqlMultiResult&) = delete;
+    MysqlMultiResult& operator=(const MysqlMultiResult&) = delete;
+
+    // 当前结果是否带有行（SELECT），否则为 INSERT/UPDATE 或存储过程末尾的状态结果
+    bool hasResultSet() const { return hasResultSet_; }
+    std::shared_ptr<IResultSet> resultSet() const { return current_; }
+    int64_t affectedRows() const { return affectedRows_; }
+    size_t index() const { return index_; }
+
+    // 前进到下一个结果；没有更多结果时返回 false
+    DbResult<bool> next() {
+        if (!active()) {
+            return DbResult<bool>::success(false);
+        }
+        MYSQL* conn = cursor_->conn;
+        if (!mysql_more_results(conn)) {
+            finished_ = true;
+            return DbResult<bool>::success(false);
+        }
+        const int rc = mysql_next_result(conn);
+        if (rc < 0) {
+            finished_ = true;
+            return DbResult<bool>::success(false);
+        }
+        if (rc > 0) {
+            // 服务端在执行后续语句时出错，剩余结果不再可读
+            finished_ = true;
+            return DbResult<bool>::failure(mysql_error(conn), mysql_errno(conn));
+        }
+        auto loaded = load();
+        if (!loaded) {
+            return DbResult<bool>::failure(loaded.error().message, loaded.error().code);
+        }
+        ++index_;
+        return DbResult<bool>::success(true);
+    }
+
+    // 丢弃尚未读取的结果
+    void drain() {
+        if (active()) {
+            (void)detail::drainMysqlResults(cursor_->conn);
+        }
+        finished_ = true;
+    }
+
+    // 由 MysqlConnection 在命令发送成功后调用，读取第一个结果
+    DbResult<void> load() {
+        MYSQL* conn = cursor_->conn;
+        MYSQL_RES* res = mysql_store_result(conn);
+        if (!res && mysql_field_count(conn) > 0) {
+            finished_ = true;
+            return DbResult<void>::failure(mysql_error(conn), mysql_errno(conn));
+        }
+        hasResultSet_ = res != nullptr;
+        affectedRows_ = res ? 0 : static_cast<int64_t>(mysql_affected_rows(conn));
+        current_ = std::make_shared<MysqlResultSet>(res);
+        return DbResult<void>::success();
+    }
+
+private:
+    bool active() const { return !finished_ && cursor_->epoch.load() == epoch_ && cursor_->conn; }
+
+    std::shared_ptr<detail::MysqlResultCursor> cursor_;
+    uint64_t epoch_;
+    bool finished_ = false;
+    bool hasResultSet_ = false;
+    int64_t affectedRows_ = 0;
+    size_t index_ = 0;
+    std::shared_ptr<IResultSet> current_;
+};
+
 class MysqlConnection : public IConnection {
     MYSQL* conn_ = nullptr;
+    std::shared_ptr<detail::MysqlResultCursor> cursor_ = std::make_shared<detail::MysqlResultCursor>();
     nlohmann::json config_;
+    MysqlOptions options_;
     std::string lastErr_;
 
 public:
     explicit MysqlConnection(const nlohmann::json& config) : config_(config) {}
+    MysqlConnection(const nlohmann::json& config, MysqlOptions options)
+        : config_(config), options_(std::move(options)) {}
 
     ~MysqlConnection() override { close(); }
 
@@ -132,6 +278,10 @@ public:
         if (isOpen()) {
             return DbResult<void>::success();
         }
+        if (!options_.configError.empty()) {
+            lastErr_ = options_.configError;
+            return DbResult<void>::failure(lastErr_);
+        }
 
         conn_ = mysql_init(nullptr);
         if (!conn_) {
@@ -146,20 +296,34 @@ public:
         const std::string db = config_.value("database", "");
         const std::string charset = config_.value("charset", "utf8mb4");
 
-        unsigned int timeout = 10;
-        mysql_options(conn_, MYSQL_OPT_CONNECT_TIMEOUT, &timeout);
         mysql_options(conn_, MYSQL_SET_CHARSET_NAME, charset.c_str());
+        if (auto transportRes = applyTransportOptions(); !transportRes) {
+            lastErr_ = transportRes.error().message;
+            mysql_close(conn_);
+            conn_ = nullptr;
+            return transportRes;
+        }
 
-        if (!mysql_real_connect(conn_, host.c_str(), user.c_str(),
+        // 套接字协议只接受 localhost，配置的 host 在此时被忽略
+        const char* socket = options_.unixSocket.empty() ? nullptr : options_.unixSocket.c_str();
+        const char* hostName = socket ? "localhost" : host.c_str();
+        unsigned long clientFlags = CLIENT_MULTI_RESULTS;
+        if (options_.multiStatements) {
+            clientFlags |= CLIENT_MULTI_STATEMENTS;
+        }
+        TraceSpan span("mysql.connect", "driver");
+        if (!mysql_real_connect(conn_, hostName, user.c_str(),
                                 pass.c_str(), db.empty() ? nullptr : db.c_str(),
-                                port, nullptr, 0)) {
+                                port, socket, clientFlags)) {
             lastErr_ = mysql_error(conn_);
             const int errCode = mysql_errno(conn_);
+            span.setError(lastErr_, errCode);
             mysql_close(conn_);
             conn_ = nullptr;
             return DbResult<void>::failure(lastErr_, errCode);
         }
 
+        cursor_->conn = conn_;
         lastErr_.clear();
         return DbResult<void>::success();
     }
@@ -169,6 +333,8 @@ public:
             mysql_close(conn_);
             conn_ = nullptr;
         }
+        cursor_->conn = nullptr;
+        ++cursor_->epoch;
     }
 
     bool isOpen() const override { return conn_ != nullptr; }
@@ -178,24 +344,48 @@ public:
             lastErr_ = "Connection is closed";
             return DbResult<std::shared_ptr<IResultSet>>::failure(lastErr_);
         }
+        beginCommand();
 
+        sdb::detail::QueryProbe probe(this, sql);
+        TraceSpan span("mysql.query", "driver");
+        span.setStatement(sql);
         if (mysql_query(conn_, sql.c_str())) {
             lastErr_ = mysql_error(conn_);
+            span.setError(lastErr_, mysql_errno(conn_));
             spdlog::error("MySQL Query Error: {} | SQL: {}", lastErr_, sql);
             return DbResult<std::shared_ptr<IResultSet>>::failure(lastErr_, mysql_errno(conn_));
         }
+        span.end();
 
+        // 结果集在此一次性读入客户端内存，之后的 next() 不再访问网络
+        ScopedQueryPhase fetchPhase(QueryPhase::Fetch);
+        TraceSpan fetchSpan("mysql.fetch", "driver");
         MYSQL_RES* res = mysql_store_result(conn_);
         if (!res) {
             if (mysql_field_count(conn_) > 0) {
                 lastErr_ = mysql_error(conn_);
+                fetchSpan.setError(lastErr_, mysql_errno(conn_));
                 spdlog::error("MySQL Store Result Error: {}", lastErr_);
                 return DbResult<std::shared_ptr<IResultSet>>::failure(lastErr_, mysql_errno(conn_));
             }
-            return DbResult<std::shared_ptr<IResultSet>>::success(std::make_shared<MysqlResultSet>(nullptr));
+        } else {
+            fetchSpan.setArg("rows", static_cast<uint64_t>(mysql_num_rows(res)));
+        }
+        // 存储过程总会在结果集之后追加一个状态结果，只返回第一个结果集，其余丢弃以免连接失步；
+        // 多语句中后面的语句失败时整条命令按失败处理
+        auto drained = detail::drainMysqlResults(conn_);
+        if (!drained) {
+            if (res) {
+                mysql_free_result(res);
+            }
+            lastErr_ = drained.error().message;
+            fetchSpan.setError(lastErr_, drained.error().code);
+            spdlog::error("MySQL Query Error: {} | SQL: {}", lastErr_, sql);
+            return DbResult<std::shared_ptr<IResultSet>>::failure(lastErr_, drained.error().code);
         }
 
         lastErr_.clear();
+        probe.succeeded();
         return DbResult<std::shared_ptr<IResultSet>>::success(std::make_shared<MysqlResultSet>(res));
     }
 
@@ -204,15 +394,83 @@ public:
             lastErr_ = "Connection is closed";
             return DbResult<int64_t>::failure(lastErr_);
         }
+        beginCommand();
 
+        sdb::detail::QueryProbe probe(this, sql);
+        TraceSpan span("mysql.execute", "driver");
+        span.setStatement(sql);
         if (mysql_query(conn_, sql.c_str())) {
             lastErr_ = mysql_error(conn_);
+            span.setError(lastErr_, mysql_errno(conn_));
             spdlog::error("MySQL Execute Error: {} | SQL: {}", lastErr_, sql);
             return DbResult<int64_t>::failure(lastErr_, mysql_errno(conn_));
         }
 
+        const auto affected = static_cast<int64_t>(mysql_affected_rows(conn_));
+        if (mysql_field_count(conn_) > 0) {
+            if (MYSQL_RES* res = mysql_store_result(conn_)) {
+                mysql_free_result(res);
+            }
+        }
+        auto drained = detail::drainMysqlResults(conn_);
+        if (!drained) {
+            lastErr_ = drained.error().message;
+            span.setError(lastErr_, drained.error().code);
+            spdlog::error("MySQL Execute Error: {} | SQL: {}", lastErr_, sql);
+            return DbResult<int64_t>::failure(lastErr_, drained.error().code);
+        }
+        lastErr_.clear();
+        probe.succeeded();
+        return DbResult<int64_t>::success(affected);
+    }
+
+    // 发送一条可能返回多个结果的命令（CALL 或开启 multi_statements 后的多语句），逐个读取结果。
+    // 在返回对象读完或析构之前，对本连接发起新命令会先丢弃剩余结果并令该对象失效
+    DbResult<std::unique_ptr<MysqlMultiResult>> queryMulti(const std::string& sql) {
+        if (!isOpen()) {
+            lastErr_ = "Connection is closed";
+            return DbResult<std::unique_ptr<MysqlMultiResult>>::failure(lastErr_);
+        }
+        beginCommand();
+
+        if (mysql_real_query(conn_, sql.data(), static_cast<unsigned long>(sql.size()))) {
+            lastErr_ = mysql_error(conn_);
+            spdlog::error("MySQL Query Error: {} | SQL: {}", lastErr_, sql);
+            return DbResult<std::unique_ptr<MysqlMultiResult>>::failure(lastErr_, mysql_errno(conn_));
+        }
+        auto results = std::make_unique<MysqlMultiResult>(cursor_, cursor_->epoch);
+        auto loaded = results->load();
+        if (!loaded) {
+            lastErr_ = loaded.error().message;
+            (void)detail::drainMysqlResults(conn_);
+            return DbResult<std::unique_ptr<MysqlMultiResult>>::failure(lastErr_, loaded.error().code);
+        }
         lastErr_.clear();
-        return DbResult<int64_t>::success(static_cast<int64_t>(mysql_affected_rows(conn_)));
+        return DbResult<std::unique_ptr<MysqlMultiResult>>::success(std::move(results));
+    }
+
+    // 收集命令返回的所有行结果集（跳过不带行的状态结果），适合一次 CALL 取回多张报表
+    DbResult<std::vector<std::shared_ptr<IResultSet>>> queryAll(const std::string& sql) {
+        auto multiRes = queryMulti(sql);
+        if (!multiRes) {
+            return DbResult<std::vector<std::shared_ptr<IResultSet>>>::failure(multiRes.error().message, multiRes.error().code);
+        }
+        auto& results = *multiRes.value();
+        std::vector<std::shared_ptr<IResultSet>> sets;
+        while (true) {
+            if (results.hasResultSet()) {
+                sets.push_back(results.resultSet());
+            }
+            auto more = results.next();
+            if (!more) {
+                lastErr_ = more.error().message;
+                return DbResult<std::vector<std::shared_ptr<IResultSet>>>::failure(lastErr_, more.error().code);
+            }
+            if (!more.value()) {
+                break;
+            }
+        }
+        return DbResult<std::vector<std::shared_ptr<IResultSet>>>::success(std::move(sets));
     }
 
     DbResult<int64_t> execute(const std::string& sql, const std::vector<DbValue>& params) override {
@@ -221,6 +479,9 @@ public:
             return DbResult<int64_t>::failure(lastErr_);
         }
 
+        beginCommand();
+        sdb::detail::QueryProbe probe(this, sql);
+        ScopedQueryPhase preparePhase(QueryPhase::Prepare);
         MYSQL_STMT* stmt = mysql_stmt_init(conn_);
         if (!stmt) {
             lastErr_ = "mysql_stmt_init failed";
@@ -234,10 +495,13 @@ public:
             }
         };
 
+        TraceSpan prepareSpan("mysql.prepare", "driver");
+        prepareSpan.setStatement(sql);
         if (mysql_stmt_prepare(stmt, sql.c_str(), static_cast<unsigned long>(sql.size())) != 0) {
             lastErr_ = mysql_stmt_error(stmt);
-            spdlog::error("MySQL Prepare Error: {} | SQL: {}", lastErr_, sql);
             const int errCode = mysql_stmt_errno(stmt);
+            prepareSpan.setError(lastErr_, errCode);
+            spdlog::error("MySQL Prepare Error: {} | SQL: {}", lastErr_, sql);
             cleanupStmt();
             return DbResult<int64_t>::failure(lastErr_, errCode);
         }
@@ -326,6 +590,8 @@ public:
             }
         }
 
+        prepareSpan.end();
+
         if (!binds.empty() && mysql_stmt_bind_param(stmt, binds.data()) != 0) {
             lastErr_ = mysql_stmt_error(stmt);
             spdlog::error("MySQL Bind Error: {} | SQL: {}", lastErr_, sql);
@@ -334,10 +600,13 @@ public:
             return DbResult<int64_t>::failure(lastErr_, errCode);
         }
 
+        preparePhase.end();
+        TraceSpan executeSpan("mysql.stmt_execute", "driver");
         if (mysql_stmt_execute(stmt) != 0) {
             lastErr_ = mysql_stmt_error(stmt);
-            spdlog::error("MySQL Stmt Execute Error: {} | SQL: {}", lastErr_, sql);
             const int errCode = mysql_stmt_errno(stmt);
+            executeSpan.setError(lastErr_, errCode);
+            spdlog::error("MySQL Stmt Execute Error: {} | SQL: {}", lastErr_, sql);
             cleanupStmt();
             return DbResult<int64_t>::failure(lastErr_, errCode);
         }
@@ -345,6 +614,7 @@ public:
         const auto affected = static_cast<int64_t>(mysql_stmt_affected_rows(stmt));
         cleanupStmt();
         lastErr_.clear();
+        probe.succeeded();
         return DbResult<int64_t>::success(affected);
     }
 
@@ -371,12 +641,141 @@ public:
         }
         return DbResult<void>::success();
     }
+
+    // 归还连接池时丢弃未读完的结果，并令仍在外部的 MysqlMultiResult 失效
+    void resetForReuse() override {
+        if (conn_) {
+            (void)detail::drainMysqlResults(conn_);
+        }
+        ++cursor_->epoch;
+    }
+
+    const MysqlOptions& options() const { return options_; }
+
+private:
+    // 新命令之前丢弃上一条多结果命令未读的结果，并令对应的 MysqlMultiResult 失效；
+    // 那些结果的错误属于上一条命令，这里不再上报
+    void beginCommand() {
+        (void)detail::drainMysqlResults(conn_);
+        ++cursor_->epoch;
+    }
+
+    // 须在 mysql_real_connect 之前调用
+    DbResult<void> applyTransportOptions() {
+        auto check = [](int rc, const char* what) {
+            return rc == 0 ? DbResult<void>::success()
+                           : DbResult<void>::failure(std::string("mysql_options failed: ") + what);
+        };
+
+        DbResult<void> res = check(mysql_options(conn_, MYSQL_OPT_CONNECT_TIMEOUT, &options_.connectTimeout), "connect_timeout");
+        if (res && options_.readTimeout) {
+            res = check(mysql_options(conn_, MYSQL_OPT_READ_TIMEOUT, &*options_.readTimeout), "read_timeout");
+        }
+        if (res && options_.writeTimeout) {
+            res = check(mysql_options(conn_, MYSQL_OPT_WRITE_TIMEOUT, &*options_.writeTimeout), "write_timeout");
+        }
+        if (res && !options_.unixSocket.empty()) {
+            const unsigned int protocol = MYSQL_PROTOCOL_SOCKET;
+            res = check(mysql_options(conn_, MYSQL_OPT_PROTOCOL, &protocol), "protocol");
+        }
+        if (res && options_.netBufferLength) {
+            res = check(mysql_options(conn_, MYSQL_OPT_NET_BUFFER_LENGTH, &*options_.netBufferLength), "net_buffer_length");
+        }
+        if (res && options_.maxAllowedPacket) {
+            res = check(mysql_options(conn_, MYSQL_OPT_MAX_ALLOWED_PACKET, &*options_.maxAllowedPacket), "max_allowed_packet");
+        }
+        if (!res || options_.compress.empty()) {
+            return res;
+        }
+#ifdef SMARTDB_MYSQL_COMPRESSION_ALGORITHMS
+        res = check(mysql_options(conn_, MYSQL_OPT_COMPRESSION_ALGORITHMS, options_.compress.c_str()), "compress");
+        if (res && options_.zstdLevel) {
+            res = check(mysql_options(conn_, MYSQL_OPT_ZSTD_COMPRESSION_LEVEL, &*options_.zstdLevel), "zstd_level");
+        }
+        return res;
+#else
+        if (options_.compress != "zlib") {
+            return DbResult<void>::failure("MySQL compression '" + options_.compress +
+                                           "' requires libmysqlclient 8.0.18 or newer; only 'zlib' is available");
+        }
+        return check(mysql_options(conn_, MYSQL_OPT_COMPRESS, nullptr), "compress");
+#endif
+    }
 };
 
 class MysqlDriver : public IDriver {
 public:
+    // 传输层调优位于配置的 "mysql" 子对象中，例如 {"host": "...", "mysql": {"unix_socket": "/run/mysqld/mysqld.sock"}}
+    static MysqlOptions parseOptions(const nlohmann::json& config) {
+        MysqlOptions options;
+        if (!config.contains("mysql") || !config["mysql"].is_object()) {
+            return options;
+        }
+        const auto& block = config["mysql"];
+
+        auto readUnsigned = [&](const char* key, uint64_t max, auto apply) {
+            if (!block.contains(key)) {
+                return;
+            }
+            if (!block[key].is_number_integer() || block[key].get<int64_t>() < 0 ||
+                static_cast<uint64_t>(block[key].get<int64_t>()) > max) {
+                options.configError = std::string("MySQL option '") + key + "' must be a non-negative integer";
+                return;
+            }
+            apply(block[key].get<uint64_t>());
+        };
+        constexpr uint64_t kUintMax = std::numeric_limits<unsigned int>::max();
+        // 服务端 max_allowed_packet 上限为 1 GiB
+        constexpr uint64_t kPacketMax = uint64_t{1} << 30;
+
+        if (block.contains("unix_socket")) {
+            if (!block["unix_socket"].is_string() || block["unix_socket"].get<std::string>().empty()) {
+                options.configError = "MySQL option 'unix_socket' must be a non-empty path";
+            } else {
+                options.unixSocket = block["unix_socket"].get<std::string>();
+            }
+        }
+        if (block.contains("compress")) {
+            const auto& value = block["compress"];
+            std::string algorithms = value.is_boolean() ? (value.get<bool>() ? "zlib" : "")
+                                   : value.is_string() ? value.get<std::string>()
+                                   : "?";
+            std::transform(algorithms.begin(), algorithms.end(), algorithms.begin(),
+                           [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            // 只接受 zlib / zstd 组成的逗号列表，"uncompressed" 与空串表示关闭
+            if (algorithms == "uncompressed") {
+                algorithms.clear();
+            }
+            size_t start = 0;
+            while (!algorithms.empty() && start <= algorithms.size()) {
+                const size_t end = std::min(algorithms.find(',', start), algorithms.size());
+                const auto name = algorithms.substr(start, end - start);
+                if (name != "zlib" && name != "zstd") {
+                    options.configError = "Invalid value for MySQL option 'compress' (expected zlib, zstd or a comma list)";
+                    break;
+                }
+                start = end + 1;
+            }
+            options.compress = algorithms;
+        }
+        readUnsigned("zstd_level", 22, [&](uint64_t v) { options.zstdLevel = static_cast<unsigned int>(v); });
+        readUnsigned("connect_timeout", kUintMax, [&](uint64_t v) { options.connectTimeout = static_cast<unsigned int>(v); });
+        readUnsigned("read_timeout", kUintMax, [&](uint64_t v) { options.readTimeout = static_cast<unsigned int>(v); });
+        readUnsigned("write_timeout", kUintMax, [&](uint64_t v) { options.writeTimeout = static_cast<unsigned int>(v); });
+        readUnsigned("net_buffer_length", kPacketMax, [&](uint64_t v) { options.netBufferLength = static_cast<unsigned long>(v); });
+        readUnsigned("max_allowed_packet", kPacketMax, [&](uint64_t v) { options.maxAllowedPacket = static_cast<unsigned long>(v); });
+        if (block.contains("multi_statements")) {
+            if (!block["multi_statements"].is_boolean()) {
+                options.configError = "MySQL option 'multi_statements' must be a boolean";
+            } else {
+                options.multiStatements = block["multi_statements"].get<bool>();
+            }
+        }
+        return options;
+    }
+
     std::unique_ptr<IConnection> createConnection(const nlohmann::json& config) override {
-        return std::make_unique<MysqlConnection>(config);
+        return std::make_unique<MysqlConnection>(config, parseOptions(config));
     }
 
     std::string name() const override { return "mysql"; }
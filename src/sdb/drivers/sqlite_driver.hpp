@@ -1,7 +1,25 @@
 #pragma once
 #include "../idb.hpp"
+#include "../probes.hpp"
+#include "../query_phases.hpp"
+#include "../tracing.hpp"
+#include "sqlite_functions.hpp"
+#include "sqlite_memory.hpp"
+#include "sqlite_statement_stats.hpp"
 #include <sqlite3.h>
 #include <spdlog/spdlog.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 
 namespace sdb::drivers {
@@ -10,9 +28,24 @@ class SqliteResultSet : public IResultSet {
     sqlite3_stmt* stmt_ = nullptr;
     bool hasRow_ = false;
     std::vector<std::string> cols_;
+    // 非空时累计 sqlite3_step 耗时与行数，在 finalize 前写入统计
+    std::shared_ptr<SqliteStatementStats> stats_;
+    std::chrono::nanoseconds stepTime_{0};
+    uint64_t rows_ = 0;
+    // 所属连接的内存账户，step 期间的分配记到该连接名下
+    detail::SqliteMemoryAccount* account_ = nullptr;
+    // 从 query() 返回到结果集销毁；不成为当前 span，调用方在遍历期间开启的 span 仍挂在原父 span 下
+    TraceSpan fetchSpan_{"sqlite.fetch", "driver", TraceSpan::current(), false};
+    // query__end 在结果集销毁时触发，覆盖逐行 step
+    sdb::detail::QueryProbe probe_;
 
 public:
-    explicit SqliteResultSet(sqlite3_stmt* stmt) : stmt_(stmt) {
+    explicit SqliteResultSet(sqlite3_stmt* stmt, std::shared_ptr<SqliteStatementStats> stats = nullptr,
+                             detail::SqliteMemoryAccount* account = nullptr, sdb::detail::QueryProbe probe = {})
+        : stmt_(stmt), stats_(std::move(stats)), account_(account), probe_(std::move(probe)) {
+        if (account_) {
+            account_->retain();
+        }
         if (!stmt_) {
             return;
         }
@@ -24,17 +57,38 @@ public:
     }
 
     ~SqliteResultSet() override {
+        if (fetchSpan_.active()) {
+            fetchSpan_.setArg("rows", rows_);
+            fetchSpan_.setArg("step_us", std::chrono::duration_cast<std::chrono::microseconds>(stepTime_).count());
+            fetchSpan_.end();
+        }
         if (stmt_) {
+            detail::SqliteMemoryScope scope(account_);
+            if (stats_) {
+                stats_->record(stmt_, stepTime_, rows_);
+            }
             sqlite3_finalize(stmt_);
         }
+        if (account_) {
+            account_->release();
+        }
     }
 
+    SqliteResultSet(const SqliteResultSet&) = delete;
+    SqliteResultSet& operator=(const SqliteResultSet&) = delete;
+
     bool next() override {
         if (!stmt_) {
             return false;
         }
-        const int rc = sqlite3_step(stmt_);
-        hasRow_ = (rc == SQLITE_ROW);
+        detail::SqliteMemoryScope scope(account_);
+        if (!stats_ && !fetchSpan_.active()) {
+            return step();
+        }
+        const auto start = std::chrono::steady_clock::now();
+        step();
+        stepTime_ += std::chrono::steady_clock::now() - start;
+        rows_ += hasRow_ ? 1 : 0;
         return hasRow_;
     }
 
@@ -74,37 +128,603 @@ public:
     }
 
     std::vector<std::string> columnNames() override { return cols_; }
+
+private:
+    bool step() {
+        const int rc = sqlite3_step(stmt_);
+        hasRow_ = rc == SQLITE_ROW;
+        if (!hasRow_ && rc != SQLITE_DONE) {
+            probe_.failed();
+        }
+        return hasRow_;
+    }
+};
+
+namespace detail {
+inline std::atomic<int>& liveSqliteConnections() {
+    static std::atomic<int> count{0};
+    return count;
+}
+
+// 具名共享内存库在最后一个连接关闭时就会被释放。该锚点连接由同一配置创建的所有连接共同持有，
+// 连接归连接池所有，因此数据库的生命周期与连接池一致
+class SharedMemoryDatabase {
+public:
+    static DbResult<std::shared_ptr<SharedMemoryDatabase>> acquire(const std::string& uri) {
+        static std::mutex mtx;
+        static std::unordered_map<std::string, std::weak_ptr<SharedMemoryDatabase>> registry;
+
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = registry.find(uri);
+        if (it != registry.end()) {
+            if (auto existing = it->second.lock()) {
+                return DbResult<std::shared_ptr<SharedMemoryDatabase>>::success(std::move(existing));
+            }
+        }
+        // 顺带清掉已释放的库，否则每个用过的名称都会在表中留下一项
+        for (auto expired = registry.begin(); expired != registry.end();) {
+            expired = expired->second.expired() ? registry.erase(expired) : std::next(expired);
+        }
+
+        sqlite3* db = nullptr;
+        const int rc = sqlite3_open_v2(uri.c_str(), &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI, nullptr);
+        if (rc != SQLITE_OK) {
+            std::string message = db ? sqlite3_errmsg(db) : sqlite3_errstr(rc);
+            sqlite3_close(db);
+            return DbResult<std::shared_ptr<SharedMemoryDatabase>>::failure(
+                "Failed to create shared in-memory database: " + message, rc);
+        }
+        auto anchor = std::shared_ptr<SharedMemoryDatabase>(new SharedMemoryDatabase(db));
+        registry[uri] = anchor;
+        return DbResult<std::shared_ptr<SharedMemoryDatabase>>::success(std::move(anchor));
+    }
+
+    // 锚点也是打开的连接，存活期间 configureSqliteRuntime 不能关闭库或替换分配器
+    ~SharedMemoryDatabase() {
+        sqlite3_close(db_);
+        liveSqliteConnections().fetch_sub(1);
+    }
+
+    SharedMemoryDatabase(const SharedMemoryDatabase&) = delete;
+    SharedMemoryDatabase& operator=(const SharedMemoryDatabase&) = delete;
+
+private:
+    explicit SharedMemoryDatabase(sqlite3* db) : db_(db) { liveSqliteConnections().fetch_add(1); }
+
+    sqlite3* db_ = nullptr;
+};
+} // namespace detail
+
+struct SqliteOptions {
+    // sqlite3_open_v2 标志。连接池保证同一连接同一时刻只被一个线程使用，
+    // 因此池化连接可以开启 noMutex 省去每次 API 调用的互斥锁
+    bool noMutex = false;
+    bool readOnly = false;
+    bool uri = false;
+    bool sharedCache = false;
+    bool noFollow = false;
+
+    // 0 表示不等待，遇到锁立即返回 SQLITE_BUSY
+    std::chrono::milliseconds busyTimeout{0};
+
+    // 以下 PRAGMA 在每次 open() 时按顺序应用一次，未设置的保持 SQLite 默认值
+    std::optional<int64_t> pageSize;
+    std::optional<std::string> autoVacuum;   // NONE / FULL / INCREMENTAL，只对尚未建表的数据库生效
+    std::optional<std::string> lockingMode;  // NORMAL / EXCLUSIVE
+    std::optional<std::string> journalMode;  // DELETE / TRUNCATE / PERSIST / MEMORY / WAL / OFF
+    // WAL 自动检查点阈值（页），0 关闭；登记到 SqliteMaintenanceScheduler 的写连接由 WAL 钩子自动关闭
+    std::optional<int64_t> walAutocheckpoint;
+    std::optional<std::string> synchronous;  // OFF / NORMAL / FULL / EXTRA
+    std::optional<int64_t> cacheSize;        // 正数为页数，负数为 KiB
+    std::optional<int64_t> mmapSize;         // 字节
+    std::optional<std::string> tempStore;    // DEFAULT / FILE / MEMORY
+    std::optional<bool> queryOnly;
+
+    // 回读值与期望不一致时：false 仅记录警告，true 令 open() 失败
+    bool strictPragmas = false;
+    std::string profile;
+    // 配置解析错误会延迟到 open() 时返回
+    std::string configError;
+
+    // 具名共享内存库："memdb" 使用 memdb VFS（file:/name?vfs=memdb），
+    // "shared_cache" 使用 file:name?mode=memory&cache=shared
+    std::string sharedMemoryName;
+    std::string sharedMemoryMode = "memdb";
+    std::shared_ptr<detail::SharedMemoryDatabase> sharedMemory;
+
+    // 由驱动共享的 C++ SQL 函数，池中每个连接都会注册
+    std::shared_ptr<SqliteFunctionRegistry> functions;
+
+    // 非空时按规范化语句收集 sqlite3_stmt_status 计数器；配置中 "statement_stats": true 时使用驱动的统计
+    std::shared_ptr<SqliteStatementStats> statementStats;
+    bool collectStatementStats = false;
+
+    // 连接级 lookaside（SQLITE_DBCONFIG_LOOKASIDE），两项都设置时在 open() 后立即生效；槽数为 0 关闭
+    std::optional<int64_t> lookasideSlotSize;
+    std::optional<int64_t> lookasideSlots;
+    // 同一配置的连接共享的内存组（由驱动填充），memoryBudget > 0 时对页缓存 + schema + 语句内存执行预算
+    std::shared_ptr<SqliteMemoryGroup> memoryGroup;
+    int64_t memoryBudget = 0;
+
+    int openFlags() const {
+        int flags = readOnly ? SQLITE_OPEN_READONLY : (SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+        if (noMutex) {
+            flags |= SQLITE_OPEN_NOMUTEX;
+        }
+        if (uri) {
+            flags |= SQLITE_OPEN_URI;
+        }
+        if (sharedCache) {
+            flags |= SQLITE_OPEN_SHAREDCACHE;
+        }
+#ifdef SQLITE_OPEN_NOFOLLOW
+        if (noFollow) {
+            flags |= SQLITE_OPEN_NOFOLLOW;
+        }
+#endif
+        return flags;
+    }
+};
+
+// 进程级 SQLite 设置，只能在没有打开的连接时调用（通常在 main 开头）
+struct SqliteRuntimeOptions {
+    enum class Threading { Default, SingleThread, MultiThread, Serialized };
+    Threading threading = Threading::Default;
+    // false 时关闭 sqlite3_memory_used 等内存统计，省去每次分配的全局锁
+    std::optional<bool> memStatus;
+    // 安装记账分配器（SQLITE_CONFIG_MALLOC 包装默认分配器），按连接统计分配字节数；false 恢复默认分配器
+    std::optional<bool> accountingAllocator;
+    // SQLITE_CONFIG_PAGECACHE：预分配 slots 个 slotSize 字节的页缓存槽，用尽后回退到普通分配；0 槽表示不使用
+    int pageCacheSlotSize = 0;
+    int pageCacheSlots = 0;
+    // SQLITE_CONFIG_LOOKASIDE：新连接的默认 lookaside 槽大小与槽数
+    std::optional<int> lookasideSlotSize;
+    std::optional<int> lookasideSlots;
+};
+
+inline DbResult<void> configureSqliteRuntime(const SqliteRuntimeOptions& options) {
+    static std::mutex mtx;
+    std::lock_guard<std::mutex> lock(mtx);
+    if (detail::liveSqliteConnections().load() != 0) {
+        return DbResult<void>::failure("configureSqliteRuntime must be called while no SQLite connection is open",
+                                       SQLITE_MISUSE);
+    }
+
+    // sqlite3_config 只能在库未初始化时调用，之前的 open 可能已隐式初始化
+    int rc = sqlite3_shutdown();
+    if (rc != SQLITE_OK) {
+        return DbResult<void>::failure("sqlite3_shutdown failed", rc);
+    }
+    switch (options.threading) {
+        case SqliteRuntimeOptions::Threading::SingleThread:
+            rc = sqlite3_config(SQLITE_CONFIG_SINGLETHREAD);
+            break;
+        case SqliteRuntimeOptions::Threading::MultiThread:
+            rc = sqlite3_config(SQLITE_CONFIG_MULTITHREAD);
+            break;
+        case SqliteRuntimeOptions::Threading::Serialized:
+            rc = sqlite3_config(SQLITE_CONFIG_SERIALIZED);
+            break;
+        case SqliteRuntimeOptions::Threading::Default:
+            break;
+    }
+    if (rc != SQLITE_OK) {
+        return DbResult<void>::failure("sqlite3_config threading mode rejected (library compiled single-threaded?)", rc);
+    }
+    if (options.memStatus) {
+        rc = sqlite3_config(SQLITE_CONFIG_MEMSTATUS, *options.memStatus ? 1 : 0);
+        if (rc != SQLITE_OK) {
+            return DbResult<void>::failure("sqlite3_config memstatus failed", rc);
+        }
+    }
+    using Allocator = detail::SqliteAccountingAllocator;
+    if (options.accountingAllocator && *options.accountingAllocator != Allocator::installed().load()) {
+        if (*options.accountingAllocator) {
+            rc = sqlite3_config(SQLITE_CONFIG_GETMALLOC, &Allocator::underlying());
+            if (rc == SQLITE_OK) {
+                rc = sqlite3_config(SQLITE_CONFIG_MALLOC, Allocator::methods());
+            }
+        } else {
+            rc = sqlite3_config(SQLITE_CONFIG_MALLOC, &Allocator::underlying());
+        }
+        if (rc != SQLITE_OK) {
+            return DbResult<void>::failure("sqlite3_config malloc failed", rc);
+        }
+        Allocator::installed().store(*options.accountingAllocator);
+    }
+    // 页缓存缓冲区必须存活到下一次 sqlite3_shutdown，这里在 shutdown 之后才替换
+    static std::unique_ptr<char[]> pageCache;
+    if (options.pageCacheSlotSize > 0 && options.pageCacheSlots > 0) {
+        auto buffer = std::make_unique<char[]>(static_cast<size_t>(options.pageCacheSlotSize) *
+                                               static_cast<size_t>(options.pageCacheSlots));
+        rc = sqlite3_config(SQLITE_CONFIG_PAGECACHE, buffer.get(), options.pageCacheSlotSize, options.pageCacheSlots);
+        if (rc != SQLITE_OK) {
+            return DbResult<void>::failure("sqlite3_config pagecache failed", rc);
+        }
+        pageCache = std::move(buffer);
+    } else if (pageCache) {
+        rc = sqlite3_config(SQLITE_CONFIG_PAGECACHE, nullptr, 0, 0);
+        if (rc != SQLITE_OK) {
+            return DbResult<void>::failure("sqlite3_config pagecache failed", rc);
+        }
+        pageCache.reset();
+    }
+    if (options.lookasideSlotSize || options.lookasideSlots) {
+        rc = sqlite3_config(SQLITE_CONFIG_LOOKASIDE, options.lookasideSlotSize.value_or(1200),
+                            options.lookasideSlots.value_or(100));
+        if (rc != SQLITE_OK) {
+            return DbResult<void>::failure("sqlite3_config lookaside failed", rc);
+        }
+    }
+    rc = sqlite3_initialize();
+    if (rc != SQLITE_OK) {
+        return DbResult<void>::failure("sqlite3_initialize failed", rc);
+    }
+    return DbResult<void>::success();
+}
+
+// 内置调优模板，配置中的同名键会覆盖模板值
+inline std::optional<SqliteOptions> sqliteProfile(const std::string& name) {
+    SqliteOptions options;
+    options.profile = name;
+    if (name == "fast-durable") {
+        // WAL + NORMAL：提交不再每次 fsync 主库，崩溃时只可能丢失最后的事务，数据库不会损坏
+        options.busyTimeout = std::chrono::milliseconds(5000);
+        options.journalMode = "WAL";
+        options.synchronous = "NORMAL";
+        options.cacheSize = -64 * 1024;
+        options.mmapSize = int64_t{256} * 1024 * 1024;
+        options.tempStore = "MEMORY";
+        return options;
+    }
+    if (name == "bulk-load") {
+        // 仅用于可重建的数据导入：关闭 fsync，独占锁避免反复获取文件锁
+        options.journalMode = "MEMORY";
+        options.synchronous = "OFF";
+        options.lockingMode = "EXCLUSIVE";
+        options.cacheSize = -256 * 1024;
+        options.tempStore = "MEMORY";
+        return options;
+    }
+    if (name == "read-only-analytics") {
+        options.readOnly = true;
+        options.busyTimeout = std::chrono::milliseconds(5000);
+        options.cacheSize = -128 * 1024;
+        options.mmapSize = int64_t{1024} * 1024 * 1024;
+        options.tempStore = "MEMORY";
+        return options;
+    }
+    return std::nullopt;
+}
+
+struct SqliteBackupOptions {
+    // 每步复制的页数，-1 表示一次完成。步与步之间会释放源库的读锁，写者不会被长时间阻塞
+    int pagesPerStep = 256;
+    std::chrono::milliseconds sleepBetweenSteps{0};
+    // 源库或目标库被锁时每次重试前的等待，以及累计等待上限
+    std::chrono::milliseconds busyRetryDelay{10};
+    std::chrono::milliseconds busyTimeout{5000};
+    std::string sourceSchema = "main";
+    std::string destSchema = "main";
+    // 每步完成后回调 (剩余页数, 总页数)，返回 false 中止备份
+    std::function<bool(int remaining, int total)> progress;
 };
 
 class SqliteConnection : public IConnection {
+public:
+    // 返回 true 表示继续等待并重试，false 表示放弃并返回 SQLITE_BUSY
+    using BusyHandler = std::function<bool(int attempt)>;
+    // 每次提交写入 WAL 后调用，参数为 WAL 中的帧数
+    using WalHook = std::function<void(int frames)>;
+
+private:
     sqlite3* db_ = nullptr;
     std::string connStr_;
+    SqliteOptions options_;
+    BusyHandler busyHandler_;
+    WalHook walHook_;
+    std::map<std::string, std::string> effectivePragmas_;
+    SqliteFunctionRegistry localFunctions_;
+    uint64_t sharedFunctionsVersion_ = 0;
+    uint64_t localFunctionsVersion_ = 0;
+    detail::SqliteMemoryAccount* account_ = detail::SqliteMemoryAccount::create();
+    // 在内存组中发布本连接计数器的位置，open 时创建、close 时移除
+    std::shared_ptr<SqliteMemoryGroup::Member> memoryMember_;
     std::string lastErr_;
 
 public:
     explicit SqliteConnection(std::string str) : connStr_(std::move(str)) {}
-    ~SqliteConnection() override { close(); }
+    SqliteConnection(std::string str, SqliteOptions options)
+        : connStr_(std::move(str)), options_(std::move(options)) {}
+    ~SqliteConnection() override {
+        close();
+        account_->release();
+    }
+
+    SqliteConnection(const SqliteConnection&) = delete;
+    SqliteConnection& operator=(const SqliteConnection&) = delete;
 
     DbResult<void> open() override {
         if (isOpen()) {
             return DbResult<void>::success();
         }
+        if (!options_.configError.empty()) {
+            lastErr_ = options_.configError;
+            return DbResult<void>::failure(lastErr_, SQLITE_MISUSE);
+        }
+        TraceSpan span("sqlite.open", "driver");
 
-        const int rc = sqlite3_open(connStr_.c_str(), &db_);
+        detail::SqliteMemoryScope scope(account_);
+        int rc = sqlite3_open_v2(connStr_.c_str(), &db_, options_.openFlags(), nullptr);
+        if (db_) {
+            detail::liveSqliteConnections().fetch_add(1);
+            if (options_.memoryGroup) {
+                memoryMember_ = options_.memoryGroup->attach(db_, account_);
+            }
+        }
         if (rc != SQLITE_OK) {
-            lastErr_ = sqlite3_errmsg(db_ ? db_ : nullptr);
+            lastErr_ = db_ ? sqlite3_errmsg(db_) : sqlite3_errstr(rc);
             close();
             return DbResult<void>::failure(lastErr_, rc);
         }
+        // lookaside 只能在连接尚未分配任何 lookaside 内存时修改，因此放在所有语句之前
+        if (options_.lookasideSlotSize && options_.lookasideSlots) {
+            rc = sqlite3_db_config(db_, SQLITE_DBCONFIG_LOOKASIDE, nullptr,
+                                   static_cast<int>(*options_.lookasideSlotSize), static_cast<int>(*options_.lookasideSlots));
+            if (rc != SQLITE_OK) {
+                lastErr_ = "sqlite3_db_config lookaside failed";
+                close();
+                return DbResult<void>::failure(lastErr_, rc);
+            }
+        }
+        if (busyHandler_) {
+            sqlite3_busy_handler(db_, &SqliteConnection::busyTrampoline, this);
+        } else if (options_.busyTimeout.count() > 0) {
+            sqlite3_busy_timeout(db_, static_cast<int>(options_.busyTimeout.count()));
+        }
+        auto pragmaRes = applyPragmas();
+        if (!pragmaRes) {
+            lastErr_ = pragmaRes.error().message;
+            close();
+            return DbResult<void>::failure(lastErr_, pragmaRes.error().code);
+        }
+        // PRAGMA wal_autocheckpoint 会替换 WAL 钩子，因此在 PRAGMA 之后安装
+        if (walHook_) {
+            sqlite3_wal_hook(db_, &SqliteConnection::walTrampoline, this);
+        }
+        auto functionsRes = syncFunctions();
+        if (!functionsRes) {
+            close();
+            return functionsRes;
+        }
         lastErr_.clear();
         return DbResult<void>::success();
     }
 
+    // 设置后在内部等待锁释放，而不是立即返回 SQLITE_BUSY；会替换已安装的 busy handler
+    void setBusyTimeout(std::chrono::milliseconds timeout) {
+        options_.busyTimeout = timeout;
+        busyHandler_ = nullptr;
+        if (db_) {
+            sqlite3_busy_timeout(db_, static_cast<int>(timeout.count() > 0 ? timeout.count() : 0));
+        }
+    }
+
+    void setBusyHandler(BusyHandler handler) {
+        busyHandler_ = std::move(handler);
+        if (!db_) {
+            return;
+        }
+        if (busyHandler_) {
+            sqlite3_busy_handler(db_, &SqliteConnection::busyTrampoline, this);
+        } else {
+            sqlite3_busy_handler(db_, nullptr, nullptr);
+        }
+    }
+
+    // 安装后 SQLite 不再在提交时自动检查点（sqlite3_wal_hook 与 wal_autocheckpoint 互斥），
+    // 检查点交给外部调度；重新 open 后自动恢复。须在连接未被其他线程使用时调用
+    void setWalHook(WalHook hook) {
+        walHook_ = std::move(hook);
+        if (!db_) {
+            return;
+        }
+        if (walHook_) {
+            sqlite3_wal_hook(db_, &SqliteConnection::walTrampoline, this);
+        } else {
+            // 恢复自动检查点，未配置时为 SQLite 默认的 1000 页
+            sqlite3_wal_autocheckpoint(db_, static_cast<int>(options_.walAutocheckpoint.value_or(1000)));
+        }
+    }
+
+    const SqliteOptions& options() const { return options_; }
+
+    // 供快照、备份等 SQLite 专有功能使用；未打开时为 nullptr
+    sqlite3* nativeHandle() const { return db_; }
+
+    // 只注册到本连接（重新 open 后自动恢复）；需要在整个连接池生效时使用 SqliteDriver::functions()
+    template <typename Fn>
+    DbResult<void> createScalarFunction(const std::string& name, Fn fn, bool deterministic = true) {
+        localFunctions_.scalar(name, std::move(fn), deterministic);
+        return isOpen() ? syncFunctions() : DbResult<void>::success();
+    }
+
+    template <typename State, typename Step, typename Final>
+    DbResult<void> createAggregateFunction(const std::string& name, Step step, Final final, bool deterministic = true) {
+        localFunctions_.aggregate<State>(name, std::move(step), std::move(final), deterministic);
+        return isOpen() ? syncFunctions() : DbResult<void>::success();
+    }
+
+    // 在本连接上安装虚拟表模块等扩展，重新 open 后自动恢复
+    DbResult<void> createModule(const std::string& name, std::function<int(sqlite3*)> install) {
+        localFunctions_.module(name, std::move(install));
+        return isOpen() ? syncFunctions() : DbResult<void>::success();
+    }
+
+    // 在线备份到另一个已打开的连接（可以是文件库或内存库）
+    DbResult<void> backupTo(SqliteConnection& dest, const SqliteBackupOptions& options = {}) {
+        if (!isOpen() || !dest.isOpen()) {
+            return DbResult<void>::failure("Backup requires both connections to be open");
+        }
+        sqlite3_backup* backup = sqlite3_backup_init(dest.db_, options.destSchema.c_str(), db_, options.sourceSchema.c_str());
+        if (!backup) {
+            return DbResult<void>::failure(sqlite3_errmsg(dest.db_), sqlite3_errcode(dest.db_));
+        }
+
+        const int pagesPerStep = options.pagesPerStep == 0 ? -1 : options.pagesPerStep;
+        std::chrono::milliseconds waited{0};
+        int rc = SQLITE_OK;
+        while (true) {
+            rc = sqlite3_backup_step(backup, pagesPerStep);
+            if (rc == SQLITE_DONE) {
+                break;
+            }
+            if (rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+                if (waited >= options.busyTimeout) {
+                    break;
+                }
+                std::this_thread::sleep_for(options.busyRetryDelay);
+                waited += options.busyRetryDelay.count() > 0 ? options.busyRetryDelay : std::chrono::milliseconds(1);
+                continue;
+            }
+            if (rc != SQLITE_OK) {
+                break;
+            }
+            if (options.progress && !options.progress(sqlite3_backup_remaining(backup), sqlite3_backup_pagecount(backup))) {
+                sqlite3_backup_finish(backup);
+                return DbResult<void>::failure("Backup aborted by progress callback", SQLITE_ABORT);
+            }
+            if (options.sleepBetweenSteps.count() > 0) {
+                std::this_thread::sleep_for(options.sleepBetweenSteps);
+            }
+        }
+        if (rc == SQLITE_DONE && options.progress) {
+            (void)options.progress(0, sqlite3_backup_pagecount(backup));
+        }
+
+        const int finishRc = sqlite3_backup_finish(backup);
+        if (rc != SQLITE_DONE) {
+            return DbResult<void>::failure(sqlite3_errstr(rc), rc);
+        }
+        if (finishRc != SQLITE_OK) {
+            return DbResult<void>::failure(sqlite3_errmsg(dest.db_), finishRc);
+        }
+        return DbResult<void>::success();
+    }
+
+    DbResult<void> backupTo(const std::string& path, const SqliteBackupOptions& options = {}) {
+        SqliteConnection dest(path);
+        auto openRes = dest.open();
+        if (!openRes) {
+            return openRes;
+        }
+        return backupTo(dest, options);
+    }
+
+#ifndef SQLITE_OMIT_DESERIALIZE
+    // 整库序列化为页镜像。源在 memdb VFS 上（deserialize 得到的库或 memdb 模式的 shared_memory）时直接引用其连续内存，只拷贝一次到结果；
+    // 其他库（文件库、普通 ":memory:"）先由 SQLite 逐页读出到临时缓冲区，再拷贝到结果，共两次
+    DbResult<std::vector<uint8_t>> serialize(const std::string& schema = "main") {
+        if (!isOpen()) {
+            return DbResult<std::vector<uint8_t>>::failure("Connection is closed");
+        }
+        sqlite3_int64 size = 0;
+        if (auto* data = sqlite3_serialize(db_, schema.c_str(), &size, SQLITE_SERIALIZE_NOCOPY)) {
+            return DbResult<std::vector<uint8_t>>::success(std::vector<uint8_t>(data, data + size));
+        }
+        unsigned char* copy = sqlite3_serialize(db_, schema.c_str(), &size, 0);
+        if (!copy) {
+            return DbResult<std::vector<uint8_t>>::failure(
+                size == 0 ? "Serialize failed: database is empty or out of memory" : sqlite3_errmsg(db_), SQLITE_NOMEM);
+        }
+        std::vector<uint8_t> image(copy, copy + size);
+        sqlite3_free(copy);
+        return DbResult<std::vector<uint8_t>>::success(std::move(image));
+    }
+
+    // 用页镜像替换 schema 的内容，连接随后成为一个可写（或只读）的内存库
+    DbResult<void> deserialize(const uint8_t* data, size_t size, bool readOnly = false,
+                               const std::string& schema = "main") {
+        if (!isOpen()) {
+            return DbResult<void>::failure("Connection is closed");
+        }
+        auto* buffer = static_cast<unsigned char*>(sqlite3_malloc64(size == 0 ? 1 : size));
+        if (!buffer) {
+            return DbResult<void>::failure("Deserialize failed: out of memory", SQLITE_NOMEM);
+        }
+        if (size > 0) {
+            std::memcpy(buffer, data, size);
+        }
+        const unsigned flags = SQLITE_DESERIALIZE_FREEONCLOSE |
+                               (readOnly ? SQLITE_DESERIALIZE_READONLY : SQLITE_DESERIALIZE_RESIZEABLE);
+        const auto sz = static_cast<sqlite3_int64>(size);
+        const int rc = sqlite3_deserialize(db_, schema.c_str(), buffer, sz, sz, flags);
+        if (rc != SQLITE_OK) {
+            // 失败时 SQLite 已按 FREEONCLOSE 释放 buffer
+            return DbResult<void>::failure(sqlite3_errmsg(db_), rc);
+        }
+        return DbResult<void>::success();
+    }
+
+    DbResult<void> deserialize(const std::vector<uint8_t>& image, bool readOnly = false,
+                               const std::string& schema = "main") {
+        return deserialize(image.data(), image.size(), readOnly, schema);
+    }
+
+    // 把当前库整体复制到 dest（通常是 ":memory:" 连接），用于测试夹具或按请求的参考数据副本。
+    // 源是 memdb 时只有 deserialize 中的一次 memcpy；其他库走 serialize() 的两次拷贝，再加这一次
+    DbResult<void> cloneInto(SqliteConnection& dest, const std::string& schema = "main") {
+        if (!isOpen() || !dest.isOpen()) {
+            return DbResult<void>::failure("Clone requires both connections to be open");
+        }
+        sqlite3_int64 size = 0;
+        if (const auto* data = sqlite3_serialize(db_, schema.c_str(), &size, SQLITE_SERIALIZE_NOCOPY)) {
+            return dest.deserialize(data, static_cast<size_t>(size), false, schema);
+        }
+        auto imageRes = serialize(schema);
+        if (!imageRes) {
+            return DbResult<void>::failure(imageRes.error().message, imageRes.error().code);
+        }
+        return dest.deserialize(imageRes.value(), false, schema);
+    }
+#endif
+
+    // open() 后回读到的 PRAGMA 实际值（小写），仅包含配置过的项
+    const std::map<std::string, std::string>& effectivePragmas() const { return effectivePragmas_; }
+
+    // 本连接的 sqlite3_db_status 计数器，以及记账分配器归属到本连接的字节数
+    SqliteMemoryStatus memoryStatus() const {
+        auto status = SqliteMemoryStatus::read(db_);
+        status.accountedBytes = account_->bytes();
+        status.accountedPeak = account_->peak();
+        return status;
+    }
+
+    // 释放本连接未使用的页缓存，返回释放前后页缓存字节数之差
+    int64_t releaseMemory() {
+        if (!db_) {
+            return 0;
+        }
+        detail::SqliteMemoryScope scope(account_);
+        const int64_t before = SqliteMemoryStatus::read(db_).cacheUsed;
+        sqlite3_db_release_memory(db_);
+        return before - SqliteMemoryStatus::read(db_).cacheUsed;
+    }
+
     void close() override {
         if (db_) {
+            detail::SqliteMemoryScope scope(account_);
+            if (memoryMember_) {
+                options_.memoryGroup->detach(memoryMember_);
+                memoryMember_.reset();
+            }
             sqlite3_close(db_);
             db_ = nullptr;
+            detail::liveSqliteConnections().fetch_sub(1);
         }
+        effectivePragmas_.clear();
+        sharedFunctionsVersion_ = 0;
+        localFunctionsVersion_ = 0;
     }
 
     bool isOpen() const override { return db_ != nullptr; }
@@ -114,19 +734,32 @@ public:
             lastErr_ = "Connection is closed";
             return DbResult<std::shared_ptr<IResultSet>>::failure(lastErr_);
         }
+        if (auto syncRes = syncFunctions(); !syncRes) {
+            return DbResult<std::shared_ptr<IResultSet>>::failure(syncRes.error().message, syncRes.error().code);
+        }
+        detail::SqliteMemoryScope scope(account_);
+        enforceMemoryBudget();
 
+        sdb::detail::QueryProbe probe(this, sql);
+        ScopedQueryPhase phase(QueryPhase::Prepare);
+        TraceSpan span("sqlite.prepare", "driver");
+        span.setStatement(sql);
         sqlite3_stmt* stmt = nullptr;
         const int rc = sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr);
         if (rc != SQLITE_OK) {
             lastErr_ = sqlite3_errmsg(db_);
+            span.setError(lastErr_, rc);
             spdlog::error("SQLite query prepare failed: {}", lastErr_);
             if (stmt) {
                 sqlite3_finalize(stmt);
             }
             return DbResult<std::shared_ptr<IResultSet>>::failure(lastErr_, rc);
         }
+        span.end();
         lastErr_.clear();
-        return DbResult<std::shared_ptr<IResultSet>>::success(std::make_shared<SqliteResultSet>(stmt));
+        probe.succeeded();
+        return DbResult<std::shared_ptr<IResultSet>>::success(
+            std::make_shared<SqliteResultSet>(stmt, options_.statementStats, account_, std::move(probe)));
     }
 
     DbResult<int64_t> execute(const std::string& sql) override {
@@ -134,15 +767,33 @@ public:
             lastErr_ = "Connection is closed";
             return DbResult<int64_t>::failure(lastErr_);
         }
+        if (auto syncRes = syncFunctions(); !syncRes) {
+            return DbResult<int64_t>::failure(syncRes.error().message, syncRes.error().code);
+        }
+        detail::SqliteMemoryScope scope(account_);
+        enforceMemoryBudget();
+
+        sdb::detail::QueryProbe probe(this, sql);
+        TraceSpan span("sqlite.exec", "driver");
+        span.setStatement(sql);
+        if (options_.statementStats) {
+            auto res = executeScriptWithStats(sql);
+            if (res) {
+                probe.succeeded();
+            }
+            return res;
+        }
 
         char* err = nullptr;
         const int rc = sqlite3_exec(db_, sql.c_str(), nullptr, nullptr, &err);
         if (rc != SQLITE_OK) {
             lastErr_ = err ? err : "Unknown error";
+            span.setError(lastErr_, rc);
             sqlite3_free(err);
             return DbResult<int64_t>::failure(lastErr_, rc);
         }
         lastErr_.clear();
+        probe.succeeded();
         return DbResult<int64_t>::success(sqlite3_changes(db_));
     }
 
@@ -151,11 +802,21 @@ public:
             lastErr_ = "Connection is closed";
             return DbResult<int64_t>::failure(lastErr_);
         }
+        if (auto syncRes = syncFunctions(); !syncRes) {
+            return DbResult<int64_t>::failure(syncRes.error().message, syncRes.error().code);
+        }
+        detail::SqliteMemoryScope scope(account_);
+        enforceMemoryBudget();
 
+        sdb::detail::QueryProbe probe(this, sql);
+        ScopedQueryPhase preparePhase(QueryPhase::Prepare);
+        TraceSpan prepareSpan("sqlite.prepare", "driver");
+        prepareSpan.setStatement(sql);
         sqlite3_stmt* stmt = nullptr;
         int rc = sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr);
         if (rc != SQLITE_OK) {
             lastErr_ = sqlite3_errmsg(db_);
+            prepareSpan.setError(lastErr_, rc);
             return DbResult<int64_t>::failure(lastErr_, rc);
         }
 
@@ -184,20 +845,31 @@ public:
 
             if (rc != SQLITE_OK) {
                 lastErr_ = sqlite3_errmsg(db_);
+                prepareSpan.setError(lastErr_, rc);
                 sqlite3_finalize(stmt);
                 return DbResult<int64_t>::failure(lastErr_, rc);
             }
         }
+        prepareSpan.setArg("params", params.size());
+        prepareSpan.end();
+        preparePhase.end();
 
+        TraceSpan stepSpan("sqlite.step", "driver");
+        const auto start = std::chrono::steady_clock::now();
         rc = sqlite3_step(stmt);
+        if (options_.statementStats) {
+            options_.statementStats->record(stmt, std::chrono::steady_clock::now() - start, 0);
+        }
         if (rc != SQLITE_DONE) {
             lastErr_ = sqlite3_errmsg(db_);
+            stepSpan.setError(lastErr_, rc);
             sqlite3_finalize(stmt);
             return DbResult<int64_t>::failure(lastErr_, rc);
         }
 
         sqlite3_finalize(stmt);
         lastErr_.clear();
+        probe.succeeded();
         return DbResult<int64_t>::success(sqlite3_changes(db_));
     }
 
@@ -224,16 +896,414 @@ public:
         }
         return DbResult<void>::success();
     }
+
+private:
+    void enforceMemoryBudget() {
+        if (memoryMember_) {
+            options_.memoryGroup->enforceBudget(db_, *memoryMember_);
+        }
+    }
+
+    // 与 sqlite3_exec 相同地逐条执行多语句脚本，但保留每条语句的句柄以便读取计数器
+    DbResult<int64_t> executeScriptWithStats(const std::string& sql) {
+        const char* tail = sql.c_str();
+        while (tail && *tail) {
+            sqlite3_stmt* stmt = nullptr;
+            int rc = sqlite3_prepare_v2(db_, tail, -1, &stmt, &tail);
+            if (rc != SQLITE_OK) {
+                lastErr_ = sqlite3_errmsg(db_);
+                return DbResult<int64_t>::failure(lastErr_, rc);
+            }
+            if (!stmt) {
+                // 只剩空白或注释
+                break;
+            }
+            uint64_t rows = 0;
+            const auto start = std::chrono::steady_clock::now();
+            while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+                ++rows;
+            }
+            options_.statementStats->record(stmt, std::chrono::steady_clock::now() - start, rows);
+            if (rc != SQLITE_DONE) {
+                lastErr_ = sqlite3_errmsg(db_);
+                sqlite3_finalize(stmt);
+                return DbResult<int64_t>::failure(lastErr_, rc);
+            }
+            sqlite3_finalize(stmt);
+        }
+        lastErr_.clear();
+        return DbResult<int64_t>::success(sqlite3_changes(db_));
+    }
+
+    // 注册自上次同步以来新增的函数；版本号未变化时只是两次原子读取
+    DbResult<void> syncFunctions() {
+        if (options_.functions && options_.functions->version() != sharedFunctionsVersion_) {
+            auto res = options_.functions->applyTo(db_, sharedFunctionsVersion_);
+            if (!res) {
+                lastErr_ = res.error().message;
+                return DbResult<void>::failure(lastErr_, res.error().code);
+            }
+            sharedFunctionsVersion_ = res.value();
+        }
+        if (localFunctions_.version() != localFunctionsVersion_) {
+            auto res = localFunctions_.applyTo(db_, localFunctionsVersion_);
+            if (!res) {
+                lastErr_ = res.error().message;
+                return DbResult<void>::failure(lastErr_, res.error().code);
+            }
+            localFunctionsVersion_ = res.value();
+        }
+        return DbResult<void>::success();
+    }
+
+    DbResult<std::string> queryPragma(const std::string& body) {
+        sqlite3_stmt* stmt = nullptr;
+        const std::string sql = "PRAGMA " + body;
+        int rc = sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr);
+        if (rc != SQLITE_OK) {
+            return DbResult<std::string>::failure(sqlite3_errmsg(db_), rc);
+        }
+        std::string value;
+        rc = sqlite3_step(stmt);
+        if (rc == SQLITE_ROW) {
+            const auto* text = sqlite3_column_text(stmt, 0);
+            value = text ? reinterpret_cast<const char*>(text) : "";
+        }
+        sqlite3_finalize(stmt);
+        if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+            return DbResult<std::string>::failure(sqlite3_errmsg(db_), rc);
+        }
+        std::transform(value.begin(), value.end(), value.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return DbResult<std::string>::success(std::move(value));
+    }
+
+    // 数值形式的枚举 PRAGMA 回读为数字，统一转换为名称再比较
+    static std::string canonicalPragmaValue(const std::string& name, std::string value) {
+        std::transform(value.begin(), value.end(), value.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (name == "synchronous") {
+            static const char* names[] = {"off", "normal", "full", "extra"};
+            if (value.size() == 1 && value[0] >= '0' && value[0] <= '3') {
+                return names[value[0] - '0'];
+            }
+        } else if (name == "auto_vacuum") {
+            static const char* names[] = {"none", "full", "incremental"};
+            if (value.size() == 1 && value[0] >= '0' && value[0] <= '2') {
+                return names[value[0] - '0'];
+            }
+        } else if (name == "temp_store") {
+            static const char* names[] = {"default", "file", "memory"};
+            if (value.size() == 1 && value[0] >= '0' && value[0] <= '2') {
+                return names[value[0] - '0'];
+            }
+        }
+        return value;
+    }
+
+    DbResult<void> applyPragmas() {
+        effectivePragmas_.clear();
+        std::vector<std::pair<std::string, std::string>> pragmas;
+        if (options_.busyTimeout.count() > 0 && !busyHandler_) {
+            pragmas.emplace_back("busy_timeout", std::to_string(options_.busyTimeout.count()));
+        }
+        // page_size 必须在切换到 WAL 之前设置，且只对新建的数据库生效
+        if (options_.pageSize) {
+            pragmas.emplace_back("page_size", std::to_string(*options_.pageSize));
+        }
+        if (options_.autoVacuum) {
+            pragmas.emplace_back("auto_vacuum", *options_.autoVacuum);
+        }
+        if (options_.lockingMode) {
+            pragmas.emplace_back("locking_mode", *options_.lockingMode);
+        }
+        if (options_.journalMode) {
+            pragmas.emplace_back("journal_mode", *options_.journalMode);
+        }
+        if (options_.walAutocheckpoint) {
+            pragmas.emplace_back("wal_autocheckpoint", std::to_string(*options_.walAutocheckpoint));
+        }
+        if (options_.synchronous) {
+            pragmas.emplace_back("synchronous", *options_.synchronous);
+        }
+        if (options_.cacheSize) {
+            pragmas.emplace_back("cache_size", std::to_string(*options_.cacheSize));
+        }
+        if (options_.mmapSize) {
+            pragmas.emplace_back("mmap_size", std::to_string(*options_.mmapSize));
+        }
+        if (options_.tempStore) {
+            pragmas.emplace_back("temp_store", *options_.tempStore);
+        }
+        if (options_.queryOnly) {
+            pragmas.emplace_back("query_only", *options_.queryOnly ? "1" : "0");
+        }
+
+        std::string mismatches;
+        for (const auto& [name, value] : pragmas) {
+            // journal_mode 等 PRAGMA 会返回一行结果，统一走 prepare/step
+            auto setRes = queryPragma(name + " = " + value);
+            if (!setRes) {
+                return DbResult<void>::failure("Failed to apply PRAGMA " + name + ": " + setRes.error().message,
+                                               setRes.error().code);
+            }
+            auto readRes = queryPragma(name);
+            if (!readRes) {
+                return DbResult<void>::failure("Failed to read back PRAGMA " + name + ": " + readRes.error().message,
+                                               readRes.error().code);
+            }
+            const auto actual = canonicalPragmaValue(name, readRes.value());
+            effectivePragmas_[name] = actual;
+            if (actual != canonicalPragmaValue(name, value)) {
+                mismatches += (mismatches.empty() ? "" : ", ") + name + " expected " + value + " got " + actual;
+            }
+        }
+
+        if (!mismatches.empty()) {
+            if (options_.strictPragmas) {
+                return DbResult<void>::failure("SQLite PRAGMA verification failed: " + mismatches, SQLITE_MISMATCH);
+            }
+            spdlog::warn("SQLite PRAGMA verification for '{}': {}", connStr_, mismatches);
+        }
+        return DbResult<void>::success();
+    }
+
+    static int walTrampoline(void* self, sqlite3*, const char*, int frames) {
+        auto* conn = static_cast<SqliteConnection*>(self);
+        try {
+            if (conn->walHook_) {
+                conn->walHook_(frames);
+            }
+        } catch (...) {
+        }
+        return SQLITE_OK;
+    }
+
+    static int busyTrampoline(void* self, int attempt) {
+        auto* conn = static_cast<SqliteConnection*>(self);
+        try {
+            return conn->busyHandler_ && conn->busyHandler_(attempt) ? 1 : 0;
+        } catch (...) {
+            return 0;
+        }
+    }
 };
 
 class SqliteDriver : public IDriver {
 public:
+    // 连接级调优位于配置的 "sqlite" 子对象中，例如 {"path": "a.db", "sqlite": {"profile": "fast-durable"}}
+    static SqliteOptions parseOptions(const nlohmann::json& config) {
+        SqliteOptions options;
+        if (!config.contains("sqlite") || !config["sqlite"].is_object()) {
+            return options;
+        }
+        const auto& block = config["sqlite"];
+
+        if (block.contains("profile")) {
+            const std::string name = block["profile"].is_string() ? block["profile"].get<std::string>() : "";
+            auto profile = sqliteProfile(name);
+            if (!profile) {
+                options.configError = "Unknown SQLite profile: " + name;
+                return options;
+            }
+            options = std::move(*profile);
+        }
+
+        auto readInt = [&](const char* key, auto apply) {
+            if (!block.contains(key)) {
+                return;
+            }
+            if (!block[key].is_number_integer()) {
+                options.configError = std::string("SQLite option '") + key + "' must be an integer";
+                return;
+            }
+            apply(block[key].get<int64_t>());
+        };
+        // 枚举类 PRAGMA 会拼接进 SQL，只接受白名单内的取值
+        auto readEnum = [&](const char* key, std::initializer_list<const char*> allowed, std::optional<std::string>& out) {
+            if (!block.contains(key)) {
+                return;
+            }
+            std::string value = block[key].is_string() ? block[key].get<std::string>()
+                              : block[key].is_number_integer() ? std::to_string(block[key].get<int64_t>())
+                              : std::string();
+            std::transform(value.begin(), value.end(), value.begin(),
+                           [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+            for (const char* candidate : allowed) {
+                if (value == candidate) {
+                    out = value;
+                    return;
+                }
+            }
+            options.configError = std::string("Invalid value for SQLite option '") + key + "'";
+        };
+
+        auto readFlag = [&](const char* key, bool& out) {
+            if (!block.contains(key)) {
+                return;
+            }
+            if (!block[key].is_boolean()) {
+                options.configError = std::string("SQLite option '") + key + "' must be a boolean";
+                return;
+            }
+            out = block[key].get<bool>();
+        };
+
+        readFlag("nomutex", options.noMutex);
+        readFlag("readonly", options.readOnly);
+        readFlag("uri", options.uri);
+        readFlag("shared_cache", options.sharedCache);
+        readFlag("nofollow", options.noFollow);
+#ifndef SQLITE_OPEN_NOFOLLOW
+        if (options.noFollow) {
+            options.configError = "SQLite option 'nofollow' requires SQLite 3.31 or newer";
+        }
+#endif
+        readInt("busy_timeout", [&](int64_t v) { options.busyTimeout = std::chrono::milliseconds(v); });
+        readInt("page_size", [&](int64_t v) { options.pageSize = v; });
+        readInt("cache_size", [&](int64_t v) { options.cacheSize = v; });
+        readInt("mmap_size", [&](int64_t v) { options.mmapSize = v; });
+        readInt("wal_autocheckpoint", [&](int64_t v) { options.walAutocheckpoint = v; });
+        readInt("lookaside_slot_size", [&](int64_t v) { options.lookasideSlotSize = v; });
+        readInt("lookaside_slots", [&](int64_t v) { options.lookasideSlots = v; });
+        readInt("memory_budget", [&](int64_t v) { options.memoryBudget = v; });
+        readEnum("auto_vacuum", {"NONE", "FULL", "INCREMENTAL", "0", "1", "2"}, options.autoVacuum);
+        readEnum("journal_mode", {"DELETE", "TRUNCATE", "PERSIST", "MEMORY", "WAL", "OFF"}, options.journalMode);
+        readEnum("synchronous", {"OFF", "NORMAL", "FULL", "EXTRA", "0", "1", "2", "3"}, options.synchronous);
+        readEnum("temp_store", {"DEFAULT", "FILE", "MEMORY", "0", "1", "2"}, options.tempStore);
+        readEnum("locking_mode", {"NORMAL", "EXCLUSIVE"}, options.lockingMode);
+        readFlag("strict_pragmas", options.strictPragmas);
+        readFlag("statement_stats", options.collectStatementStats);
+        if (block.contains("shared_memory")) {
+            const auto& value = block["shared_memory"];
+            const std::string name = value.is_string() ? value.get<std::string>() : "";
+            const bool validName = !name.empty() && std::all_of(name.begin(), name.end(), [](unsigned char c) {
+                return std::isalnum(c) || c == '_' || c == '-' || c == '.';
+            });
+            if (!validName) {
+                options.configError = "SQLite option 'shared_memory' must be a name made of [A-Za-z0-9_.-]";
+            }
+            options.sharedMemoryName = name;
+        }
+        if (block.contains("shared_memory_mode")) {
+            const auto& value = block["shared_memory_mode"];
+            options.sharedMemoryMode = value.is_string() ? value.get<std::string>() : "";
+            if (options.sharedMemoryMode != "memdb" && options.sharedMemoryMode != "shared_cache") {
+                options.configError = "SQLite option 'shared_memory_mode' must be 'memdb' or 'shared_cache'";
+            }
+        }
+        if (block.contains("query_only")) {
+            bool queryOnly = false;
+            readFlag("query_only", queryOnly);
+            options.queryOnly = queryOnly;
+        }
+        // 读写分离池中的角色，由 readOnlyConfig / writerConfig 设置，在模板展开之后生效
+        if (block.contains("role")) {
+            const std::string role = block["role"].is_string() ? block["role"].get<std::string>() : "";
+            if (role == "reader") {
+                // journal_mode / locking_mode / auto_vacuum 只能由写连接设置，模板带来的也要去掉
+                options.journalMode.reset();
+                options.lockingMode.reset();
+                options.autoVacuum.reset();
+            } else if (role == "writer") {
+                if (block.contains("readonly") && options.readOnly) {
+                    options.configError = "SQLite option 'readonly' cannot be used for the writer of a read/write pool";
+                }
+                // 模板（如 read-only-analytics）带来的只读设置不作用于写连接
+                options.readOnly = false;
+                options.queryOnly.reset();
+            } else {
+                options.configError = "SQLite option 'role' must be 'reader' or 'writer'";
+            }
+        }
+        return options;
+    }
+
     std::unique_ptr<IConnection> createConnection(const nlohmann::json& config) override {
         std::string connString = config.value("path", ":memory:");
-        return std::make_unique<SqliteConnection>(connString);
+        auto options = parseOptions(config);
+        if (!options.sharedMemoryName.empty() && options.configError.empty()) {
+            connString = sharedMemoryUri(options.sharedMemoryName, options.sharedMemoryMode);
+            options.uri = true;
+            auto anchorRes = detail::SharedMemoryDatabase::acquire(connString);
+            if (anchorRes) {
+                options.sharedMemory = std::move(anchorRes.value());
+            } else {
+                options.configError = anchorRes.error().message;
+            }
+        }
+        options.functions = functions_;
+        if (options.collectStatementStats) {
+            options.statementStats = statementStats_;
+        }
+        options.memoryGroup = memoryGroup(config);
+        if (options.memoryBudget > 0) {
+            options.memoryGroup->setBudget(options.memoryBudget);
+        }
+        return std::make_unique<SqliteConnection>(connString, std::move(options));
+    }
+
+    // 在驱动上登记的函数会注册到它创建的每个连接，包括已经在连接池中的连接（下一次执行语句前补注册）
+    SqliteFunctionRegistry& functions() { return *functions_; }
+
+    // 配置了 "statement_stats": true 的连接共享这一份语句统计
+    SqliteStatementStats& statementStats() { return *statementStats_; }
+
+    // 同一份配置创建的连接（即同一个连接池）共享一个内存组，用于汇总 sqlite3_db_status 与执行内存预算
+    std::shared_ptr<SqliteMemoryGroup> memoryGroup(const nlohmann::json& config) {
+        const auto key = config.dump();
+        std::lock_guard<std::mutex> lock(memoryGroupsMtx_);
+        auto& slot = memoryGroups_[key];
+        auto group = slot.lock();
+        if (!group) {
+            group = std::make_shared<SqliteMemoryGroup>();
+            slot = group;
+            for (auto it = memoryGroups_.begin(); it != memoryGroups_.end();) {
+                it = it->second.expired() ? memoryGroups_.erase(it) : std::next(it);
+            }
+        }
+        return group;
+    }
+
+    static std::string sharedMemoryUri(const std::string& name, const std::string& mode) {
+        if (mode == "shared_cache") {
+            return "file:" + name + "?mode=memory&cache=shared";
+        }
+        return "file:/" + name + "?vfs=memdb";
     }
 
     std::string name() const override { return "sqlite"; }
+
+    // WAL 模式下读连接不会阻塞写连接：只读打开并开启 query_only，
+    // 只能由写连接设置的 journal_mode / locking_mode / auto_vacuum（包括模板中的）由 parseOptions 按角色去掉
+    nlohmann::json readOnlyConfig(const nlohmann::json& config) const override {
+        nlohmann::json reader = config;
+        auto& block = reader["sqlite"];
+        if (!block.is_object()) {
+            block = nlohmann::json::object();
+        }
+        block["readonly"] = true;
+        block["query_only"] = true;
+        block["role"] = "reader";
+        return reader;
+    }
+
+    // 写连接忽略模板带来的只读设置；显式配置 "readonly": true 时打开失败
+    nlohmann::json writerConfig(const nlohmann::json& config) const override {
+        nlohmann::json writer = config;
+        auto& block = writer["sqlite"];
+        if (!block.is_object()) {
+            block = nlohmann::json::object();
+        }
+        block["role"] = "writer";
+        return writer;
+    }
+
+private:
+    std::shared_ptr<SqliteFunctionRegistry> functions_ = std::make_shared<SqliteFunctionRegistry>();
+    std::shared_ptr<SqliteStatementStats> statementStats_ = std::make_shared<SqliteStatementStats>();
+    std::mutex memoryGroupsMtx_;
+    std::unordered_map<std::string, std::weak_ptr<SqliteMemoryGroup>> memoryGroups_;
 };
 
 } // namespace sdb::drivers
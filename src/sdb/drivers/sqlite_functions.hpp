@@ -0,0 +1,358 @@
+#pragma once
+#include "../idb.hpp"
+#include <sqlite3.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <climits>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sdb::drivers {
+
+namespace detail {
+
+template <typename T>
+struct IsOptional : std::false_type {};
+template <typename T>
+struct IsOptional<std::optional<T>> : std::true_type {};
+
+template <typename T>
+struct IsDbResult : std::false_type {};
+template <typename T>
+struct IsDbResult<DbResult<T>> : std::true_type {};
+
+template <typename>
+inline constexpr bool kUnsupportedSqliteType = false;
+
+// 可调用对象的参数与返回类型，支持 lambda（含 mutable）与函数指针
+template <typename T>
+struct CallableTraits : CallableTraits<decltype(&T::operator())> {};
+
+template <typename R, typename... A>
+struct CallableTraits<R (*)(A...)> {
+    using Result = R;
+    using Args = std::tuple<std::decay_t<A>...>;
+    static constexpr size_t arity = sizeof...(A);
+};
+
+template <typename C, typename R, typename... A>
+struct CallableTraits<R (C::*)(A...) const> : CallableTraits<R (*)(A...)> {};
+
+template <typename C, typename R, typename... A>
+struct CallableTraits<R (C::*)(A...)> : CallableTraits<R (*)(A...)> {};
+
+// sqlite3_value -> C++。string_view 与 SQLite 内部缓冲区共享内存，只在本次调用内有效
+template <typename T>
+T fromSqliteValue(sqlite3_value* value) {
+    if constexpr (IsOptional<T>::value) {
+        if (sqlite3_value_type(value) == SQLITE_NULL) {
+            return std::nullopt;
+        }
+        return fromSqliteValue<typename T::value_type>(value);
+    } else if constexpr (std::is_same_v<T, bool>) {
+        return sqlite3_value_int64(value) != 0;
+    } else if constexpr (std::is_integral_v<T>) {
+        return static_cast<T>(sqlite3_value_int64(value));
+    } else if constexpr (std::is_floating_point_v<T>) {
+        return static_cast<T>(sqlite3_value_double(value));
+    } else if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>) {
+        const auto* text = reinterpret_cast<const char*>(sqlite3_value_text(value));
+        return T(text ? text : "", static_cast<size_t>(sqlite3_value_bytes(value)));
+    } else if constexpr (std::is_same_v<T, std::vector<uint8_t>>) {
+        const auto* blob = static_cast<const uint8_t*>(sqlite3_value_blob(value));
+        return blob ? T(blob, blob + sqlite3_value_bytes(value)) : T{};
+    } else if constexpr (std::is_same_v<T, DbValue>) {
+        switch (sqlite3_value_type(value)) {
+            case SQLITE_INTEGER:
+                return DbValue(static_cast<int64_t>(sqlite3_value_int64(value)));
+            case SQLITE_FLOAT:
+                return DbValue(sqlite3_value_double(value));
+            case SQLITE_TEXT:
+                return DbValue(fromSqliteValue<std::string>(value));
+            case SQLITE_BLOB:
+                return DbValue(fromSqliteValue<std::vector<uint8_t>>(value));
+            default:
+                return DbValue{};
+        }
+    } else {
+        static_assert(kUnsupportedSqliteType<T>, "Unsupported SQLite function argument type");
+    }
+}
+
+// C++ -> sqlite3_result_*
+template <typename T>
+void setSqliteResult(sqlite3_context* ctx, const T& value) {
+    if constexpr (IsOptional<T>::value) {
+        if (!value) {
+            sqlite3_result_null(ctx);
+        } else {
+            setSqliteResult(ctx, *value);
+        }
+    } else if constexpr (IsDbResult<T>::value) {
+        if (!value) {
+            sqlite3_result_error(ctx, value.error().message.c_str(), -1);
+            if (value.error().code != 0) {
+                sqlite3_result_error_code(ctx, value.error().code);
+            }
+        } else {
+            setSqliteResult(ctx, value.value());
+        }
+    } else if constexpr (std::is_same_v<T, std::nullptr_t> || std::is_same_v<T, std::monostate>) {
+        sqlite3_result_null(ctx);
+    } else if constexpr (std::is_same_v<T, bool>) {
+        sqlite3_result_int(ctx, value ? 1 : 0);
+    } else if constexpr (std::is_integral_v<T>) {
+        sqlite3_result_int64(ctx, static_cast<sqlite3_int64>(value));
+    } else if constexpr (std::is_floating_point_v<T>) {
+        sqlite3_result_double(ctx, static_cast<double>(value));
+    } else if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>) {
+        sqlite3_result_text64(ctx, value.data(), value.size(), SQLITE_TRANSIENT, SQLITE_UTF8);
+    } else if constexpr (std::is_same_v<T, std::vector<uint8_t>>) {
+        sqlite3_result_blob64(ctx, value.data(), value.size(), SQLITE_TRANSIENT);
+    } else if constexpr (std::is_same_v<T, DbValue>) {
+        std::visit([ctx](const auto& v) { setSqliteResult(ctx, v); }, value);
+    } else {
+        static_assert(kUnsupportedSqliteType<T>, "Unsupported SQLite function result type");
+    }
+}
+
+template <typename Tuple>
+struct TupleTail;
+template <typename Head, typename... Tail>
+struct TupleTail<std::tuple<Head, Tail...>> {
+    using type = std::tuple<Tail...>;
+};
+
+template <typename Args>
+inline constexpr bool kVariadicArgs = std::is_same_v<Args, std::tuple<std::vector<DbValue>>>;
+
+// 单个 std::vector<DbValue> 参数表示接受任意个数的参数
+template <typename Tuple, size_t... I>
+Tuple unpackSqliteArgs(int argc, sqlite3_value** argv, std::index_sequence<I...>) {
+    if constexpr (kVariadicArgs<Tuple>) {
+        std::vector<DbValue> values;
+        values.reserve(static_cast<size_t>(argc));
+        for (int i = 0; i < argc; ++i) {
+            values.push_back(fromSqliteValue<DbValue>(argv[i]));
+        }
+        return Tuple(std::move(values));
+    } else {
+        (void)argc;
+        (void)argv;
+        return Tuple(fromSqliteValue<std::tuple_element_t<I, Tuple>>(argv[I])...);
+    }
+}
+
+template <typename Fn>
+Fn& sqliteUserFunction(sqlite3_context* ctx) {
+    return *static_cast<Fn*>(static_cast<std::shared_ptr<void>*>(sqlite3_user_data(ctx))->get());
+}
+
+template <typename Fn>
+void scalarTrampoline(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+    using Traits = CallableTraits<Fn>;
+    using Args = typename Traits::Args;
+    try {
+        auto args = unpackSqliteArgs<Args>(argc, argv, std::make_index_sequence<Traits::arity>{});
+        auto& fn = sqliteUserFunction<Fn>(ctx);
+        if constexpr (std::is_void_v<typename Traits::Result>) {
+            std::apply(fn, std::move(args));
+            sqlite3_result_null(ctx);
+        } else {
+            setSqliteResult(ctx, std::apply(fn, std::move(args)));
+        }
+    } catch (const std::exception& e) {
+        sqlite3_result_error(ctx, e.what(), -1);
+    } catch (...) {
+        sqlite3_result_error(ctx, "Unknown C++ exception in SQLite function", -1);
+    }
+}
+
+template <typename State, typename Step, typename Final>
+struct AggregateFunction {
+    Step step;
+    Final final;
+};
+
+// 聚合状态以指针形式存放在 sqlite3_aggregate_context 中，首次 step 时构造、xFinal 时析构
+template <typename State, typename Step, typename Final>
+void aggregateStepTrampoline(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+    using Traits = CallableTraits<Step>;
+    using Args = typename TupleTail<typename Traits::Args>::type;
+    auto** slot = static_cast<State**>(sqlite3_aggregate_context(ctx, sizeof(State*)));
+    if (!slot) {
+        sqlite3_result_error_nomem(ctx);
+        return;
+    }
+    try {
+        if (!*slot) {
+            *slot = new State();
+        }
+        auto args = unpackSqliteArgs<Args>(argc, argv, std::make_index_sequence<Traits::arity - 1>{});
+        auto& fn = sqliteUserFunction<AggregateFunction<State, Step, Final>>(ctx);
+        std::apply([&](auto&&... a) { fn.step(**slot, std::move(a)...); }, std::move(args));
+    } catch (const std::exception& e) {
+        sqlite3_result_error(ctx, e.what(), -1);
+    } catch (...) {
+        sqlite3_result_error(ctx, "Unknown C++ exception in SQLite aggregate", -1);
+    }
+}
+
+template <typename State, typename Step, typename Final>
+void aggregateFinalTrampoline(sqlite3_context* ctx) {
+    auto** slot = static_cast<State**>(sqlite3_aggregate_context(ctx, 0));
+    std::unique_ptr<State> owned(slot ? *slot : nullptr);
+    try {
+        auto& fn = sqliteUserFunction<AggregateFunction<State, Step, Final>>(ctx);
+        // 没有任何输入行时对默认构造的状态调用 final，由 final 决定返回 0 还是 NULL
+        State empty{};
+        setSqliteResult(ctx, fn.final(owned ? *owned : empty));
+    } catch (const std::exception& e) {
+        sqlite3_result_error(ctx, e.what(), -1);
+    } catch (...) {
+        sqlite3_result_error(ctx, "Unknown C++ exception in SQLite aggregate", -1);
+    }
+}
+
+inline void destroySqliteUserData(void* p) {
+    delete static_cast<std::shared_ptr<void>*>(p);
+}
+
+} // namespace detail
+
+// C++ 标量/聚合 SQL 函数的登记表。登记本身不触碰任何连接，
+// 由 SqliteConnection 在 open() 以及之后每次执行语句前补注册新增的函数
+class SqliteFunctionRegistry {
+public:
+    // fn 的参数与返回值支持 int/int64_t/double/bool/std::string/std::string_view/
+    // std::vector<uint8_t>/DbValue 及其 std::optional（NULL）；返回 DbResult<T> 失败时抛出 SQL 错误。
+    // deterministic 函数带 SQLITE_DETERMINISTIC，可用于表达式索引和查询规划期的常量折叠
+    template <typename Fn>
+    void scalar(const std::string& name, Fn fn, bool deterministic = true) {
+        using Traits = detail::CallableTraits<Fn>;
+        const int nArg = detail::kVariadicArgs<typename Traits::Args> ? -1 : static_cast<int>(Traits::arity);
+        Entry entry;
+        entry.name = name;
+        entry.nArg = nArg;
+        entry.flags = flagsFor(deterministic);
+        entry.userData = std::make_shared<Fn>(std::move(fn));
+        entry.xFunc = &detail::scalarTrampoline<Fn>;
+        add(std::move(entry));
+    }
+
+    // step(State&, args...) 逐行累积，final(State&) 产出结果；State 必须可默认构造
+    template <typename State, typename Step, typename Final>
+    void aggregate(const std::string& name, Step step, Final final, bool deterministic = true) {
+        using Traits = detail::CallableTraits<Step>;
+        static_assert(Traits::arity >= 1, "Aggregate step must take State& as its first argument");
+        using Args = typename detail::TupleTail<typename Traits::Args>::type;
+        const int nArg = detail::kVariadicArgs<Args> ? -1 : static_cast<int>(Traits::arity) - 1;
+        Entry entry;
+        entry.name = name;
+        entry.nArg = nArg;
+        entry.flags = flagsFor(deterministic);
+        entry.userData = std::make_shared<detail::AggregateFunction<State, Step, Final>>(
+            detail::AggregateFunction<State, Step, Final>{std::move(step), std::move(final)});
+        entry.xStep = &detail::aggregateStepTrampoline<State, Step, Final>;
+        entry.xFinal = &detail::aggregateFinalTrampoline<State, Step, Final>;
+        add(std::move(entry));
+    }
+
+    // 需要在每个连接上单独安装的其它扩展，例如虚拟表模块；install 返回 SQLite 结果码
+    void module(const std::string& name, std::function<int(sqlite3*)> install) {
+        Entry entry;
+        entry.name = name;
+        entry.nArg = kModuleArity;
+        entry.install = std::move(install);
+        add(std::move(entry));
+    }
+
+    // 每次登记递增，连接据此判断是否需要补注册
+    uint64_t version() const { return version_.load(std::memory_order_acquire); }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return entries_.size();
+    }
+
+    // 把版本号大于 sinceVersion 的函数注册到 db，返回注册后的版本号
+    DbResult<uint64_t> applyTo(sqlite3* db, uint64_t sinceVersion = 0) const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        uint64_t applied = sinceVersion;
+        for (const auto& entry : entries_) {
+            if (entry.version <= sinceVersion) {
+                continue;
+            }
+            int rc = SQLITE_OK;
+            if (entry.install) {
+                rc = entry.install(db);
+            } else {
+                auto* holder = new std::shared_ptr<void>(entry.userData);
+                // 失败时 SQLite 也会调用 xDestroy 释放 holder
+                rc = sqlite3_create_function_v2(db, entry.name.c_str(), entry.nArg, entry.flags, holder,
+                                                entry.xFunc, entry.xStep, entry.xFinal,
+                                                &detail::destroySqliteUserData);
+            }
+            if (rc != SQLITE_OK) {
+                return DbResult<uint64_t>::failure(
+                    "Failed to register SQLite extension '" + entry.name + "': " + sqlite3_errmsg(db), rc);
+            }
+            applied = std::max(applied, entry.version);
+        }
+        return DbResult<uint64_t>::success(std::max(applied, version_.load(std::memory_order_acquire)));
+    }
+
+private:
+    // 模块与函数分属不同命名空间，用不可能出现的参数个数区分
+    static constexpr int kModuleArity = INT_MIN;
+
+    struct Entry {
+        std::string name;
+        int nArg = 0;
+        int flags = SQLITE_UTF8;
+        uint64_t version = 0;
+        std::shared_ptr<void> userData;
+        void (*xFunc)(sqlite3_context*, int, sqlite3_value**) = nullptr;
+        void (*xStep)(sqlite3_context*, int, sqlite3_value**) = nullptr;
+        void (*xFinal)(sqlite3_context*) = nullptr;
+        std::function<int(sqlite3*)> install;
+    };
+
+    static int flagsFor(bool deterministic) {
+        return SQLITE_UTF8 | (deterministic ? SQLITE_DETERMINISTIC : 0);
+    }
+
+    // 同名同参数个数的函数（或同名模块）会被替换
+    void add(Entry entry) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        entry.version = version_.load(std::memory_order_relaxed) + 1;
+        bool replaced = false;
+        for (auto& existing : entries_) {
+            if (existing.name == entry.name && existing.nArg == entry.nArg) {
+                existing = std::move(entry);
+                replaced = true;
+                break;
+            }
+        }
+        if (!replaced) {
+            entries_.push_back(std::move(entry));
+        }
+        version_.fetch_add(1, std::memory_order_release);
+    }
+
+    mutable std::mutex mtx_;
+    std::vector<Entry> entries_;
+    std::atomic<uint64_t> version_{0};
+};
+
+} // namespace sdb::drivers
@@ -0,0 +1,453 @@
+#pragma once
+#include "sqlite_driver.hpp"
+#include "../connection_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+namespace sdb::drivers {
+
+// 在独立的后台连接上执行 WAL 检查点、增量 vacuum 与 PRAGMA optimize。
+// 写连接须经 attachWriter / writerFactory 登记：登记时安装 WAL 钩子，关闭 SQLite 的自动检查点
+// （检查点不再落在恰好越过阈值的那次提交上），并由钩子报告 WAL 帧数供 PASSIVE 检查点判断
+class SqliteMaintenanceScheduler {
+public:
+    enum class Task { PassiveCheckpoint, TruncateCheckpoint, IncrementalVacuum, Optimize };
+
+    struct TaskReport {
+        Task task = Task::PassiveCheckpoint;
+        bool ok = true;
+        // TRUNCATE 等待读者超时后退化为 PASSIVE，此时 busy 为 true
+        bool busy = false;
+        std::chrono::microseconds duration{0};
+        int64_t walBytesBefore = 0;
+        int walFrames = 0;
+        int checkpointedFrames = 0;
+        int64_t freedPages = 0;
+        std::string error;
+    };
+
+    struct Options {
+        // 后台线程检查 WAL 大小与空闲状态的周期
+        std::chrono::milliseconds interval{1000};
+        // 尚未回写主库的 WAL 帧（按帧大小折算）超过该值时执行 PASSIVE 检查点（不等待读写者）
+        int64_t passiveWalBytes = int64_t{4} * 1024 * 1024;
+        // WAL 文件超过该大小或进入空闲窗口时执行 TRUNCATE 检查点，把 WAL 文件截断为 0
+        int64_t truncateWalBytes = int64_t{64} * 1024 * 1024;
+        // idleProbe 连续返回 true 达到 idleWindow 后才做 TRUNCATE / vacuum / optimize；为空时视为从不空闲
+        std::function<bool()> idleProbe;
+        std::chrono::milliseconds idleWindow{5000};
+        // TRUNCATE 等待读者的时长
+        std::chrono::milliseconds busyTimeout{100};
+        // 仅在 auto_vacuum=INCREMENTAL 的库上生效
+        int64_t vacuumMinFreePages = 256;
+        int64_t vacuumPagesPerRun = 1024;
+        std::chrono::milliseconds optimizeInterval{std::chrono::hours(1)};
+        // 每个任务完成后回调，用于导出到外部监控
+        std::function<void(const TaskReport&)> onTask;
+    };
+
+    struct TaskStats {
+        uint64_t runs = 0;
+        uint64_t failures = 0;
+        uint64_t busy = 0;
+        uint64_t totalMicros = 0;
+        uint64_t maxMicros = 0;
+        uint64_t lastMicros = 0;
+    };
+
+    struct MetricsSnapshot {
+        TaskStats passiveCheckpoints;
+        TaskStats truncateCheckpoints;
+        TaskStats incrementalVacuums;
+        TaskStats optimizes;
+        uint64_t ticks = 0;
+        // WAL 文件大小；完整检查点之后文件不会变小，待回写的量见 lastPendingFrames
+        int64_t lastWalBytes = 0;
+        int64_t lastPendingFrames = 0;
+        int64_t peakWalBytes = 0;
+        std::string lastError;
+    };
+
+    static DbResult<std::unique_ptr<SqliteMaintenanceScheduler>> create(std::unique_ptr<SqliteConnection> conn,
+                                                                        Options options) {
+        using Result = DbResult<std::unique_ptr<SqliteMaintenanceScheduler>>;
+        if (!conn) {
+            return Result::failure("SqliteMaintenanceScheduler requires a connection");
+        }
+        if (conn->options().readOnly) {
+            return Result::failure("SqliteMaintenanceScheduler requires a writable connection");
+        }
+        auto openRes = conn->open();
+        if (!openRes) {
+            return Result::failure(openRes.error().message, openRes.error().code);
+        }
+        conn->setBusyTimeout(options.busyTimeout);
+        return Result::success(std::unique_ptr<SqliteMaintenanceScheduler>(
+            new SqliteMaintenanceScheduler(std::move(conn), std::move(options))));
+    }
+
+    static DbResult<std::unique_ptr<SqliteMaintenanceScheduler>> create(const std::string& path, Options options) {
+        return create(std::make_unique<SqliteConnection>(path), std::move(options));
+    }
+
+    // 登记写连接。须在该连接未被其他线程使用时调用（例如刚创建、尚未放入连接池时）
+    void attachWriter(SqliteConnection& writer) { writer.setWalHook(hookFor(walFrames_)); }
+
+    // 包装写连接池的工厂：创建出的 SQLite 连接自动登记，非 SQLite 连接原样返回并告警
+    ConnectionPool::Factory writerFactory(ConnectionPool::Factory factory) {
+        return [factory = std::move(factory), frames = walFrames_]() {
+            auto connRes = factory();
+            if (connRes) {
+                if (auto* sqlite = dynamic_cast<SqliteConnection*>(connRes.value().get())) {
+                    sqlite->setWalHook(hookFor(frames));
+                } else {
+                    spdlog::warn("SqliteMaintenanceScheduler::writerFactory: connection is not a SqliteConnection");
+                }
+            }
+            return connRes;
+        };
+    }
+
+    // 连接池中没有借出的连接即视为空闲
+    static std::function<bool()> idleWhenUnused(const std::shared_ptr<ConnectionPool>& pool) {
+        std::weak_ptr<ConnectionPool> weak = pool;
+        return [weak]() {
+            auto p = weak.lock();
+            return !p || p->inUseSize() == 0;
+        };
+    }
+
+    ~SqliteMaintenanceScheduler() { stop(); }
+
+    SqliteMaintenanceScheduler(const SqliteMaintenanceScheduler&) = delete;
+    SqliteMaintenanceScheduler& operator=(const SqliteMaintenanceScheduler&) = delete;
+
+    void start() {
+        std::lock_guard<std::mutex> lock(stateMtx_);
+        if (worker_.joinable()) {
+            return;
+        }
+        stopping_ = false;
+        worker_ = std::thread([this] { loop(); });
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(stateMtx_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        if (worker_.joinable()) {
+            worker_.join();
+        }
+    }
+
+    // 按 WAL 大小与空闲状态决定本轮要做的任务；后台线程每个 interval 调用一次，也可以手动调用
+    DbResult<void> runOnce() {
+        std::lock_guard<std::mutex> lock(runMtx_);
+        const auto now = std::chrono::steady_clock::now();
+        const int64_t walBytes = walSize();
+        const int64_t pendingFrames = pendingWalFrames();
+        {
+            std::lock_guard<std::mutex> metricsLock(metricsMtx_);
+            ++metrics_.ticks;
+            metrics_.lastWalBytes = walBytes;
+            metrics_.lastPendingFrames = pendingFrames;
+            metrics_.peakWalBytes = std::max(metrics_.peakWalBytes, walBytes);
+        }
+
+        if (options_.idleProbe && options_.idleProbe()) {
+            if (!idleSince_) {
+                idleSince_ = now;
+            }
+        } else {
+            idleSince_.reset();
+        }
+        const bool idle = idleSince_ && now - *idleSince_ >= options_.idleWindow;
+
+        DbResult<void> result = DbResult<void>::success();
+        auto keepFirstError = [&](DbResult<void> res) {
+            if (!res && result) {
+                result = std::move(res);
+            }
+        };
+
+        // vacuum 与 optimize 本身也会写 WAL，先执行它们，再由随后的检查点一并截断
+        int64_t fileBytes = walBytes;
+        int64_t pendingBytes = pendingFrames * walFrameBytes_;
+        if (idle) {
+            if (incrementalAutoVacuum_) {
+                keepFirstError(incrementalVacuumLocked(false));
+            }
+            if (!lastOptimize_ || now - *lastOptimize_ >= options_.optimizeInterval) {
+                keepFirstError(optimizeLocked());
+                lastOptimize_ = now;
+            }
+            fileBytes = walSize();
+            pendingBytes = pendingWalFrames() * walFrameBytes_;
+        }
+        // PASSIVE 不会缩小 WAL 文件，只按待回写的帧触发，否则文件越过阈值后每轮都会空跑一次
+        if (fileBytes >= options_.truncateWalBytes || (idle && fileBytes > 0)) {
+            keepFirstError(checkpointLocked(true, fileBytes));
+        } else if (pendingBytes > 0 && pendingBytes >= options_.passiveWalBytes) {
+            keepFirstError(checkpointLocked(false, fileBytes));
+        }
+        return result;
+    }
+
+    DbResult<void> checkpoint(bool truncate) {
+        std::lock_guard<std::mutex> lock(runMtx_);
+        return checkpointLocked(truncate, walSize());
+    }
+
+    // force 为 true 时忽略 vacuumMinFreePages
+    DbResult<void> incrementalVacuum(bool force = false) {
+        std::lock_guard<std::mutex> lock(runMtx_);
+        return incrementalVacuumLocked(force);
+    }
+
+    DbResult<void> optimize() {
+        std::lock_guard<std::mutex> lock(runMtx_);
+        return optimizeLocked();
+    }
+
+    // 当前 WAL 文件大小（字节），内存库或非 WAL 模式为 0
+    int64_t walSize() const {
+        const char* file = sqlite3_db_filename(conn_->nativeHandle(), "main");
+        if (!file || !*file) {
+            return 0;
+        }
+        std::error_code ec;
+        const auto size = std::filesystem::file_size(std::string(file) + "-wal", ec);
+        return ec ? 0 : static_cast<int64_t>(size);
+    }
+
+    // 尚未检查点回主库的 WAL 帧数：登记的写连接在每次提交后报告 WAL 中的帧数，本调度器的检查点报告
+    // 已回写的帧数，两者之差即待回写量。没有登记写连接时只反映本调度器自身的写入
+    int64_t pendingWalFrames() const { return walFrames_->pending(); }
+
+    MetricsSnapshot metrics() const {
+        std::lock_guard<std::mutex> lock(metricsMtx_);
+        return metrics_;
+    }
+
+    void resetMetrics() {
+        std::lock_guard<std::mutex> lock(metricsMtx_);
+        metrics_ = MetricsSnapshot{};
+    }
+
+    static const char* taskName(Task task) {
+        switch (task) {
+            case Task::PassiveCheckpoint:
+                return "wal_checkpoint_passive";
+            case Task::TruncateCheckpoint:
+                return "wal_checkpoint_truncate";
+            case Task::IncrementalVacuum:
+                return "incremental_vacuum";
+            case Task::Optimize:
+                return "optimize";
+        }
+        return "unknown";
+    }
+
+private:
+    // WAL 帧计数，由写连接的 WAL 钩子与检查点结果共同更新；钩子持有 shared_ptr，调度器先于写连接销毁也安全
+    struct WalFrames {
+        mutable std::mutex mtx;
+        int64_t frames = 0;
+        int64_t backfilled = 0;
+
+        void committed(int64_t n) {
+            std::lock_guard<std::mutex> lock(mtx);
+            // 帧数变小说明 WAL 已从头重写，之前回写的帧不再算数
+            if (n < frames) {
+                backfilled = 0;
+            }
+            frames = n;
+        }
+
+        void checkpointed(int64_t log, int64_t done) {
+            std::lock_guard<std::mutex> lock(mtx);
+            frames = log;
+            backfilled = done;
+        }
+
+        int64_t pending() const {
+            std::lock_guard<std::mutex> lock(mtx);
+            return frames > backfilled ? frames - backfilled : 0;
+        }
+    };
+
+    static SqliteConnection::WalHook hookFor(std::shared_ptr<WalFrames> frames) {
+        return [frames = std::move(frames)](int n) { frames->committed(n); };
+    }
+
+    SqliteMaintenanceScheduler(std::unique_ptr<SqliteConnection> conn, Options options)
+        : conn_(std::move(conn)), options_(std::move(options)) {
+        // vacuum 与 optimize 在本连接上写 WAL，同样计入
+        attachWriter(*conn_);
+        incrementalAutoVacuum_ = pragmaInt("auto_vacuum").value_or(0) == 2;
+        // 每帧 24 字节帧头加一页
+        walFrameBytes_ = pragmaInt("page_size").value_or(4096) + 24;
+    }
+
+    void loop() {
+        std::unique_lock<std::mutex> lock(stateMtx_);
+        while (!stopping_) {
+            cv_.wait_for(lock, options_.interval, [this] { return stopping_; });
+            if (stopping_) {
+                break;
+            }
+            lock.unlock();
+            auto res = runOnce();
+            if (!res) {
+                spdlog::warn("SQLite maintenance failed: {}", res.error().message);
+            }
+            lock.lock();
+        }
+    }
+
+    std::optional<int64_t> pragmaInt(const std::string& name) {
+        auto rsRes = conn_->query("PRAGMA " + name);
+        if (!rsRes || !rsRes.value()->next()) {
+            return std::nullopt;
+        }
+        const auto value = rsRes.value()->get(0);
+        if (const auto* v = std::get_if<int64_t>(&value)) {
+            return *v;
+        }
+        return std::nullopt;
+    }
+
+    DbResult<void> checkpointLocked(bool truncate, int64_t walBytes) {
+        TaskReport report;
+        report.task = truncate ? Task::TruncateCheckpoint : Task::PassiveCheckpoint;
+        report.walBytesBefore = walBytes;
+        const auto start = std::chrono::steady_clock::now();
+        const int rc = sqlite3_wal_checkpoint_v2(conn_->nativeHandle(), nullptr,
+                                                 truncate ? SQLITE_CHECKPOINT_TRUNCATE : SQLITE_CHECKPOINT_PASSIVE,
+                                                 &report.walFrames, &report.checkpointedFrames);
+        report.duration = elapsedSince(start);
+        if (report.walFrames >= 0) {
+            walFrames_->checkpointed(report.walFrames, report.checkpointedFrames);
+        }
+        if (rc == SQLITE_BUSY) {
+            report.busy = true;
+        } else if (rc != SQLITE_OK) {
+            report.ok = false;
+            report.error = sqlite3_errmsg(conn_->nativeHandle());
+        }
+        return finish(report, rc);
+    }
+
+    DbResult<void> incrementalVacuumLocked(bool force) {
+        const int64_t before = pragmaInt("freelist_count").value_or(0);
+        if (before == 0 || (!force && before < options_.vacuumMinFreePages)) {
+            return DbResult<void>::success();
+        }
+        TaskReport report;
+        report.task = Task::IncrementalVacuum;
+        const auto start = std::chrono::steady_clock::now();
+        auto res = conn_->execute("PRAGMA incremental_vacuum(" + std::to_string(options_.vacuumPagesPerRun) + ")");
+        report.duration = elapsedSince(start);
+        if (!res) {
+            report.ok = false;
+            report.error = res.error().message;
+            return finish(report, res.error().code);
+        }
+        report.freedPages = before - pragmaInt("freelist_count").value_or(before);
+        return finish(report, SQLITE_OK);
+    }
+
+    DbResult<void> optimizeLocked() {
+        TaskReport report;
+        report.task = Task::Optimize;
+        const auto start = std::chrono::steady_clock::now();
+        auto res = conn_->execute("PRAGMA optimize");
+        report.duration = elapsedSince(start);
+        if (!res) {
+            report.ok = false;
+            report.error = res.error().message;
+            return finish(report, res.error().code);
+        }
+        return finish(report, SQLITE_OK);
+    }
+
+    DbResult<void> finish(const TaskReport& report, int rc) {
+        const auto micros = static_cast<uint64_t>(report.duration.count());
+        {
+            std::lock_guard<std::mutex> lock(metricsMtx_);
+            TaskStats& stats = statsFor(report.task);
+            ++stats.runs;
+            stats.totalMicros += micros;
+            stats.maxMicros = std::max(stats.maxMicros, micros);
+            stats.lastMicros = micros;
+            if (report.busy) {
+                ++stats.busy;
+            }
+            if (!report.ok) {
+                ++stats.failures;
+                metrics_.lastError = report.error;
+            }
+        }
+        spdlog::debug("SQLite maintenance {} took {}us (wal {} bytes, {} / {} frames)", taskName(report.task), micros,
+                      report.walBytesBefore, report.checkpointedFrames, report.walFrames);
+        if (options_.onTask) {
+            options_.onTask(report);
+        }
+        if (!report.ok) {
+            return DbResult<void>::failure(std::string(taskName(report.task)) + " failed: " + report.error, rc);
+        }
+        return DbResult<void>::success();
+    }
+
+    TaskStats& statsFor(Task task) {
+        switch (task) {
+            case Task::PassiveCheckpoint:
+                return metrics_.passiveCheckpoints;
+            case Task::TruncateCheckpoint:
+                return metrics_.truncateCheckpoints;
+            case Task::IncrementalVacuum:
+                return metrics_.incrementalVacuums;
+            case Task::Optimize:
+                break;
+        }
+        return metrics_.optimizes;
+    }
+
+    static std::chrono::microseconds elapsedSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    }
+
+    std::shared_ptr<WalFrames> walFrames_ = std::make_shared<WalFrames>();
+    std::unique_ptr<SqliteConnection> conn_;
+    Options options_;
+    bool incrementalAutoVacuum_ = false;
+    int64_t walFrameBytes_ = 4096 + 24;
+
+    std::mutex runMtx_;
+    std::optional<std::chrono::steady_clock::time_point> idleSince_;
+    std::optional<std::chrono::steady_clock::time_point> lastOptimize_;
+
+    mutable std::mutex metricsMtx_;
+    MetricsSnapshot metrics_;
+
+    std::mutex stateMtx_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+    std::thread worker_;
+};
+
+} // namespace sdb::drivers
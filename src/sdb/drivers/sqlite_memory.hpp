@@ -0,0 +1,367 @@
+#pragma once
+#include <sqlite3.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace sdb::drivers {
+
+namespace detail {
+
+// 单个连接的内存账户。每块分配都持有一次引用，连接关闭后账户在最后一块内存释放时才销毁
+class SqliteMemoryAccount {
+public:
+    static SqliteMemoryAccount* create() { return new SqliteMemoryAccount(); }
+
+    void retain() { refs_.fetch_add(1, std::memory_order_relaxed); }
+
+    void release() {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+    void add(int64_t delta) {
+        const int64_t now = bytes_.fetch_add(delta, std::memory_order_relaxed) + delta;
+        int64_t peak = peak_.load(std::memory_order_relaxed);
+        while (now > peak && !peak_.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+        }
+    }
+
+    int64_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+    int64_t peak() const { return peak_.load(std::memory_order_relaxed); }
+
+private:
+    SqliteMemoryAccount() = default;
+
+    std::atomic<int64_t> bytes_{0};
+    std::atomic<int64_t> peak_{0};
+    std::atomic<int64_t> refs_{1};
+};
+
+// 当前线程正在代表哪个连接调用 SQLite；为空时计入全局未归属账户
+inline SqliteMemoryAccount*& currentSqliteMemoryAccount() {
+    static thread_local SqliteMemoryAccount* account = nullptr;
+    return account;
+}
+
+class SqliteMemoryScope {
+public:
+    explicit SqliteMemoryScope(SqliteMemoryAccount* account) : previous_(currentSqliteMemoryAccount()) {
+        currentSqliteMemoryAccount() = account;
+    }
+    ~SqliteMemoryScope() { currentSqliteMemoryAccount() = previous_; }
+
+    SqliteMemoryScope(const SqliteMemoryScope&) = delete;
+    SqliteMemoryScope& operator=(const SqliteMemoryScope&) = delete;
+
+private:
+    SqliteMemoryAccount* previous_;
+};
+
+// 包装 SQLite 默认分配器：每块前置 16 字节头，记录所属账户与大小（保持 8 字节对齐）
+class SqliteAccountingAllocator {
+public:
+    static constexpr int kHeader = 16;
+
+    struct Header {
+        SqliteMemoryAccount* account;
+        int64_t size;
+    };
+    static_assert(sizeof(Header) <= kHeader, "allocation header must fit in kHeader bytes");
+
+    static sqlite3_mem_methods& underlying() {
+        static sqlite3_mem_methods methods{};
+        return methods;
+    }
+
+    static SqliteMemoryAccount& unattributed() {
+        static SqliteMemoryAccount* account = SqliteMemoryAccount::create();
+        return *account;
+    }
+
+    static std::atomic<bool>& installed() {
+        static std::atomic<bool> flag{false};
+        return flag;
+    }
+
+    static const sqlite3_mem_methods* methods() {
+        static const sqlite3_mem_methods m = {
+            &xMalloc, &xFree, &xRealloc, &xSize, &xRoundup, &xInit, &xShutdown, nullptr
+        };
+        return &m;
+    }
+
+private:
+    static SqliteMemoryAccount* chargeTo() {
+        auto* account = currentSqliteMemoryAccount();
+        return account ? account : &unattributed();
+    }
+
+    static void* xMalloc(int n) {
+        auto* base = static_cast<char*>(underlying().xMalloc(n + kHeader));
+        if (!base) {
+            return nullptr;
+        }
+        auto* account = chargeTo();
+        account->retain();
+        account->add(n);
+        *reinterpret_cast<Header*>(base) = Header{account, n};
+        return base + kHeader;
+    }
+
+    static void xFree(void* p) {
+        if (!p) {
+            return;
+        }
+        auto* base = static_cast<char*>(p) - kHeader;
+        const Header header = *reinterpret_cast<Header*>(base);
+        underlying().xFree(base);
+        header.account->add(-header.size);
+        header.account->release();
+    }
+
+    static void* xRealloc(void* p, int n) {
+        auto* base = static_cast<char*>(p) - kHeader;
+        const Header header = *reinterpret_cast<Header*>(base);
+        auto* grown = static_cast<char*>(underlying().xRealloc(base, n + kHeader));
+        if (!grown) {
+            return nullptr;
+        }
+        reinterpret_cast<Header*>(grown)->size = n;
+        header.account->add(n - header.size);
+        return grown + kHeader;
+    }
+
+    static int xSize(void* p) {
+        return p ? static_cast<int>(reinterpret_cast<Header*>(static_cast<char*>(p) - kHeader)->size) : 0;
+    }
+
+    static int xRoundup(int n) { return (n + 7) & ~7; }
+
+    static int xInit(void* appData) { return underlying().xInit(appData); }
+    static void xShutdown(void* appData) { underlying().xShutdown(appData); }
+};
+
+} // namespace detail
+
+// sqlite3_db_status 的快照，字节数均为当前值，hit/miss 为累计次数
+struct SqliteMemoryStatus {
+    int64_t cacheUsed = 0;
+    int64_t cacheUsedShared = 0;
+    int64_t cacheHit = 0;
+    int64_t cacheMiss = 0;
+    int64_t cacheWrite = 0;
+    int64_t cacheSpill = 0;
+    int64_t schemaUsed = 0;
+    int64_t stmtUsed = 0;
+    int64_t lookasideUsed = 0;
+    int64_t lookasideHit = 0;
+    int64_t lookasideMissSize = 0;
+    int64_t lookasideMissFull = 0;
+    // 记账分配器归属到连接的字节数，未安装分配器时为 0
+    int64_t accountedBytes = 0;
+    int64_t accountedPeak = 0;
+
+    static SqliteMemoryStatus read(sqlite3* db) {
+        SqliteMemoryStatus s;
+        if (!db) {
+            return s;
+        }
+        auto current = [db](int op) {
+            int cur = 0;
+            int hi = 0;
+            sqlite3_db_status(db, op, &cur, &hi, 0);
+            return static_cast<int64_t>(cur);
+        };
+        auto highwater = [db](int op) {
+            int cur = 0;
+            int hi = 0;
+            sqlite3_db_status(db, op, &cur, &hi, 0);
+            return static_cast<int64_t>(hi);
+        };
+        s.cacheUsed = current(SQLITE_DBSTATUS_CACHE_USED);
+        s.cacheUsedShared = current(SQLITE_DBSTATUS_CACHE_USED_SHARED);
+        s.cacheHit = current(SQLITE_DBSTATUS_CACHE_HIT);
+        s.cacheMiss = current(SQLITE_DBSTATUS_CACHE_MISS);
+        s.cacheWrite = current(SQLITE_DBSTATUS_CACHE_WRITE);
+#ifdef SQLITE_DBSTATUS_CACHE_SPILL
+        s.cacheSpill = current(SQLITE_DBSTATUS_CACHE_SPILL);
+#endif
+        s.schemaUsed = current(SQLITE_DBSTATUS_SCHEMA_USED);
+        s.stmtUsed = current(SQLITE_DBSTATUS_STMT_USED);
+        s.lookasideUsed = current(SQLITE_DBSTATUS_LOOKASIDE_USED);
+        // 以下三项只有最高值有意义
+        s.lookasideHit = highwater(SQLITE_DBSTATUS_LOOKASIDE_HIT);
+        s.lookasideMissSize = highwater(SQLITE_DBSTATUS_LOOKASIDE_MISS_SIZE);
+        s.lookasideMissFull = highwater(SQLITE_DBSTATUS_LOOKASIDE_MISS_FULL);
+        return s;
+    }
+
+    // 预算按页缓存、schema 与预编译语句三项计
+    int64_t budgetedBytes() const { return cacheUsed + schemaUsed + stmtUsed; }
+
+    SqliteMemoryStatus& operator+=(const SqliteMemoryStatus& o) {
+        cacheUsed += o.cacheUsed;
+        cacheUsedShared += o.cacheUsedShared;
+        cacheHit += o.cacheHit;
+        cacheMiss += o.cacheMiss;
+        cacheWrite += o.cacheWrite;
+        cacheSpill += o.cacheSpill;
+        schemaUsed += o.schemaUsed;
+        stmtUsed += o.stmtUsed;
+        lookasideUsed += o.lookasideUsed;
+        lookasideHit += o.lookasideHit;
+        lookasideMissSize += o.lookasideMissSize;
+        lookasideMissFull += o.lookasideMissFull;
+        accountedBytes += o.accountedBytes;
+        accountedPeak += o.accountedPeak;
+        return *this;
+    }
+};
+
+// 同一配置创建的连接（通常即一个连接池）共享的内存组：汇总 sqlite3_db_status，并执行内存预算。
+// sqlite3_db_status 只在连接自己的线程上调用（NOMUTEX 连接不加锁，SCHEMA_USED / STMT_USED 会临时改动连接状态），
+// 结果发布到各自的 Member，组内汇总只读已发布的值；超出预算时，由连接在下一条语句前释放自己的页缓存
+class SqliteMemoryGroup {
+public:
+    struct Snapshot {
+        size_t connections = 0;
+        SqliteMemoryStatus total;
+        int64_t budget = 0;
+        uint64_t releases = 0;
+        int64_t releasedBytes = 0;
+    };
+
+    // 一个连接在组内的发布位置。publish() 只能由持有该连接的线程调用
+    class Member {
+    public:
+        explicit Member(detail::SqliteMemoryAccount* account) : account_(account) {}
+
+        void publish(sqlite3* db) {
+            auto status = SqliteMemoryStatus::read(db);
+            std::lock_guard<std::mutex> lock(mtx_);
+            status_ = status;
+        }
+
+        SqliteMemoryStatus published() const {
+            SqliteMemoryStatus status;
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                status = status_;
+            }
+            // 记账分配器的计数本身是原子量，可以直接读取最新值
+            if (account_) {
+                status.accountedBytes = account_->bytes();
+                status.accountedPeak = account_->peak();
+            }
+            return status;
+        }
+
+    private:
+        friend class SqliteMemoryGroup;
+
+        detail::SqliteMemoryAccount* account_;
+        mutable std::mutex mtx_;
+        SqliteMemoryStatus status_;
+        // 只由连接自己的线程读写
+        int64_t lastPublishMicros_ = 0;
+    };
+
+    void setBudget(int64_t bytes) { budget_.store(bytes, std::memory_order_relaxed); }
+    int64_t budget() const { return budget_.load(std::memory_order_relaxed); }
+
+    // 两次发布计数器、两次预算检查之间的最短间隔，避免每条语句都读取全部计数器
+    void setCheckInterval(std::chrono::milliseconds interval) { checkIntervalMicros_ = interval.count() * 1000; }
+
+    // 在连接自己的线程上调用（open 时），立即发布一次计数器
+    std::shared_ptr<Member> attach(sqlite3* db, detail::SqliteMemoryAccount* account) {
+        auto member = std::make_shared<Member>(account);
+        member->publish(db);
+        member->lastPublishMicros_ = nowMicros();
+        std::lock_guard<std::mutex> lock(mtx_);
+        members_.push_back(member);
+        return member;
+    }
+
+    void detach(const std::shared_ptr<Member>& member) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        members_.erase(std::remove(members_.begin(), members_.end(), member), members_.end());
+    }
+
+    // 汇总各连接最近一次发布的计数器，最多滞后一个检查间隔
+    Snapshot snapshot() const {
+        Snapshot s;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            s.connections = members_.size();
+            for (const auto& m : members_) {
+                s.total += m->published();
+            }
+        }
+        s.budget = budget();
+        s.releases = releases_.load(std::memory_order_relaxed);
+        s.releasedBytes = releasedBytes_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    // 由连接在自己的线程上、执行语句前调用：按间隔发布本连接的计数器，超出预算时释放本连接未使用的页缓存
+    void enforceBudget(sqlite3* db, Member& self) {
+        if (!db) {
+            return;
+        }
+        const int64_t now = nowMicros();
+        if (now - self.lastPublishMicros_ >= checkIntervalMicros_) {
+            self.publish(db);
+            self.lastPublishMicros_ = now;
+        }
+        const int64_t limit = budget();
+        if (limit <= 0) {
+            return;
+        }
+        int64_t last = lastCheckMicros_.load(std::memory_order_relaxed);
+        if (!overBudget_.load(std::memory_order_relaxed)) {
+            if (now - last < checkIntervalMicros_ ||
+                !lastCheckMicros_.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+                return;
+            }
+            overBudget_.store(snapshot().total.budgetedBytes() > limit, std::memory_order_relaxed);
+            if (!overBudget_.load(std::memory_order_relaxed)) {
+                return;
+            }
+        }
+
+        const int64_t before = SqliteMemoryStatus::read(db).cacheUsed;
+        sqlite3_db_release_memory(db);
+        self.publish(db);
+        self.lastPublishMicros_ = now;
+        const int64_t after = self.published().cacheUsed;
+        releases_.fetch_add(1, std::memory_order_relaxed);
+        releasedBytes_.fetch_add(std::max<int64_t>(0, before - after), std::memory_order_relaxed);
+        // 每次释放后重新评估，回到预算内即停止
+        overBudget_.store(snapshot().total.budgetedBytes() > limit, std::memory_order_relaxed);
+        lastCheckMicros_.store(now, std::memory_order_relaxed);
+    }
+
+private:
+    static int64_t nowMicros() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    mutable std::mutex mtx_;
+    std::vector<std::shared_ptr<Member>> members_;
+    std::atomic<int64_t> budget_{0};
+    int64_t checkIntervalMicros_ = 50 * 1000;
+    std::atomic<int64_t> lastCheckMicros_{0};
+    std::atomic<bool> overBudget_{false};
+    std::atomic<uint64_t> releases_{0};
+    std::atomic<int64_t> releasedBytes_{0};
+};
+
+} // namespace sdb::drivers
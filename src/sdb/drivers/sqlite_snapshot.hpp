@@ -0,0 +1,155 @@
+#pragma once
+#include "sqlite_driver.hpp"
+#include "../connection_pool.hpp"
+#include "../instrumented_connection.hpp"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sdb::drivers {
+
+// 让多个连接读取 WAL 数据库的同一个提交点：在源连接上 sqlite3_snapshot_get，
+// 再在其余连接上 sqlite3_snapshot_open。全程只持有读事务，不会阻塞写者。
+// 需要以 SQLITE_ENABLE_SNAPSHOT 编译的 SQLite（CMake 选项 SMARTDB_SQLITE_SNAPSHOT）
+class SnapshotGroup {
+public:
+    static constexpr bool supported() {
+#ifdef SQLITE_ENABLE_SNAPSHOT
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // 在 source 上开启读事务并捕获快照，source 自身也成为组成员
+    static DbResult<std::unique_ptr<SnapshotGroup>> capture(IConnection& source, const std::string& schema = "main") {
+        using Result = DbResult<std::unique_ptr<SnapshotGroup>>;
+#ifdef SQLITE_ENABLE_SNAPSHOT
+        auto* conn = connectionAs<SqliteConnection>(source);
+        if (!conn || !conn->nativeHandle()) {
+            return Result::failure("SnapshotGroup requires an open SqliteConnection");
+        }
+        auto beginRes = conn->begin();
+        if (!beginRes) {
+            return Result::failure(beginRes.error().message, beginRes.error().code);
+        }
+        sqlite3_snapshot* snapshot = nullptr;
+        const int rc = sqlite3_snapshot_get(conn->nativeHandle(), schema.c_str(), &snapshot);
+        if (rc != SQLITE_OK) {
+            // 数据库不是 WAL 模式，或 WAL 文件自创建以来尚无提交时也会失败
+            std::string message = std::string("sqlite3_snapshot_get failed: ") + sqlite3_errmsg(conn->nativeHandle());
+            (void)conn->rollback();
+            return Result::failure(std::move(message), rc);
+        }
+        auto group = std::unique_ptr<SnapshotGroup>(new SnapshotGroup(schema, snapshot));
+        group->members_.push_back(conn);
+        return Result::success(std::move(group));
+#else
+        (void)source;
+        (void)schema;
+        return Result::failure("SQLite snapshots require SQLITE_ENABLE_SNAPSHOT (SMARTDB_SQLITE_SNAPSHOT=ON)");
+#endif
+    }
+
+    // 从连接池借出 members 个连接：第一个捕获快照，其余打开同一快照
+    static DbResult<std::unique_ptr<SnapshotGroup>> capture(ConnectionPool& pool, size_t members,
+                                                            const std::string& schema = "main") {
+        using Result = DbResult<std::unique_ptr<SnapshotGroup>>;
+        if (members == 0) {
+            return Result::failure("SnapshotGroup requires at least one member");
+        }
+        auto firstRes = pool.acquire();
+        if (!firstRes) {
+            return Result::failure(firstRes.error().message, firstRes.error().code);
+        }
+        auto first = std::move(firstRes.value());
+        auto groupRes = capture(*first, schema);
+        if (!groupRes) {
+            return groupRes;
+        }
+        auto group = std::move(groupRes.value());
+        group->handles_.push_back(std::move(first));
+
+        for (size_t i = 1; i < members; ++i) {
+            auto handleRes = pool.acquire();
+            if (!handleRes) {
+                return Result::failure(handleRes.error().message, handleRes.error().code);
+            }
+            auto handle = std::move(handleRes.value());
+            auto joinRes = group->join(*handle);
+            if (!joinRes) {
+                return Result::failure(joinRes.error().message, joinRes.error().code);
+            }
+            group->handles_.push_back(std::move(handle));
+        }
+        return Result::success(std::move(group));
+    }
+
+    // 在 reader 上开启读事务并定位到组快照；reader 必须处于自动提交状态
+    DbResult<void> join(IConnection& reader) {
+#ifdef SQLITE_ENABLE_SNAPSHOT
+        if (!snapshot_) {
+            return DbResult<void>::failure("SnapshotGroup has been released");
+        }
+        auto* conn = connectionAs<SqliteConnection>(reader);
+        if (!conn || !conn->nativeHandle()) {
+            return DbResult<void>::failure("SnapshotGroup requires an open SqliteConnection");
+        }
+        auto beginRes = conn->begin();
+        if (!beginRes) {
+            return beginRes;
+        }
+        const int rc = sqlite3_snapshot_open(conn->nativeHandle(), schema_.c_str(), snapshot_);
+        if (rc != SQLITE_OK) {
+            // SQLITE_ERROR_SNAPSHOT 表示快照已被检查点覆盖
+            std::string message = std::string("sqlite3_snapshot_open failed: ") + sqlite3_errmsg(conn->nativeHandle());
+            (void)conn->rollback();
+            return DbResult<void>::failure(std::move(message), rc);
+        }
+        members_.push_back(conn);
+        return DbResult<void>::success();
+#else
+        (void)reader;
+        return DbResult<void>::failure("SQLite snapshots require SQLITE_ENABLE_SNAPSHOT (SMARTDB_SQLITE_SNAPSHOT=ON)");
+#endif
+    }
+
+    size_t size() const { return members_.size(); }
+
+    // 仅对通过连接池捕获的组有效，按加入顺序返回成员
+    IConnection& member(size_t index) { return *handles_.at(index); }
+
+    // 结束所有成员的读事务并释放快照；析构时自动调用
+    void release() {
+        for (auto* conn : members_) {
+            (void)conn->rollback();
+        }
+        members_.clear();
+#ifdef SQLITE_ENABLE_SNAPSHOT
+        if (snapshot_) {
+            sqlite3_snapshot_free(snapshot_);
+            snapshot_ = nullptr;
+        }
+#endif
+        handles_.clear();
+    }
+
+    ~SnapshotGroup() { release(); }
+
+    SnapshotGroup(const SnapshotGroup&) = delete;
+    SnapshotGroup& operator=(const SnapshotGroup&) = delete;
+
+private:
+    std::string schema_;
+#ifdef SQLITE_ENABLE_SNAPSHOT
+    SnapshotGroup(std::string schema, sqlite3_snapshot* snapshot) : schema_(std::move(schema)), snapshot_(snapshot) {}
+
+    sqlite3_snapshot* snapshot_ = nullptr;
+#endif
+    std::vector<SqliteConnection*> members_;
+    std::vector<ConnectionPool::Handle> handles_;
+};
+
+} // namespace sdb::drivers
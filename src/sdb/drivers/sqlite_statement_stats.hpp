@@ -0,0 +1,197 @@
+#pragma once
+#include "../sql_normalize.hpp"
+#include <sqlite3.h>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace sdb::drivers {
+
+// 按语句指纹汇总 sqlite3_stmt_status 计数器。超过阈值的语句自动记录一次 EXPLAIN QUERY PLAN，
+// 用于在生产环境定位全表扫描、临时 B 树排序和自动索引
+class SqliteStatementStats {
+public:
+    struct Options {
+        // 单次执行耗时或全表扫描步数超过阈值时捕获查询计划；0 表示不按该条件捕获
+        std::chrono::microseconds planThreshold{std::chrono::milliseconds(100)};
+        int64_t planFullscanSteps = 10000;
+        // 超出上限的新语句计入 "<other>"
+        size_t maxStatements = 1024;
+    };
+
+    struct Entry {
+        std::string sql;
+        uint64_t fingerprint = 0;
+        uint64_t calls = 0;
+        uint64_t rows = 0;
+        uint64_t fullscanSteps = 0;
+        uint64_t sorts = 0;
+        uint64_t autoindexes = 0;
+        uint64_t vmSteps = 0;
+        uint64_t totalMicros = 0;
+        uint64_t maxMicros = 0;
+        uint64_t slowCalls = 0;
+        std::string plan;
+    };
+
+    SqliteStatementStats() = default;
+    explicit SqliteStatementStats(Options options) : options_(std::move(options)) {}
+
+    void setOptions(Options options) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        options_ = std::move(options);
+    }
+
+    // 语句执行完毕、finalize 之前调用
+    void record(sqlite3_stmt* stmt, std::chrono::nanoseconds elapsed, uint64_t rows) {
+        if (!stmt) {
+            return;
+        }
+        const char* text = sqlite3_sql(stmt);
+        const auto fullscan = static_cast<uint64_t>(sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 0));
+        const auto sorts = static_cast<uint64_t>(sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_SORT, 0));
+        const auto autoindexes = static_cast<uint64_t>(sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_AUTOINDEX, 0));
+        const auto vmSteps = static_cast<uint64_t>(sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_VM_STEP, 0));
+        const auto micros = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+        auto statement = sdb::detail::threadSqlNormalizer().normalize(text ? text : "");
+        uint64_t key = hashNormalizedSql(statement);
+
+        bool capturePlan = false;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            auto it = entries_.find(key);
+            if (it == entries_.end()) {
+                if (entries_.size() >= options_.maxStatements) {
+                    statement = "<other>";
+                    key = hashNormalizedSql(statement);
+                    it = entries_.find(key);
+                }
+                if (it == entries_.end()) {
+                    it = entries_.try_emplace(key).first;
+                    it->second.sql = std::string(statement);
+                    it->second.fingerprint = key;
+                }
+            }
+            Entry& e = it->second;
+            ++e.calls;
+            e.rows += rows;
+            e.fullscanSteps += fullscan;
+            e.sorts += sorts;
+            e.autoindexes += autoindexes;
+            e.vmSteps += vmSteps;
+            e.totalMicros += micros;
+            e.maxMicros = std::max(e.maxMicros, micros);
+            const bool slow = (options_.planThreshold.count() > 0 && micros >= static_cast<uint64_t>(options_.planThreshold.count())) ||
+                              (options_.planFullscanSteps > 0 && fullscan >= static_cast<uint64_t>(options_.planFullscanSteps));
+            if (slow) {
+                ++e.slowCalls;
+                capturePlan = e.plan.empty() && e.sql != "<other>";
+            }
+        }
+
+        if (capturePlan) {
+            auto plan = explainQueryPlan(sqlite3_db_handle(stmt), text ? text : "");
+            std::lock_guard<std::mutex> lock(mtx_);
+            auto it = entries_.find(key);
+            if (it != entries_.end() && it->second.plan.empty()) {
+                it->second.plan = std::move(plan);
+            }
+        }
+    }
+
+    // 按累计耗时降序
+    std::vector<Entry> snapshot() const {
+        std::vector<Entry> out;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            out.reserve(entries_.size());
+            for (const auto& [key, entry] : entries_) {
+                out.push_back(entry);
+            }
+        }
+        std::sort(out.begin(), out.end(), [](const Entry& a, const Entry& b) { return a.totalMicros > b.totalMicros; });
+        return out;
+    }
+
+    std::optional<Entry> find(const std::string& sql) const {
+        const uint64_t key = sqlFingerprint(sql);
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = entries_.find(key);
+        if (it == entries_.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    nlohmann::json toJson() const {
+        nlohmann::json statements = nlohmann::json::array();
+        for (const auto& e : snapshot()) {
+            statements.push_back({
+                {"sql", e.sql},
+                {"fingerprint", formatSqlFingerprint(e.fingerprint)},
+                {"calls", e.calls},
+                {"rows", e.rows},
+                {"fullscan_steps", e.fullscanSteps},
+                {"sorts", e.sorts},
+                {"autoindexes", e.autoindexes},
+                {"vm_steps", e.vmSteps},
+                {"total_us", e.totalMicros},
+                {"max_us", e.maxMicros},
+                {"slow_calls", e.slowCalls},
+                {"plan", e.plan}
+            });
+        }
+        return {{"statements", std::move(statements)}};
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return entries_.size();
+    }
+
+    void reset() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        entries_.clear();
+    }
+
+    // 形如 sqlite3 命令行的缩进文本，每行一个计划节点
+    static std::string explainQueryPlan(sqlite3* db, const std::string& sql) {
+        sqlite3_stmt* stmt = nullptr;
+        if (!db || sqlite3_prepare_v2(db, ("EXPLAIN QUERY PLAN " + sql).c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+            if (stmt) {
+                sqlite3_finalize(stmt);
+            }
+            return {};
+        }
+        std::map<int, int> depth;
+        std::string plan;
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            const int id = sqlite3_column_int(stmt, 0);
+            const int parent = sqlite3_column_int(stmt, 1);
+            const auto* detail = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+            const int level = depth.count(parent) ? depth[parent] + 1 : 0;
+            depth[id] = level;
+            if (!plan.empty()) {
+                plan += '\n';
+            }
+            plan += std::string(static_cast<size_t>(level) * 2, ' ') + (detail ? detail : "");
+        }
+        sqlite3_finalize(stmt);
+        return plan;
+    }
+
+private:
+    mutable std::mutex mtx_;
+    Options options_;
+    std::unordered_map<uint64_t, Entry> entries_;
+};
+
+} // namespace sdb::drivers
@@ -0,0 +1,567 @@
+#pragma once
+#include "sqlite_driver.hpp"
+#include "sqlite_functions.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace sdb::drivers {
+
+// xFilter 收到的约束：op 为 SQLITE_INDEX_CONSTRAINT_EQ / GT / GE / LT / LE
+struct SqliteVtabConstraint {
+    int column = -1;
+    int op = 0;
+    DbValue value;
+};
+
+// 以只读虚拟表形式暴露给 SQLite 的 C++ 数据源。注册后数据源必须保持不变，
+// 游标会直接返回其内部存储的指针
+class SqliteVirtualTable {
+public:
+    struct Column {
+        std::string name;
+        std::string type;  // INTEGER / REAL / TEXT / BLOB
+    };
+
+    class Cursor {
+    public:
+        virtual ~Cursor() = default;
+        virtual bool eof() const = 0;
+        virtual void next() = 0;
+        virtual int64_t rowid() const = 0;
+        virtual void result(sqlite3_context* ctx, int column) const = 0;
+    };
+
+    virtual ~SqliteVirtualTable() = default;
+
+    virtual const std::vector<Column>& columns() const = 0;
+    virtual double estimatedRows() const = 0;
+    // 该列上的等值/范围约束可以由数据源自己完成，而不必全表扫描
+    virtual bool indexed(int column) const = 0;
+    // 按 column 打开游标时行按该列升序返回，ORDER BY 可以省去排序
+    virtual bool orderedBy(int column) const { (void)column; return false; }
+    // column 为 -1 时全表扫描；否则 constraints 均作用于 column
+    virtual std::unique_ptr<Cursor> open(int column, const std::vector<SqliteVtabConstraint>& constraints) = 0;
+};
+
+// 列式容器：每列一个 std::vector<int64_t / double / std::string>，行号即 rowid。
+// 通过 shared_ptr 共享已有数据，不发生拷贝；createIndex 为列建立一次排序置换，之后按二分查找定位
+class SqliteColumnarTable : public SqliteVirtualTable {
+public:
+    template <typename T>
+    DbResult<void> addColumn(const std::string& name, std::shared_ptr<const std::vector<T>> data) {
+        static_assert(std::is_same_v<T, int64_t> || std::is_same_v<T, double> || std::is_same_v<T, std::string>,
+                      "Columnar virtual table supports int64_t, double and std::string columns");
+        if (!data) {
+            return DbResult<void>::failure("Column data is null: " + name);
+        }
+        if (!entries_.empty() && data->size() != rows_) {
+            return DbResult<void>::failure("Column '" + name + "' has " + std::to_string(data->size()) +
+                                           " rows, expected " + std::to_string(rows_));
+        }
+        if (data->size() > std::numeric_limits<uint32_t>::max()) {
+            return DbResult<void>::failure("Column '" + name + "' exceeds 2^32 rows");
+        }
+        rows_ = data->size();
+        const char* type = std::is_same_v<T, int64_t> ? "INTEGER" : std::is_same_v<T, double> ? "REAL" : "TEXT";
+        columns_.push_back(Column{name, type});
+        entries_.push_back(Entry{std::move(data), {}, false});
+        return DbResult<void>::success();
+    }
+
+    template <typename T>
+    DbResult<void> addColumn(const std::string& name, std::vector<T> data) {
+        return addColumn<T>(name, std::make_shared<const std::vector<T>>(std::move(data)));
+    }
+
+    // 已按升序排列的列只做校验，不额外占用内存
+    DbResult<void> createIndex(const std::string& name) {
+        const int column = columnIndex(name);
+        if (column < 0) {
+            return DbResult<void>::failure("Unknown column: " + name);
+        }
+        auto& entry = entries_[static_cast<size_t>(column)];
+        std::visit([&](const auto& data) {
+            const auto& values = *data;
+            if (std::is_sorted(values.begin(), values.end())) {
+                entry.order.clear();
+            } else {
+                entry.order.resize(values.size());
+                std::iota(entry.order.begin(), entry.order.end(), 0u);
+                std::stable_sort(entry.order.begin(), entry.order.end(),
+                                 [&](uint32_t a, uint32_t b) { return values[a] < values[b]; });
+            }
+        }, entry.data);
+        entry.indexed = true;
+        return DbResult<void>::success();
+    }
+
+    size_t rows() const { return rows_; }
+
+    const std::vector<Column>& columns() const override { return columns_; }
+    double estimatedRows() const override { return static_cast<double>(rows_); }
+
+    bool indexed(int column) const override {
+        return column >= 0 && static_cast<size_t>(column) < entries_.size() && entries_[static_cast<size_t>(column)].indexed;
+    }
+
+    bool orderedBy(int column) const override { return indexed(column); }
+
+    std::unique_ptr<Cursor> open(int column, const std::vector<SqliteVtabConstraint>& constraints) override {
+        if (!indexed(column)) {
+            return std::make_unique<ColumnarCursor>(*this, nullptr, 0, rows_);
+        }
+        const auto& entry = entries_[static_cast<size_t>(column)];
+        size_t lo = 0;
+        size_t hi = rows_;
+        for (const auto& c : constraints) {
+            std::visit([&](const auto& data) { narrow(*data, entry.order, c, lo, hi); }, entry.data);
+        }
+        return std::make_unique<ColumnarCursor>(*this, entry.order.empty() ? nullptr : &entry.order, lo, std::max(lo, hi));
+    }
+
+private:
+    using ColumnData = std::variant<std::shared_ptr<const std::vector<int64_t>>,
+                                    std::shared_ptr<const std::vector<double>>,
+                                    std::shared_ptr<const std::vector<std::string>>>;
+
+    struct Entry {
+        ColumnData data;
+        // 空表示列本身有序
+        std::vector<uint32_t> order;
+        bool indexed = false;
+    };
+
+    class ColumnarCursor : public Cursor {
+    public:
+        ColumnarCursor(const SqliteColumnarTable& table, const std::vector<uint32_t>* order, size_t pos, size_t end)
+            : table_(table), order_(order), pos_(pos), end_(end) {}
+
+        bool eof() const override { return pos_ >= end_; }
+        void next() override { ++pos_; }
+        int64_t rowid() const override { return static_cast<int64_t>(row()); }
+
+        void result(sqlite3_context* ctx, int column) const override {
+            const size_t r = row();
+            std::visit([&](const auto& data) {
+                using T = typename std::decay_t<decltype(*data)>::value_type;
+                const auto& value = (*data)[r];
+                if constexpr (std::is_same_v<T, int64_t>) {
+                    sqlite3_result_int64(ctx, value);
+                } else if constexpr (std::is_same_v<T, double>) {
+                    sqlite3_result_double(ctx, value);
+                } else {
+                    // 数据源在注册期间保持不变，文本直接引用容器内存
+                    sqlite3_result_text64(ctx, value.data(), value.size(), SQLITE_STATIC, SQLITE_UTF8);
+                }
+            }, table_.entries_[static_cast<size_t>(column)].data);
+        }
+
+    private:
+        size_t row() const { return order_ ? (*order_)[pos_] : pos_; }
+
+        const SqliteColumnarTable& table_;
+        const std::vector<uint32_t>* order_;
+        size_t pos_;
+        size_t end_;
+    };
+
+    int columnIndex(const std::string& name) const {
+        for (size_t i = 0; i < columns_.size(); ++i) {
+            if (columns_[i].name == name) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    // 约束值与列类型不匹配（例如 TEXT 列与数值比较）时不收窄，由 SQLite 逐行复核
+    template <typename T>
+    static std::optional<T> boundFor(const DbValue& value) {
+        if constexpr (std::is_same_v<T, int64_t>) {
+            if (const auto* v = std::get_if<int64_t>(&value)) {
+                return *v;
+            }
+        } else if constexpr (std::is_same_v<T, double>) {
+            if (const auto* v = std::get_if<double>(&value)) {
+                return *v;
+            }
+            // 2^53 以内的整数可以无损转换为 double
+            if (const auto* v = std::get_if<int64_t>(&value); v && std::llabs(*v) <= (int64_t{1} << 53)) {
+                return static_cast<double>(*v);
+            }
+        } else {
+            if (const auto* v = std::get_if<std::string>(&value)) {
+                return *v;
+            }
+        }
+        return std::nullopt;
+    }
+
+    template <typename T>
+    static void narrow(const std::vector<T>& values, const std::vector<uint32_t>& order,
+                       const SqliteVtabConstraint& c, size_t& lo, size_t& hi) {
+        auto bound = boundFor<T>(c.value);
+        if (!bound) {
+            return;
+        }
+        auto at = [&](size_t i) -> const T& { return values[order.empty() ? i : order[i]]; };
+        auto lowerBound = [&](const T& key) {
+            size_t first = 0;
+            size_t count = values.size();
+            while (count > 0) {
+                const size_t step = count / 2;
+                if (at(first + step) < key) {
+                    first += step + 1;
+                    count -= step + 1;
+                } else {
+                    count = step;
+                }
+            }
+            return first;
+        };
+        auto upperBound = [&](const T& key) {
+            size_t first = 0;
+            size_t count = values.size();
+            while (count > 0) {
+                const size_t step = count / 2;
+                if (!(key < at(first + step))) {
+                    first += step + 1;
+                    count -= step + 1;
+                } else {
+                    count = step;
+                }
+            }
+            return first;
+        };
+
+        switch (c.op) {
+            case SQLITE_INDEX_CONSTRAINT_EQ:
+                lo = std::max(lo, lowerBound(*bound));
+                hi = std::min(hi, upperBound(*bound));
+                break;
+            case SQLITE_INDEX_CONSTRAINT_GT:
+                lo = std::max(lo, upperBound(*bound));
+                break;
+            case SQLITE_INDEX_CONSTRAINT_GE:
+                lo = std::max(lo, lowerBound(*bound));
+                break;
+            case SQLITE_INDEX_CONSTRAINT_LT:
+                hi = std::min(hi, lowerBound(*bound));
+                break;
+            case SQLITE_INDEX_CONSTRAINT_LE:
+                hi = std::min(hi, upperBound(*bound));
+                break;
+            default:
+                break;
+        }
+    }
+
+    std::vector<Column> columns_;
+    std::vector<Entry> entries_;
+    size_t rows_ = 0;
+};
+
+// 生成器数据源：每次扫描调用 factory 得到一个新的生成器，生成器逐行填充 Row，返回 false 结束。
+// filterable 中列出的列上的约束会传给 factory，生成器可以据此跳过不需要的行
+class SqliteGeneratorTable : public SqliteVirtualTable {
+public:
+    using Row = std::vector<DbValue>;
+    using Generator = std::function<bool(Row&)>;
+    using Factory = std::function<Generator(int column, const std::vector<SqliteVtabConstraint>& constraints)>;
+
+    SqliteGeneratorTable(std::vector<Column> columns, Factory factory, double estimatedRows = 1e6,
+                         std::vector<std::string> filterable = {})
+        : columns_(std::move(columns)), factory_(std::move(factory)), estimatedRows_(estimatedRows) {
+        for (const auto& name : filterable) {
+            for (size_t i = 0; i < columns_.size(); ++i) {
+                if (columns_[i].name == name) {
+                    filterable_.push_back(static_cast<int>(i));
+                }
+            }
+        }
+    }
+
+    const std::vector<Column>& columns() const override { return columns_; }
+    double estimatedRows() const override { return estimatedRows_; }
+
+    bool indexed(int column) const override {
+        return std::find(filterable_.begin(), filterable_.end(), column) != filterable_.end();
+    }
+
+    std::unique_ptr<Cursor> open(int column, const std::vector<SqliteVtabConstraint>& constraints) override {
+        return std::make_unique<GeneratorCursor>(factory_(column, constraints), columns_.size());
+    }
+
+private:
+    class GeneratorCursor : public Cursor {
+    public:
+        GeneratorCursor(Generator generator, size_t width) : generator_(std::move(generator)), row_(width) {
+            next();
+        }
+
+        bool eof() const override { return eof_; }
+
+        void next() override {
+            ++rowid_;
+            std::fill(row_.begin(), row_.end(), DbValue{});
+            eof_ = !generator_ || !generator_(row_);
+        }
+
+        int64_t rowid() const override { return rowid_; }
+
+        void result(sqlite3_context* ctx, int column) const override {
+            const auto index = static_cast<size_t>(column);
+            if (index >= row_.size()) {
+                sqlite3_result_null(ctx);
+                return;
+            }
+            detail::setSqliteResult(ctx, row_[index]);
+        }
+
+    private:
+        Generator generator_;
+        Row row_;
+        int64_t rowid_ = 0;
+        bool eof_ = false;
+    };
+
+    std::vector<Column> columns_;
+    Factory factory_;
+    double estimatedRows_;
+    std::vector<int> filterable_;
+};
+
+namespace detail {
+
+struct SqliteVtab : sqlite3_vtab {
+    SqliteVirtualTable* source = nullptr;
+};
+
+struct SqliteVtabCursor : sqlite3_vtab_cursor {
+    std::unique_ptr<SqliteVirtualTable::Cursor> impl;
+};
+
+inline std::string quoteSqliteIdentifier(const std::string& name) {
+    std::string quoted = "\"";
+    for (char c : name) {
+        quoted += c;
+        if (c == '"') {
+            quoted += '"';
+        }
+    }
+    return quoted + "\"";
+}
+
+inline bool isRangeOp(int op) {
+    return op == SQLITE_INDEX_CONSTRAINT_EQ || op == SQLITE_INDEX_CONSTRAINT_GT || op == SQLITE_INDEX_CONSTRAINT_GE ||
+           op == SQLITE_INDEX_CONSTRAINT_LT || op == SQLITE_INDEX_CONSTRAINT_LE;
+}
+
+inline int vtabConnect(sqlite3* db, void* aux, int, const char* const*, sqlite3_vtab** out, char** err) {
+    auto* source = static_cast<std::shared_ptr<SqliteVirtualTable>*>(aux)->get();
+    std::string ddl = "CREATE TABLE x(";
+    const auto& columns = source->columns();
+    for (size_t i = 0; i < columns.size(); ++i) {
+        ddl += (i ? ", " : "") + quoteSqliteIdentifier(columns[i].name) + " " + columns[i].type;
+    }
+    ddl += ")";
+    const int rc = sqlite3_declare_vtab(db, ddl.c_str());
+    if (rc != SQLITE_OK) {
+        *err = sqlite3_mprintf("%s", sqlite3_errmsg(db));
+        return rc;
+    }
+    auto* vtab = new SqliteVtab();
+    vtab->source = source;
+    *out = vtab;
+    return SQLITE_OK;
+}
+
+inline int vtabDisconnect(sqlite3_vtab* vtab) {
+    delete static_cast<SqliteVtab*>(vtab);
+    return SQLITE_OK;
+}
+
+// 选一个可由数据源处理的列：优先等值约束，其次范围约束；ORDER BY 该列升序时由游标直接按序返回。
+// 约束不设 omit，SQLite 仍会逐行复核，数据源只负责收窄扫描范围
+inline int vtabBestIndex(sqlite3_vtab* vtab, sqlite3_index_info* info) {
+    const auto* source = static_cast<SqliteVtab*>(vtab)->source;
+    const auto& columns = source->columns();
+    int column = -1;
+    bool equality = false;
+    for (int i = 0; i < info->nConstraint; ++i) {
+        const auto& c = info->aConstraint[i];
+        if (!c.usable || !isRangeOp(c.op) || !source->indexed(c.iColumn)) {
+            continue;
+        }
+        // 非 BINARY 排序规则的文本比较无法用二分查找完成
+        if (columns[static_cast<size_t>(c.iColumn)].type == "TEXT" &&
+            sqlite3_stricmp(sqlite3_vtab_collation(info, i), "BINARY") != 0) {
+            continue;
+        }
+        if (column < 0 || (!equality && c.op == SQLITE_INDEX_CONSTRAINT_EQ)) {
+            column = c.iColumn;
+            equality = c.op == SQLITE_INDEX_CONSTRAINT_EQ;
+        }
+    }
+
+    std::string ops;
+    int argc = 0;
+    if (column >= 0) {
+        for (int i = 0; i < info->nConstraint; ++i) {
+            const auto& c = info->aConstraint[i];
+            if (c.usable && c.iColumn == column && isRangeOp(c.op) &&
+                (columns[static_cast<size_t>(column)].type != "TEXT" ||
+                 sqlite3_stricmp(sqlite3_vtab_collation(info, i), "BINARY") == 0)) {
+                info->aConstraintUsage[i].argvIndex = ++argc;
+                ops += std::to_string(c.op) + ",";
+            }
+        }
+    } else if (info->nOrderBy == 1 && !info->aOrderBy[0].desc && source->orderedBy(info->aOrderBy[0].iColumn)) {
+        column = info->aOrderBy[0].iColumn;
+    }
+    if (column >= 0 && info->nOrderBy == 1 && info->aOrderBy[0].iColumn == column && !info->aOrderBy[0].desc &&
+        source->orderedBy(column)) {
+        info->orderByConsumed = 1;
+    }
+
+    const double rows = std::max(1.0, source->estimatedRows());
+    if (argc == 0) {
+        info->estimatedCost = rows;
+        info->estimatedRows = static_cast<sqlite3_int64>(rows);
+    } else if (equality) {
+        info->estimatedCost = std::log2(rows) + 10.0;
+        info->estimatedRows = 10;
+    } else {
+        info->estimatedCost = std::log2(rows) + rows / 4.0;
+        info->estimatedRows = static_cast<sqlite3_int64>(rows / 4.0);
+    }
+    info->idxNum = column;
+    if (!ops.empty()) {
+        info->idxStr = sqlite3_mprintf("%s", ops.c_str());
+        info->needToFreeIdxStr = 1;
+    }
+    return SQLITE_OK;
+}
+
+inline int vtabOpen(sqlite3_vtab*, sqlite3_vtab_cursor** out) {
+    *out = new SqliteVtabCursor();
+    return SQLITE_OK;
+}
+
+inline int vtabClose(sqlite3_vtab_cursor* cursor) {
+    delete static_cast<SqliteVtabCursor*>(cursor);
+    return SQLITE_OK;
+}
+
+inline int vtabFilter(sqlite3_vtab_cursor* base, int idxNum, const char* idxStr, int argc, sqlite3_value** argv) {
+    auto* cursor = static_cast<SqliteVtabCursor*>(base);
+    auto* source = static_cast<SqliteVtab*>(base->pVtab)->source;
+    std::vector<SqliteVtabConstraint> constraints;
+    constraints.reserve(static_cast<size_t>(argc));
+    const char* p = idxStr ? idxStr : "";
+    for (int i = 0; i < argc && *p; ++i) {
+        char* endp = nullptr;
+        const int op = static_cast<int>(std::strtol(p, &endp, 10));
+        p = (*endp == ',') ? endp + 1 : endp;
+        constraints.push_back(SqliteVtabConstraint{idxNum, op, fromSqliteValue<DbValue>(argv[i])});
+    }
+    try {
+        cursor->impl = source->open(idxNum, constraints);
+    } catch (const std::exception& e) {
+        sqlite3_free(base->pVtab->zErrMsg);
+        base->pVtab->zErrMsg = sqlite3_mprintf("%s", e.what());
+        return SQLITE_ERROR;
+    }
+    return SQLITE_OK;
+}
+
+inline int vtabNext(sqlite3_vtab_cursor* base) {
+    auto* cursor = static_cast<SqliteVtabCursor*>(base);
+    try {
+        cursor->impl->next();
+    } catch (const std::exception& e) {
+        sqlite3_free(base->pVtab->zErrMsg);
+        base->pVtab->zErrMsg = sqlite3_mprintf("%s", e.what());
+        return SQLITE_ERROR;
+    }
+    return SQLITE_OK;
+}
+
+inline int vtabEof(sqlite3_vtab_cursor* base) {
+    const auto* cursor = static_cast<SqliteVtabCursor*>(base);
+    return !cursor->impl || cursor->impl->eof();
+}
+
+inline int vtabColumn(sqlite3_vtab_cursor* base, sqlite3_context* ctx, int column) {
+    static_cast<SqliteVtabCursor*>(base)->impl->result(ctx, column);
+    return SQLITE_OK;
+}
+
+inline int vtabRowid(sqlite3_vtab_cursor* base, sqlite3_int64* rowid) {
+    *rowid = static_cast<SqliteVtabCursor*>(base)->impl->rowid();
+    return SQLITE_OK;
+}
+
+inline void destroyVirtualTableSource(void* p) {
+    delete static_cast<std::shared_ptr<SqliteVirtualTable>*>(p);
+}
+
+// 只读、仅同名（eponymous-only）模块：xCreate 为空，直接以模块名作为表名查询，无需 CREATE VIRTUAL TABLE
+inline const sqlite3_module* virtualTableModule() {
+    static const sqlite3_module module = [] {
+        sqlite3_module m{};
+        m.iVersion = 0;
+        m.xCreate = nullptr;
+        m.xConnect = &vtabConnect;
+        m.xBestIndex = &vtabBestIndex;
+        m.xDisconnect = &vtabDisconnect;
+        m.xDestroy = &vtabDisconnect;
+        m.xOpen = &vtabOpen;
+        m.xClose = &vtabClose;
+        m.xFilter = &vtabFilter;
+        m.xNext = &vtabNext;
+        m.xEof = &vtabEof;
+        m.xColumn = &vtabColumn;
+        m.xRowid = &vtabRowid;
+        return m;
+    }();
+    return &module;
+}
+
+} // namespace detail
+
+// 返回可交给 SqliteConnection::createModule 或 SqliteFunctionRegistry::module 的安装函数
+inline std::function<int(sqlite3*)> virtualTableInstaller(const std::string& name,
+                                                          std::shared_ptr<SqliteVirtualTable> table) {
+    return [name, table](sqlite3* db) {
+        auto* holder = new std::shared_ptr<SqliteVirtualTable>(table);
+        // 失败时 SQLite 同样会调用析构回调释放 holder
+        return sqlite3_create_module_v2(db, name.c_str(), detail::virtualTableModule(), holder,
+                                        &detail::destroyVirtualTableSource);
+    };
+}
+
+inline DbResult<void> registerVirtualTable(SqliteConnection& conn, const std::string& name,
+                                           std::shared_ptr<SqliteVirtualTable> table) {
+    return conn.createModule(name, virtualTableInstaller(name, std::move(table)));
+}
+
+// 登记到驱动后，驱动创建的每个池化连接都能直接查询该表
+inline void registerVirtualTable(SqliteFunctionRegistry& registry, const std::string& name,
+                                 std::shared_ptr<SqliteVirtualTable> table) {
+    registry.module(name, virtualTableInstaller(name, std::move(table)));
+}
+
+} // namespace sdb::drivers
@@ -44,6 +44,9 @@ public:
  virtual DbResult<void> begin() = 0;
  virtual DbResult<void> commit() = 0;
  virtual DbResult<void> rollback() = 0;
+
+ // 连接归还连接池前调用：丢弃未读完的结果并令仍在外部的结果对象失效，使下一位借用者拿到干净的连接
+ virtual void resetForReuse() {}
 };
 
 class TransactionGuard {
@@ -125,6 +128,17 @@ public:
  // URL 格式示例: "file:mydb.sqlite" 或 "host=127.0.0.1;user=root..."
  virtual std::unique_ptr<IConnection> createConnection(const nlohmann::json& config) = 0;
  virtual std::string name() const = 0;
+
+ // 由写连接配置派生只读连接配置，用于读写分离连接池；返回 null 表示驱动不支持
+ virtual nlohmann::json readOnlyConfig(const nlohmann::json& config) const {
+     (void)config;
+     return nullptr;
+ }
+
+ // 由配置派生读写分离池中写连接的配置，默认原样使用
+ virtual nlohmann::json writerConfig(const nlohmann::json& config) const {
+     return config;
+ }
 };
 
 } // namespace sdb
@@ -0,0 +1,360 @@
+#pragma once
+#include "idb.hpp"
+#include "query_phases.hpp"
+#include "query_stats.hpp"
+#include <nlohmann/json.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace sdb {
+
+enum class ConnectionOp { Open = 0, Query, Execute, Begin, Commit, Rollback };
+constexpr size_t kConnectionOpCount = 6;
+
+inline const char* connectionOpName(ConnectionOp op) {
+    switch (op) {
+        case ConnectionOp::Open: return "open";
+        case ConnectionOp::Query: return "query";
+        case ConnectionOp::Execute: return "execute";
+        case ConnectionOp::Begin: return "begin";
+        case ConnectionOp::Commit: return "commit";
+        case ConnectionOp::Rollback: return "rollback";
+    }
+    return "unknown";
+}
+
+// 一组连接（通常是同一个配置名下的连接池）共享的埋点：各操作的延迟直方图与错误数、读取的行数与字节数，
+// 以及按规范化语句汇总的 QueryStats
+class ConnectionInstrumentation {
+public:
+    struct OpSnapshot {
+        uint64_t calls = 0;
+        uint64_t errors = 0;
+        LatencyHistogram::Snapshot latency;
+    };
+
+    struct Snapshot {
+        std::string name;
+        std::array<OpSnapshot, kConnectionOpCount> ops;
+        uint64_t rowsFetched = 0;
+        uint64_t bytesFetched = 0;
+        int64_t connections = 0;
+    };
+
+    explicit ConnectionInstrumentation(std::string name = {}, QueryStats::Options options = {})
+        : name_(std::move(name)), queries_(std::move(options)) {}
+
+    ConnectionInstrumentation(const ConnectionInstrumentation&) = delete;
+    ConnectionInstrumentation& operator=(const ConnectionInstrumentation&) = delete;
+
+    const std::string& name() const { return name_; }
+
+    // 开启后每条语句按 prepare / execute / fetch / decode 记录墙钟与线程 CPU 时间（QueryStats::Entry::phases）。
+    // 每次阶段切换多一次 clock_gettime(CLOCK_THREAD_CPUTIME_ID)（系统调用），单行点查约增加 3 µs，默认关闭
+    void setPhaseTiming(bool enabled) { phaseTiming_.store(enabled, std::memory_order_relaxed); }
+    bool phaseTiming() const { return phaseTiming_.load(std::memory_order_relaxed); }
+
+    QueryStats& queries() { return queries_; }
+    const QueryStats& queries() const { return queries_; }
+
+    void recordOp(ConnectionOp op, std::chrono::nanoseconds elapsed, bool ok) {
+        auto& slot = ops_[static_cast<size_t>(op)];
+        slot.latency.record(static_cast<uint64_t>(elapsed.count() < 0 ? 0 : elapsed.count()));
+        if (!ok) {
+            slot.errors.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void addFetched(uint64_t rows, uint64_t bytes) {
+        rowsFetched_.fetch_add(rows, std::memory_order_relaxed);
+        bytesFetched_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    // 当前存活的被包装连接数
+    void connectionCreated() { connections_.fetch_add(1, std::memory_order_relaxed); }
+    void connectionDestroyed() { connections_.fetch_sub(1, std::memory_order_relaxed); }
+
+    Snapshot snapshot() const {
+        Snapshot s;
+        s.name = name_;
+        for (size_t i = 0; i < kConnectionOpCount; ++i) {
+            s.ops[i].latency = ops_[i].latency.snapshot();
+            s.ops[i].calls = s.ops[i].latency.count;
+            s.ops[i].errors = ops_[i].errors.load(std::memory_order_relaxed);
+        }
+        s.rowsFetched = rowsFetched_.load(std::memory_order_relaxed);
+        s.bytesFetched = bytesFetched_.load(std::memory_order_relaxed);
+        s.connections = connections_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    nlohmann::json toJson() const {
+        const auto s = snapshot();
+        auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+        nlohmann::json ops = nlohmann::json::object();
+        for (size_t i = 0; i < kConnectionOpCount; ++i) {
+            const auto& op = s.ops[i];
+            ops[connectionOpName(static_cast<ConnectionOp>(i))] = {
+                {"calls", op.calls},
+                {"errors", op.errors},
+                {"total_us", us(op.latency.sumNanos)},
+                {"p50_us", us(op.latency.percentile(0.50))},
+                {"p99_us", us(op.latency.percentile(0.99))},
+                {"max_us", us(op.latency.maxNanos)},
+            };
+        }
+        return {
+            {"name", s.name},
+            {"connections", s.connections},
+            {"rows_fetched", s.rowsFetched},
+            {"bytes_fetched", s.bytesFetched},
+            {"operations", std::move(ops)},
+            {"queries", queries_.toJson()},
+        };
+    }
+
+    void reset() {
+        for (auto& op : ops_) {
+            op.latency.reset();
+            op.errors.store(0, std::memory_order_relaxed);
+        }
+        rowsFetched_.store(0, std::memory_order_relaxed);
+        bytesFetched_.store(0, std::memory_order_relaxed);
+        queries_.reset();
+    }
+
+private:
+    struct OpSlot {
+        LatencyHistogram latency;
+        std::atomic<uint64_t> errors{0};
+    };
+
+    std::string name_;
+    QueryStats queries_;
+    std::array<OpSlot, kConnectionOpCount> ops_;
+    std::atomic<uint64_t> rowsFetched_{0};
+    std::atomic<uint64_t> bytesFetched_{0};
+    std::atomic<int64_t> connections_{0};
+    std::atomic<bool> phaseTiming_{false};
+};
+
+namespace detail {
+inline uint64_t dbValueBytes(const DbValue& v) {
+    if (const auto* s = std::get_if<std::string>(&v)) {
+        return s->size();
+    }
+    if (const auto* b = std::get_if<std::vector<uint8_t>>(&v)) {
+        return b->size();
+    }
+    if (std::holds_alternative<int>(v)) {
+        return sizeof(int);
+    }
+    if (std::holds_alternative<bool>(v)) {
+        return 1;
+    }
+    return isNull(v) ? 0 : 8;
+}
+} // namespace detail
+
+// 统计经过的行与字节。语句的总耗时 = query() 调用 + 各次 next()，在结果集销毁时记入 QueryStats；
+// 开启阶段计时时 next() 计入 fetch、get() 计入 decode
+class InstrumentedResultSet : public IResultSet {
+public:
+    InstrumentedResultSet(std::shared_ptr<IResultSet> inner, std::shared_ptr<ConnectionInstrumentation> instrumentation,
+                          std::string sql, std::chrono::nanoseconds queryTime)
+        : inner_(std::move(inner)), instrumentation_(std::move(instrumentation)), sql_(std::move(sql)),
+          elapsed_(queryTime) {}
+
+    // 延续 query() 中已开始的阶段计时
+    InstrumentedResultSet(std::shared_ptr<IResultSet> inner, std::shared_ptr<ConnectionInstrumentation> instrumentation,
+                          std::string sql, std::chrono::nanoseconds queryTime, const QueryPhaseClock& phases)
+        : InstrumentedResultSet(std::move(inner), std::move(instrumentation), std::move(sql), queryTime) {
+        phased_ = true;
+        phases_ = phases;
+    }
+
+    ~InstrumentedResultSet() override {
+        instrumentation_->addFetched(rows_, bytes_);
+        instrumentation_->queries().record(sql_, elapsed_, rows_, bytes_, true, phased_ ? &phases_.times() : nullptr);
+    }
+
+    InstrumentedResultSet(const InstrumentedResultSet&) = delete;
+    InstrumentedResultSet& operator=(const InstrumentedResultSet&) = delete;
+
+    bool next() override {
+        const auto start = std::chrono::steady_clock::now();
+        if (phased_) {
+            phases_.switchTo(QueryPhase::Fetch);
+        }
+        const bool hasRow = inner_->next();
+        if (phased_) {
+            phases_.pause();
+        }
+        elapsed_ += std::chrono::steady_clock::now() - start;
+        rows_ += hasRow ? 1 : 0;
+        return hasRow;
+    }
+
+    DbValue get(int index) override {
+        return decoded([&] { return inner_->get(index); });
+    }
+
+    DbValue get(const std::string& columnName) override {
+        return decoded([&] { return inner_->get(columnName); });
+    }
+
+    std::vector<std::string> columnNames() override { return inner_->columnNames(); }
+
+    IResultSet& inner() { return *inner_; }
+
+private:
+    template <typename Fn>
+    DbValue decoded(Fn&& fn) {
+        if (phased_) {
+            phases_.switchTo(QueryPhase::Decode);
+        }
+        auto v = fn();
+        if (phased_) {
+            phases_.pause();
+        }
+        bytes_ += detail::dbValueBytes(v);
+        return v;
+    }
+
+    std::shared_ptr<IResultSet> inner_;
+    std::shared_ptr<ConnectionInstrumentation> instrumentation_;
+    std::string sql_;
+    std::chrono::nanoseconds elapsed_;
+    uint64_t rows_ = 0;
+    uint64_t bytes_ = 0;
+    bool phased_ = false;
+    QueryPhaseClock phases_;
+};
+
+// 包装任意驱动的连接，为 open/query/execute/begin/commit/rollback 计时并统计结果集行数。
+// 需要驱动特有接口时用 connectionAs<T>() 取得内部连接
+class InstrumentedConnection : public IConnection {
+public:
+    InstrumentedConnection(std::unique_ptr<IConnection> inner, std::shared_ptr<ConnectionInstrumentation> instrumentation)
+        : inner_(std::move(inner)), instrumentation_(std::move(instrumentation)) {
+        instrumentation_->connectionCreated();
+    }
+
+    ~InstrumentedConnection() override {
+        inner_.reset();
+        instrumentation_->connectionDestroyed();
+    }
+
+    InstrumentedConnection(const InstrumentedConnection&) = delete;
+    InstrumentedConnection& operator=(const InstrumentedConnection&) = delete;
+
+    IConnection& inner() { return *inner_; }
+    const IConnection& inner() const { return *inner_; }
+    ConnectionInstrumentation& instrumentation() { return *instrumentation_; }
+
+    DbResult<void> open() override {
+        return timed(ConnectionOp::Open, [&] { return inner_->open(); });
+    }
+
+    void close() override { inner_->close(); }
+
+    bool isOpen() const override { return inner_->isOpen(); }
+
+    void resetForReuse() override { inner_->resetForReuse(); }
+
+    DbResult<std::shared_ptr<IResultSet>> query(const std::string& sql) override {
+        const bool phased = instrumentation_->phaseTiming();
+        QueryPhaseClock phases;
+        const auto start = std::chrono::steady_clock::now();
+        auto res = phased ? inPhases(phases, [&] { return inner_->query(sql); }) : inner_->query(sql);
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        instrumentation_->recordOp(ConnectionOp::Query, elapsed, res.ok());
+        if (!res) {
+            instrumentation_->queries().record(sql, elapsed, 0, 0, false, phased ? &phases.times() : nullptr);
+            return res;
+        }
+        if (phased) {
+            return DbResult<std::shared_ptr<IResultSet>>::success(
+                std::make_shared<InstrumentedResultSet>(std::move(res.value()), instrumentation_, sql, elapsed, phases));
+        }
+        return DbResult<std::shared_ptr<IResultSet>>::success(
+            std::make_shared<InstrumentedResultSet>(std::move(res.value()), instrumentation_, sql, elapsed));
+    }
+
+    DbResult<int64_t> execute(const std::string& sql) override {
+        return timedExecute(sql, [&] { return inner_->execute(sql); });
+    }
+
+    DbResult<int64_t> execute(const std::string& sql, const std::vector<DbValue>& params) override {
+        return timedExecute(sql, [&] { return inner_->execute(sql, params); });
+    }
+
+    DbResult<void> begin() override {
+        return timed(ConnectionOp::Begin, [&] { return inner_->begin(); });
+    }
+
+    DbResult<void> commit() override {
+        return timed(ConnectionOp::Commit, [&] { return inner_->commit(); });
+    }
+
+    DbResult<void> rollback() override {
+        return timed(ConnectionOp::Rollback, [&] { return inner_->rollback(); });
+    }
+
+private:
+    template <typename Fn>
+    DbResult<void> timed(ConnectionOp op, Fn&& fn) {
+        const auto start = std::chrono::steady_clock::now();
+        auto res = fn();
+        instrumentation_->recordOp(op, std::chrono::steady_clock::now() - start, res.ok());
+        return res;
+    }
+
+    template <typename Fn>
+    DbResult<int64_t> timedExecute(const std::string& sql, Fn&& fn) {
+        const bool phased = instrumentation_->phaseTiming();
+        QueryPhaseClock phases;
+        const auto start = std::chrono::steady_clock::now();
+        auto res = phased ? inPhases(phases, fn) : fn();
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        instrumentation_->recordOp(ConnectionOp::Execute, elapsed, res.ok());
+        const uint64_t affected = res.ok() && res.value() > 0 ? static_cast<uint64_t>(res.value()) : 0;
+        instrumentation_->queries().record(sql, elapsed, affected, 0, res.ok(), phased ? &phases.times() : nullptr);
+        return res;
+    }
+
+    // 驱动调用默认计入 execute，驱动内部用 ScopedQueryPhase 把 prepare / fetch 划出来
+    template <typename Fn>
+    static std::invoke_result_t<Fn&> inPhases(QueryPhaseClock& phases, Fn&& fn) {
+        ScopedQueryPhaseClock scope(&phases);
+        phases.switchTo(QueryPhase::Execute);
+        auto res = fn();
+        phases.pause();
+        return res;
+    }
+
+    std::unique_ptr<IConnection> inner_;
+    std::shared_ptr<ConnectionInstrumentation> instrumentation_;
+};
+
+// 穿过 InstrumentedConnection 包装取得驱动的具体连接类型，类型不符时返回 nullptr
+template <typename T>
+T* connectionAs(IConnection& conn) {
+    if (auto* typed = dynamic_cast<T*>(&conn)) {
+        return typed;
+    }
+    if (auto* wrapped = dynamic_cast<InstrumentedConnection*>(&conn)) {
+        return connectionAs<T>(wrapped->inner());
+    }
+    return nullptr;
+}
+
+} // namespace sdb
@@ -0,0 +1,251 @@
+#pragma once
+#include "types.hpp"
+#include <spdlog/spdlog.h>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+namespace sdb {
+
+// 把 source() 的文本（通常是 DatabaseManager::renderPrometheus）按周期写入文件，
+// 和/或在本机 HTTP 端点 GET /metrics 上提供，供 Prometheus 抓取或 node_exporter textfile collector 读取
+class MetricsExporter {
+public:
+    using Source = std::function<std::string()>;
+
+    struct Options {
+        // 非空时每个 interval 原子替换该文件（先写 .tmp 再 rename）
+        std::string path;
+        std::chrono::milliseconds interval{15000};
+        // < 0 不开启 HTTP；0 由系统分配端口，实际端口见 httpPort()。Windows 上不支持
+        int httpPort = -1;
+        std::string bindAddress = "127.0.0.1";
+    };
+
+    static DbResult<std::unique_ptr<MetricsExporter>> start(Source source, Options options) {
+        using Result = DbResult<std::unique_ptr<MetricsExporter>>;
+        if (!source) {
+            return Result::failure("MetricsExporter requires a source");
+        }
+        if (options.path.empty() && options.httpPort < 0) {
+            return Result::failure("MetricsExporter requires a file path or an HTTP port");
+        }
+        std::unique_ptr<MetricsExporter> exporter(new MetricsExporter(std::move(source), std::move(options)));
+        if (exporter->options_.httpPort >= 0) {
+            auto listenRes = exporter->listen();
+            if (!listenRes) {
+                return Result::failure(listenRes.error().message, listenRes.error().code);
+            }
+        }
+        if (!exporter->options_.path.empty()) {
+            auto writeRes = exporter->writeNow();
+            if (!writeRes) {
+                return Result::failure(writeRes.error().message);
+            }
+            exporter->fileWorker_ = std::thread([raw = exporter.get()] { raw->fileLoop(); });
+        }
+        if (exporter->listenFd_ >= 0) {
+            exporter->httpWorker_ = std::thread([raw = exporter.get()] { raw->httpLoop(); });
+        }
+        return Result::success(std::move(exporter));
+    }
+
+    ~MetricsExporter() { stop(); }
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        if (fileWorker_.joinable()) {
+            fileWorker_.join();
+        }
+        if (httpWorker_.joinable()) {
+            httpWorker_.join();
+        }
+        closeListener();
+    }
+
+    int httpPort() const { return boundPort_; }
+
+    uint64_t writes() const { return writes_.load(std::memory_order_relaxed); }
+    uint64_t scrapes() const { return scrapes_.load(std::memory_order_relaxed); }
+
+    DbResult<void> writeNow() {
+        const std::string tmp = options_.path + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::trunc);
+            if (!out) {
+                return DbResult<void>::failure("Cannot open metrics file: " + tmp);
+            }
+            out << source_();
+            if (!out) {
+                return DbResult<void>::failure("Failed to write metrics file: " + tmp);
+            }
+        }
+        std::error_code ec;
+        std::filesystem::rename(tmp, options_.path, ec);
+        if (ec) {
+            return DbResult<void>::failure("Cannot replace metrics file " + options_.path + ": " + ec.message());
+        }
+        writes_.fetch_add(1, std::memory_order_relaxed);
+        return DbResult<void>::success();
+    }
+
+private:
+    MetricsExporter(Source source, Options options) : source_(std::move(source)), options_(std::move(options)) {}
+
+    void fileLoop() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (!stopping_) {
+            cv_.wait_for(lock, options_.interval, [this] { return stopping_; });
+            if (stopping_) {
+                break;
+            }
+            lock.unlock();
+            auto res = writeNow();
+            if (!res) {
+                spdlog::warn("Metrics export failed: {}", res.error().message);
+            }
+            lock.lock();
+        }
+    }
+
+    bool stopping() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return stopping_;
+    }
+
+#ifndef _WIN32
+    DbResult<void> listen() {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(options_.httpPort));
+        if (inet_pton(AF_INET, options_.bindAddress.c_str(), &addr.sin_addr) != 1) {
+            return DbResult<void>::failure("Invalid metrics bind address: " + options_.bindAddress);
+        }
+        listenFd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (listenFd_ < 0) {
+            return DbResult<void>::failure("Cannot create metrics socket", errno);
+        }
+        int one = 1;
+        ::setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (::bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(listenFd_, 16) != 0) {
+            const int err = errno;
+            closeListener();
+            return DbResult<void>::failure("Cannot listen on " + options_.bindAddress + ":" +
+                                               std::to_string(options_.httpPort),
+                                           err);
+        }
+        socklen_t len = sizeof(addr);
+        ::getsockname(listenFd_, reinterpret_cast<sockaddr*>(&addr), &len);
+        boundPort_ = ntohs(addr.sin_port);
+        return DbResult<void>::success();
+    }
+
+    // 单线程逐个处理请求；poll 超时用于及时响应 stop()
+    void httpLoop() {
+        while (!stopping()) {
+            pollfd pfd{listenFd_, POLLIN, 0};
+            if (::poll(&pfd, 1, 100) <= 0) {
+                continue;
+            }
+            const int client = ::accept(listenFd_, nullptr, nullptr);
+            if (client < 0) {
+                continue;
+            }
+            serve(client);
+            ::close(client);
+        }
+    }
+
+    void serve(int client) {
+        timeval timeout{1, 0};
+        ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        std::string request;
+        char buf[1024];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+            const auto n = ::recv(client, buf, sizeof(buf), 0);
+            if (n <= 0) {
+                break;
+            }
+            request.append(buf, static_cast<size_t>(n));
+        }
+        const auto lineEnd = request.find("\r\n");
+        const std::string line = request.substr(0, lineEnd);
+        std::string status = "200 OK";
+        std::string body;
+        if (line.rfind("GET /metrics ", 0) == 0 || line.rfind("GET /metrics?", 0) == 0) {
+            body = source_();
+            scrapes_.fetch_add(1, std::memory_order_relaxed);
+        } else if (line.rfind("GET ", 0) == 0) {
+            status = "404 Not Found";
+            body = "try /metrics\n";
+        } else {
+            status = "405 Method Not Allowed";
+        }
+        std::string response = "HTTP/1.1 " + status +
+                               "\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: " +
+                               std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+        size_t sent = 0;
+        while (sent < response.size()) {
+#ifdef MSG_NOSIGNAL
+            const auto n = ::send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+#else
+            const auto n = ::send(client, response.data() + sent, response.size() - sent, 0);
+#endif
+            if (n <= 0) {
+                break;
+            }
+            sent += static_cast<size_t>(n);
+        }
+    }
+
+    void closeListener() {
+        if (listenFd_ >= 0) {
+            ::close(listenFd_);
+            listenFd_ = -1;
+        }
+    }
+#else
+    DbResult<void> listen() { return DbResult<void>::failure("MetricsExporter HTTP endpoint is not supported on Windows"); }
+    void httpLoop() {}
+    void closeListener() {}
+#endif
+
+    Source source_;
+    Options options_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+    std::thread fileWorker_;
+    std::thread httpWorker_;
+    int listenFd_ = -1;
+    int boundPort_ = 0;
+    std::atomic<uint64_t> writes_{0};
+    std::atomic<uint64_t> scrapes_{0};
+};
+
+} // namespace sdb
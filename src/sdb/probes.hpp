@@ -0,0 +1,92 @@
+#pragma once
+#include "sql_normalize.hpp"
+#include <cstdint>
+#include <string>
+#include <utility>
+
+// USDT 静态探针（provider "smartdb"），供 perf / bpftrace / SystemTap 在运行中的进程上挂载。
+// 以 -DSMARTDB_USDT=ON 构建时展开为 <sys/sdt.h> 的探针：未被追踪时每个探针只是一条 nop，
+// 需要额外计算的参数（语句指纹）由 semaphore 判断是否有追踪器挂载；未开启时宏与 QueryProbe 全部为空。
+//
+//   acquire__start(pool)                  acquire__end(pool, ok, elapsed_ns)
+//   wait__start(pool)                     wait__end(pool, timed_out)
+//   connection__create(pool, conn)        connection__destroy(pool, conn)
+//   query__start(conn, fingerprint, sql)  query__end(conn, fingerprint, ok)
+//
+// 例：bpftrace -e 'usdt:./app:smartdb:acquire__end { @[arg1] = hist(arg2); }'
+#if defined(SMARTDB_USDT)
+#if !__has_include(<sys/sdt.h>)
+#error "SMARTDB_USDT requires <sys/sdt.h> (systemtap-sdt-dev / systemtap-sdt-devel)"
+#endif
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+// 追踪器挂载时会把对应 semaphore 加一；inline 变量保证每个探针在整个程序中只有一份
+#define SDB_PROBE_SEMAPHORE(name) \
+    inline volatile unsigned short smartdb_##name##_semaphore __attribute__((unused, section(".probes"))) = 0;
+#define SDB_PROBE_ENABLED(name) __builtin_expect(smartdb_##name##_semaphore != 0, 0)
+#define SDB_PROBE(name, ...) STAP_PROBEV(smartdb, name, __VA_ARGS__)
+
+SDB_PROBE_SEMAPHORE(acquire__start)
+SDB_PROBE_SEMAPHORE(acquire__end)
+SDB_PROBE_SEMAPHORE(wait__start)
+SDB_PROBE_SEMAPHORE(wait__end)
+SDB_PROBE_SEMAPHORE(connection__create)
+SDB_PROBE_SEMAPHORE(connection__destroy)
+SDB_PROBE_SEMAPHORE(query__start)
+SDB_PROBE_SEMAPHORE(query__end)
+#else
+#define SDB_PROBE_ENABLED(name) false
+#define SDB_PROBE(name, ...) ((void)0)
+#endif
+
+namespace sdb::detail {
+
+// 一次语句执行的 query__start / query__end。构造时触发 start，析构时以 succeeded() 标记的结果触发 end；
+// 可移动，以便随结果集延续到遍历结束
+class QueryProbe {
+public:
+    QueryProbe() = default;
+
+#if defined(SMARTDB_USDT)
+    QueryProbe(const void* conn, const std::string& sql) {
+        if (SDB_PROBE_ENABLED(query__start) || SDB_PROBE_ENABLED(query__end)) {
+            conn_ = conn;
+            fingerprint_ = sqlFingerprint(sql);
+            SDB_PROBE(query__start, conn_, fingerprint_, sql.c_str());
+        }
+    }
+
+    ~QueryProbe() {
+        if (conn_) {
+            SDB_PROBE(query__end, conn_, fingerprint_, ok_ ? 1 : 0);
+        }
+    }
+
+    QueryProbe(QueryProbe&& other) noexcept
+        : conn_(std::exchange(other.conn_, nullptr)), fingerprint_(other.fingerprint_), ok_(other.ok_) {}
+
+    QueryProbe& operator=(QueryProbe&& other) noexcept {
+        if (this != &other) {
+            std::swap(conn_, other.conn_);
+            std::swap(fingerprint_, other.fingerprint_);
+            std::swap(ok_, other.ok_);
+        }
+        return *this;
+    }
+
+    void succeeded() { ok_ = true; }
+    void failed() { ok_ = false; }
+
+private:
+    const void* conn_ = nullptr;
+    uint64_t fingerprint_ = 0;
+    bool ok_ = false;
+#else
+    QueryProbe(const void*, const std::string&) {}
+    void succeeded() {}
+    void failed() {}
+#endif
+};
+
+} // namespace sdb::detail
@@ -0,0 +1,146 @@
+#pragma once
+#include "query_stats.hpp"
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace sdb {
+
+// 生成 Prometheus 文本格式（0.0.4）。同名指标的样本按族归并，族内 HELP / TYPE 只输出一次，
+// 调用方可以按对象遍历、交错写入不同的指标
+class PrometheusWriter {
+public:
+    using Labels = std::vector<std::pair<std::string, std::string>>;
+
+    // 延迟直方图导出的 le 边界（秒）
+    static constexpr std::array<double, 17> kBucketBounds = {
+        0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025,
+        0.05,    0.1,    0.25,    0.5,    1,     2.5,    5,     10,
+    };
+
+    void counter(const std::string& name, const std::string& help, const Labels& labels, double value) {
+        sample(family(name, "counter", help), name, labels, value);
+    }
+
+    void gauge(const std::string& name, const std::string& help, const Labels& labels, double value) {
+        sample(family(name, "gauge", help), name, labels, value);
+    }
+
+    // LatencyHistogram 的对数桶折算到 kBucketBounds：只计入上界不超过 le 的内部桶，
+    // 边界落在内部桶中间时该桶整体计入下一个 le（偏差不超过一个内部桶宽，约 12.5%）
+    void histogram(const std::string& name, const std::string& help, const Labels& labels,
+                   const LatencyHistogram::Snapshot& h) {
+        auto& body = family(name, "histogram", help);
+        size_t bucket = 0;
+        uint64_t cumulative = 0;
+        for (double bound : kBucketBounds) {
+            const auto boundNanos = static_cast<uint64_t>(std::llround(bound * 1e9));
+            while (bucket < LatencyHistogram::kBuckets && LatencyHistogram::bucketUpper(bucket) <= boundNanos) {
+                cumulative += h.counts[bucket++];
+            }
+            sample(body, name + "_bucket", labels, static_cast<double>(cumulative), {"le", formatValue(bound)});
+        }
+        sample(body, name + "_bucket", labels, static_cast<double>(h.count), {"le", "+Inf"});
+        sample(body, name + "_sum", labels, static_cast<double>(h.sumNanos) / 1e9);
+        sample(body, name + "_count", labels, static_cast<double>(h.count));
+    }
+
+    std::string str() const {
+        std::string out;
+        for (const auto& name : order_) {
+            const auto& f = families_.at(name);
+            out += "# HELP " + name + " " + escape(f.help, false) + "\n";
+            out += "# TYPE " + name + " " + f.type + "\n";
+            out += f.body;
+        }
+        return out;
+    }
+
+    static std::string formatValue(double v) {
+        if (std::isnan(v)) {
+            return "NaN";
+        }
+        if (std::isinf(v)) {
+            return v > 0 ? "+Inf" : "-Inf";
+        }
+        // 取能精确往返的最短表示，0.00005 不会写成 5.0000000000000002e-05
+        char buf[32];
+        for (int precision = 6; precision <= 17; ++precision) {
+            std::snprintf(buf, sizeof(buf), "%.*g", precision, v);
+            if (std::strtod(buf, nullptr) == v) {
+                break;
+            }
+        }
+        return buf;
+    }
+
+    // 标签值转义反斜杠、双引号与换行；HELP 文本只转义反斜杠与换行
+    static std::string escape(const std::string& value, bool quote = true) {
+        std::string out;
+        out.reserve(value.size());
+        for (char c : value) {
+            if (c == '\\') {
+                out += "\\\\";
+            } else if (c == '\n') {
+                out += "\\n";
+            } else if (c == '"' && quote) {
+                out += "\\\"";
+            } else {
+                out += c;
+            }
+        }
+        return out;
+    }
+
+private:
+    struct Family {
+        std::string type;
+        std::string help;
+        std::string body;
+    };
+
+    std::string& family(const std::string& name, const char* type, const std::string& help) {
+        auto [it, inserted] = families_.try_emplace(name);
+        if (inserted) {
+            it->second.type = type;
+            it->second.help = help;
+            order_.push_back(name);
+        }
+        return it->second.body;
+    }
+
+    static void sample(std::string& body, const std::string& name, const Labels& labels, double value,
+                       const std::pair<std::string, std::string>& extra = {}) {
+        body += name;
+        if (!labels.empty() || !extra.first.empty()) {
+            body += '{';
+            bool first = true;
+            auto append = [&](const std::string& key, const std::string& v) {
+                body += first ? "" : ",";
+                body += key + "=\"" + escape(v) + "\"";
+                first = false;
+            };
+            for (const auto& [key, v] : labels) {
+                append(key, v);
+            }
+            if (!extra.first.empty()) {
+                append(extra.first, extra.second);
+            }
+            body += '}';
+        }
+        body += ' ';
+        body += formatValue(value);
+        body += '\n';
+    }
+
+    std::vector<std::string> order_;
+    std::unordered_map<std::string, Family> families_;
+};
+
+} // namespace sdb
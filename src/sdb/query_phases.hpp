@@ -0,0 +1,148 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+
+namespace sdb {
+
+// 一条语句的耗时阶段：prepare（解析 / 绑定参数）、execute（服务器或引擎执行）、
+// fetch（取下一行 / 读取网络结果）、decode（列值转换为 DbValue）
+enum class QueryPhase { Prepare = 0, Execute, Fetch, Decode };
+constexpr size_t kQueryPhaseCount = 4;
+
+inline const char* queryPhaseName(QueryPhase phase) {
+    switch (phase) {
+        case QueryPhase::Prepare: return "prepare";
+        case QueryPhase::Execute: return "execute";
+        case QueryPhase::Fetch: return "fetch";
+        case QueryPhase::Decode: return "decode";
+    }
+    return "unknown";
+}
+
+// 各阶段的墙钟时间与本线程 CPU 时间（纳秒）。墙钟减 CPU 即等待服务器、磁盘或锁的时间
+struct QueryPhaseTimes {
+    std::array<uint64_t, kQueryPhaseCount> wallNanos{};
+    std::array<uint64_t, kQueryPhaseCount> cpuNanos{};
+
+    uint64_t wall(QueryPhase phase) const { return wallNanos[static_cast<size_t>(phase)]; }
+    uint64_t cpu(QueryPhase phase) const { return cpuNanos[static_cast<size_t>(phase)]; }
+
+    QueryPhaseTimes& operator+=(const QueryPhaseTimes& other) {
+        for (size_t i = 0; i < kQueryPhaseCount; ++i) {
+            wallNanos[i] += other.wallNanos[i];
+            cpuNanos[i] += other.cpuNanos[i];
+        }
+        return *this;
+    }
+};
+
+namespace detail {
+// 调用线程已消耗的 CPU 时间；平台不支持时返回 0（此时只有墙钟拆分）
+inline uint64_t threadCpuNanos() {
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+    timespec ts{};
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+#else
+    return 0;
+#endif
+}
+} // namespace detail
+
+// 按阶段累计时间的秒表：switchTo() 结束当前阶段并开始新阶段，pause() 结束当前阶段且不计入任何阶段
+// （调用方在两次驱动调用之间的代码）。每次切换读一次墙钟与一次线程 CPU 时钟
+class QueryPhaseClock {
+public:
+    // 返回切换前的阶段（未计时时为 -1），供 ScopedQueryPhase 恢复
+    int switchTo(QueryPhase phase) {
+        const int previous = current_;
+        tick();
+        current_ = static_cast<int>(phase);
+        return previous;
+    }
+
+    void resume(int phase) {
+        tick();
+        current_ = phase;
+    }
+
+    void pause() { resume(-1); }
+
+    const QueryPhaseTimes& times() const { return times_; }
+
+private:
+    void tick() {
+        const auto wall = std::chrono::steady_clock::now();
+        const uint64_t cpu = detail::threadCpuNanos();
+        if (current_ >= 0) {
+            const auto i = static_cast<size_t>(current_);
+            const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(wall - wallMark_).count();
+            times_.wallNanos[i] += static_cast<uint64_t>(elapsed < 0 ? 0 : elapsed);
+            times_.cpuNanos[i] += cpu > cpuMark_ ? cpu - cpuMark_ : 0;
+        }
+        wallMark_ = wall;
+        cpuMark_ = cpu;
+    }
+
+    QueryPhaseTimes times_;
+    int current_ = -1;
+    std::chrono::steady_clock::time_point wallMark_;
+    uint64_t cpuMark_ = 0;
+};
+
+namespace detail {
+// 本线程正在计时的语句；InstrumentedConnection 开启阶段计时时设置，驱动据此标注内部阶段
+inline QueryPhaseClock*& currentQueryPhaseClock() {
+    thread_local QueryPhaseClock* clock = nullptr;
+    return clock;
+}
+} // namespace detail
+
+// 在作用域内把 clock 设为本线程当前的阶段时钟
+class ScopedQueryPhaseClock {
+public:
+    explicit ScopedQueryPhaseClock(QueryPhaseClock* clock) : previous_(detail::currentQueryPhaseClock()) {
+        detail::currentQueryPhaseClock() = clock;
+    }
+
+    ~ScopedQueryPhaseClock() { detail::currentQueryPhaseClock() = previous_; }
+
+    ScopedQueryPhaseClock(const ScopedQueryPhaseClock&) = delete;
+    ScopedQueryPhaseClock& operator=(const ScopedQueryPhaseClock&) = delete;
+
+private:
+    QueryPhaseClock* previous_;
+};
+
+// 驱动内部标注阶段（如 prepare、读取网络结果）。未开启阶段计时时只有一次线程本地读取
+class ScopedQueryPhase {
+public:
+    explicit ScopedQueryPhase(QueryPhase phase) : clock_(detail::currentQueryPhaseClock()) {
+        if (clock_) {
+            previous_ = clock_->switchTo(phase);
+        }
+    }
+
+    ~ScopedQueryPhase() { end(); }
+
+    // 提前结束标注，回到进入前的阶段
+    void end() {
+        if (clock_) {
+            clock_->resume(previous_);
+            clock_ = nullptr;
+        }
+    }
+
+    ScopedQueryPhase(const ScopedQueryPhase&) = delete;
+    ScopedQueryPhase& operator=(const ScopedQueryPhase&) = delete;
+
+private:
+    QueryPhaseClock* clock_;
+    int previous_ = -1;
+};
+
+} // namespace sdb
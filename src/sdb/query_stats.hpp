@@ -0,0 +1,513 @@
+#pragma once
+#include "query_phases.hpp"
+#include "sql_normalize.hpp"
+#include <spdlog/spdlog.h>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace sdb {
+
+// 无锁延迟直方图（纳秒）：1 µs 以下合为一个桶，之后每个 2 的幂区间分 8 个子桶，最高约 36 分钟，
+// 分位数相对误差约 6%。记录只做几次 relaxed 原子自增
+class LatencyHistogram {
+public:
+    static constexpr unsigned kMinExp = 10;
+    static constexpr unsigned kMaxExp = 41;
+    static constexpr unsigned kSubBits = 3;
+    static constexpr size_t kSub = size_t{1} << kSubBits;
+    static constexpr size_t kBuckets = 1 + (kMaxExp - kMinExp + 1) * kSub;
+
+    struct Snapshot {
+        std::array<uint64_t, kBuckets> counts{};
+        uint64_t count = 0;
+        uint64_t sumNanos = 0;
+        uint64_t maxNanos = 0;
+
+        // q 取 [0, 1]，返回所在桶的中点（不超过观测到的最大值）
+        uint64_t percentile(double q) const {
+            if (count == 0) {
+                return 0;
+            }
+            const auto target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(count))));
+            uint64_t seen = 0;
+            for (size_t i = 0; i < kBuckets; ++i) {
+                seen += counts[i];
+                if (seen >= target) {
+                    const uint64_t mid = (bucketLower(i) + bucketUpper(i)) / 2;
+                    return std::min(mid, maxNanos);
+                }
+            }
+            return maxNanos;
+        }
+
+        double meanNanos() const { return count ? static_cast<double>(sumNanos) / static_cast<double>(count) : 0; }
+
+        Snapshot& operator+=(const Snapshot& other) {
+            for (size_t i = 0; i < kBuckets; ++i) {
+                counts[i] += other.counts[i];
+            }
+            count += other.count;
+            sumNanos += other.sumNanos;
+            maxNanos = std::max(maxNanos, other.maxNanos);
+            return *this;
+        }
+    };
+
+    void record(uint64_t nanos) {
+        counts_[bucketOf(nanos)].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(nanos, std::memory_order_relaxed);
+        uint64_t prev = max_.load(std::memory_order_relaxed);
+        while (nanos > prev && !max_.compare_exchange_weak(prev, nanos, std::memory_order_relaxed)) {
+        }
+    }
+
+    Snapshot snapshot() const {
+        Snapshot s;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            s.counts[i] = counts_[i].load(std::memory_order_relaxed);
+            s.count += s.counts[i];
+        }
+        s.sumNanos = sum_.load(std::memory_order_relaxed);
+        s.maxNanos = max_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    void reset() {
+        for (auto& c : counts_) {
+            c.store(0, std::memory_order_relaxed);
+        }
+        sum_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+    static size_t bucketOf(uint64_t nanos) {
+        if (nanos < (uint64_t{1} << kMinExp)) {
+            return 0;
+        }
+#if defined(__GNUC__) || defined(__clang__)
+        const unsigned e = 63u - static_cast<unsigned>(__builtin_clzll(nanos));
+#else
+        unsigned e = 63;
+        while (!(nanos >> e)) {
+            --e;
+        }
+#endif
+        if (e > kMaxExp) {
+            return kBuckets - 1;
+        }
+        const uint64_t sub = (nanos >> (e - kSubBits)) & (kSub - 1);
+        return 1 + (e - kMinExp) * kSub + static_cast<size_t>(sub);
+    }
+
+    // 桶 i 覆盖 [bucketLower(i), bucketUpper(i))
+    static uint64_t bucketLower(size_t index) {
+        if (index == 0) {
+            return 0;
+        }
+        const uint64_t e = (index - 1) / kSub + kMinExp;
+        const uint64_t sub = (index - 1) % kSub;
+        return (kSub + sub) << (e - kSubBits);
+    }
+
+    static uint64_t bucketUpper(size_t index) {
+        if (index == 0) {
+            return uint64_t{1} << kMinExp;
+        }
+        const uint64_t e = (index - 1) / kSub + kMinExp;
+        return bucketLower(index) + (uint64_t{1} << (e - kSubBits));
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> counts_{};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+// 按语句指纹（sqlFingerprint）汇总延迟直方图、行数与字节数，并对超过阈值的调用写慢查询日志（可采样、截断 SQL）。
+// 热路径只有一次线程本地的原始 SQL 查找和若干 relaxed 原子操作；未命中时规范化并按指纹查线程本地缓存，
+// 只有首次见到的语句才会加锁。内联字面量的 SQL 不按原文缓存，避免缓存被一次性的文本挤满
+class QueryStats {
+public:
+    struct SlowQuery {
+        std::string sql;
+        std::string statement;
+        bool truncated = false;
+        bool ok = true;
+        std::chrono::nanoseconds elapsed{0};
+        uint64_t rows = 0;
+        uint64_t bytes = 0;
+        std::chrono::system_clock::time_point at;
+    };
+
+    struct Options {
+        // 超出上限的新语句计入 "<other>"
+        size_t maxStatements = 1024;
+        // 耗时不低于阈值的调用计为慢查询；0 表示关闭慢查询日志
+        std::chrono::microseconds slowThreshold{std::chrono::milliseconds(100)};
+        // 每 N 条慢查询记录一条（1 表示全部记录），计数不受采样影响
+        uint32_t slowSampleEvery = 1;
+        // 日志中的原始 SQL 超过该长度时截断
+        size_t slowSqlMaxLength = 1024;
+        // 保留最近多少条慢查询供 slowQueries() 读取
+        size_t slowLogCapacity = 128;
+        // 为空时用 spdlog::warn 输出
+        std::function<void(const SlowQuery&)> slowQuerySink;
+    };
+
+    struct Entry {
+        std::string statement;
+        uint64_t fingerprint = 0;
+        uint64_t calls = 0;
+        uint64_t errors = 0;
+        uint64_t rows = 0;
+        uint64_t bytes = 0;
+        uint64_t slowCalls = 0;
+        LatencyHistogram::Snapshot latency;
+        // 带阶段拆分的调用数及其各阶段累计时间
+        uint64_t phasedCalls = 0;
+        QueryPhaseTimes phases;
+    };
+
+    QueryStats() : QueryStats(Options{}) {}
+    explicit QueryStats(Options options) : options_(std::move(options)), id_(nextId()) {
+        slowThresholdNanos_.store(toNanos(options_.slowThreshold), std::memory_order_relaxed);
+    }
+
+    QueryStats(const QueryStats&) = delete;
+    QueryStats& operator=(const QueryStats&) = delete;
+
+    void setOptions(Options options) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        options_ = std::move(options);
+        slowThresholdNanos_.store(toNanos(options_.slowThreshold), std::memory_order_relaxed);
+    }
+
+    Options options() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return options_;
+    }
+
+    // 一次调用结束后记录；rows / bytes 为读取或影响的行数与结果字节数，phases 非空时累计各阶段的墙钟与 CPU 时间
+    void record(const std::string& sql, std::chrono::nanoseconds elapsed, uint64_t rows = 0, uint64_t bytes = 0,
+                bool ok = true, const QueryPhaseTimes* phases = nullptr) {
+        Slot* slot = lookup(sql);
+        if (phases) {
+            slot->addPhases(*phases);
+        }
+        const auto nanos = static_cast<uint64_t>(elapsed.count() < 0 ? 0 : elapsed.count());
+        slot->latency.record(nanos);
+        if (rows) {
+            slot->rows.fetch_add(rows, std::memory_order_relaxed);
+        }
+        if (bytes) {
+            slot->bytes.fetch_add(bytes, std::memory_order_relaxed);
+        }
+        if (!ok) {
+            slot->errors.fetch_add(1, std::memory_order_relaxed);
+        }
+        const uint64_t threshold = slowThresholdNanos_.load(std::memory_order_relaxed);
+        if (threshold > 0 && nanos >= threshold) {
+            slot->slowCalls.fetch_add(1, std::memory_order_relaxed);
+            recordSlow(*slot, sql, elapsed, rows, bytes, ok);
+        }
+    }
+
+    // 有调用记录的语句，按累计耗时降序
+    std::vector<Entry> snapshot() const {
+        std::vector<Entry> out;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            out.reserve(slots_.size());
+            for (const auto& [key, slot] : slots_) {
+                Entry e = slot->toEntry();
+                if (e.calls > 0) {
+                    out.push_back(std::move(e));
+                }
+            }
+        }
+        std::sort(out.begin(), out.end(),
+                  [](const Entry& a, const Entry& b) { return a.latency.sumNanos > b.latency.sumNanos; });
+        return out;
+    }
+
+    std::optional<Entry> find(const std::string& sql) const {
+        const uint64_t fingerprint = sqlFingerprint(sql);
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = slots_.find(fingerprint);
+        if (it == slots_.end()) {
+            return std::nullopt;
+        }
+        return it->second->toEntry();
+    }
+
+    // 最近的慢查询，旧的在前
+    std::vector<SlowQuery> slowQueries() const {
+        std::lock_guard<std::mutex> lock(slowMtx_);
+        return {slowLog_.begin(), slowLog_.end()};
+    }
+
+    // 超过阈值的调用总数（含未被采样的）
+    uint64_t slowQueryCount() const { return slowSeen_.load(std::memory_order_relaxed); }
+
+    nlohmann::json toJson() const {
+        nlohmann::json statements = nlohmann::json::array();
+        auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+        for (const auto& e : snapshot()) {
+            statements.push_back({
+                {"statement", e.statement},
+                {"fingerprint", formatSqlFingerprint(e.fingerprint)},
+                {"calls", e.calls},
+                {"errors", e.errors},
+                {"rows", e.rows},
+                {"bytes", e.bytes},
+                {"slow_calls", e.slowCalls},
+                {"total_us", us(e.latency.sumNanos)},
+                {"mean_us", e.latency.meanNanos() / 1000.0},
+                {"p50_us", us(e.latency.percentile(0.50))},
+                {"p90_us", us(e.latency.percentile(0.90))},
+                {"p99_us", us(e.latency.percentile(0.99))},
+                {"max_us", us(e.latency.maxNanos)},
+            });
+            if (e.phasedCalls > 0) {
+                nlohmann::json phases = nlohmann::json::object();
+                for (size_t i = 0; i < kQueryPhaseCount; ++i) {
+                    phases[queryPhaseName(static_cast<QueryPhase>(i))] = {
+                        {"wall_us", us(e.phases.wallNanos[i])},
+                        {"cpu_us", us(e.phases.cpuNanos[i])},
+                    };
+                }
+                statements.back()["phased_calls"] = e.phasedCalls;
+                statements.back()["phases"] = std::move(phases);
+            }
+        }
+        return {{"statements", std::move(statements)}, {"slow_queries", slowQueryCount()}};
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return slots_.size();
+    }
+
+    // 清零计数与慢查询日志。语句槽保留（其他线程的缓存可能仍指向它们），snapshot() 不再列出没有调用的语句
+    void reset() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            for (auto& [key, slot] : slots_) {
+                slot->reset();
+            }
+        }
+        std::lock_guard<std::mutex> lock(slowMtx_);
+        slowLog_.clear();
+        slowSeen_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    struct Slot {
+        std::string statement;
+        uint64_t fingerprint = 0;
+        LatencyHistogram latency;
+        std::atomic<uint64_t> errors{0};
+        std::atomic<uint64_t> rows{0};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> slowCalls{0};
+        std::atomic<uint64_t> phasedCalls{0};
+        std::array<std::atomic<uint64_t>, kQueryPhaseCount> phaseWall{};
+        std::array<std::atomic<uint64_t>, kQueryPhaseCount> phaseCpu{};
+
+        void addPhases(const QueryPhaseTimes& times) {
+            phasedCalls.fetch_add(1, std::memory_order_relaxed);
+            for (size_t i = 0; i < kQueryPhaseCount; ++i) {
+                phaseWall[i].fetch_add(times.wallNanos[i], std::memory_order_relaxed);
+                phaseCpu[i].fetch_add(times.cpuNanos[i], std::memory_order_relaxed);
+            }
+        }
+
+        Entry toEntry() const {
+            Entry e;
+            e.statement = statement;
+            e.fingerprint = fingerprint;
+            e.latency = latency.snapshot();
+            e.calls = e.latency.count;
+            e.errors = errors.load(std::memory_order_relaxed);
+            e.rows = rows.load(std::memory_order_relaxed);
+            e.bytes = bytes.load(std::memory_order_relaxed);
+            e.slowCalls = slowCalls.load(std::memory_order_relaxed);
+            e.phasedCalls = phasedCalls.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < kQueryPhaseCount; ++i) {
+                e.phases.wallNanos[i] = phaseWall[i].load(std::memory_order_relaxed);
+                e.phases.cpuNanos[i] = phaseCpu[i].load(std::memory_order_relaxed);
+            }
+            return e;
+        }
+
+        void reset() {
+            latency.reset();
+            errors.store(0, std::memory_order_relaxed);
+            rows.store(0, std::memory_order_relaxed);
+            bytes.store(0, std::memory_order_relaxed);
+            slowCalls.store(0, std::memory_order_relaxed);
+            phasedCalls.store(0, std::memory_order_relaxed);
+            for (size_t i = 0; i < kQueryPhaseCount; ++i) {
+                phaseWall[i].store(0, std::memory_order_relaxed);
+                phaseCpu[i].store(0, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    // 原始 SQL / 指纹 -> 槽 的线程本地缓存，按实例编号分组；编号全局递增、不会复用，已销毁实例的条目不会再被访问。
+    // last 记住上一次用到的实例，同一线程连续记录同一个实例时省去外层查找。
+    // 含内联字面量的 SQL 取值多变，不进 bySql，只放进按哈希直接映射的小数组 recent：反复执行的同一条
+    // 字面量 SQL 命中后不必再规范化，取值不断变化的 SQL 只会相互覆盖，占用有上限
+    struct RecentSql {
+        std::string sql;
+        Slot* slot = nullptr;
+    };
+    static constexpr size_t kRecentLiteralSql = 64;
+    struct SlotCache {
+        std::unordered_map<std::string, Slot*> bySql;
+        std::unordered_map<uint64_t, Slot*> byFingerprint;
+        std::array<RecentSql, kRecentLiteralSql> recent;
+    };
+    struct ThreadCache {
+        std::unordered_map<uint64_t, SlotCache> owners;
+        uint64_t lastOwner = 0;
+        SlotCache* last = nullptr;
+    };
+    static constexpr size_t kThreadCacheLimit = 512;
+    static constexpr size_t kThreadCacheOwners = 64;
+
+    static uint64_t toNanos(std::chrono::microseconds d) {
+        return d.count() > 0 ? static_cast<uint64_t>(d.count()) * 1000 : 0;
+    }
+
+    static uint64_t nextId() {
+        static std::atomic<uint64_t> counter{0};
+        return ++counter;
+    }
+
+    Slot* lookup(const std::string& sql) {
+        thread_local ThreadCache cache;
+        if (cache.lastOwner != id_ || !cache.last) {
+            if (cache.owners.size() >= kThreadCacheOwners && !cache.owners.count(id_)) {
+                cache.owners.clear();
+            }
+            cache.last = &cache.owners[id_];
+            cache.lastOwner = id_;
+        }
+        auto& slots = *cache.last;
+        auto hit = slots.bySql.find(sql);
+        if (hit != slots.bySql.end()) {
+            return hit->second;
+        }
+        auto& recent = slots.recent[std::hash<std::string>{}(sql) & (kRecentLiteralSql - 1)];
+        if (recent.slot && recent.sql == sql) {
+            return recent.slot;
+        }
+        auto& normalizer = detail::threadSqlNormalizer();
+        const auto statement = normalizer.normalize(sql);
+        const uint64_t fingerprint = hashNormalizedSql(statement);
+        Slot* slot = nullptr;
+        auto byFingerprint = slots.byFingerprint.find(fingerprint);
+        if (byFingerprint != slots.byFingerprint.end()) {
+            slot = byFingerprint->second;
+        } else {
+            slot = slotFor(fingerprint, statement);
+            if (slots.byFingerprint.size() >= kThreadCacheLimit) {
+                slots.byFingerprint.clear();
+            }
+            slots.byFingerprint.emplace(fingerprint, slot);
+        }
+        if (!normalizer.sawLiterals()) {
+            if (slots.bySql.size() >= kThreadCacheLimit) {
+                slots.bySql.clear();
+            }
+            slots.bySql.emplace(sql, slot);
+        } else {
+            recent.sql.assign(sql);
+            recent.slot = slot;
+        }
+        return slot;
+    }
+
+    Slot* slotFor(uint64_t fingerprint, std::string_view statement) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = slots_.find(fingerprint);
+        if (it == slots_.end()) {
+            if (slots_.size() >= options_.maxStatements) {
+                statement = "<other>";
+                fingerprint = hashNormalizedSql(statement);
+                it = slots_.find(fingerprint);
+            }
+            if (it == slots_.end()) {
+                auto slot = std::make_unique<Slot>();
+                slot->statement = std::string(statement);
+                slot->fingerprint = fingerprint;
+                it = slots_.emplace(fingerprint, std::move(slot)).first;
+            }
+        }
+        return it->second.get();
+    }
+
+    void recordSlow(const Slot& slot, const std::string& sql, std::chrono::nanoseconds elapsed, uint64_t rows,
+                    uint64_t bytes, bool ok) {
+        const uint64_t seen = slowSeen_.fetch_add(1, std::memory_order_relaxed);
+        std::function<void(const SlowQuery&)> sink;
+        SlowQuery entry;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            const uint32_t every = std::max<uint32_t>(1, options_.slowSampleEvery);
+            if (seen % every != 0) {
+                return;
+            }
+            const size_t limit = options_.slowSqlMaxLength;
+            entry.truncated = limit > 0 && sql.size() > limit;
+            entry.sql = entry.truncated ? sql.substr(0, limit) : sql;
+            sink = options_.slowQuerySink;
+            entry.statement = slot.statement;
+            entry.ok = ok;
+            entry.elapsed = elapsed;
+            entry.rows = rows;
+            entry.bytes = bytes;
+            entry.at = std::chrono::system_clock::now();
+            std::lock_guard<std::mutex> slowLock(slowMtx_);
+            slowLog_.push_back(entry);
+            while (slowLog_.size() > options_.slowLogCapacity) {
+                slowLog_.pop_front();
+            }
+        }
+        if (sink) {
+            sink(entry);
+        } else {
+            spdlog::warn("Slow query ({} us, {} rows{}): {}{}",
+                         std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count(), rows,
+                         ok ? "" : ", failed", entry.sql, entry.truncated ? "..." : "");
+        }
+    }
+
+    mutable std::mutex mtx_;
+    Options options_;
+    std::atomic<uint64_t> slowThresholdNanos_{0};
+    const uint64_t id_;
+    std::unordered_map<uint64_t, std::unique_ptr<Slot>> slots_;
+
+    mutable std::mutex slowMtx_;
+    std::deque<SlowQuery> slowLog_;
+    std::atomic<uint64_t> slowSeen_{0};
+};
+
+} // namespace sdb
@@ -0,0 +1,213 @@
+#pragma once
+#include "idb.hpp"
+#include "connection_pool.hpp"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sdb {
+
+// N 个只读连接 + 1 个写连接。适用于 SQLite WAL：读者之间、读者与写者之间互不阻塞，
+// 写延迟不再受混在同一池里的长查询影响
+class ReadWritePool : public std::enable_shared_from_this<ReadWritePool> {
+public:
+    struct Options {
+        size_t readers = 4;
+        std::chrono::milliseconds waitTimeout{5000};
+        bool testOnBorrow = true;
+    };
+
+    static DbResult<std::shared_ptr<ReadWritePool>> create(ConnectionPool::Factory writerFactory,
+                                                           ConnectionPool::Factory readerFactory,
+                                                           Options options) {
+        if (options.readers == 0) {
+            return DbResult<std::shared_ptr<ReadWritePool>>::failure("ReadWritePool requires at least one reader");
+        }
+
+        // 写连接预先创建，确保数据库文件和 journal_mode 在只读连接打开前就绪
+        ConnectionPool::Options writerOptions;
+        writerOptions.minSize = 1;
+        writerOptions.maxSize = 1;
+        writerOptions.waitTimeout = options.waitTimeout;
+        writerOptions.testOnBorrow = options.testOnBorrow;
+        auto writerRes = ConnectionPool::createWithFactory(std::move(writerFactory), writerOptions);
+        if (!writerRes) {
+            return DbResult<std::shared_ptr<ReadWritePool>>::failure(writerRes.error().message, writerRes.error().code);
+        }
+        if (writerRes.value()->totalSize() == 0) {
+            return DbResult<std::shared_ptr<ReadWritePool>>::failure(
+                "ReadWritePool failed to open writer: " + writerRes.value()->lastError());
+        }
+
+        ConnectionPool::Options readerOptions;
+        readerOptions.maxSize = options.readers;
+        readerOptions.waitTimeout = options.waitTimeout;
+        readerOptions.testOnBorrow = options.testOnBorrow;
+        auto readerRes = ConnectionPool::createWithFactory(std::move(readerFactory), readerOptions);
+        if (!readerRes) {
+            return DbResult<std::shared_ptr<ReadWritePool>>::failure(readerRes.error().message, readerRes.error().code);
+        }
+
+        auto pool = std::shared_ptr<ReadWritePool>(
+            new ReadWritePool(std::move(writerRes.value()), std::move(readerRes.value())));
+        return DbResult<std::shared_ptr<ReadWritePool>>::success(std::move(pool));
+    }
+
+    DbResult<ConnectionPool::Handle> acquireReader() { return readers_->acquire(); }
+    DbResult<ConnectionPool::Handle> acquireWriter() { return writer_->acquire(); }
+
+    const std::shared_ptr<ConnectionPool>& readers() const { return readers_; }
+    const std::shared_ptr<ConnectionPool>& writer() const { return writer_; }
+
+    // 按调用自动路由的连接：事务外的 query 走只读池，execute 与整个事务走写连接
+    std::unique_ptr<IConnection> connection();
+
+    void shutdown() {
+        readers_->shutdown();
+        writer_->shutdown();
+    }
+
+private:
+    ReadWritePool(std::shared_ptr<ConnectionPool> writer, std::shared_ptr<ConnectionPool> readers)
+        : writer_(std::move(writer)), readers_(std::move(readers)) {}
+
+    std::shared_ptr<ConnectionPool> writer_;
+    std::shared_ptr<ConnectionPool> readers_;
+};
+
+// 结果集持有借出的连接，遍历结束并释放结果集后连接才归还到池中
+class PooledResultSet : public IResultSet {
+public:
+    PooledResultSet(ConnectionPool::Handle handle, std::shared_ptr<IResultSet> inner)
+        : handle_(std::move(handle)), inner_(std::move(inner)) {}
+
+    bool next() override { return inner_ && inner_->next(); }
+    DbValue get(int index) override { return inner_ ? inner_->get(index) : DbValue{}; }
+    DbValue get(const std::string& columnName) override { return inner_ ? inner_->get(columnName) : DbValue{}; }
+    std::vector<std::string> columnNames() override { return inner_ ? inner_->columnNames() : std::vector<std::string>{}; }
+
+private:
+    ConnectionPool::Handle handle_;
+    std::shared_ptr<IResultSet> inner_;
+};
+
+class RoutedConnection : public IConnection {
+public:
+    explicit RoutedConnection(std::shared_ptr<ReadWritePool> pool) : pool_(std::move(pool)) {}
+
+    ~RoutedConnection() override { close(); }
+
+    DbResult<void> open() override {
+        closed_ = false;
+        return DbResult<void>::success();
+    }
+
+    void close() override {
+        if (txWriter_) {
+            (void)txWriter_->rollback();
+            txWriter_.reset();
+        }
+        closed_ = true;
+    }
+
+    bool isOpen() const override { return !closed_; }
+
+    bool inTransaction() const { return static_cast<bool>(txWriter_); }
+
+    DbResult<std::shared_ptr<IResultSet>> query(const std::string& sql) override {
+        if (closed_) {
+            return DbResult<std::shared_ptr<IResultSet>>::failure("Connection is closed");
+        }
+        // 事务内读取必须看到本事务尚未提交的写入
+        if (txWriter_) {
+            return txWriter_->query(sql);
+        }
+        auto readerRes = pool_->acquireReader();
+        if (!readerRes) {
+            return DbResult<std::shared_ptr<IResultSet>>::failure(readerRes.error().message, readerRes.error().code);
+        }
+        auto reader = std::move(readerRes.value());
+        auto rsRes = reader->query(sql);
+        if (!rsRes) {
+            return rsRes;
+        }
+        return DbResult<std::shared_ptr<IResultSet>>::success(
+            std::make_shared<PooledResultSet>(std::move(reader), std::move(rsRes.value())));
+    }
+
+    DbResult<int64_t> execute(const std::string& sql) override {
+        return withWriter([&](IConnection& conn) { return conn.execute(sql); });
+    }
+
+    DbResult<int64_t> execute(const std::string& sql, const std::vector<DbValue>& params) override {
+        return withWriter([&](IConnection& conn) { return conn.execute(sql, params); });
+    }
+
+    DbResult<void> begin() override {
+        if (closed_) {
+            return DbResult<void>::failure("Connection is closed");
+        }
+        if (txWriter_) {
+            return DbResult<void>::failure("Transaction already active");
+        }
+        auto writerRes = pool_->acquireWriter();
+        if (!writerRes) {
+            return DbResult<void>::failure(writerRes.error().message, writerRes.error().code);
+        }
+        auto writer = std::move(writerRes.value());
+        auto res = writer->begin();
+        if (!res) {
+            return res;
+        }
+        txWriter_ = std::move(writer);
+        return DbResult<void>::success();
+    }
+
+    DbResult<void> commit() override {
+        if (!txWriter_) {
+            return DbResult<void>::failure("Transaction is not active");
+        }
+        auto res = txWriter_->commit();
+        if (res) {
+            txWriter_.reset();
+        }
+        return res;
+    }
+
+    DbResult<void> rollback() override {
+        if (!txWriter_) {
+            return DbResult<void>::failure("Transaction is not active");
+        }
+        auto res = txWriter_->rollback();
+        txWriter_.reset();
+        return res;
+    }
+
+private:
+    template <typename Fn>
+    DbResult<int64_t> withWriter(Fn&& fn) {
+        if (closed_) {
+            return DbResult<int64_t>::failure("Connection is closed");
+        }
+        if (txWriter_) {
+            return fn(*txWriter_);
+        }
+        auto writerRes = pool_->acquireWriter();
+        if (!writerRes) {
+            return DbResult<int64_t>::failure(writerRes.error().message, writerRes.error().code);
+        }
+        return fn(*writerRes.value());
+    }
+
+    std::shared_ptr<ReadWritePool> pool_;
+    ConnectionPool::Handle txWriter_;
+    bool closed_ = false;
+};
+
+inline std::unique_ptr<IConnection> ReadWritePool::connection() {
+    return std::make_unique<RoutedConnection>(shared_from_this());
+}
+
+} // namespace sdb
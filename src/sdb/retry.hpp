@@ -0,0 +1,252 @@
+#pragma once
+#include "idb.hpp"
+#include "connection_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace sdb {
+
+// SQLite 的 BUSY/LOCKED（含扩展码）与 MySQL 的死锁/锁等待超时都可以通过整体重放事务来恢复
+inline bool isTransientError(const DbError& error) {
+    switch (error.code) {
+        case 5:    // SQLITE_BUSY
+        case 6:    // SQLITE_LOCKED
+        case 261:  // SQLITE_BUSY_RECOVERY
+        case 262:  // SQLITE_LOCKED_SHAREDCACHE
+        case 517:  // SQLITE_BUSY_SNAPSHOT
+        case 518:  // SQLITE_LOCKED_VTAB
+        case 773:  // SQLITE_BUSY_TIMEOUT
+        case 1205: // ER_LOCK_WAIT_TIMEOUT
+        case 1213: // ER_LOCK_DEADLOCK
+            return true;
+        default:
+            return false;
+    }
+}
+
+// 令牌桶式重试预算：每次成功调用存入 depositPerSuccess 个令牌，每次重试取出 1 个，
+// 防止在持续冲突时所有调用方同时放大负载
+class RetryBudget {
+public:
+    explicit RetryBudget(double maxTokens = 20.0, double depositPerSuccess = 0.1)
+        : maxTokens_(maxTokens), deposit_(depositPerSuccess), tokens_(maxTokens) {}
+
+    bool tryWithdraw() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (tokens_ < 1.0) {
+            return false;
+        }
+        tokens_ -= 1.0;
+        return true;
+    }
+
+    void recordSuccess() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        tokens_ = std::min(maxTokens_, tokens_ + deposit_);
+    }
+
+    double available() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return tokens_;
+    }
+
+private:
+    const double maxTokens_;
+    const double deposit_;
+    mutable std::mutex mtx_;
+    double tokens_;
+};
+
+class RetryMetrics {
+public:
+    struct Snapshot {
+        uint64_t calls = 0;
+        uint64_t attempts = 0;
+        uint64_t retries = 0;
+        uint64_t successes = 0;
+        uint64_t failures = 0;
+        uint64_t exhausted = 0;
+        uint64_t budgetRejections = 0;
+        uint64_t totalBackoffMicros = 0;
+    };
+
+    Snapshot snapshot() const {
+        Snapshot s;
+        s.calls = calls_.load(std::memory_order_relaxed);
+        s.attempts = attempts_.load(std::memory_order_relaxed);
+        s.retries = retries_.load(std::memory_order_relaxed);
+        s.successes = successes_.load(std::memory_order_relaxed);
+        s.failures = failures_.load(std::memory_order_relaxed);
+        s.exhausted = exhausted_.load(std::memory_order_relaxed);
+        s.budgetRejections = budgetRejections_.load(std::memory_order_relaxed);
+        s.totalBackoffMicros = totalBackoffMicros_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    void reset() {
+        calls_ = 0;
+        attempts_ = 0;
+        retries_ = 0;
+        successes_ = 0;
+        failures_ = 0;
+        exhausted_ = 0;
+        budgetRejections_ = 0;
+        totalBackoffMicros_ = 0;
+    }
+
+    void recordCall() { calls_.fetch_add(1, std::memory_order_relaxed); }
+    void recordAttempt() { attempts_.fetch_add(1, std::memory_order_relaxed); }
+    void recordSuccess() { successes_.fetch_add(1, std::memory_order_relaxed); }
+    void recordFailure() { failures_.fetch_add(1, std::memory_order_relaxed); }
+    void recordExhausted() { exhausted_.fetch_add(1, std::memory_order_relaxed); }
+    void recordBudgetRejection() { budgetRejections_.fetch_add(1, std::memory_order_relaxed); }
+
+    void recordRetry(std::chrono::microseconds backoff) {
+        retries_.fetch_add(1, std::memory_order_relaxed);
+        totalBackoffMicros_.fetch_add(static_cast<uint64_t>(backoff.count()), std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> calls_{0};
+    std::atomic<uint64_t> attempts_{0};
+    std::atomic<uint64_t> retries_{0};
+    std::atomic<uint64_t> successes_{0};
+    std::atomic<uint64_t> failures_{0};
+    std::atomic<uint64_t> exhausted_{0};
+    std::atomic<uint64_t> budgetRejections_{0};
+    std::atomic<uint64_t> totalBackoffMicros_{0};
+};
+
+struct RetryPolicy {
+    int maxAttempts = 5;
+    std::chrono::milliseconds initialBackoff{5};
+    std::chrono::milliseconds maxBackoff{500};
+    double multiplier = 2.0;
+    // 0 为固定退避，1 为 full jitter：实际等待在 [backoff * (1 - jitter), backoff] 内均匀取值
+    double jitter = 0.5;
+    std::shared_ptr<RetryBudget> budget;
+    std::shared_ptr<RetryMetrics> metrics;
+    // 为空时使用 isTransientError
+    std::function<bool(const DbError&)> retryable;
+
+    std::chrono::microseconds backoffFor(int retry) const {
+        const double base = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(initialBackoff).count());
+        const double cap = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(maxBackoff).count());
+        double delay = base * std::pow(multiplier < 1.0 ? 1.0 : multiplier, retry > 0 ? retry - 1 : 0);
+        delay = std::min(delay, cap);
+
+        const double j = std::clamp(jitter, 0.0, 1.0);
+        if (j > 0.0 && delay > 0.0) {
+            thread_local std::mt19937_64 rng{std::random_device{}()};
+            std::uniform_real_distribution<double> dist(delay * (1.0 - j), delay);
+            delay = dist(rng);
+        }
+        return std::chrono::microseconds(static_cast<int64_t>(delay));
+    }
+};
+
+// 重放 fn 直到成功、遇到不可重试错误、次数用尽或预算耗尽；fn 必须返回 DbResult<T> 且可安全重放
+template <typename Fn>
+auto withRetry(const RetryPolicy& policy, Fn&& fn) -> std::invoke_result_t<Fn&> {
+    using Result = std::invoke_result_t<Fn&>;
+    RetryMetrics* metrics = policy.metrics.get();
+    if (metrics) {
+        metrics->recordCall();
+    }
+
+    const int maxAttempts = policy.maxAttempts < 1 ? 1 : policy.maxAttempts;
+    for (int attempt = 1;; ++attempt) {
+        if (metrics) {
+            metrics->recordAttempt();
+        }
+
+        Result res = fn();
+        if (res) {
+            if (metrics) {
+                metrics->recordSuccess();
+            }
+            if (policy.budget) {
+                policy.budget->recordSuccess();
+            }
+            return res;
+        }
+
+        const bool transient = policy.retryable ? policy.retryable(res.error()) : isTransientError(res.error());
+        if (!transient) {
+            if (metrics) {
+                metrics->recordFailure();
+            }
+            return res;
+        }
+        if (attempt >= maxAttempts) {
+            if (metrics) {
+                metrics->recordFailure();
+                metrics->recordExhausted();
+            }
+            return res;
+        }
+        if (policy.budget && !policy.budget->tryWithdraw()) {
+            if (metrics) {
+                metrics->recordFailure();
+                metrics->recordBudgetRejection();
+            }
+            return res;
+        }
+
+        const auto backoff = policy.backoffFor(attempt);
+        if (metrics) {
+            metrics->recordRetry(backoff);
+        }
+        if (backoff.count() > 0) {
+            std::this_thread::sleep_for(backoff);
+        }
+    }
+}
+
+// 在事务内执行 fn(conn) 并提交；BEGIN、fn 或 COMMIT 任一步出现瞬时错误时回滚并整体重放
+template <typename Fn>
+auto retryTransaction(IConnection& conn, const RetryPolicy& policy, Fn&& fn)
+    -> std::invoke_result_t<Fn&, IConnection&> {
+    using Result = std::invoke_result_t<Fn&, IConnection&>;
+    return withRetry(policy, [&]() -> Result {
+        auto txRes = TransactionGuard::begin(conn);
+        if (!txRes) {
+            return Result::failure(txRes.error().message, txRes.error().code);
+        }
+        auto tx = std::move(txRes.value());
+
+        Result res = fn(conn);
+        if (!res) {
+            return res;
+        }
+        auto commitRes = tx.commit();
+        if (!commitRes) {
+            return Result::failure(commitRes.error().message, commitRes.error().code);
+        }
+        return res;
+    });
+}
+
+// 从连接池借出一个连接，并在同一连接上完成所有重放
+template <typename Fn>
+auto retryTransaction(ConnectionPool& pool, const RetryPolicy& policy, Fn&& fn)
+    -> std::invoke_result_t<Fn&, IConnection&> {
+    using Result = std::invoke_result_t<Fn&, IConnection&>;
+    auto handleRes = pool.acquire();
+    if (!handleRes) {
+        return Result::failure(handleRes.error().message, handleRes.error().code);
+    }
+    auto handle = std::move(handleRes.value());
+    return retryTransaction(*handle, policy, std::forward<Fn>(fn));
+}
+
+} // namespace sdb
@@ -0,0 +1,339 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace sdb {
+
+namespace detail {
+
+// 字符分类表，避免 <cctype> 每个字符一次 locale 查询；非 ASCII 字节按标识符处理
+struct SqlCharTable {
+    static constexpr uint8_t kSpace = 1;
+    static constexpr uint8_t kDigit = 2;
+    static constexpr uint8_t kIdent = 4;
+
+    uint8_t cls[256]{};
+
+    constexpr SqlCharTable() {
+        for (int c = 0; c < 256; ++c) {
+            if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v') {
+                cls[c] = kSpace;
+            } else if (c >= '0' && c <= '9') {
+                cls[c] = kDigit | kIdent;
+            } else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c >= 0x80) {
+                cls[c] = kIdent;
+            }
+        }
+    }
+};
+
+inline constexpr SqlCharTable kSqlChars{};
+
+inline bool sqlIs(char c, uint8_t mask) { return (kSqlChars.cls[static_cast<unsigned char>(c)] & mask) != 0; }
+
+inline char sqlLower(char c) { return (c >= 'A' && c <= 'Z') ? static_cast<char>(c | 0x20) : c; }
+
+// out[0, n) 是否以独立的单词 word 结尾（忽略末尾一个空格）；out 中的关键字已是小写
+inline bool sqlEndsWithWord(const char* out, size_t n, std::string_view word) {
+    if (n > 0 && out[n - 1] == ' ') {
+        --n;
+    }
+    return n >= word.size() && std::memcmp(out + n - word.size(), word.data(), word.size()) == 0 &&
+           (n == word.size() || !sqlIs(out[n - word.size() - 1], SqlCharTable::kIdent));
+}
+
+// 已输出内容之后的 + / - 是否为一元符号：运算符、( 与关键字之后是，标识符、) 与参数之后是二元运算
+inline bool sqlSignIsUnary(const char* out, size_t n) {
+    if (n == 0) {
+        return true;
+    }
+    const char last = out[n - 1];
+    if (last == ')' || last == '?' || last == '"' || last == '`') {
+        return false;
+    }
+    if (!sqlIs(last, SqlCharTable::kIdent)) {
+        return true;
+    }
+    size_t start = n;
+    while (start > 0 && sqlIs(out[start - 1], SqlCharTable::kIdent)) {
+        --start;
+    }
+    static constexpr std::string_view kKeywords[] = {
+        "and",   "between", "by",     "case", "else",  "having", "in",     "interval", "is",   "like",
+        "limit", "not",     "offset", "on",   "or",    "return", "select", "set",      "then", "values",
+        "when",  "where"};
+    const std::string_view word(out + start, n - start);
+    for (const auto keyword : kKeywords) {
+        if (word == keyword) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 单遍规范化到 out（至少 sql.size() 字节，输出不会比输入长），返回输出长度；
+// literals 置为是否替换了内联字面量（占位符不算）
+inline size_t normalizeSqlInto(std::string_view sql, char* out, bool& literals) {
+    const char* p = sql.data();
+    const char* const end = p + sql.size();
+    size_t n = 0;
+    bool pendingSpace = false;
+    literals = false;
+    // 括号深度与各层是否为 IN (...) 列表或 VALUES 行（第 d 层对应 listBits 的第 d 位，超过 63 层不再折叠）；
+    // valuesDepth 为 VALUES 关键字所在的层，-1 表示不在 VALUES 子句中
+    int depth = 0;
+    uint64_t listBits = 0;
+    int valuesDepth = -1;
+    auto inList = [&] { return depth > 0 && depth < 64 && ((listBits >> depth) & 1) != 0; };
+
+    // ( 之后与 ) , ; 之前不补空格，使 "IN ( 1 , 2 )" 与 "IN (1,2)" 得到同一结果
+    auto space = [&](char next) {
+        if (pendingSpace && n > 0 && out[n - 1] != '(' && next != ')' && next != ',' && next != ';') {
+            out[n++] = ' ';
+        }
+        pendingSpace = false;
+    };
+    // IN 列表与 VALUES 行中紧跟 "?," 的 ? 直接丢弃，IN (?, ?, ...)、VALUES (?, ?) 折叠为 (?)；
+    // 其他位置（SELECT 列表、LIMIT ?, ?、函数参数）的参数个数是语句结构的一部分，保持原样
+    auto param = [&] {
+        if (inList() && n >= 2 && out[n - 1] == ',' && out[n - 2] == '?') {
+            --n;
+            pendingSpace = false;
+            return;
+        }
+        space('?');
+        out[n++] = '?';
+    };
+
+    while (p < end) {
+        const char c = *p;
+        if (sqlIs(c, SqlCharTable::kSpace)) {
+            pendingSpace = true;
+            ++p;
+        } else if (c == '-' && p + 1 < end && p[1] == '-') {
+            while (p < end && *p != '\n') {
+                ++p;
+            }
+            pendingSpace = true;
+        } else if (c == '/' && p + 1 < end && p[1] == '*') {
+            p += 2;
+            while (p < end && !(*p == '*' && p + 1 < end && p[1] == '/')) {
+                ++p;
+            }
+            p = p < end ? p + 2 : end;
+            pendingSpace = true;
+        } else if (c == '\'') {
+            // 字符串字面量，'' 为转义；X'..' / B'..' / N'..' / E'..' 的前缀一并去掉
+            for (++p; p < end; ++p) {
+                if (*p == '\'') {
+                    if (p + 1 < end && p[1] == '\'') {
+                        ++p;
+                    } else {
+                        ++p;
+                        break;
+                    }
+                }
+            }
+            const char prefix = n > 0 ? out[n - 1] : '\0';
+            if (!pendingSpace && (prefix == 'x' || prefix == 'b' || prefix == 'n' || prefix == 'e') &&
+                (n == 1 || !sqlIs(out[n - 2], SqlCharTable::kIdent))) {
+                // 连同前缀之前补的空格一起撤回，由 param() 重新决定空格与列表折叠
+                --n;
+                if (n > 0 && out[n - 1] == ' ') {
+                    --n;
+                    pendingSpace = true;
+                }
+            }
+            literals = true;
+            param();
+        } else if (c == '"' || c == '`') {
+            // 带引号的标识符原样保留（区分大小写）
+            const char* start = p;
+            for (++p; p < end; ++p) {
+                if (*p == c) {
+                    if (p + 1 < end && p[1] == c) {
+                        ++p;
+                    } else {
+                        ++p;
+                        break;
+                    }
+                }
+            }
+            space(c);
+            std::memcpy(out + n, start, static_cast<size_t>(p - start));
+            n += static_cast<size_t>(p - start);
+        } else if ((c == '-' || c == '+') && p + 1 < end && sqlIs(p[1], SqlCharTable::kDigit) &&
+                   sqlSignIsUnary(out, n)) {
+            // 一元正负号归入数字字面量，"= -4"、"LIMIT -1" 与 "= 4"、"LIMIT 1" 相同；"a - 4" 仍是减法
+            ++p;
+        } else if ((sqlIs(c, SqlCharTable::kDigit) || (c == '.' && p + 1 < end && sqlIs(p[1], SqlCharTable::kDigit))) &&
+                   (pendingSpace || n == 0 || !sqlIs(out[n - 1], SqlCharTable::kIdent))) {
+            // 数字字面量：整数、小数、1e-5、0x1F
+            const bool hex = c == '0' && p + 1 < end && (p[1] == 'x' || p[1] == 'X');
+            for (++p; p < end; ++p) {
+                if (sqlIs(*p, SqlCharTable::kIdent) || *p == '.') {
+                    continue;
+                }
+                if (!hex && (*p == '+' || *p == '-') && (p[-1] == 'e' || p[-1] == 'E')) {
+                    continue;
+                }
+                break;
+            }
+            literals = true;
+            param();
+        } else if ((c == ':' || c == '@') && p + 1 < end && p[1] == c) {
+            // :: 类型转换与 @@ 系统变量不是占位符
+            space(c);
+            out[n++] = c;
+            out[n++] = c;
+            p += 2;
+        } else if (c == '?' || ((c == ':' || c == '@' || c == '$') && p + 1 < end && sqlIs(p[1], SqlCharTable::kIdent))) {
+            // 各种占位符（?、?1、:name、@name、$1）统一为 ?
+            for (++p; p < end && sqlIs(*p, SqlCharTable::kIdent); ++p) {
+            }
+            param();
+        } else if (sqlIs(c, SqlCharTable::kIdent)) {
+            space(c);
+            const size_t start = n;
+            do {
+                out[n++] = sqlLower(*p++);
+            } while (p < end && sqlIs(*p, SqlCharTable::kIdent));
+            const std::string_view word(out + start, n - start);
+            if (word == "values") {
+                valuesDepth = depth;
+            } else if (depth == valuesDepth) {
+                // VALUES 行之后的 ON DUPLICATE KEY UPDATE 等不再属于 VALUES
+                valuesDepth = -1;
+            } else if (word == "select" && inList()) {
+                // IN (SELECT ...) 是子查询而不是值列表
+                listBits &= ~(uint64_t{1} << depth);
+            }
+        } else {
+            bool list = false;
+            if (c == '(') {
+                // IN 之后、VALUES 之后，以及列表中的元组 IN ((1, 2), (3, 4))；列表里的函数调用不算
+                const char prev = n > 0 ? out[n - 1] : '\0';
+                list = sqlEndsWithWord(out, n, "in") || depth == valuesDepth ||
+                       (inList() && (prev == '(' || prev == ','));
+            }
+            space(c);
+            out[n++] = c;
+            ++p;
+            if (c == '(') {
+                if (++depth < 64) {
+                    listBits = list ? listBits | (uint64_t{1} << depth) : listBits & ~(uint64_t{1} << depth);
+                }
+            } else if (c == ')' && depth > 0) {
+                --depth;
+                if (depth < valuesDepth) {
+                    valuesDepth = -1;
+                }
+            }
+            // 多行 VALUES (?), (?), ... 与 IN ((?), (?)) 折叠为一行
+            if (c == ')' && (depth == valuesDepth || inList()) && n >= 7 && std::memcmp(out + n - 3, "(?)", 3) == 0) {
+                size_t k = n - 3;
+                if (out[k - 1] == ' ') {
+                    --k;
+                }
+                if (k >= 4 && out[k - 1] == ',' && std::memcmp(out + k - 4, "(?)", 3) == 0) {
+                    n = k - 1;
+                }
+            }
+        }
+    }
+    while (n > 0 && out[n - 1] == ';') {
+        --n;
+    }
+    return n;
+}
+
+inline uint64_t loadSqlWord(const char* p, size_t len) {
+    uint64_t w = 0;
+    std::memcpy(&w, p, len);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    w = __builtin_bswap64(w);
+#endif
+    return w;
+}
+
+} // namespace detail
+
+// 规范化文本的 64 位指纹：按 8 字节一组混合，结果与平台字节序、进程无关，可跨进程与版本比较
+inline uint64_t hashNormalizedSql(std::string_view normalized) {
+    constexpr uint64_t kMul1 = 0x9e3779b97f4a7c15ULL;
+    constexpr uint64_t kMul2 = 0xc2b2ae3d27d4eb4fULL;
+    const char* p = normalized.data();
+    size_t len = normalized.size();
+    uint64_t h = 0x27d4eb2f165667c5ULL ^ (static_cast<uint64_t>(len) * kMul1);
+    auto round = [&](uint64_t w) {
+        h ^= w * kMul2;
+        h = ((h << 31) | (h >> 33)) * kMul1;
+    };
+    for (; len >= 8; p += 8, len -= 8) {
+        round(detail::loadSqlWord(p, 8));
+    }
+    if (len > 0) {
+        round(detail::loadSqlWord(p, len));
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// 16 位小写十六进制，用于 JSON / trace 等不便携带 64 位整数的场合
+inline std::string formatSqlFingerprint(uint64_t fingerprint) {
+    static constexpr char kHex[] = "0123456789abcdef";
+    std::string out(16, '0');
+    for (int i = 15; i >= 0; --i, fingerprint >>= 4) {
+        out[static_cast<size_t>(i)] = kHex[fingerprint & 0xf];
+    }
+    return out;
+}
+
+// 把字面量与占位符替换为 ?、小写化关键字与标识符、去掉注释、合并空白，并把 IN (?, ?, ...) 与多行
+// VALUES 折叠为一项，使只有参数不同的语句归为同一条。内部缓冲区在多次调用间复用，稳态下不分配内存；
+// 非线程安全，每个线程各用一个
+class SqlNormalizer {
+public:
+    // 返回的视图在下一次调用前有效
+    std::string_view normalize(std::string_view sql) {
+        if (buf_.size() < sql.size()) {
+            buf_.resize(sql.size());
+        }
+        const size_t n = detail::normalizeSqlInto(sql, buf_.data(), literals_);
+        return {buf_.data(), n};
+    }
+
+    uint64_t fingerprint(std::string_view sql) { return hashNormalizedSql(normalize(sql)); }
+
+    // 上一次 normalize() 是否替换了内联字面量；这类原始 SQL 不值得按原文缓存
+    bool sawLiterals() const { return literals_; }
+
+private:
+    std::string buf_;
+    bool literals_ = false;
+};
+
+namespace detail {
+inline SqlNormalizer& threadSqlNormalizer() {
+    thread_local SqlNormalizer normalizer;
+    return normalizer;
+}
+} // namespace detail
+
+inline std::string normalizeSql(std::string_view sql) {
+    std::string out(sql.size(), '\0');
+    bool literals = false;
+    out.resize(detail::normalizeSqlInto(sql, out.data(), literals));
+    return out;
+}
+
+// 等价于 hashNormalizedSql(normalizeSql(sql))，但使用线程本地缓冲区，不分配内存
+inline uint64_t sqlFingerprint(std::string_view sql) { return detail::threadSqlNormalizer().fingerprint(sql); }
+
+} // namespace sdb
@@ -0,0 +1,367 @@
+#pragma once
+#include "types.hpp"
+#include "sql_normalize.hpp"
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sdb {
+
+// 父 span 的标识，跨线程传递时按值拷贝
+struct TraceContext {
+    uint64_t traceId = 0;
+    uint64_t spanId = 0;
+
+    bool valid() const { return spanId != 0; }
+};
+
+struct TraceEvent {
+    std::string name;
+    std::string category;
+    uint64_t traceId = 0;
+    uint64_t spanId = 0;
+    uint64_t parentSpanId = 0;
+    uint32_t threadId = 0;
+    // 相对 Tracer::start() 的纳秒数
+    int64_t startNanos = 0;
+    int64_t durationNanos = 0;
+    bool error = false;
+    nlohmann::json args;
+};
+
+// 进程内 span 收集器。未启用时 TraceSpan 的开销只有一次 relaxed 原子读；
+// 启用后结束的 span 追加到有上限的缓冲区，stop() 写出 Chrome trace-event JSON（chrome://tracing、Perfetto）
+// 或 OTLP/JSON（可直接 POST 给 collector 的 /v1/traces，或由 Jaeger 等导入）
+class Tracer {
+public:
+    enum class Format { ChromeTrace, OtlpJson };
+
+    struct Options {
+        // 非空时 stop() 把缓冲区写到该文件
+        std::string path;
+        Format format = Format::ChromeTrace;
+        // 超出后丢弃新 span 并计入 droppedEvents()
+        size_t maxEvents = 1 << 20;
+        std::string serviceName = "smartdb";
+    };
+
+    static Tracer& global() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    Tracer() = default;
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    ~Tracer() {
+        if (enabled()) {
+            (void)stop();
+        }
+    }
+
+    void start() { start(Options{}); }
+
+    // 清空缓冲区并开始收集
+    void start(Options options) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        options_ = std::move(options);
+        events_.clear();
+        dropped_ = 0;
+        epoch_ = std::chrono::steady_clock::now();
+        epochUnixNanos_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::system_clock::now().time_since_epoch())
+                              .count();
+        enabled_.store(true, std::memory_order_release);
+    }
+
+    // 停止收集；配置了 path 时写出文件。缓冲区保留到下一次 start()
+    DbResult<void> stop() {
+        enabled_.store(false, std::memory_order_release);
+        std::string path;
+        Format format;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            path = options_.path;
+            format = options_.format;
+        }
+        if (path.empty()) {
+            return DbResult<void>::success();
+        }
+        return writeTo(path, format);
+    }
+
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    void record(TraceEvent event, std::chrono::steady_clock::time_point start,
+                std::chrono::steady_clock::time_point end) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!enabled()) {
+            return;
+        }
+        if (events_.size() >= options_.maxEvents) {
+            ++dropped_;
+            return;
+        }
+        event.startNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(start - epoch_).count();
+        event.durationNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        events_.push_back(std::move(event));
+    }
+
+    std::vector<TraceEvent> events() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return events_;
+    }
+
+    uint64_t droppedEvents() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return dropped_;
+    }
+
+    // Chrome trace-event 格式："X"（完整事件）按线程嵌套显示，span / trace id 放在 args 中
+    nlohmann::json toChromeTrace() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        nlohmann::json events = nlohmann::json::array();
+        for (const auto& e : events_) {
+            nlohmann::json args = e.args.is_object() ? e.args : nlohmann::json::object();
+            args["trace_id"] = hex(e.traceId, 16);
+            args["span_id"] = hex(e.spanId, 16);
+            if (e.parentSpanId != 0) {
+                args["parent_span_id"] = hex(e.parentSpanId, 16);
+            }
+            if (e.error) {
+                args["error"] = true;
+            }
+            events.push_back({
+                {"name", e.name},
+                {"cat", e.category},
+                {"ph", "X"},
+                {"ts", static_cast<double>(e.startNanos) / 1000.0},
+                {"dur", static_cast<double>(e.durationNanos) / 1000.0},
+                {"pid", 1},
+                {"tid", e.threadId},
+                {"args", std::move(args)},
+            });
+        }
+        return {
+            {"traceEvents", std::move(events)},
+            {"displayTimeUnit", "ns"},
+            {"otherData", {{"service", options_.serviceName}, {"dropped_events", dropped_}}},
+        };
+    }
+
+    // OTLP/JSON（ExportTraceServiceRequest）：64 位 trace id 左侧补零到 128 位
+    nlohmann::json toOtlpJson() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        nlohmann::json spans = nlohmann::json::array();
+        for (const auto& e : events_) {
+            nlohmann::json attributes = nlohmann::json::array();
+            attributes.push_back(otlpAttribute("sdb.category", e.category));
+            attributes.push_back(otlpAttribute("thread.id", e.threadId));
+            if (e.args.is_object()) {
+                for (const auto& [key, value] : e.args.items()) {
+                    attributes.push_back(otlpAttribute(key, value));
+                }
+            }
+            const int64_t start = epochUnixNanos_ + e.startNanos;
+            nlohmann::json span = {
+                {"traceId", hex(e.traceId, 32)},
+                {"spanId", hex(e.spanId, 16)},
+                {"name", e.name},
+                {"kind", e.category == "driver" ? 3 : 1},
+                {"startTimeUnixNano", std::to_string(start)},
+                {"endTimeUnixNano", std::to_string(start + e.durationNanos)},
+                {"attributes", std::move(attributes)},
+                {"status", {{"code", e.error ? 2 : 0}}},
+            };
+            if (e.parentSpanId != 0) {
+                span["parentSpanId"] = hex(e.parentSpanId, 16);
+            }
+            spans.push_back(std::move(span));
+        }
+        return {{"resourceSpans",
+                 {{{"resource", {{"attributes", {otlpAttribute("service.name", options_.serviceName)}}}},
+                   {"scopeSpans", {{{"scope", {{"name", "smartdb"}}}, {"spans", std::move(spans)}}}}}}}};
+    }
+
+    DbResult<void> writeTo(const std::string& path, Format format) const {
+        const auto doc = format == Format::ChromeTrace ? toChromeTrace() : toOtlpJson();
+        std::ofstream out(path, std::ios::trunc);
+        if (!out) {
+            return DbResult<void>::failure("Cannot open trace file: " + path);
+        }
+        out << doc.dump() << '\n';
+        if (!out) {
+            return DbResult<void>::failure("Failed to write trace file: " + path);
+        }
+        return DbResult<void>::success();
+    }
+
+    // span / trace id：随机起点的计数器经 splitmix64 打散，非零且进程内不重复
+    static uint64_t nextId() {
+        static std::atomic<uint64_t> counter{std::random_device{}()};
+        uint64_t z = counter.fetch_add(0x9e3779b97f4a7c15ULL, std::memory_order_relaxed) + 0x9e3779b97f4a7c15ULL;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        z ^= z >> 31;
+        return z == 0 ? 1 : z;
+    }
+
+    // 从 1 起编号的线程号，比 std::thread::id 的哈希更便于在查看器中阅读
+    static uint32_t threadId() {
+        static std::atomic<uint32_t> next{1};
+        thread_local const uint32_t id = next.fetch_add(1, std::memory_order_relaxed);
+        return id;
+    }
+
+private:
+    static std::string hex(uint64_t v, int width) {
+        char buf[33];
+        std::snprintf(buf, sizeof(buf), "%0*llx", width, static_cast<unsigned long long>(v));
+        return buf;
+    }
+
+    static nlohmann::json otlpAttribute(const std::string& key, const nlohmann::json& value) {
+        nlohmann::json v;
+        if (value.is_boolean()) {
+            v["boolValue"] = value.get<bool>();
+        } else if (value.is_number_integer()) {
+            // OTLP/JSON 的 int64 以字符串编码
+            v["intValue"] = value.is_number_unsigned() ? std::to_string(value.get<uint64_t>())
+                                                       : std::to_string(value.get<int64_t>());
+        } else if (value.is_number()) {
+            v["doubleValue"] = value.get<double>();
+        } else if (value.is_string()) {
+            v["stringValue"] = value.get<std::string>();
+        } else {
+            v["stringValue"] = value.dump();
+        }
+        return {{"key", key}, {"value", std::move(v)}};
+    }
+
+    std::atomic<bool> enabled_{false};
+    mutable std::mutex mtx_;
+    Options options_;
+    std::vector<TraceEvent> events_;
+    uint64_t dropped_ = 0;
+    std::chrono::steady_clock::time_point epoch_ = std::chrono::steady_clock::now();
+    int64_t epochUnixNanos_ = 0;
+};
+
+namespace detail {
+inline TraceContext& currentTraceContext() {
+    thread_local TraceContext context;
+    return context;
+}
+} // namespace detail
+
+// RAII span。默认以本线程当前 span 为父并在作用域内成为当前 span，池、驱动与调用方的 span 因此自动嵌套
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name, const char* category = "sdb")
+        : TraceSpan(name, category, detail::currentTraceContext(), true) {}
+
+    // 显式指定父上下文；makeCurrent 为 false 时不改变本线程的当前 span，用于生命周期不按作用域嵌套的 span
+    TraceSpan(const char* name, const char* category, TraceContext parent, bool makeCurrent) {
+        if (!Tracer::global().enabled()) {
+            return;
+        }
+        active_ = true;
+        event_.name = name;
+        event_.category = category;
+        event_.traceId = parent.valid() ? parent.traceId : Tracer::nextId();
+        event_.parentSpanId = parent.spanId;
+        event_.spanId = Tracer::nextId();
+        event_.threadId = Tracer::threadId();
+        if (makeCurrent) {
+            current_ = true;
+            previous_ = detail::currentTraceContext();
+            detail::currentTraceContext() = context();
+        }
+        start_ = std::chrono::steady_clock::now();
+    }
+
+    ~TraceSpan() { end(); }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    bool active() const { return active_; }
+
+    TraceContext context() const { return {event_.traceId, event_.spanId}; }
+
+    template <typename T>
+    void setArg(const char* key, T&& value) {
+        if (active_) {
+            event_.args[key] = std::forward<T>(value);
+        }
+    }
+
+    // 规范化后的语句及其指纹，字面量不会进入 trace 文件
+    void setStatement(const std::string& sql) {
+        if (active_) {
+            const auto statement = detail::threadSqlNormalizer().normalize(sql);
+            event_.args["fingerprint"] = formatSqlFingerprint(hashNormalizedSql(statement));
+            event_.args["statement"] = std::string(statement);
+        }
+    }
+
+    // 驱动错误信息常引用字面量（如 MySQL 的 Duplicate entry 'alice@x'），与语句一样规范化后再记录；
+    // code 为驱动错误码，0 表示没有
+    void setError(const std::string& message, int code = 0) {
+        if (active_) {
+            event_.error = true;
+            event_.args["error_message"] = std::string(detail::threadSqlNormalizer().normalize(message));
+            if (code != 0) {
+                event_.args["error_code"] = code;
+            }
+        }
+    }
+
+    void end() {
+        if (!active_) {
+            return;
+        }
+        active_ = false;
+        const auto end = std::chrono::steady_clock::now();
+        if (current_) {
+            detail::currentTraceContext() = previous_;
+        }
+        Tracer::global().record(std::move(event_), start_, end);
+    }
+
+    static TraceContext current() { return detail::currentTraceContext(); }
+
+private:
+    bool active_ = false;
+    bool current_ = false;
+    TraceEvent event_;
+    TraceContext previous_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// 在工作线程上沿用提交方的上下文（TraceSpan::current()），作用域结束时恢复
+class ScopedTraceContext {
+public:
+    explicit ScopedTraceContext(TraceContext context) : previous_(detail::currentTraceContext()) {
+        detail::currentTraceContext() = context;
+    }
+
+    ~ScopedTraceContext() { detail::currentTraceContext() = previous_; }
+
+    ScopedTraceContext(const ScopedTraceContext&) = delete;
+    ScopedTraceContext& operator=(const ScopedTraceContext&) = delete;
+
+private:
+    TraceContext previous_;
+};
+
+} // namespace sdb
@@ -3,9 +3,24 @@
 #include "sdb/types.hpp"
 #include "sdb/db.hpp"
 #include "sdb/connection_pool.hpp"
+#include "sdb/retry.hpp"
+#include "sdb/read_write_pool.hpp"
+#include "sdb/query_stats.hpp"
+#include "sdb/sql_normalize.hpp"
+#include "sdb/instrumented_connection.hpp"
+#include "sdb/tracing.hpp"
+#include "sdb/prometheus.hpp"
+#include "sdb/metrics_exporter.hpp"
 #include "sdb/drivers/sqlite_driver.hpp"
+#include "sdb/drivers/sqlite_snapshot.hpp"
+#include "sdb/drivers/sqlite_vtab.hpp"
+#include "sdb/drivers/sqlite_maintenance.hpp"
 #include "sdb/drivers/mysql_driver.hpp"
+#ifndef _WIN32
+#include "mysql_wire_server.hpp"
+#endif
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <cstdlib>
@@ -13,6 +28,9 @@
 #include <fstream>
 #include <future>
 #include <mutex>
+#include <optional>
+#include <regex>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <vector>
@@ -120,6 +138,140 @@ TEST(TransactionGuardTest, BeginFailureReturnsError) {
     EXPECT_EQ(conn.beginCount, 1);
 }
 
+TEST(RetryPolicyTest, ReplaysTransientFailuresWithinTransaction) {
+    FakeTxConnection conn;
+    sdb::RetryPolicy policy;
+    policy.maxAttempts = 4;
+    policy.initialBackoff = std::chrono::milliseconds(1);
+    policy.metrics = std::make_shared<sdb::RetryMetrics>();
+
+    int calls = 0;
+    auto res = sdb::retryTransaction(conn, policy, [&](sdb::IConnection&) {
+        ++calls;
+        if (calls < 3) {
+            return sdb::DbResult<int64_t>::failure("database is locked", 5);
+        }
+        return sdb::DbResult<int64_t>::success(42);
+    });
+    ASSERT_TRUE(res) << res.error().message;
+    EXPECT_EQ(res.value(), 42);
+    EXPECT_EQ(calls, 3);
+    EXPECT_EQ(conn.beginCount, 3);
+    EXPECT_EQ(conn.rollbackCount, 2);
+    EXPECT_EQ(conn.commitCount, 1);
+
+    const auto metrics = policy.metrics->snapshot();
+    EXPECT_EQ(metrics.calls, 1);
+    EXPECT_EQ(metrics.attempts, 3);
+    EXPECT_EQ(metrics.retries, 2);
+    EXPECT_EQ(metrics.successes, 1);
+    EXPECT_EQ(metrics.failures, 0);
+}
+
+TEST(RetryPolicyTest, StopsOnPermanentErrorsExhaustionAndBudget) {
+    FakeTxConnection conn;
+    sdb::RetryPolicy policy;
+    policy.maxAttempts = 3;
+    policy.initialBackoff = std::chrono::milliseconds(0);
+    policy.metrics = std::make_shared<sdb::RetryMetrics>();
+
+    int calls = 0;
+    auto permanent = sdb::retryTransaction(conn, policy, [&](sdb::IConnection&) {
+        ++calls;
+        return sdb::DbResult<void>::failure("syntax error", 1);
+    });
+    EXPECT_FALSE(permanent);
+    EXPECT_EQ(calls, 1);
+
+    calls = 0;
+    auto deadlock = sdb::retryTransaction(conn, policy, [&](sdb::IConnection&) {
+        ++calls;
+        return sdb::DbResult<void>::failure("Deadlock found when trying to get lock", 1213);
+    });
+    EXPECT_FALSE(deadlock);
+    EXPECT_EQ(deadlock.error().code, 1213);
+    EXPECT_EQ(calls, 3);
+    EXPECT_EQ(policy.metrics->snapshot().exhausted, 1);
+
+    policy.budget = std::make_shared<sdb::RetryBudget>(1.0, 0.0);
+    calls = 0;
+    auto budgeted = sdb::withRetry(policy, [&]() {
+        ++calls;
+        return sdb::DbResult<void>::failure("Lock wait timeout exceeded", 1205);
+    });
+    EXPECT_FALSE(budgeted);
+    EXPECT_EQ(calls, 2);
+    EXPECT_EQ(policy.metrics->snapshot().budgetRejections, 1);
+}
+
+TEST(RetryPolicyTest, BackoffGrowsAndRespectsCapAndJitter) {
+    sdb::RetryPolicy policy;
+    policy.initialBackoff = std::chrono::milliseconds(10);
+    policy.maxBackoff = std::chrono::milliseconds(35);
+    policy.jitter = 0.0;
+    EXPECT_EQ(policy.backoffFor(1), std::chrono::microseconds(10000));
+    EXPECT_EQ(policy.backoffFor(2), std::chrono::microseconds(20000));
+    EXPECT_EQ(policy.backoffFor(3), std::chrono::microseconds(35000));
+
+    policy.jitter = 0.5;
+    for (int i = 0; i < 50; ++i) {
+        const auto delay = policy.backoffFor(2);
+        EXPECT_GE(delay, std::chrono::microseconds(10000));
+        EXPECT_LE(delay, std::chrono::microseconds(20000));
+    }
+}
+
+TEST(SqliteDriverTest, BusyTimeoutWaitsForWriterAndRetryRecoversBusy) {
+    const auto stamp = std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    const auto path = (std::filesystem::temp_directory_path() / ("smartdb_busy_" + stamp + ".db")).string();
+
+    sdb::drivers::SqliteDriver driver;
+    auto writer = driver.createConnection({{"path", path}});
+    auto waiter = driver.createConnection({{"path", path}, {"sqlite", {{"busy_timeout", 2000}}}});
+    auto impatient = driver.createConnection({{"path", path}});
+    ASSERT_TRUE(writer->open());
+    ASSERT_TRUE(waiter->open());
+    ASSERT_TRUE(impatient->open());
+    ASSERT_TRUE(writer->execute("CREATE TABLE kv (k INTEGER PRIMARY KEY, v INTEGER)"));
+
+    ASSERT_TRUE(writer->execute("BEGIN IMMEDIATE"));
+    ASSERT_TRUE(writer->execute("INSERT INTO kv VALUES (1, 1)"));
+
+    auto busyRes = impatient->execute("INSERT INTO kv VALUES (2, 2)");
+    EXPECT_FALSE(busyRes);
+    EXPECT_TRUE(sdb::isTransientError(busyRes.error()));
+
+    auto release = std::async(std::launch::async, [&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return writer->commit();
+    });
+    auto waitedRes = waiter->execute("INSERT INTO kv VALUES (3, 3)");
+    EXPECT_TRUE(waitedRes) << waitedRes.error().message;
+    ASSERT_TRUE(release.get());
+
+    ASSERT_TRUE(writer->execute("BEGIN IMMEDIATE"));
+    auto unlock = std::async(std::launch::async, [&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        return writer->rollback();
+    });
+    sdb::RetryPolicy policy;
+    policy.maxAttempts = 50;
+    policy.initialBackoff = std::chrono::milliseconds(2);
+    policy.maxBackoff = std::chrono::milliseconds(10);
+    policy.metrics = std::make_shared<sdb::RetryMetrics>();
+    auto retried = sdb::retryTransaction(*impatient, policy, [](sdb::IConnection& c) {
+        return c.execute("INSERT INTO kv VALUES (4, 4)");
+    });
+    ASSERT_TRUE(unlock.get());
+    EXPECT_TRUE(retried) << retried.error().message;
+    EXPECT_GE(policy.metrics->snapshot().retries, 1);
+
+    writer->close();
+    waiter->close();
+    impatient->close();
+    std::filesystem::remove(path);
+}
+
 TEST(SqliteDriverTest, InMemoryInsertQueryAndBlob) {
     sdb::drivers::SqliteDriver driver;
     auto conn = driver.createConnection({{"path", ":memory:"}});
@@ -149,6 +301,640 @@ TEST(SqliteDriverTest, InMemoryInsertQueryAndBlob) {
     EXPECT_EQ(payload, blob);
 }
 
+TEST(SqliteDriverTest, ProfileAppliesAndVerifiesPragmasOnOpen) {
+    const auto stamp = std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    const auto path = (std::filesystem::temp_directory_path() / ("smartdb_profile_" + stamp + ".db")).string();
+
+    sdb::drivers::SqliteDriver driver;
+    auto conn = driver.createConnection({
+        {"path", path},
+        {"sqlite", {{"profile", "fast-durable"}, {"cache_size", -4096}, {"page_size", 8192}}}
+    });
+    auto openRes = conn->open();
+    ASSERT_TRUE(openRes) << openRes.error().message;
+
+    auto* sqlite = dynamic_cast<sdb::drivers::SqliteConnection*>(conn.get());
+    ASSERT_NE(sqlite, nullptr);
+    const auto& pragmas = sqlite->effectivePragmas();
+    EXPECT_EQ(pragmas.at("journal_mode"), "wal");
+    EXPECT_EQ(pragmas.at("synchronous"), "normal");
+    EXPECT_EQ(pragmas.at("cache_size"), "-4096");
+    EXPECT_EQ(pragmas.at("page_size"), "8192");
+    EXPECT_EQ(pragmas.at("temp_store"), "memory");
+    EXPECT_EQ(pragmas.at("busy_timeout"), "5000");
+    EXPECT_EQ(sqlite->options().profile, "fast-durable");
+
+    conn->close();
+    for (const char* suffix : {"", "-wal", "-shm"}) {
+        std::filesystem::remove(path + suffix);
+    }
+}
+
+TEST(SqliteDriverTest, InvalidOrUnverifiablePragmasFailOpen) {
+    sdb::drivers::SqliteDriver driver;
+
+    auto unknown = driver.createConnection({{"path", ":memory:"}, {"sqlite", {{"profile", "warp-speed"}}}});
+    auto unknownRes = unknown->open();
+    EXPECT_FALSE(unknownRes);
+    EXPECT_NE(unknownRes.error().message.find("Unknown SQLite profile"), std::string::npos);
+
+    auto injected = driver.createConnection({{"path", ":memory:"}, {"sqlite", {{"journal_mode", "WAL; DROP TABLE x"}}}});
+    EXPECT_FALSE(injected->open());
+
+    // 内存库无法切换到 WAL：默认只告警，strict 模式下拒绝打开
+    auto lenient = driver.createConnection({{"path", ":memory:"}, {"sqlite", {{"journal_mode", "wal"}}}});
+    EXPECT_TRUE(lenient->open());
+    auto strict = driver.createConnection({{"path", ":memory:"}, {"sqlite", {{"journal_mode", "wal"}, {"strict_pragmas", true}}}});
+    auto strictRes = strict->open();
+    EXPECT_FALSE(strictRes);
+    EXPECT_NE(strictRes.error().message.find("journal_mode"), std::string::npos);
+    EXPECT_FALSE(strict->isOpen());
+}
+
+TEST(SqliteDriverTest, OpenFlagsFromConfig) {
+    const auto stamp = std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    const auto path = (std::filesystem::temp_directory_path() / ("smartdb_flags_" + stamp + ".db")).string();
+
+    sdb::drivers::SqliteDriver driver;
+    auto missing = driver.createConnection({{"path", path}, {"sqlite", {{"readonly", true}}}});
+    EXPECT_FALSE(missing->open());
+
+    auto writer = driver.createConnection({{"path", path}, {"sqlite", {{"nomutex", true}}}});
+    ASSERT_TRUE(writer->open());
+    auto* sqliteWriter = dynamic_cast<sdb::drivers::SqliteConnection*>(writer.get());
+    ASSERT_NE(sqliteWriter, nullptr);
+    EXPECT_NE(sqliteWriter->options().openFlags() & SQLITE_OPEN_NOMUTEX, 0);
+    ASSERT_TRUE(writer->execute("CREATE TABLE t (id INTEGER)"));
+    ASSERT_TRUE(writer->execute("INSERT INTO t VALUES (1)"));
+
+    auto reader = driver.createConnection({{"path", path}, {"sqlite", {{"readonly", true}}}});
+    ASSERT_TRUE(reader->open());
+    auto rsRes = reader->query("SELECT COUNT(*) FROM t");
+    ASSERT_TRUE(rsRes) << rsRes.error().message;
+    ASSERT_TRUE(rsRes.value()->next());
+    EXPECT_EQ(std::get<int64_t>(rsRes.value()->get(0)), 1);
+    auto writeRes = reader->execute("INSERT INTO t VALUES (2)");
+    EXPECT_FALSE(writeRes);
+    EXPECT_EQ(writeRes.error().code, SQLITE_READONLY);
+
+    auto uriConn = driver.createConnection({{"path", "file:" + path + "?mode=ro"}, {"sqlite", {{"uri", true}}}});
+    ASSERT_TRUE(uriConn->open());
+    EXPECT_FALSE(uriConn->execute("INSERT INTO t VALUES (3)"));
+
+    auto badFlag = driver.createConnection({{"path", path}, {"sqlite", {{"nomutex", "yes"}}}});
+    EXPECT_FALSE(badFlag->open());
+
+    rsRes.value().reset();
+    writer->close();
+    reader->close();
+    uriConn->close();
+    std::filesystem::remove(path);
+}
+
+TEST(SqliteDriverTest, RuntimeConfigRequiresNoOpenConnections) {
+    sdb::drivers::SqliteDriver driver;
+    sdb::drivers::SqliteRuntimeOptions runtime;
+    runtime.threading = sdb::drivers::SqliteRuntimeOptions::Threading::MultiThread;
+    runtime.memStatus = false;
+    {
+        auto conn = driver.createConnection({{"path", ":memory:"}});
+        ASSERT_TRUE(conn->open());
+        EXPECT_FALSE(sdb::drivers::configureSqliteRuntime(runtime));
+    }
+    {
+        // 连接关闭后，具名共享内存库的锚点仍由连接对象持有
+        auto conn = driver.createConnection({{"path", ":memory:"}, {"sqlite", {{"shared_memory", "smartdb_runtime_anchor"}}}});
+        ASSERT_TRUE(conn->open());
+        conn->close();
+        EXPECT_FALSE(sdb::drivers::configureSqliteRuntime(runtime));
+    }
+
+    auto res = sdb::drivers::configureSqliteRuntime(runtime);
+    ASSERT_TRUE(res) << res.error().message;
+    auto conn = driver.createConnection({{"path", ":memory:"}});
+    ASSERT_TRUE(conn->open());
+    ASSERT_TRUE(conn->execute("CREATE TABLE t (id INTEGER)"));
+    conn->close();
+
+    runtime.threading = sdb::drivers::SqliteRuntimeOptions::Threading::Serialized;
+    runtime.memStatus = true;
+    ASSERT_TRUE(sdb::drivers::configureSqliteRuntime(runtime));
+}
+
+TEST(SqliteDriverTest, IncrementalBackupCopiesLiveDatabase) {
+    const auto stamp = std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    const auto srcPath = (std::filesystem::temp_directory_path() / ("smartdb_backup_src_" + stamp + ".db")).string();
+    const auto dstPath = (std::filesystem::temp_directory_path() / ("smartdb_backup_dst_" + stamp + ".db")).string();
+
+    sdb::drivers::SqliteConnection source(srcPath);
+    ASSERT_TRUE(source.open());
+    ASSERT_TRUE(source.execute("CREATE TABLE blobs (id INTEGER PRIMARY KEY, payload BLOB)"));
+    ASSERT_TRUE(source.execute("BEGIN"));
+    for (int i = 0; i < 64; ++i) {
+        ASSERT_TRUE(source.execute("INSERT INTO blobs (payload) VALUES (?)", {std::vector<uint8_t>(2048, static_cast<uint8_t>(i))}));
+    }
+    ASSERT_TRUE(source.execute("COMMIT"));
+
+    int steps = 0;
+    int lastRemaining = -1;
+    sdb::drivers::SqliteBackupOptions options;
+    options.pagesPerStep = 8;
+    options.progress = [&](int remaining, int total) {
+        ++steps;
+        lastRemaining = remaining;
+        return total > 0;
+    };
+    auto backupRes = source.backupTo(dstPath, options);
+    ASSERT_TRUE(backupRes) << backupRes.error().message;
+    EXPECT_GT(steps, 2);
+    EXPECT_EQ(lastRemaining, 0);
+
+    sdb::drivers::SqliteConnection copy(dstPath);
+    ASSERT_TRUE(copy.open());
+    auto rsRes = copy.query("SELECT COUNT(*) FROM blobs");
+    ASSERT_TRUE(rsRes && rsRes.value()->next());
+    EXPECT_EQ(std::get<int64_t>(rsRes.value()->get(0)), 64);
+
+    // 目标库上仍有未结束的读语句时，超过 busyTimeout 后返回 SQLITE_BUSY 而不是无限等待
+    options.busyTimeout = std::chrono::milliseconds(30);
+    auto busyRes = source.backupTo(dstPath, options);
+    EXPECT_FALSE(busyRes);
+    EXPECT_EQ(busyRes.error().code, SQLITE_BUSY);
+
+    rsRes.value().reset();
+    options.progress = [](int, int) { return false; };
+    auto abortRes = source.backupTo(dstPath, options);
+    EXPECT_FALSE(abortRes);
+    EXPECT_EQ(abortRes.error().code, SQLITE_ABORT);
+
+    copy.close();
+    source.close();
+    std::filesystem::remove(srcPath);
+    std::filesystem::remove(dstPath);
+}
+
+TEST(SqliteDriverTest, SerializeAndCloneInMemoryFixtures) {
+    sdb::drivers::SqliteConnection fixture(":memory:");
+    ASSERT_TRUE(fixture.open());
+    ASSERT_TRUE(fixture.execute("CREATE TABLE ref (code TEXT PRIMARY KEY, label TEXT)"));
+    ASSERT_TRUE(fixture.execute("INSERT INTO ref VALUES ('a', 'alpha'), ('b', 'beta')"));
+
+    auto imageRes = fixture.serialize();
+    ASSERT_TRUE(imageRes) << imageRes.error().message;
+    EXPECT_FALSE(imageRes.value().empty());
+
+    sdb::drivers::SqliteConnection scratchA(":memory:");
+    sdb::drivers::SqliteConnection scratchB(":memory:");
+    ASSERT_TRUE(scratchA.open());
+    ASSERT_TRUE(scratchB.open());
+    auto cloneRes = fixture.cloneInto(scratchA);
+    ASSERT_TRUE(cloneRes) << cloneRes.error().message;
+    auto loadRes = scratchB.deserialize(imageRes.value());
+    ASSERT_TRUE(loadRes) << loadRes.error().message;
+
+    ASSERT_TRUE(scratchA.execute("DELETE FROM ref WHERE code = 'a'"));
+    ASSERT_TRUE(scratchB.execute("INSERT INTO ref VALUES ('c', 'gamma')"));
+
+    auto count = [](sdb::IConnection& conn) -> int64_t {
+        auto rsRes = conn.query("SELECT COUNT(*) FROM ref");
+        if (!rsRes || !rsRes.value()->next()) {
+            return -1;
+        }
+        return std::get<int64_t>(rsRes.value()->get(0));
+    };
+    EXPECT_EQ(count(fixture), 2);
+    EXPECT_EQ(count(scratchA), 1);
+    EXPECT_EQ(count(scratchB), 3);
+
+    sdb::drivers::SqliteConnection frozen(":memory:");
+    ASSERT_TRUE(frozen.open());
+    ASSERT_TRUE(frozen.deserialize(imageRes.value(), true));
+    EXPECT_FALSE(frozen.execute("DELETE FROM ref"));
+    EXPECT_EQ(count(frozen), 2);
+}
+
+TEST(SqliteDriverTest, ScalarAndAggregateFunctionsMarshalTypes) {
+    sdb::drivers::SqliteConnection conn(":memory:");
+    ASSERT_TRUE(conn.open());
+    ASSERT_TRUE(conn.execute("CREATE TABLE items (name TEXT, price REAL, qty INTEGER, tag BLOB)"));
+    ASSERT_TRUE(conn.execute("INSERT INTO items VALUES ('Apple', 1.5, 4, x'0102'), ('pear', 2.0, 1, NULL), ('Fig', 3.25, 2, x'03')"));
+
+    ASSERT_TRUE(conn.createScalarFunction("lower_ascii", [](std::string_view s) {
+        std::string out(s);
+        std::transform(out.begin(), out.end(), out.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return out;
+    }));
+    ASSERT_TRUE(conn.createScalarFunction("tag_len", [](std::optional<std::vector<uint8_t>> tag) -> std::optional<int64_t> {
+        if (!tag) {
+            return std::nullopt;
+        }
+        return static_cast<int64_t>(tag->size());
+    }));
+    ASSERT_TRUE(conn.createScalarFunction("checked_div", [](int64_t a, int64_t b) -> sdb::DbResult<double> {
+        if (b == 0) {
+            return sdb::DbResult<double>::failure("division by zero");
+        }
+        return sdb::DbResult<double>::success(static_cast<double>(a) / static_cast<double>(b));
+    }));
+    ASSERT_TRUE(conn.createScalarFunction("arg_count", [](const std::vector<sdb::DbValue>& args) {
+        return static_cast<int>(args.size());
+    }));
+    int calls = 0;
+    ASSERT_TRUE(conn.createScalarFunction("counter", [&calls]() { return ++calls; }, false));
+
+    struct Weighted {
+        double sum = 0;
+        int64_t weight = 0;
+    };
+    ASSERT_TRUE(conn.createAggregateFunction<Weighted>(
+        "weighted_avg",
+        [](Weighted& st, double value, int64_t weight) {
+            st.sum += value * static_cast<double>(weight);
+            st.weight += weight;
+        },
+        [](const Weighted& st) -> std::optional<double> {
+            if (st.weight == 0) {
+                return std::nullopt;
+            }
+            return st.sum / static_cast<double>(st.weight);
+        }));
+
+    auto rsRes = conn.query("SELECT lower_ascii(name), tag_len(tag), arg_count(1, 'a', NULL) FROM items ORDER BY rowid");
+    ASSERT_TRUE(rsRes) << rsRes.error().message;
+    auto& rs = rsRes.value();
+    ASSERT_TRUE(rs->next());
+    EXPECT_EQ(std::get<std::string>(rs->get(0)), "apple");
+    EXPECT_EQ(std::get<int64_t>(rs->get(1)), 2);
+    EXPECT_EQ(std::get<int64_t>(rs->get(2)), 3);
+    ASSERT_TRUE(rs->next());
+    EXPECT_EQ(std::get<std::string>(rs->get(0)), "pear");
+    EXPECT_TRUE(sdb::isNull(rs->get(1)));
+    rsRes.value().reset();
+
+    auto avgRes = conn.query("SELECT weighted_avg(price, qty), checked_div(7, 2) FROM items");
+    ASSERT_TRUE(avgRes && avgRes.value()->next());
+    EXPECT_DOUBLE_EQ(std::get<double>(avgRes.value()->get(0)), (1.5 * 4 + 2.0 * 1 + 3.25 * 2) / 7.0);
+    EXPECT_DOUBLE_EQ(std::get<double>(avgRes.value()->get(1)), 3.5);
+    avgRes.value().reset();
+
+    auto emptyRes = conn.query("SELECT weighted_avg(price, qty) FROM items WHERE qty > 100");
+    ASSERT_TRUE(emptyRes && emptyRes.value()->next());
+    EXPECT_TRUE(sdb::isNull(emptyRes.value()->get(0)));
+    emptyRes.value().reset();
+
+    auto errRes = conn.execute("SELECT checked_div(1, 0)");
+    ASSERT_FALSE(errRes);
+    EXPECT_NE(errRes.error().message.find("division by zero"), std::string::npos);
+
+    // 只有确定性函数可以出现在表达式索引中
+    EXPECT_TRUE(conn.execute("CREATE INDEX items_lower ON items (lower_ascii(name))"));
+    EXPECT_FALSE(conn.execute("CREATE INDEX items_counter ON items (counter())"));
+    auto lookup = conn.query("SELECT qty FROM items WHERE lower_ascii(name) = 'fig'");
+    ASSERT_TRUE(lookup && lookup.value()->next());
+    EXPECT_EQ(std::get<int64_t>(lookup.value()->get(0)), 2);
+    lookup.value().reset();
+
+    // 重新打开后本连接登记的函数自动恢复
+    conn.close();
+    ASSERT_TRUE(conn.open());
+    auto again = conn.query("SELECT lower_ascii('ABC')");
+    ASSERT_TRUE(again && again.value()->next());
+    EXPECT_EQ(std::get<std::string>(again.value()->get(0)), "abc");
+}
+
+TEST(SqliteDriverTest, VirtualTablesExposeColumnarDataAndGenerators) {
+    auto codes = std::make_shared<const std::vector<std::string>>(std::vector<std::string>{"delta", "alpha", "charlie", "bravo", "alpha"});
+    auto table = std::make_shared<sdb::drivers::SqliteColumnarTable>();
+    ASSERT_TRUE(table->addColumn("code", codes));
+    ASSERT_TRUE(table->addColumn<int64_t>("rank", {40, 10, 30, 20, 11}));
+    ASSERT_TRUE(table->addColumn<double>("weight", {0.4, 0.1, 0.3, 0.2, 0.11}));
+    EXPECT_FALSE(table->addColumn<int64_t>("short", {1, 2}));
+    ASSERT_TRUE(table->createIndex("code"));
+    ASSERT_TRUE(table->createIndex("rank"));
+    EXPECT_FALSE(table->createIndex("missing"));
+
+    sdb::drivers::SqliteConnection conn(":memory:");
+    ASSERT_TRUE(conn.open());
+    ASSERT_TRUE(sdb::drivers::registerVirtualTable(conn, "ref_codes", table));
+    ASSERT_TRUE(conn.execute("CREATE TABLE orders (id INTEGER PRIMARY KEY, code TEXT)"));
+    ASSERT_TRUE(conn.execute("INSERT INTO orders (code) VALUES ('alpha'), ('bravo'), ('zulu')"));
+
+    auto collect = [&](const std::string& sql) {
+        std::vector<std::string> out;
+        auto rsRes = conn.query(sql);
+        EXPECT_TRUE(rsRes) << (rsRes ? "" : rsRes.error().message);
+        while (rsRes && rsRes.value()->next()) {
+            out.push_back(sdb::toString(rsRes.value()->get(0)));
+        }
+        return out;
+    };
+
+    EXPECT_EQ(collect("SELECT o.id || ':' || r.rank FROM orders o JOIN ref_codes r ON r.code = o.code ORDER BY o.id, r.rank"),
+              (std::vector<std::string>{"1:10", "1:11", "2:20"}));
+    EXPECT_EQ(collect("SELECT code FROM ref_codes WHERE rank > 11 AND rank <= 30"),
+              (std::vector<std::string>{"bravo", "charlie"}));
+    EXPECT_EQ(collect("SELECT rank FROM ref_codes WHERE code = 'ALPHA' COLLATE NOCASE ORDER BY rank"),
+              (std::vector<std::string>{"10", "11"}));
+    EXPECT_EQ(collect("SELECT weight FROM ref_codes WHERE rank = 30"), (std::vector<std::string>{std::to_string(0.3)}));
+
+    // 按索引列顺序返回时 ORDER BY 无需额外排序
+    auto plan = collect("EXPLAIN QUERY PLAN SELECT code FROM ref_codes WHERE rank >= 20 ORDER BY rank");
+    ASSERT_FALSE(plan.empty());
+    for (const auto& line : plan) {
+        EXPECT_EQ(line.find("TEMP B-TREE"), std::string::npos) << line;
+    }
+    EXPECT_EQ(collect("SELECT rank FROM ref_codes WHERE rank >= 20 ORDER BY rank"),
+              (std::vector<std::string>{"20", "30", "40"}));
+
+    std::vector<sdb::drivers::SqliteVtabConstraint> seen;
+    auto generator = std::make_shared<sdb::drivers::SqliteGeneratorTable>(
+        std::vector<sdb::drivers::SqliteVirtualTable::Column>{{"n", "INTEGER"}, {"square", "INTEGER"}},
+        [&seen](int, const std::vector<sdb::drivers::SqliteVtabConstraint>& constraints) {
+            seen = constraints;
+            int64_t start = 1;
+            for (const auto& c : constraints) {
+                if (c.op == SQLITE_INDEX_CONSTRAINT_GE) {
+                    start = std::get<int64_t>(c.value);
+                }
+            }
+            return sdb::drivers::SqliteGeneratorTable::Generator([n = start](std::vector<sdb::DbValue>& row) mutable {
+                if (n > 100) {
+                    return false;
+                }
+                row[0] = n;
+                row[1] = n * n;
+                ++n;
+                return true;
+            });
+        },
+        100.0, std::vector<std::string>{"n"});
+    ASSERT_TRUE(sdb::drivers::registerVirtualTable(conn, "squares", generator));
+    EXPECT_EQ(collect("SELECT square FROM squares WHERE n >= 98"), (std::vector<std::string>{"9604", "9801", "10000"}));
+    ASSERT_EQ(seen.size(), 1u);
+    EXPECT_EQ(seen[0].column, 0);
+    EXPECT_EQ(seen[0].op, SQLITE_INDEX_CONSTRAINT_GE);
+    EXPECT_EQ(collect("SELECT COUNT(*) FROM squares"), (std::vector<std::string>{"100"}));
+}
+
+TEST(SqliteDriverTest, MaintenanceSchedulerCheckpointsVacuumsAndOptimizes) {
+    const auto stamp = std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    const auto path = (std::filesystem::temp_directory_path() / ("smartdb_maintenance_" + stamp + ".db")).string();
+
+    sdb::drivers::SqliteDriver driver;
+    auto writer = driver.createConnection({
+        {"path", path},
+        {"sqlite", {{"journal_mode", "WAL"}, {"auto_vacuum", "INCREMENTAL"}, {"strict_pragmas", true}}}
+    });
+    ASSERT_TRUE(writer->open());
+    auto* sqliteWriter = dynamic_cast<sdb::drivers::SqliteConnection*>(writer.get());
+    ASSERT_NE(sqliteWriter, nullptr);
+    EXPECT_EQ(sqliteWriter->effectivePragmas().at("auto_vacuum"), "incremental");
+    ASSERT_TRUE(writer->execute("CREATE TABLE events (id INTEGER PRIMARY KEY, payload BLOB)"));
+
+    std::atomic<bool> idle{false};
+    std::vector<sdb::drivers::SqliteMaintenanceScheduler::Task> tasks;
+    sdb::drivers::SqliteMaintenanceScheduler::Options options;
+    options.passiveWalBytes = 64 * 1024;
+    options.truncateWalBytes = int64_t{1} << 40;
+    options.idleProbe = [&idle] { return idle.load(); };
+    options.idleWindow = std::chrono::milliseconds(0);
+    options.vacuumMinFreePages = 16;
+    options.onTask = [&tasks](const sdb::drivers::SqliteMaintenanceScheduler::TaskReport& report) {
+        EXPECT_TRUE(report.ok) << report.error;
+        tasks.push_back(report.task);
+    };
+    auto schedulerRes = sdb::drivers::SqliteMaintenanceScheduler::create(path, options);
+    ASSERT_TRUE(schedulerRes) << schedulerRes.error().message;
+    auto& scheduler = *schedulerRes.value();
+
+    // 登记后写连接不再自动检查点（默认每 1000 页一次），1200 页的事务全部留在 WAL 中
+    auto walAutocheckpoint = [](sdb::IConnection& conn) {
+        auto rs = conn.query("PRAGMA wal_autocheckpoint");
+        return rs && rs.value()->next() ? std::get<int64_t>(rs.value()->get(0)) : -1;
+    };
+    EXPECT_EQ(walAutocheckpoint(*writer), 1000);
+    scheduler.attachWriter(*sqliteWriter);
+    EXPECT_EQ(walAutocheckpoint(*writer), 0);
+    ASSERT_TRUE(writer->begin());
+    for (int i = 0; i < 1200; ++i) {
+        ASSERT_TRUE(writer->execute("INSERT INTO events (payload) VALUES (?)", {std::vector<uint8_t>(4096, 1)}));
+    }
+    ASSERT_TRUE(writer->commit());
+
+    // 写连接池的工厂包装后，池中的连接同样被登记
+    auto pool = sdb::ConnectionPool::createWithFactory(scheduler.writerFactory([path]() {
+                    return sdb::DbResult<std::unique_ptr<sdb::IConnection>>::success(
+                        std::make_unique<sdb::drivers::SqliteConnection>(path));
+                })).value();
+    {
+        auto handle = pool->acquire();
+        ASSERT_TRUE(handle);
+        EXPECT_EQ(walAutocheckpoint(*handle.value()), 0);
+    }
+    pool->shutdown();
+
+    // 关闭自动检查点后 WAL 只增不减，直到后台检查点
+    const int64_t walBefore = scheduler.walSize();
+    EXPECT_GT(walBefore, 1200 * 4096);
+    EXPECT_GT(scheduler.pendingWalFrames(), 1200);
+    ASSERT_TRUE(scheduler.runOnce());
+    ASSERT_EQ(tasks.size(), 1u);
+    EXPECT_EQ(tasks[0], sdb::drivers::SqliteMaintenanceScheduler::Task::PassiveCheckpoint);
+    EXPECT_EQ(scheduler.walSize(), walBefore);
+    EXPECT_EQ(scheduler.pendingWalFrames(), 0);
+
+    // PASSIVE 不缩小文件；没有新写入时不再重复检查点
+    ASSERT_TRUE(scheduler.runOnce());
+    EXPECT_EQ(tasks.size(), 1u);
+
+    ASSERT_TRUE(writer->execute("DELETE FROM events"));
+    idle = true;
+    tasks.clear();
+    ASSERT_TRUE(scheduler.runOnce());
+    EXPECT_EQ(tasks, (std::vector<sdb::drivers::SqliteMaintenanceScheduler::Task>{
+                         sdb::drivers::SqliteMaintenanceScheduler::Task::IncrementalVacuum,
+                         sdb::drivers::SqliteMaintenanceScheduler::Task::Optimize,
+                         sdb::drivers::SqliteMaintenanceScheduler::Task::TruncateCheckpoint}));
+    EXPECT_EQ(scheduler.walSize(), 0);
+
+    const auto metrics = scheduler.metrics();
+    EXPECT_EQ(metrics.ticks, 3u);
+    EXPECT_EQ(metrics.passiveCheckpoints.runs, 1u);
+    EXPECT_EQ(metrics.truncateCheckpoints.runs, 1u);
+    EXPECT_EQ(metrics.incrementalVacuums.runs, 1u);
+    EXPECT_EQ(metrics.optimizes.runs, 1u);
+    EXPECT_GE(metrics.peakWalBytes, walBefore);
+    EXPECT_GT(metrics.truncateCheckpoints.totalMicros, 0u);
+
+    // 后台线程按周期运行
+    scheduler.resetMetrics();
+    tasks.clear();
+    sdb::drivers::SqliteMaintenanceScheduler::Options threaded;
+    threaded.interval = std::chrono::milliseconds(5);
+    auto threadedRes = sdb::drivers::SqliteMaintenanceScheduler::create(path, threaded);
+    ASSERT_TRUE(threadedRes);
+    threadedRes.value()->start();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (threadedRes.value()->metrics().ticks < 3 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    threadedRes.value()->stop();
+    EXPECT_GE(threadedRes.value()->metrics().ticks, 3u);
+
+    threadedRes.value().reset();
+    schedulerRes.value().reset();
+    writer->close();
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + "-wal");
+    std::filesystem::remove(path + "-shm");
+}
+
+TEST(SqliteDriverTest, StatementStatsFlagScansSortsAndCapturePlans) {
+    EXPECT_EQ(sdb::normalizeSql("SELECT  *\n FROM t1 WHERE a = 42 AND b IN ('x', 'it''s', 3) LIMIT 10;"),
+              "select * from t1 where a = ? and b in (?) limit ?");
+
+    sdb::drivers::SqliteDriver driver;
+    sdb::drivers::SqliteStatementStats::Options statsOptions;
+    statsOptions.planThreshold = std::chrono::microseconds(0);
+    statsOptions.planFullscanSteps = 50;
+    driver.statementStats().setOptions(statsOptions);
+
+    auto conn = driver.createConnection({{"path", ":memory:"}, {"sqlite", {{"statement_stats", true}}}});
+    ASSERT_TRUE(conn->open());
+    ASSERT_TRUE(conn->execute("CREATE TABLE orders (id INTEGER PRIMARY KEY, customer INTEGER, total REAL)"));
+    ASSERT_TRUE(conn->execute("CREATE TABLE customers (cid INTEGER, name TEXT)"));
+    ASSERT_TRUE(conn->begin());
+    for (int i = 0; i < 200; ++i) {
+        ASSERT_TRUE(conn->execute("INSERT INTO orders (customer, total) VALUES (?, ?)", {i % 20, i * 1.5}));
+    }
+    for (int i = 0; i < 20; ++i) {
+        ASSERT_TRUE(conn->execute("INSERT INTO customers VALUES (?, ?)", {i, std::string("c") + std::to_string(i)}));
+    }
+    ASSERT_TRUE(conn->commit());
+
+    for (int customer : {3, 7}) {
+        auto rsRes = conn->query("SELECT total FROM orders WHERE customer = " + std::to_string(customer) + " ORDER BY total");
+        ASSERT_TRUE(rsRes);
+        while (rsRes.value()->next()) {
+        }
+    }
+    {
+        auto rsRes = conn->query("SELECT COUNT(*) FROM orders o JOIN customers c ON c.cid = o.customer");
+        ASSERT_TRUE(rsRes && rsRes.value()->next());
+        EXPECT_EQ(std::get<int64_t>(rsRes.value()->get(0)), 200);
+    }
+
+    auto& stats = driver.statementStats();
+    auto scan = stats.find("SELECT total FROM orders WHERE customer = 1 ORDER BY total");
+    ASSERT_TRUE(scan.has_value());
+    EXPECT_EQ(scan->calls, 2u);
+    EXPECT_EQ(scan->rows, 20u);
+    EXPECT_GE(scan->fullscanSteps, 398u);
+    EXPECT_GE(scan->sorts, 2u);
+    EXPECT_GT(scan->vmSteps, 0u);
+    EXPECT_EQ(scan->slowCalls, 2u);
+    EXPECT_NE(scan->plan.find("SCAN"), std::string::npos) << scan->plan;
+    EXPECT_NE(scan->plan.find("TEMP B-TREE"), std::string::npos) << scan->plan;
+
+    auto insert = stats.find("INSERT INTO orders (customer, total) VALUES (?, ?)");
+    ASSERT_TRUE(insert.has_value());
+    EXPECT_EQ(insert->calls, 200u);
+    EXPECT_EQ(insert->fullscanSteps, 0u);
+    EXPECT_TRUE(insert->plan.empty());
+
+    auto join = stats.find("SELECT COUNT(*) FROM orders o JOIN customers c ON c.cid = o.customer");
+    ASSERT_TRUE(join.has_value());
+    EXPECT_GT(join->autoindexes, 0u);
+    EXPECT_NE(join->plan.find("AUTOMATIC"), std::string::npos) << join->plan;
+
+    const auto json = stats.toJson();
+    ASSERT_TRUE(json["statements"].is_array());
+    EXPECT_EQ(json["statements"].size(), stats.size());
+
+    // 未开启 statement_stats 的连接不写入统计
+    stats.reset();
+    auto plain = driver.createConnection({{"path", ":memory:"}});
+    ASSERT_TRUE(plain->open());
+    ASSERT_TRUE(plain->execute("CREATE TABLE t (a INTEGER)"));
+    EXPECT_EQ(stats.size(), 0u);
+}
+
+TEST(SqliteDriverTest, MemoryAccountingStatusAndBudget) {
+    sdb::drivers::SqliteRuntimeOptions runtime;
+    runtime.accountingAllocator = true;
+    runtime.lookasideSlotSize = 256;
+    runtime.lookasideSlots = 64;
+    ASSERT_TRUE(sdb::drivers::configureSqliteRuntime(runtime));
+
+    const std::string path = (std::filesystem::temp_directory_path() / "sdb_memory_budget.db").string();
+    std::filesystem::remove(path);
+    {
+        sdb::drivers::SqliteDriver driver;
+        const nlohmann::json config = {{"path", path},
+                                       {"sqlite", {{"cache_size", -8192},
+                                                   {"lookaside_slot_size", 128},
+                                                   {"lookaside_slots", 32},
+                                                   {"memory_budget", 64 * 1024}}}};
+        auto group = driver.memoryGroup(config);
+        group->setCheckInterval(std::chrono::milliseconds(0));
+        EXPECT_EQ(group->budget(), 0);
+
+        auto writer = driver.createConnection(config);
+        auto reader = driver.createConnection(config);
+        EXPECT_EQ(group->budget(), 64 * 1024);
+        ASSERT_TRUE(writer->open());
+        ASSERT_TRUE(reader->open());
+        EXPECT_EQ(group->snapshot().connections, 2u);
+
+        // 先放宽预算装入数据，确认页缓存确实增长
+        group->setBudget(0);
+        ASSERT_TRUE(writer->execute("CREATE TABLE blobs (id INTEGER PRIMARY KEY, payload BLOB)"));
+        ASSERT_TRUE(writer->begin());
+        for (int i = 0; i < 400; ++i) {
+            ASSERT_TRUE(writer->execute("INSERT INTO blobs (payload) VALUES (?)", {std::vector<uint8_t>(1024, static_cast<uint8_t>(i))}));
+        }
+        ASSERT_TRUE(writer->commit());
+        {
+            auto rsRes = reader->query("SELECT SUM(LENGTH(payload)) FROM blobs");
+            ASSERT_TRUE(rsRes && rsRes.value()->next());
+            EXPECT_EQ(std::get<int64_t>(rsRes.value()->get(0)), 400 * 1024);
+        }
+
+        auto* sqliteWriter = dynamic_cast<sdb::drivers::SqliteConnection*>(writer.get());
+        ASSERT_NE(sqliteWriter, nullptr);
+        // 组内汇总只读各连接在自己线程上（下一条语句前）发布的计数器
+        ASSERT_TRUE(writer->execute("SELECT 1"));
+        const auto own = sqliteWriter->memoryStatus();
+        EXPECT_GT(own.cacheUsed, 200 * 1024);
+        EXPECT_GT(own.schemaUsed, 0);
+        EXPECT_GT(own.cacheWrite, 0);
+        EXPECT_GT(own.accountedBytes, own.cacheUsed);
+        EXPECT_GE(own.accountedPeak, own.accountedBytes);
+
+        auto before = group->snapshot();
+        EXPECT_GE(before.total.cacheUsed, own.cacheUsed);
+        EXPECT_GT(before.total.cacheMiss + before.total.cacheHit, 0);
+        EXPECT_GT(before.total.accountedBytes, 0);
+        EXPECT_EQ(before.releases, 0u);
+
+        // 超出预算后，下一条语句前释放本连接的空闲页缓存
+        group->setBudget(64 * 1024);
+        ASSERT_TRUE(writer->execute("SELECT 1"));
+        auto after = group->snapshot();
+        EXPECT_GE(after.releases, 1u);
+        EXPECT_GT(after.releasedBytes, 0);
+        EXPECT_LT(sqliteWriter->memoryStatus().cacheUsed, own.cacheUsed);
+
+        writer->close();
+        EXPECT_EQ(group->snapshot().connections, 1u);
+    }
+    std::filesystem::remove(path);
+
+    runtime = {};
+    runtime.accountingAllocator = false;
+    EXPECT_TRUE(sdb::drivers::configureSqliteRuntime(runtime));
+}
+
 TEST(ConnectionPoolTest, ReusesSingleConnection) {
     auto driver = std::make_shared<sdb::drivers::SqliteDriver>();
     sdb::ConnectionPool::Options options;
@@ -174,6 +960,33 @@ TEST(ConnectionPoolTest, ReusesSingleConnection) {
     EXPECT_EQ(conn2.get(), firstPtr);
 }
 
+TEST(ConnectionPoolTest, ReleaseResetsConnectionForReuse) {
+    class ResettableConnection : public FakeTxConnection {
+    public:
+        explicit ResettableConnection(std::atomic<int>& resets) : resets_(resets) {}
+        void resetForReuse() override { ++resets_; }
+
+    private:
+        std::atomic<int>& resets_;
+    };
+    std::atomic<int> resets{0};
+    auto pool = sdb::ConnectionPool::createWithFactory([&resets]() {
+                    return sdb::DbResult<std::unique_ptr<sdb::IConnection>>::success(
+                        std::make_unique<ResettableConnection>(resets));
+                }).value();
+    {
+        auto handle = pool->acquire();
+        ASSERT_TRUE(handle);
+        EXPECT_EQ(resets.load(), 0);
+    }
+    EXPECT_EQ(resets.load(), 1);
+    {
+        auto handle = pool->acquire();
+        ASSERT_TRUE(handle);
+    }
+    EXPECT_EQ(resets.load(), 2);
+}
+
 TEST(ConnectionPoolTest, ExhaustedPoolTimesOut) {
     auto driver = std::make_shared<sdb::drivers::SqliteDriver>();
     sdb::ConnectionPool::Options options;
@@ -409,6 +1222,838 @@ TEST(ConnectionPoolTest, DatabaseManagerPoolCacheSeparatesOptions) {
     EXPECT_NE(pool1.get(), pool2.get());
 }
 
+TEST(ReadWritePoolTest, RoutesQueriesToReadersAndWritesToSingleWriter) {
+    const auto stamp = std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    const auto dbPath = (std::filesystem::temp_directory_path() / ("smartdb_rw_" + stamp + ".db")).string();
+    const auto cfgPath = std::filesystem::temp_directory_path() / ("smartdb_rw_config_" + stamp + ".json");
+
+    nlohmann::json j;
+    j["connections"]["rw"] = {{"driver", "sqlite"}, {"path", dbPath}, {"sqlite", {{"profile", "fast-durable"}}}};
+    j["connections"]["remote"] = {{"driver", "mysql"}};
+    {
+        std::ofstream out(cfgPath);
+        ASSERT_TRUE(out.is_open());
+        out << j.dump(2);
+    }
+
+    sdb::DatabaseManager manager;
+    ASSERT_TRUE(manager.registerDriver(std::make_shared<sdb::drivers::SqliteDriver>()));
+    ASSERT_TRUE(manager.registerDriver(std::make_shared<sdb::drivers::MysqlDriver>()));
+    ASSERT_TRUE(manager.loadConfig(cfgPath.string()));
+
+    auto unsupported = manager.createReadWritePool("remote");
+    EXPECT_FALSE(unsupported);
+
+    sdb::ReadWritePool::Options options;
+    options.readers = 2;
+    options.waitTimeout = std::chrono::milliseconds(200);
+    auto poolRes = manager.createReadWritePool("rw", options);
+    ASSERT_TRUE(poolRes) << poolRes.error().message;
+    auto pool = poolRes.value();
+    auto again = manager.createReadWritePool("rw", options);
+    ASSERT_TRUE(again);
+    EXPECT_EQ(again.value().get(), pool.get());
+    EXPECT_EQ(pool->writer()->totalSize(), 1u);
+
+    auto conn = pool->connection();
+    ASSERT_TRUE(conn->open());
+    ASSERT_TRUE(conn->execute("CREATE TABLE kv (k INTEGER PRIMARY KEY, v TEXT)"));
+    ASSERT_TRUE(conn->execute("INSERT INTO kv VALUES (?, ?)", {int64_t{1}, std::string("one")}));
+
+    {
+        auto rsRes = conn->query("SELECT v FROM kv WHERE k = 1");
+        ASSERT_TRUE(rsRes) << rsRes.error().message;
+        ASSERT_TRUE(rsRes.value()->next());
+        EXPECT_EQ(std::get<std::string>(rsRes.value()->get(0)), "one");
+        EXPECT_EQ(pool->readers()->inUseSize(), 1u);
+    }
+    EXPECT_EQ(pool->readers()->inUseSize(), 0u);
+    EXPECT_EQ(pool->readers()->metrics().acquireSuccesses, 1u);
+
+    auto readerRes = pool->acquireReader();
+    ASSERT_TRUE(readerRes);
+    EXPECT_FALSE(readerRes.value()->execute("INSERT INTO kv VALUES (9, 'nine')"));
+    readerRes.value().reset();
+
+    {
+        auto txRes = sdb::TransactionGuard::begin(*conn);
+        ASSERT_TRUE(txRes) << txRes.error().message;
+        ASSERT_TRUE(conn->execute("INSERT INTO kv VALUES (2, 'two')"));
+        auto inTx = conn->query("SELECT COUNT(*) FROM kv");
+        ASSERT_TRUE(inTx && inTx.value()->next());
+        EXPECT_EQ(std::get<int64_t>(inTx.value()->get(0)), 2);
+
+        auto other = pool->connection();
+        auto outside = other->query("SELECT COUNT(*) FROM kv");
+        ASSERT_TRUE(outside && outside.value()->next());
+        EXPECT_EQ(std::get<int64_t>(outside.value()->get(0)), 1);
+        EXPECT_FALSE(other->execute("INSERT INTO kv VALUES (3, 'three')"));
+        ASSERT_TRUE(txRes.value().commit());
+    }
+    EXPECT_FALSE(static_cast<sdb::RoutedConnection*>(conn.get())->inTransaction());
+
+    conn.reset();
+    pool.reset();
+    again.value().reset();
+    for (const char* suffix : {"", "-wal", "-shm"}) {
+        std::filesystem::remove(dbPath + suffix);
+    }
+    std::filesystem::remove(cfgPath);
+}
+
+TEST(ReadWritePoolTest, ProfilesKeepWriterOnlySettingsOffReadersAndReadOnlyOffWriter) {
+    const auto stamp = std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    const auto dir = std::filesystem::temp_directory_path();
+    const auto bulkPath = (dir / ("smartdb_rw_bulk_" + stamp + ".db")).string();
+    const auto analyticsPath = (dir / ("smartdb_rw_analytics_" + stamp + ".db")).string();
+    const auto cfgPath = dir / ("smartdb_rw_profiles_" + stamp + ".json");
+
+    nlohmann::json j;
+    j["connections"]["bulk"] = {{"driver", "sqlite"}, {"path", bulkPath}, {"sqlite", {{"profile", "bulk-load"}}}};
+    j["connections"]["analytics"] = {
+        {"driver", "sqlite"}, {"path", analyticsPath}, {"sqlite", {{"profile", "read-only-analytics"}}}};
+    j["connections"]["explicit_readonly"] = {
+        {"driver", "sqlite"}, {"path", analyticsPath}, {"sqlite", {{"readonly", true}}}};
+    {
+        std::ofstream out(cfgPath);
+        ASSERT_TRUE(out.is_open());
+        out << j.dump(2);
+    }
+
+    sdb::DatabaseManager manager;
+    ASSERT_TRUE(manager.registerDriver(std::make_shared<sdb::drivers::SqliteDriver>()));
+    ASSERT_TRUE(manager.loadConfig(cfgPath.string()));
+    sdb::ReadWritePool::Options options;
+    options.readers = 2;
+    options.waitTimeout = std::chrono::milliseconds(200);
+
+    // bulk-load 的 journal_mode=MEMORY / locking_mode=EXCLUSIVE 只作用于写连接
+    {
+        auto poolRes = manager.createReadWritePool("bulk", options);
+        ASSERT_TRUE(poolRes) << poolRes.error().message;
+        auto reader = poolRes.value()->acquireReader();
+        ASSERT_TRUE(reader) << reader.error().message;
+        auto second = poolRes.value()->acquireReader();
+        ASSERT_TRUE(second) << second.error().message;
+        auto mode = reader.value()->query("PRAGMA locking_mode");
+        ASSERT_TRUE(mode && mode.value()->next());
+        EXPECT_EQ(std::get<std::string>(mode.value()->get(0)), "normal");
+        auto writer = poolRes.value()->acquireWriter();
+        ASSERT_TRUE(writer);
+        auto journal = writer.value()->query("PRAGMA journal_mode");
+        ASSERT_TRUE(journal && journal.value()->next());
+        EXPECT_EQ(std::get<std::string>(journal.value()->get(0)), "memory");
+    }
+
+    // read-only-analytics 的只读设置只作用于读连接
+    {
+        auto poolRes = manager.createReadWritePool("analytics", options);
+        ASSERT_TRUE(poolRes) << poolRes.error().message;
+        auto conn = poolRes.value()->connection();
+        ASSERT_TRUE(conn->open());
+        ASSERT_TRUE(conn->execute("CREATE TABLE kv (k INTEGER PRIMARY KEY, v TEXT)"));
+        ASSERT_TRUE(conn->execute("INSERT INTO kv VALUES (1, 'one')"));
+        auto rs = conn->query("SELECT COUNT(*) FROM kv");
+        ASSERT_TRUE(rs && rs.value()->next());
+        EXPECT_EQ(std::get<int64_t>(rs.value()->get(0)), 1);
+        auto reader = poolRes.value()->acquireReader();
+        ASSERT_TRUE(reader);
+        EXPECT_FALSE(reader.value()->execute("INSERT INTO kv VALUES (2, 'two')"));
+    }
+
+    auto rejected = manager.createReadWritePool("explicit_readonly", options);
+    ASSERT_FALSE(rejected);
+    EXPECT_NE(rejected.error().message.find("readonly"), std::string::npos) << rejected.error().message;
+
+    for (const auto& path : {bulkPath, analyticsPath}) {
+        for (const char* suffix : {"", "-wal", "-shm", "-journal"}) {
+            std::filesystem::remove(path + suffix);
+        }
+    }
+    std::filesystem::remove(cfgPath);
+}
+
+TEST(ConnectionPoolTest, SharedMemoryDatabaseVisibleAcrossPooledConnections) {
+    for (const char* mode : {"memdb", "shared_cache"}) {
+        SCOPED_TRACE(mode);
+        sdb::DatabaseManager manager;
+        ASSERT_TRUE(manager.registerDriver(std::make_shared<sdb::drivers::SqliteDriver>()));
+        const nlohmann::json config = {
+            {"path", ":memory:"},
+            {"sqlite", {{"shared_memory", std::string("smartdb_shared_") + mode}, {"shared_memory_mode", mode}}}
+        };
+
+        sdb::ConnectionPool::Options options;
+        options.maxSize = 3;
+        options.waitTimeout = std::chrono::milliseconds(100);
+        {
+            auto poolRes = manager.createPoolRaw("sqlite", config, options);
+            ASSERT_TRUE(poolRes) << poolRes.error().message;
+            auto pool = poolRes.value();
+
+            auto aRes = pool->acquire();
+            auto bRes = pool->acquire();
+            ASSERT_TRUE(aRes) << aRes.error().message;
+            ASSERT_TRUE(bRes) << bRes.error().message;
+            ASSERT_TRUE(aRes.value()->execute("CREATE TABLE staging (id INTEGER)"));
+            ASSERT_TRUE(aRes.value()->execute("INSERT INTO staging VALUES (1), (2)"));
+
+            auto rsRes = bRes.value()->query("SELECT COUNT(*) FROM staging");
+            ASSERT_TRUE(rsRes) << rsRes.error().message;
+            ASSERT_TRUE(rsRes.value()->next());
+            EXPECT_EQ(std::get<int64_t>(rsRes.value()->get(0)), 2);
+        }
+
+        // 池销毁后共享内存库随之释放
+        auto poolRes = manager.createPoolRaw("sqlite", config, options);
+        ASSERT_TRUE(poolRes) << poolRes.error().message;
+        auto connRes = poolRes.value()->acquire();
+        ASSERT_TRUE(connRes) << connRes.error().message;
+        EXPECT_FALSE(connRes.value()->query("SELECT COUNT(*) FROM staging"));
+    }
+
+    sdb::drivers::SqliteDriver driver;
+    auto bad = driver.createConnection({{"sqlite", {{"shared_memory", "../etc?vfs=unix"}}}});
+    EXPECT_FALSE(bad->open());
+}
+
+TEST(ConnectionPoolTest, DriverFunctionsReplayOnEveryPooledConnection) {
+    sdb::DatabaseManager manager;
+    auto driver = std::make_shared<sdb::drivers::SqliteDriver>();
+    ASSERT_TRUE(manager.registerDriver(driver));
+    driver->functions().scalar("add_one", [](int64_t v) { return v + 1; });
+
+    sdb::ConnectionPool::Options options;
+    options.maxSize = 2;
+    options.waitTimeout = std::chrono::milliseconds(100);
+    auto poolRes = manager.createPoolRaw("sqlite", {{"path", ":memory:"}}, options);
+    ASSERT_TRUE(poolRes) << poolRes.error().message;
+    auto pool = poolRes.value();
+
+    auto aRes = pool->acquire();
+    auto bRes = pool->acquire();
+    ASSERT_TRUE(aRes && bRes);
+
+    // 连接已在池中之后登记的函数也会在下一条语句前补注册
+    driver->functions().aggregate<std::string>(
+        "concat_all", [](std::string& acc, std::string_view part) { acc.append(part); },
+        [](const std::string& acc) { return acc; });
+
+    for (auto* handle : {&aRes.value(), &bRes.value()}) {
+        auto rsRes = (*handle)->query("SELECT add_one(41), concat_all(x) FROM (SELECT 'a' AS x UNION ALL SELECT 'b')");
+        ASSERT_TRUE(rsRes) << rsRes.error().message;
+        ASSERT_TRUE(rsRes.value()->next());
+        EXPECT_EQ(std::get<int64_t>(rsRes.value()->get(0)), 42);
+        EXPECT_EQ(std::get<std::string>(rsRes.value()->get(1)), "ab");
+    }
+    EXPECT_EQ(driver->functions().size(), 2u);
+}
+
+TEST(SqliteSnapshotTest, ParallelReadersShareOneCommitPoint) {
+    if (!sdb::drivers::SnapshotGroup::supported()) {
+        sdb::drivers::SqliteDriver driver;
+        auto conn = driver.createConnection({{"path", ":memory:"}});
+        ASSERT_TRUE(conn->open());
+        EXPECT_FALSE(sdb::drivers::SnapshotGroup::capture(*conn));
+        GTEST_SKIP() << "SQLite built without SQLITE_ENABLE_SNAPSHOT; configure with -DSMARTDB_SQLITE_SNAPSHOT=ON.";
+    }
+
+    const auto stamp = std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    const auto path = (std::filesystem::temp_directory_path() / ("smartdb_snapshot_" + stamp + ".db")).string();
+    const nlohmann::json config = {{"path", path}, {"sqlite", {{"journal_mode", "WAL"}}}};
+
+    auto driver = std::make_shared<sdb::drivers::SqliteDriver>();
+    auto writer = driver->createConnection(config);
+    ASSERT_TRUE(writer->open());
+    ASSERT_TRUE(writer->execute("CREATE TABLE events (id INTEGER)"));
+    ASSERT_TRUE(writer->execute("INSERT INTO events VALUES (1), (2), (3)"));
+
+    sdb::ConnectionPool::Options options;
+    options.maxSize = 3;
+    auto poolRes = sdb::ConnectionPool::createWithFactory(
+        [driver, config]() { return sdb::DbResult<std::unique_ptr<sdb::IConnection>>::success(driver->createConnection(config)); },
+        options);
+    ASSERT_TRUE(poolRes) << poolRes.error().message;
+
+    auto groupRes = sdb::drivers::SnapshotGroup::capture(*poolRes.value(), 3);
+    ASSERT_TRUE(groupRes) << groupRes.error().message;
+    auto group = std::move(groupRes.value());
+    ASSERT_EQ(group->size(), 3u);
+
+    ASSERT_TRUE(writer->execute("INSERT INTO events VALUES (4)"));
+
+    std::vector<std::future<int64_t>> counts;
+    for (size_t i = 0; i < group->size(); ++i) {
+        counts.push_back(std::async(std::launch::async, [&group, i]() -> int64_t {
+            auto rsRes = group->member(i).query("SELECT COUNT(*) FROM events");
+            if (!rsRes || !rsRes.value()->next()) {
+                return -1;
+            }
+            return std::get<int64_t>(rsRes.value()->get(0));
+        }));
+    }
+    for (auto& count : counts) {
+        EXPECT_EQ(count.get(), 3);
+    }
+
+    group.reset();
+    auto connRes = poolRes.value()->acquire();
+    ASSERT_TRUE(connRes);
+    auto rsRes = connRes.value()->query("SELECT COUNT(*) FROM events");
+    ASSERT_TRUE(rsRes && rsRes.value()->next());
+    EXPECT_EQ(std::get<int64_t>(rsRes.value()->get(0)), 4);
+
+    rsRes.value().reset();
+    connRes.value().reset();
+    poolRes.value()->shutdown();
+    writer->close();
+    for (const char* suffix : {"", "-wal", "-shm"}) {
+        std::filesystem::remove(path + suffix);
+    }
+}
+
+TEST(SqlNormalizeTest, FingerprintIgnoresLiteralsListsCommentsAndWhitespace) {
+    EXPECT_EQ(sdb::normalizeSql("SELECT \"Name\", x'ff' FROM t /* hint */ WHERE id IN ( 1 , 2.5e-3, -4, 0x1F ) "
+                                "AND d = '2024-01-01' -- tail\n AND k = :key AND c::text = @@mode;"),
+              "select \"Name\", ? from t where id in (?) and d = ? and k = ? and c::text = @@mode");
+    EXPECT_EQ(sdb::normalizeSql("INSERT INTO kv (id, v) VALUES (1, 'a'), (2, 'b'),(3, 'c')"),
+              "insert into kv (id, v) values (?)");
+    EXPECT_EQ(sdb::normalizeSql("INSERT INTO kv VALUES (1, now()), (2, now()) ON DUPLICATE KEY UPDATE v = 1, w = 2"),
+              "insert into kv values (?, now()), (?, now()) on duplicate key update v = ?, w = ?");
+    EXPECT_EQ(sdb::normalizeSql("SELECT a FROM t WHERE (a, b) IN ((1, 2), (3, 4)) AND c IN (SELECT 1, 2)"),
+              "select a from t where (a, b) in ((?)) and c in (select ?, ?)");
+
+    EXPECT_EQ(sdb::normalizeSql("SELECT CASE WHEN a BETWEEN -1 AND +2 THEN -1 ELSE -2 END FROM t LIMIT -1"),
+              "select case when a between ? and ? then ? else ? end from t limit ?");
+    EXPECT_EQ(sdb::normalizeSql("SELECT a - 1 FROM t"), "select a - ? from t");
+    EXPECT_EQ(sdb::normalizeSql("SELECT v FROM t WHERE k IN (x'01', X'02', b'1') AND n = N'abc'"),
+              "select v from t where k in (?) and n = ?");
+
+    // 列表以外的参数个数是语句结构的一部分，不折叠
+    EXPECT_EQ(sdb::normalizeSql("SELECT 1, 2, 3"), "select ?, ?, ?");
+    EXPECT_NE(sdb::sqlFingerprint("SELECT 1, 2, 3"), sdb::sqlFingerprint("SELECT 1"));
+    EXPECT_EQ(sdb::normalizeSql("SELECT v FROM kv LIMIT 10, 20"), "select v from kv limit ?, ?");
+    EXPECT_NE(sdb::sqlFingerprint("SELECT v FROM kv LIMIT 10, 20"), sdb::sqlFingerprint("SELECT v FROM kv LIMIT 10"));
+    EXPECT_EQ(sdb::normalizeSql("SELECT substr(name,1,2) FROM t"), "select substr(name,?,?) from t");
+    EXPECT_NE(sdb::sqlFingerprint("SELECT substr(name,1,2) FROM t"), sdb::sqlFingerprint("SELECT substr(name,1) FROM t"));
+
+    const uint64_t fp = sdb::sqlFingerprint("SELECT v FROM kv WHERE id IN (1, 2, 3) AND s = 'it''s'");
+    EXPECT_EQ(sdb::sqlFingerprint("select v\n  from kv where id in (?) and s = $1;"), fp);
+    EXPECT_EQ(sdb::sqlFingerprint("SELECT v FROM kv WHERE id IN (9) AND s = ''"), fp);
+    EXPECT_EQ(fp, sdb::hashNormalizedSql("select v from kv where id in (?) and s = ?"));
+    // 指纹须跨进程、跨版本稳定：钉住具体取值，改动混合常数或按字读取方式都会使其失败
+    EXPECT_EQ(sdb::hashNormalizedSql(""), 0x9353dfc8a195f3e2ULL);
+    EXPECT_EQ(sdb::hashNormalizedSql("select ?"), 0x7681da9faa307014ULL);
+    EXPECT_EQ(fp, 0x9b7c46ebe435c255ULL);
+    EXPECT_EQ(sdb::sqlFingerprint("INSERT INTO kv (id, v) VALUES (1, 'a'), (2, 'b')"), 0x7fff514f0d0d0fb7ULL);
+    EXPECT_EQ(sdb::formatSqlFingerprint(fp), "9b7c46ebe435c255");
+    EXPECT_NE(sdb::sqlFingerprint("SELECT w FROM kv WHERE id IN (1) AND s = 'x'"), fp);
+    EXPECT_NE(sdb::sqlFingerprint("SELECT v FROM kv WHERE id = 1 AND s = 'x'"), fp);
+    EXPECT_EQ(sdb::formatSqlFingerprint(0x1fULL), "000000000000001f");
+
+    sdb::SqlNormalizer normalizer;
+    EXPECT_EQ(normalizer.normalize("DELETE FROM t WHERE id = ?"), "delete from t where id = ?");
+    EXPECT_FALSE(normalizer.sawLiterals());
+    EXPECT_EQ(normalizer.normalize("DELETE FROM t WHERE id = 7"), "delete from t where id = ?");
+    EXPECT_TRUE(normalizer.sawLiterals());
+}
+
+TEST(QueryStatsTest, HistogramsPerStatementAndSampledSlowLog) {
+    using namespace std::chrono_literals;
+    std::vector<sdb::QueryStats::SlowQuery> sunk;
+    sdb::QueryStats::Options options;
+    options.slowThreshold = 1ms;
+    options.slowSampleEvery = 2;
+    options.slowSqlMaxLength = 25;
+    options.slowQuerySink = [&](const sdb::QueryStats::SlowQuery& q) { sunk.push_back(q); };
+    sdb::QueryStats stats(options);
+
+    for (int i = 0; i < 100; ++i) {
+        stats.record("SELECT v FROM kv WHERE id = " + std::to_string(i), std::chrono::microseconds(10 + i), 1, 32);
+    }
+    stats.record("SELECT v FROM kv WHERE id = 7", 5ms, 1, 32);
+    stats.record("SELECT v FROM kv WHERE id = 8", 6ms, 0, 0, false);
+    stats.record("UPDATE kv SET v = 'x' WHERE id IN (1, 2, 3)", 20us, 3);
+
+    auto point = stats.find("select v from kv where id = 12345");
+    ASSERT_TRUE(point.has_value());
+    EXPECT_EQ(point->statement, "select v from kv where id = ?");
+    EXPECT_EQ(point->calls, 102u);
+    EXPECT_EQ(point->errors, 1u);
+    EXPECT_EQ(point->rows, 101u);
+    EXPECT_EQ(point->bytes, 101u * 32);
+    EXPECT_EQ(point->slowCalls, 2u);
+    const auto p50 = point->latency.percentile(0.5);
+    EXPECT_GE(p50, 55'000u);
+    EXPECT_LE(p50, 65'000u);
+    EXPECT_EQ(point->latency.maxNanos, 6'000'000u);
+
+    auto snapshot = stats.snapshot();
+    ASSERT_EQ(snapshot.size(), 2u);
+    EXPECT_EQ(snapshot[0].statement, "select v from kv where id = ?");
+    EXPECT_EQ(snapshot[1].statement, "update kv set v = ? where id in (?)");
+
+    // 两条慢查询按每 2 条采样 1 条，只留下第一条，且 SQL 被截断到 25 字节
+    EXPECT_EQ(stats.slowQueryCount(), 2u);
+    ASSERT_EQ(sunk.size(), 1u);
+    EXPECT_EQ(sunk[0].sql, "SELECT v FROM kv WHERE id");
+    EXPECT_TRUE(sunk[0].truncated);
+    EXPECT_EQ(sunk[0].statement, "select v from kv where id = ?");
+    EXPECT_EQ(sunk[0].elapsed, 5ms);
+    ASSERT_EQ(stats.slowQueries().size(), 1u);
+
+    auto json = stats.toJson();
+    EXPECT_EQ(json["statements"].size(), 2u);
+    EXPECT_EQ(json["slow_queries"], 2);
+
+    stats.reset();
+    EXPECT_TRUE(stats.snapshot().empty());
+    EXPECT_TRUE(stats.slowQueries().empty());
+    stats.record("SELECT v FROM kv WHERE id = 1", 10us);
+    EXPECT_EQ(stats.find("SELECT v FROM kv WHERE id = 2")->calls, 1u);
+}
+
+TEST(QueryStatsTest, StatementCapAndConcurrentRecording) {
+    sdb::QueryStats::Options options;
+    options.maxStatements = 2;
+    options.slowThreshold = std::chrono::microseconds(0);
+    sdb::QueryStats stats(options);
+    stats.record("SELECT 1 FROM a", std::chrono::microseconds(1));
+    stats.record("SELECT 1 FROM b", std::chrono::microseconds(1));
+    stats.record("SELECT 1 FROM c", std::chrono::microseconds(1));
+    stats.record("SELECT 1 FROM d", std::chrono::microseconds(1));
+    ASSERT_TRUE(stats.find("SELECT 1 FROM c").has_value() == false);
+    auto snapshot = stats.snapshot();
+    ASSERT_EQ(snapshot.size(), 3u);
+    EXPECT_EQ(std::count_if(snapshot.begin(), snapshot.end(),
+                            [](const auto& e) { return e.statement == "<other>" && e.calls == 2; }),
+              1);
+
+    sdb::QueryStats shared;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; ++t) {
+        workers.emplace_back([&shared, t]() {
+            for (int i = 0; i < 5000; ++i) {
+                shared.record("SELECT * FROM t WHERE k = " + std::to_string(t * 5000 + i), std::chrono::microseconds(i % 50),
+                              1, 8);
+            }
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    auto entry = shared.find("SELECT * FROM t WHERE k = 0");
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_EQ(entry->calls, 20000u);
+    EXPECT_EQ(entry->bytes, 160000u);
+    EXPECT_EQ(entry->latency.count, 20000u);
+
+    for (size_t i = 1; i < sdb::LatencyHistogram::kBuckets; ++i) {
+        EXPECT_EQ(sdb::LatencyHistogram::bucketLower(i), sdb::LatencyHistogram::bucketUpper(i - 1));
+        EXPECT_EQ(sdb::LatencyHistogram::bucketOf(sdb::LatencyHistogram::bucketLower(i)), i);
+    }
+}
+
+TEST(InstrumentedConnectionTest, ManagerWrapsConfiguredConnections) {
+    const auto stamp = std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    const auto cfgPath = std::filesystem::temp_directory_path() / ("smartdb_instrument_config_" + stamp + ".json");
+    nlohmann::json j;
+    j["connections"]["plain"] = {{"driver", "sqlite"}, {"path", ":memory:"}};
+    j["connections"]["traced"] = {{"driver", "sqlite"}, {"path", ":memory:"}, {"instrument", {{"slow_query_ms", 0}}}};
+    j["connections"]["bad_slow"] = {{"driver", "sqlite"}, {"path", ":memory:"}, {"instrument", {{"slow_query_ms", "100"}}}};
+    j["connections"]["bad_sample"] = {{"driver", "sqlite"}, {"path", ":memory:"}, {"instrument", {{"slow_sample_every", -1}}}};
+    j["connections"]["bad_max"] = {{"driver", "sqlite"}, {"path", ":memory:"}, {"instrument", {{"max_statements", 1.5}}}};
+    j["connections"]["bad_phase"] = {{"driver", "sqlite"}, {"path", ":memory:"}, {"instrument", {{"phase_timing", "yes"}}}};
+    {
+        std::ofstream out(cfgPath);
+        ASSERT_TRUE(out.is_open());
+        out << j.dump(2);
+    }
+
+    sdb::DatabaseManager manager;
+    ASSERT_TRUE(manager.registerDriver(std::make_shared<sdb::drivers::SqliteDriver>()));
+    ASSERT_TRUE(manager.loadConfig(cfgPath.string()));
+    std::filesystem::remove(cfgPath);
+
+    // 类型不符的埋点配置返回失败，不抛出 nlohmann::json 异常
+    for (const auto* name : {"bad_slow", "bad_sample", "bad_max", "bad_phase"}) {
+        auto bad = manager.createConnection(name);
+        ASSERT_FALSE(bad) << name;
+        EXPECT_NE(bad.error().message.find("Instrument option"), std::string::npos) << bad.error().message;
+        EXPECT_EQ(manager.instrumentation(name), nullptr);
+    }
+
+    auto plain = manager.createConnection("plain");
+    ASSERT_TRUE(plain);
+    EXPECT_EQ(dynamic_cast<sdb::InstrumentedConnection*>(plain.value().get()), nullptr);
+    EXPECT_EQ(manager.instrumentation("plain"), nullptr);
+
+    auto connRes = manager.createConnection("traced");
+    ASSERT_TRUE(connRes) << connRes.error().message;
+    auto& conn = *connRes.value();
+    ASSERT_NE(sdb::connectionAs<sdb::drivers::SqliteConnection>(conn), nullptr);
+    auto instrumentation = manager.instrumentation("traced");
+    ASSERT_NE(instrumentation, nullptr);
+    EXPECT_EQ(manager.instrumentations().size(), 1u);
+
+    ASSERT_TRUE(conn.open());
+    ASSERT_TRUE(conn.execute("CREATE TABLE kv (k INTEGER PRIMARY KEY, v TEXT)"));
+    ASSERT_TRUE(conn.begin());
+    for (int i = 1; i <= 3; ++i) {
+        ASSERT_TRUE(conn.execute("INSERT INTO kv VALUES (?, ?)", {int64_t{i}, std::string("value")}));
+    }
+    ASSERT_TRUE(conn.commit());
+    ASSERT_TRUE(conn.begin());
+    ASSERT_TRUE(conn.rollback());
+    EXPECT_FALSE(conn.query("SELECT * FROM missing"));
+    {
+        auto rsRes = conn.query("SELECT k, v FROM kv WHERE k > 0");
+        ASSERT_TRUE(rsRes) << rsRes.error().message;
+        while (rsRes.value()->next()) {
+            EXPECT_EQ(std::get<std::string>(rsRes.value()->get("v")), "value");
+        }
+    }
+
+    const auto s = instrumentation->snapshot();
+    auto op = [&s](sdb::ConnectionOp o) { return s.ops[static_cast<size_t>(o)]; };
+    EXPECT_EQ(s.connections, 1);
+    EXPECT_EQ(op(sdb::ConnectionOp::Open).calls, 1u);
+    EXPECT_EQ(op(sdb::ConnectionOp::Execute).calls, 4u);
+    EXPECT_EQ(op(sdb::ConnectionOp::Begin).calls, 2u);
+    EXPECT_EQ(op(sdb::ConnectionOp::Commit).calls, 1u);
+    EXPECT_EQ(op(sdb::ConnectionOp::Rollback).calls, 1u);
+    EXPECT_EQ(op(sdb::ConnectionOp::Query).calls, 2u);
+    EXPECT_EQ(op(sdb::ConnectionOp::Query).errors, 1u);
+    EXPECT_EQ(s.rowsFetched, 3u);
+    EXPECT_EQ(s.bytesFetched, 15u);
+
+    // 结果集销毁时按规范化语句记入 QueryStats；slow_query_ms 为 0 时关闭慢查询日志
+    auto select = instrumentation->queries().find("SELECT k, v FROM kv WHERE k > 5");
+    ASSERT_TRUE(select.has_value());
+    EXPECT_EQ(select->calls, 1u);
+    EXPECT_EQ(select->rows, 3u);
+    auto insert = instrumentation->queries().find("INSERT INTO kv VALUES (?, ?)");
+    ASSERT_TRUE(insert.has_value());
+    EXPECT_EQ(insert->calls, 3u);
+    EXPECT_EQ(instrumentation->queries().find("SELECT * FROM missing")->errors, 1u);
+    EXPECT_EQ(instrumentation->queries().slowQueryCount(), 0u);
+    EXPECT_TRUE(instrumentation->toJson()["operations"].contains("rollback"));
+
+    connRes.value().reset();
+    EXPECT_EQ(instrumentation->snapshot().connections, 0);
+}
+
+TEST(InstrumentedConnectionTest, PhaseTimingSplitsWallAndThreadCpuTime) {
+    auto instrumentation = std::make_shared<sdb::ConnectionInstrumentation>("phases");
+    instrumentation->setPhaseTiming(true);
+    sdb::InstrumentedConnection conn(
+        std::make_unique<sdb::drivers::SqliteConnection>(":memory:"), instrumentation);
+    ASSERT_TRUE(conn.open());
+    ASSERT_TRUE(conn.execute("CREATE TABLE kv (k INTEGER PRIMARY KEY, v TEXT)"));
+    for (int i = 1; i <= 50; ++i) {
+        ASSERT_TRUE(conn.execute("INSERT INTO kv VALUES (?, ?)", {int64_t{i}, std::string(64, 'x')}));
+    }
+    {
+        auto rs = conn.query("SELECT k, v FROM kv");
+        ASSERT_TRUE(rs) << rs.error().message;
+        while (rs.value()->next()) {
+            (void)rs.value()->get(0);
+            (void)rs.value()->get("v");
+        }
+    }
+
+    using sdb::QueryPhase;
+    auto insert = instrumentation->queries().find("INSERT INTO kv VALUES (?, ?)");
+    ASSERT_TRUE(insert.has_value());
+    EXPECT_EQ(insert->phasedCalls, 50u);
+    EXPECT_GT(insert->phases.wall(QueryPhase::Prepare), 0u);
+    EXPECT_GT(insert->phases.wall(QueryPhase::Execute), 0u);
+    EXPECT_EQ(insert->phases.wall(QueryPhase::Fetch), 0u);
+
+    auto select = instrumentation->queries().find("SELECT k, v FROM kv");
+    ASSERT_TRUE(select.has_value());
+    EXPECT_EQ(select->phasedCalls, 1u);
+    EXPECT_GT(select->phases.wall(QueryPhase::Prepare), 0u);
+    EXPECT_GT(select->phases.wall(QueryPhase::Fetch), 0u);
+    EXPECT_GT(select->phases.wall(QueryPhase::Decode), 0u);
+    const auto json = instrumentation->queries().toJson();
+    bool exported = false;
+    for (const auto& e : json["statements"]) {
+        if (e["statement"] == select->statement) {
+            exported = e["phases"]["decode"].contains("cpu_us");
+        }
+    }
+    EXPECT_TRUE(exported);
+
+    // 阻塞等待只计入墙钟：CPU 时间远小于墙钟即说明延迟来自等待而非本进程计算
+    class SleepyConnection : public FakeTxConnection {
+    public:
+        sdb::DbResult<int64_t> execute(const std::string&) override {
+            std::this_thread::sleep_for(std::chrono::milliseconds(30));
+            return sdb::DbResult<int64_t>::success(1);
+        }
+    };
+    sdb::InstrumentedConnection sleepy(std::make_unique<SleepyConnection>(), instrumentation);
+    ASSERT_TRUE(sleepy.execute("UPDATE remote SET v = 1"));
+    auto wait = instrumentation->queries().find("UPDATE remote SET v = 1");
+    ASSERT_TRUE(wait.has_value());
+    EXPECT_GE(wait->phases.wall(QueryPhase::Execute), 30'000'000u);
+#ifndef _WIN32
+    EXPECT_LT(wait->phases.cpu(QueryPhase::Execute), 15'000'000u);
+#endif
+
+    instrumentation->setPhaseTiming(false);
+    ASSERT_TRUE(conn.execute("DELETE FROM kv"));
+    auto plain = instrumentation->queries().find("DELETE FROM kv");
+    ASSERT_TRUE(plain.has_value());
+    EXPECT_EQ(plain->calls, 1u);
+    EXPECT_EQ(plain->phasedCalls, 0u);
+}
+
+TEST(TracingTest, PoolAndDriverSpansNestUnderCallerAndExport) {
+    EXPECT_FALSE(sdb::TraceSpan("before_start").active());
+
+    sdb::ConnectionPool::Options options;
+    options.maxSize = 1;
+    auto pool = sdb::ConnectionPool::createWithFactory(
+                    []() -> sdb::DbResult<std::unique_ptr<sdb::IConnection>> {
+                        return sdb::DbResult<std::unique_ptr<sdb::IConnection>>::success(
+                            std::make_unique<sdb::drivers::SqliteConnection>(":memory:"));
+                    },
+                    options)
+                    .value();
+
+    auto& tracer = sdb::Tracer::global();
+    tracer.start();
+    sdb::TraceContext requestContext;
+    {
+        sdb::TraceSpan request("request", "app");
+        requestContext = request.context();
+        auto handle = pool->acquire();
+        ASSERT_TRUE(handle) << handle.error().message;
+        ASSERT_TRUE(handle.value()->execute("CREATE TABLE t (v INTEGER)"));
+        ASSERT_TRUE(handle.value()->execute("INSERT INTO t VALUES (?)", {int64_t{42}}));
+        {
+            auto rs = handle.value()->query("SELECT v FROM t WHERE v = 42");
+            ASSERT_TRUE(rs);
+            while (rs.value()->next()) {
+            }
+        }
+        EXPECT_FALSE(handle.value()->query("SELECT * FROM missing"));
+        ASSERT_TRUE(handle.value()->execute("CREATE TABLE users (email TEXT CHECK (email <> 'alice@x'))"));
+        EXPECT_FALSE(handle.value()->execute("INSERT INTO users VALUES (?)", {std::string("alice@x")}));
+        std::thread worker([context = request.context()]() {
+            sdb::ScopedTraceContext adopt(context);
+            sdb::TraceSpan span("worker", "app");
+        });
+        worker.join();
+    }
+    ASSERT_TRUE(tracer.stop());
+    EXPECT_FALSE(sdb::TraceSpan("after_stop").active());
+
+    const auto events = tracer.events();
+    auto find = [&events](const std::string& name, size_t nth = 0) -> const sdb::TraceEvent* {
+        for (const auto& e : events) {
+            if (e.name == name && nth-- == 0) {
+                return &e;
+            }
+        }
+        return nullptr;
+    };
+    const auto* request = find("request");
+    const auto* acquire = find("pool.acquire");
+    const auto* create = find("pool.create");
+    const auto* connect = find("pool.connect");
+    const auto* open = find("sqlite.open");
+    const auto* exec = find("sqlite.exec");
+    const auto* step = find("sqlite.step");
+    const auto* select = find("sqlite.prepare", 1);
+    const auto* failed = find("sqlite.prepare", 2);
+    const auto* fetch = find("sqlite.fetch");
+    const auto* worker = find("worker");
+    for (const auto* e : {request, acquire, create, connect, open, exec, step, select, failed, fetch, worker}) {
+        ASSERT_NE(e, nullptr);
+        EXPECT_EQ(e->traceId, requestContext.traceId) << e->name;
+    }
+    EXPECT_EQ(request->parentSpanId, 0u);
+    EXPECT_EQ(acquire->parentSpanId, request->spanId);
+    EXPECT_EQ(acquire->args.value("source", ""), "created");
+    EXPECT_EQ(create->parentSpanId, acquire->spanId);
+    EXPECT_EQ(connect->parentSpanId, acquire->spanId);
+    EXPECT_EQ(open->parentSpanId, connect->spanId);
+    EXPECT_EQ(exec->parentSpanId, request->spanId);
+    EXPECT_EQ(step->parentSpanId, request->spanId);
+    // 语句经规范化，字面量不进入 trace
+    EXPECT_EQ(select->args.value("statement", ""), "select v from t where v = ?");
+    EXPECT_TRUE(failed->error);
+    EXPECT_EQ(failed->args.value("error_code", 0), SQLITE_ERROR);
+    // 错误信息中的字面量（CHECK constraint failed: email <> 'alice@x'）同样被替换
+    const auto* rejected = find("sqlite.step", 1);
+    ASSERT_NE(rejected, nullptr);
+    EXPECT_TRUE(rejected->error);
+    EXPECT_EQ(rejected->args.value("error_code", 0), SQLITE_CONSTRAINT);
+    EXPECT_EQ(rejected->args.value("error_message", ""), "check constraint failed: email <> ?");
+    EXPECT_EQ(fetch->parentSpanId, request->spanId);
+    EXPECT_EQ(fetch->args.value("rows", 0), 1);
+    EXPECT_EQ(worker->parentSpanId, request->spanId);
+    EXPECT_NE(worker->threadId, request->threadId);
+    EXPECT_LE(request->startNanos, acquire->startNanos);
+    EXPECT_GE(request->startNanos + request->durationNanos, fetch->startNanos + fetch->durationNanos);
+
+    const auto chrome = tracer.toChromeTrace();
+    ASSERT_EQ(chrome["traceEvents"].size(), events.size());
+    EXPECT_EQ(chrome["traceEvents"][0]["ph"], "X");
+    const auto otlp = tracer.toOtlpJson();
+    const auto& spans = otlp["resourceSpans"][0]["scopeSpans"][0]["spans"];
+    ASSERT_EQ(spans.size(), events.size());
+    EXPECT_EQ(spans[0]["traceId"].get<std::string>().size(), 32u);
+
+    const auto path = std::filesystem::temp_directory_path() /
+                      ("smartdb_trace_" + std::to_string(requestContext.spanId) + ".json");
+    ASSERT_TRUE(tracer.writeTo(path.string(), sdb::Tracer::Format::ChromeTrace));
+    {
+        std::ifstream in(path);
+        const auto parsed = nlohmann::json::parse(in, nullptr, false);
+        ASSERT_FALSE(parsed.is_discarded());
+        EXPECT_EQ(parsed["traceEvents"].size(), events.size());
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(PrometheusTest, ManagerRendersPoolConnectionAndStatementMetrics) {
+    const auto stamp = std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    const auto dir = std::filesystem::temp_directory_path();
+    const auto cfgPath = dir / ("smartdb_prometheus_config_" + stamp + ".json");
+    nlohmann::json j;
+    j["connections"]["app"] = {{"driver", "sqlite"}, {"path", ":memory:"}, {"instrument", {{"phase_timing", true}}}};
+    {
+        std::ofstream out(cfgPath);
+        ASSERT_TRUE(out.is_open());
+        out << j.dump(2);
+    }
+
+    sdb::DatabaseManager manager;
+    ASSERT_TRUE(manager.registerDriver(std::make_shared<sdb::drivers::SqliteDriver>()));
+    ASSERT_TRUE(manager.loadConfig(cfgPath.string()));
+    std::filesystem::remove(cfgPath);
+
+    sdb::ConnectionPool::Options options;
+    options.maxSize = 2;
+    auto poolRes = manager.createPool("app", options);
+    ASSERT_TRUE(poolRes) << poolRes.error().message;
+    auto pool = poolRes.value();
+    auto other = manager.createPool("app", sdb::ConnectionPool::Options{});
+    ASSERT_TRUE(other);
+    {
+        auto handle = pool->acquire();
+        ASSERT_TRUE(handle) << handle.error().message;
+        ASSERT_TRUE(handle.value()->execute("CREATE TABLE t (v TEXT)"));
+        ASSERT_TRUE(handle.value()->execute("INSERT INTO t VALUES ('a\"b')"));
+        auto rs = handle.value()->query("SELECT v FROM t");
+        ASSERT_TRUE(rs);
+        while (rs.value()->next()) {
+            (void)rs.value()->get(0);
+        }
+    }
+    manager.addMetricsCollector([](sdb::PrometheusWriter& out) {
+        out.gauge("smartdb_custom", "Custom collector.", {{"k", "v"}}, 1.5);
+    });
+
+    const auto text = manager.renderPrometheus();
+    EXPECT_NE(text.find("# TYPE smartdb_pool_acquire_attempts_total counter"), std::string::npos);
+    EXPECT_NE(text.find("smartdb_pool_acquire_attempts_total{pool=\"app\",role=\"pool\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("smartdb_pool_acquire_attempts_total{pool=\"app#2\",role=\"pool\"} 0\n"), std::string::npos);
+    EXPECT_NE(text.find("smartdb_pool_connections{pool=\"app\",role=\"pool\",state=\"idle\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("smartdb_pool_acquire_duration_seconds_bucket{pool=\"app\",role=\"pool\",le=\"+Inf\"} 1\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("smartdb_connection_rows_fetched_total{connection=\"app\"} 1\n"), std::string::npos);
+    // 语句序列以指纹为标签，语句文本只在 smartdb_statement_info 中出现
+    const std::string fp = sdb::formatSqlFingerprint(sdb::sqlFingerprint("select v from t"));
+    EXPECT_NE(text.find("smartdb_statement_calls_total{connection=\"app\",fingerprint=\"" + fp + "\"} 1\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("smartdb_statement_info{connection=\"app\",fingerprint=\"" + fp +
+                        "\",statement=\"select v from t\"} 1\n"),
+              std::string::npos);
+    EXPECT_EQ(text.find("smartdb_statement_calls_total{connection=\"app\",statement="), std::string::npos);
+    EXPECT_NE(text.find("smartdb_custom{k=\"v\"} 1.5\n"), std::string::npos);
+    EXPECT_NE(text.find("smartdb_statement_phase_cpu_seconds_total{connection=\"app\",fingerprint=\"" + fp + "\","
+                        "phase=\"decode\"} "),
+              std::string::npos);
+    // 每个族的 HELP / TYPE 只出现一次，样本行符合文本格式
+    size_t typeLines = 0;
+    size_t pos = 0;
+    while ((pos = text.find("# TYPE smartdb_statement_duration_seconds ", pos)) != std::string::npos) {
+        ++typeLines;
+        ++pos;
+    }
+    EXPECT_EQ(typeLines, 1u);
+    const std::regex sampleLine(R"re([a-zA-Z_:][a-zA-Z0-9_:]*(\{([a-zA-Z_][a-zA-Z0-9_]*="([^"\\\n]|\\.)*",?)*\})? [-+0-9.eEInfNa]+)re");
+    std::istringstream lines(text);
+    std::string line;
+    size_t samples = 0;
+    while (std::getline(lines, line)) {
+        if (line.rfind("# ", 0) == 0) {
+            continue;
+        }
+        ++samples;
+        EXPECT_TRUE(std::regex_match(line, sampleLine)) << line;
+    }
+    EXPECT_GT(samples, 100u);
+
+    sdb::MetricsExporter::Options exportOptions;
+    exportOptions.path = (dir / ("smartdb_metrics_" + stamp + ".prom")).string();
+    exportOptions.interval = std::chrono::milliseconds(20);
+#ifndef _WIN32
+    exportOptions.httpPort = 0;
+#endif
+    auto exporterRes = manager.startMetricsExporter(exportOptions);
+    ASSERT_TRUE(exporterRes) << exporterRes.error().message;
+    auto& exporter = *exporterRes.value();
+    {
+        std::ifstream in(exportOptions.path);
+        std::stringstream content;
+        content << in.rdbuf();
+        EXPECT_NE(content.str().find("smartdb_pool_max_connections{pool=\"app\",role=\"pool\"} 2\n"), std::string::npos);
+    }
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (exporter.writes() < 2 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_GE(exporter.writes(), 2u);
+
+#ifndef _WIN32
+    ASSERT_GT(exporter.httpPort(), 0);
+    auto get = [&](const std::string& target) {
+        const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(exporter.httpPort()));
+        inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        std::string response;
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+            const std::string request = "GET " + target + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+            (void)::send(fd, request.data(), request.size(), 0);
+            char buf[4096];
+            ssize_t n;
+            while ((n = ::recv(fd, buf, sizeof(buf), 0)) > 0) {
+                response.append(buf, static_cast<size_t>(n));
+            }
+        }
+        ::close(fd);
+        return response;
+    };
+    const auto scrape = get("/metrics");
+    EXPECT_EQ(scrape.rfind("HTTP/1.1 200 OK\r\n", 0), 0u) << scrape;
+    EXPECT_NE(scrape.find("Content-Type: text/plain; version=0.0.4"), std::string::npos);
+    EXPECT_NE(scrape.find("smartdb_statement_calls_total{connection=\"app\""), std::string::npos);
+    EXPECT_EQ(get("/").rfind("HTTP/1.1 404", 0), 0u);
+    EXPECT_EQ(exporter.scrapes(), 1u);
+#endif
+
+    exporter.stop();
+    std::filesystem::remove(exportOptions.path);
+}
+
 TEST(DatabaseManagerTest, MissingConfigUsesLastErrorInsteadOfException) {
     sdb::DatabaseManager manager;
     auto regRes = manager.registerDriver(std::make_shared<sdb::drivers::SqliteDriver>());
@@ -463,11 +2108,61 @@ nlohmann::json mysqlConfigFromEnv() {
     cfg["password"] = read("SMARTDB_MYSQL_PASSWORD", "root");
     cfg["database"] = read("SMARTDB_MYSQL_DATABASE", "my_app");
     cfg["charset"] = read("SMARTDB_MYSQL_CHARSET", "utf8mb4");
+    const auto socket = read("SMARTDB_MYSQL_SOCKET", "");
+    if (!socket.empty()) {
+        cfg["mysql"]["unix_socket"] = socket;
+    }
     return cfg;
 }
 
 } // namespace
 
+TEST(MysqlDriverTest, TransportOptionsParsedFromConfigBlock) {
+    using sdb::drivers::MysqlDriver;
+
+    auto defaults = MysqlDriver::parseOptions({{"host", "127.0.0.1"}});
+    EXPECT_TRUE(defaults.configError.empty());
+    EXPECT_TRUE(defaults.unixSocket.empty());
+    EXPECT_TRUE(defaults.compress.empty());
+    EXPECT_EQ(defaults.connectTimeout, 10u);
+    EXPECT_FALSE(defaults.readTimeout.has_value());
+
+    auto tuned = MysqlDriver::parseOptions({{"mysql", {{"unix_socket", "/run/mysqld/mysqld.sock"},
+                                                       {"compress", "ZSTD,zlib"},
+                                                       {"zstd_level", 3},
+                                                       {"connect_timeout", 2},
+                                                       {"read_timeout", 30},
+                                                       {"write_timeout", 15},
+                                                       {"net_buffer_length", 65536},
+                                                       {"max_allowed_packet", 64 * 1024 * 1024}}}});
+    EXPECT_TRUE(tuned.configError.empty()) << tuned.configError;
+    EXPECT_EQ(tuned.unixSocket, "/run/mysqld/mysqld.sock");
+    EXPECT_EQ(tuned.compress, "zstd,zlib");
+    EXPECT_EQ(tuned.zstdLevel, 3u);
+    EXPECT_EQ(tuned.connectTimeout, 2u);
+    EXPECT_EQ(tuned.readTimeout, 30u);
+    EXPECT_EQ(tuned.writeTimeout, 15u);
+    EXPECT_EQ(tuned.netBufferLength, 65536ul);
+    EXPECT_EQ(tuned.maxAllowedPacket, 64ul * 1024 * 1024);
+
+    EXPECT_EQ(MysqlDriver::parseOptions({{"mysql", {{"compress", true}}}}).compress, "zlib");
+    EXPECT_TRUE(MysqlDriver::parseOptions({{"mysql", {{"compress", "uncompressed"}}}}).compress.empty());
+    EXPECT_FALSE(MysqlDriver::parseOptions({{"mysql", {{"compress", "lz4"}}}}).configError.empty());
+    EXPECT_FALSE(MysqlDriver::parseOptions({{"mysql", {{"read_timeout", -1}}}}).configError.empty());
+    EXPECT_FALSE(MysqlDriver::parseOptions({{"mysql", {{"zstd_level", 40}}}}).configError.empty());
+    EXPECT_FALSE(MysqlDriver::parseOptions({{"mysql", {{"unix_socket", ""}}}}).configError.empty());
+    EXPECT_TRUE(MysqlDriver::parseOptions({{"mysql", {{"multi_statements", true}}}}).multiStatements);
+    EXPECT_FALSE(MysqlDriver::parseOptions({{"mysql", {{"multi_statements", "yes"}}}}).configError.empty());
+
+    // 配置错误在 open() 时返回，不会尝试连接
+    MysqlDriver driver;
+    auto conn = driver.createConnection({{"mysql", {{"net_buffer_length", "big"}}}});
+    auto openRes = conn->open();
+    ASSERT_FALSE(openRes);
+    EXPECT_NE(openRes.error().message.find("net_buffer_length"), std::string::npos);
+    EXPECT_FALSE(conn->isOpen());
+}
+
 TEST(MysqlDriverTest, ParameterizedInsertAndQueryTypes) {
     if (!mysqlTestEnabled()) {
         GTEST_SKIP() << "Set SMARTDB_MYSQL_TEST_ENABLE=1 to run MySQL integration tests.";
@@ -541,3 +2236,238 @@ TEST(MysqlDriverTest, OpenCloseShouldBeIdempotent) {
     conn->close();
     EXPECT_FALSE(conn->isOpen());
 }
+
+TEST(MysqlDriverTest, StoredProcedureResultSetsAreIteratedAndDrained) {
+    if (!mysqlTestEnabled()) {
+        GTEST_SKIP() << "Set SMARTDB_MYSQL_TEST_ENABLE=1 to run MySQL integration tests.";
+    }
+
+    auto config = mysqlConfigFromEnv();
+    config["mysql"]["multi_statements"] = true;
+    sdb::drivers::MysqlDriver driver;
+    auto conn = driver.createConnection(config);
+    auto openRes = conn->open();
+    ASSERT_TRUE(openRes) << openRes.error().message;
+    auto* mysql = dynamic_cast<sdb::drivers::MysqlConnection*>(conn.get());
+    ASSERT_NE(mysql, nullptr);
+
+    ASSERT_TRUE(conn->execute("DROP PROCEDURE IF EXISTS smartdb_report"));
+    ASSERT_TRUE(conn->execute("CREATE PROCEDURE smartdb_report() BEGIN SELECT 1 AS a; SELECT 2 AS b, 3 AS c; END"));
+
+    auto allRes = mysql->queryAll("CALL smartdb_report()");
+    ASSERT_TRUE(allRes) << allRes.error().message;
+    ASSERT_EQ(allRes.value().size(), 2u);
+    ASSERT_TRUE(allRes.value()[1]->next());
+    EXPECT_EQ(allRes.value()[1]->columnNames(), (std::vector<std::string>{"b", "c"}));
+
+    // 只读第一个结果就发起下一条命令，连接不能失步
+    {
+        auto multiRes = mysql->queryMulti("CALL smartdb_report()");
+        ASSERT_TRUE(multiRes) << multiRes.error().message;
+        EXPECT_TRUE(multiRes.value()->hasResultSet());
+        auto rsRes = conn->query("SELECT 42");
+        ASSERT_TRUE(rsRes) << rsRes.error().message;
+        auto more = multiRes.value()->next();
+        ASSERT_TRUE(more);
+        EXPECT_FALSE(more.value());
+    }
+    auto single = conn->query("CALL smartdb_report()");
+    ASSERT_TRUE(single) << single.error().message;
+    EXPECT_TRUE(conn->execute("SELECT 1; SELECT 2"));
+
+    // 多语句中后面的语句失败时整条命令失败，连接仍可继续使用
+    ASSERT_TRUE(conn->execute("DROP TABLE IF EXISTS smartdb_multi_fail"));
+    ASSERT_TRUE(conn->execute("CREATE TABLE smartdb_multi_fail (id INT PRIMARY KEY)"));
+    auto partial = conn->execute("INSERT INTO smartdb_multi_fail VALUES (1); INSERT INTO smartdb_multi_fail VALUES (1)");
+    ASSERT_FALSE(partial);
+    EXPECT_EQ(partial.error().code, 1062);
+    auto failedQuery = conn->query("SELECT 1; SELECT * FROM smartdb_no_such_table");
+    ASSERT_FALSE(failedQuery);
+    EXPECT_EQ(failedQuery.error().code, 1146);
+    auto countRes = conn->query("SELECT COUNT(*) FROM smartdb_multi_fail");
+    ASSERT_TRUE(countRes) << countRes.error().message;
+    ASSERT_TRUE(countRes.value()->next());
+    EXPECT_EQ(std::get<int64_t>(countRes.value()->get(0)), 1);
+    EXPECT_TRUE(conn->execute("DROP TABLE smartdb_multi_fail"));
+    EXPECT_TRUE(conn->execute("DROP PROCEDURE smartdb_report"));
+}
+
+#ifndef _WIN32
+TEST(MysqlWireServerTest, GreetsWithProtocol10Handshake) {
+    sdb::test::MysqlWireServer server;
+    ASSERT_TRUE(server.start());
+    ASSERT_NE(server.port(), 0);
+
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GE(fd, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(server.port());
+    ASSERT_EQ(::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+
+    unsigned char header[4] = {};
+    ASSERT_EQ(::recv(fd, header, 4, MSG_WAITALL), 4);
+    const size_t len = header[0] | (header[1] << 8) | (header[2] << 16);
+    EXPECT_EQ(header[3], 0);
+    std::string payload(len, '\0');
+    ASSERT_EQ(::recv(fd, payload.data(), len, MSG_WAITALL), static_cast<ssize_t>(len));
+    ::close(fd);
+
+    EXPECT_EQ(payload[0], 10);
+    EXPECT_EQ(std::string(payload.c_str() + 1), "8.0.36-smartdb-fixture");
+    EXPECT_NE(payload.find("caching_sha2_password"), std::string::npos);
+    server.stop();
+    EXPECT_EQ(server.metrics().connections, 1u);
+}
+
+TEST(MysqlWireServerTest, DriverRoundTripsTextBinaryAndMultiResults) {
+    using sdb::test::MysqlWireColumn;
+    using sdb::test::MysqlWireResult;
+    using sdb::test::MysqlWireType;
+
+    std::mutex mtx;
+    std::vector<sdb::test::MysqlWireValue> lastParams;
+    sdb::test::MysqlWireServer::Options options;
+    options.rows = 3;
+    options.columns = 2;
+    options.valueBytes = 5;
+    options.unixSocket = (std::filesystem::temp_directory_path() / "sdb_wire_fixture.sock").string();
+    options.handler = [&](const sdb::test::MysqlWireRequest& request) -> std::vector<MysqlWireResult> {
+        if (request.sql == "CALL broken()") {
+            return {MysqlWireResult::table({{"a", MysqlWireType::LongLong}}, {{std::string("1")}}),
+                    MysqlWireResult::error(1146, "Table 'test.missing' doesn't exist")};
+        }
+        if (request.sql.rfind("CALL", 0) == 0) {
+            return {MysqlWireResult::table({{"a", MysqlWireType::LongLong}}, {{std::string("1")}}),
+                    MysqlWireResult::table({{"b", MysqlWireType::VarString}, {"c", MysqlWireType::Double}},
+                                           {{std::string("x"), std::string("2.5")}, {std::nullopt, std::string("3")}}),
+                    MysqlWireResult::ok()};
+        }
+        if (request.sql.rfind("SELECT bad", 0) == 0) {
+            // 二进制协议下无法编码的值：服务端应回 ERR 包，而不是在服务线程里抛异常
+            return {MysqlWireResult::table({{"n", MysqlWireType::Long}},
+                                           request.describeOnly ? std::vector<std::vector<sdb::test::MysqlWireValue>>{}
+                                                                : std::vector<std::vector<sdb::test::MysqlWireValue>>{
+                                                                      {std::string("not-a-number")}})};
+        }
+        if (request.prepared && !request.describeOnly) {
+            std::lock_guard<std::mutex> lock(mtx);
+            lastParams = request.params;
+        }
+        return sdb::test::MysqlWireServer::syntheticResponse(options, request);
+    };
+    sdb::test::MysqlWireServer server(options);
+    ASSERT_TRUE(server.start());
+
+    sdb::drivers::MysqlDriver driver;
+    auto conn = driver.createConnection(server.connectionConfig<nlohmann::json>());
+    auto openRes = conn->open();
+    if (!openRes && server.metrics().connections == 0) {
+        GTEST_SKIP() << "MySQL client library cannot reach the fixture: " << openRes.error().message;
+    }
+    ASSERT_TRUE(openRes) << openRes.error().message;
+
+    {
+        auto rsRes = conn->query("SELECT * FROM wide");
+        ASSERT_TRUE(rsRes) << rsRes.error().message;
+        auto rs = rsRes.value();
+        EXPECT_EQ(rs->columnNames(), (std::vector<std::string>{"id", "c0", "c1"}));
+        int64_t rows = 0;
+        while (rs->next()) {
+            ++rows;
+            EXPECT_EQ(std::get<int64_t>(rs->get("id")), rows);
+            EXPECT_EQ(std::get<std::string>(rs->get(1)), "xxxxx");
+        }
+        EXPECT_EQ(rows, 3);
+    }
+
+    const std::vector<uint8_t> blob{0x00, 0xff, 0x10};
+    auto insRes = conn->execute("INSERT INTO t VALUES (?, ?, ?, ?, ?, ?)",
+                                {int64_t{1} << 40, -7, 1.5, std::string("hello"), blob, std::monostate{}});
+    ASSERT_TRUE(insRes) << insRes.error().message;
+    EXPECT_EQ(insRes.value(), 1);
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        ASSERT_EQ(lastParams.size(), 6u);
+        EXPECT_EQ(lastParams[0], std::to_string(int64_t{1} << 40));
+        EXPECT_EQ(lastParams[1], "-7");
+        EXPECT_EQ(lastParams[2], "1.5");
+        EXPECT_EQ(lastParams[3], "hello");
+        EXPECT_EQ(lastParams[4], std::string("\x00\xff\x10", 3));
+        EXPECT_FALSE(lastParams[5].has_value());
+    }
+
+    auto* mysql = dynamic_cast<sdb::drivers::MysqlConnection*>(conn.get());
+    ASSERT_NE(mysql, nullptr);
+    auto allRes = mysql->queryAll("CALL report()");
+    ASSERT_TRUE(allRes) << allRes.error().message;
+    ASSERT_EQ(allRes.value().size(), 2u);
+    auto second = allRes.value()[1];
+    ASSERT_TRUE(second->next());
+    EXPECT_EQ(std::get<std::string>(second->get("b")), "x");
+    EXPECT_DOUBLE_EQ(std::get<double>(second->get("c")), 2.5);
+    ASSERT_TRUE(second->next());
+    EXPECT_TRUE(std::holds_alternative<std::monostate>(second->get("b")));
+
+    // 多结果集比借出它的池化连接活得更久：归还时剩余结果已被丢弃，结果对象失效，析构不再访问连接
+    {
+        auto pool = sdb::ConnectionPool::createWithFactory([&driver, &server]() {
+                        return sdb::DbResult<std::unique_ptr<sdb::IConnection>>::success(
+                            driver.createConnection(server.connectionConfig<nlohmann::json>()));
+                    }).value();
+        std::unique_ptr<sdb::drivers::MysqlMultiResult> orphan;
+        {
+            auto handle = pool->acquire();
+            ASSERT_TRUE(handle) << handle.error().message;
+            auto* pooled = dynamic_cast<sdb::drivers::MysqlConnection*>(handle.value().get());
+            ASSERT_NE(pooled, nullptr);
+            auto multiRes = pooled->queryMulti("CALL report()");
+            ASSERT_TRUE(multiRes) << multiRes.error().message;
+            orphan = std::move(multiRes.value());
+        }
+        auto next = orphan->next();
+        ASSERT_TRUE(next);
+        EXPECT_FALSE(next.value());
+        auto reused = pool->acquire();
+        ASSERT_TRUE(reused);
+        EXPECT_TRUE(reused.value()->query("SELECT 1"));
+        orphan.reset();
+        EXPECT_TRUE(reused.value()->query("SELECT 1"));
+    }
+
+    // query() 只取第一个结果集，其余结果被丢弃，连接保持同步
+    auto firstOnly = conn->query("CALL report()");
+    ASSERT_TRUE(firstOnly) << firstOnly.error().message;
+    EXPECT_TRUE(conn->execute("UPDATE t SET a = 1"));
+
+    // 后续结果出错时 query() / execute() 均返回该错误，不能当作成功
+    auto brokenQuery = conn->query("CALL broken()");
+    ASSERT_FALSE(brokenQuery);
+    EXPECT_EQ(brokenQuery.error().code, 1146);
+    auto brokenExec = conn->execute("CALL broken()");
+    ASSERT_FALSE(brokenExec);
+    EXPECT_EQ(brokenExec.error().code, 1146);
+    EXPECT_TRUE(conn->query("SELECT 1"));
+
+    auto badValue = conn->execute("SELECT bad FROM t WHERE id = ?", {int64_t{1}});
+    ASSERT_FALSE(badValue);
+    EXPECT_EQ(badValue.error().code, 1105);
+    EXPECT_TRUE(conn->query("SELECT 1"));
+    conn->close();
+
+    auto socketConfig = server.connectionConfig<nlohmann::json>();
+    socketConfig["mysql"]["unix_socket"] = options.unixSocket;
+    auto local = driver.createConnection(socketConfig);
+    auto localRes = local->open();
+    ASSERT_TRUE(localRes) << localRes.error().message;
+    EXPECT_TRUE(local->query("SELECT 1"));
+    local->close();
+
+    server.stop();
+    const auto m = server.metrics();
+    EXPECT_EQ(m.connections, 3u);
+    EXPECT_GE(m.queries, 5u);
+    EXPECT_EQ(m.executes, 2u);
+}
+#endif
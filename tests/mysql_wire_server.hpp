@@ -0,0 +1,991 @@
+#pragma once
+// 进程内 MySQL 线协议替身服务器，仅用于测试与基准：不解析 SQL、不校验密码，
+// 由 handler 决定每条语句返回的结果。支持握手（caching_sha2_password 快速认证 /
+// mysql_native_password）、COM_QUERY、COM_STMT_PREPARE/EXECUTE/CLOSE/RESET、文本与二进制结果集，
+// 以及多结果集（存储过程风格）。只在 POSIX 平台可用
+#ifndef _WIN32
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace sdb::test {
+
+// 与 enum_field_types 取值一致，测试代码不必依赖 mysql.h
+enum class MysqlWireType : uint8_t {
+    Tiny = 1,
+    Short = 2,
+    Long = 3,
+    Float = 4,
+    Double = 5,
+    Null = 6,
+    LongLong = 8,
+    VarString = 253,
+    String = 254,
+    Blob = 252,
+};
+
+struct MysqlWireColumn {
+    std::string name;
+    MysqlWireType type = MysqlWireType::VarString;
+};
+
+// 值一律以文本表示（NULL 为 nullopt），二进制协议下按列类型编码
+using MysqlWireValue = std::optional<std::string>;
+
+struct MysqlWireResult {
+    std::vector<MysqlWireColumn> columns;
+    std::vector<std::vector<MysqlWireValue>> rows;
+    uint64_t affectedRows = 0;
+    uint64_t lastInsertId = 0;
+    uint16_t errorCode = 0;
+    std::string errorMessage;
+
+    bool isError() const { return errorCode != 0; }
+    bool hasRows() const { return !columns.empty(); }
+
+    static MysqlWireResult ok(uint64_t affected = 0, uint64_t lastInsertId = 0) {
+        MysqlWireResult r;
+        r.affectedRows = affected;
+        r.lastInsertId = lastInsertId;
+        return r;
+    }
+
+    static MysqlWireResult error(uint16_t code, std::string message) {
+        MysqlWireResult r;
+        r.errorCode = code;
+        r.errorMessage = std::move(message);
+        return r;
+    }
+
+    static MysqlWireResult table(std::vector<MysqlWireColumn> columns, std::vector<std::vector<MysqlWireValue>> rows) {
+        MysqlWireResult r;
+        r.columns = std::move(columns);
+        r.rows = std::move(rows);
+        return r;
+    }
+};
+
+struct MysqlWireRequest {
+    std::string sql;
+    // 预编译语句的参数（文本形式）；COM_QUERY 时为空
+    std::vector<MysqlWireValue> params;
+    bool prepared = false;
+    // COM_STMT_PREPARE 时为 true：只需返回列定义，用于预编译响应中的列元数据，不应产生副作用
+    bool describeOnly = false;
+};
+
+class MysqlWireServer {
+public:
+    // 返回多个结果时，除最后一个外都带 SERVER_MORE_RESULTS_EXISTS，与存储过程的行为一致
+    using Handler = std::function<std::vector<MysqlWireResult>(const MysqlWireRequest&)>;
+
+    struct Options {
+        // 每条命令响应前的人为延迟，模拟网络往返与服务端执行时间
+        std::chrono::microseconds latency{0};
+        // 默认 handler 对 SELECT 返回的合成结果：id 列 + columns 个文本列，每个值 valueBytes 字节
+        size_t rows = 1;
+        size_t columns = 1;
+        size_t valueBytes = 16;
+        // 非空时同时监听该 Unix 域套接字
+        std::string unixSocket;
+        // 为空时使用默认 handler
+        Handler handler;
+    };
+
+    struct MetricsSnapshot {
+        uint64_t connections = 0;
+        uint64_t queries = 0;
+        uint64_t prepares = 0;
+        uint64_t executes = 0;
+        uint64_t bytesSent = 0;
+    };
+
+    MysqlWireServer() : MysqlWireServer(Options{}) {}
+    explicit MysqlWireServer(Options options) : options_(std::move(options)) {}
+
+    ~MysqlWireServer() { stop(); }
+
+    MysqlWireServer(const MysqlWireServer&) = delete;
+    MysqlWireServer& operator=(const MysqlWireServer&) = delete;
+
+    // 监听 127.0.0.1 的随机端口；失败返回 false
+    bool start() {
+        if (running_) {
+            return true;
+        }
+        tcpFd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (tcpFd_ < 0) {
+            return false;
+        }
+        const int one = 1;
+        ::setsockopt(tcpFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t len = sizeof(addr);
+        if (::bind(tcpFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(tcpFd_, 64) != 0 ||
+            ::getsockname(tcpFd_, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+            closeListeners();
+            return false;
+        }
+        port_ = ntohs(addr.sin_port);
+
+        if (!options_.unixSocket.empty()) {
+            unixFd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            sockaddr_un un{};
+            un.sun_family = AF_UNIX;
+            if (unixFd_ < 0 || options_.unixSocket.size() >= sizeof(un.sun_path)) {
+                closeListeners();
+                return false;
+            }
+            std::memcpy(un.sun_path, options_.unixSocket.c_str(), options_.unixSocket.size() + 1);
+            ::unlink(options_.unixSocket.c_str());
+            if (::bind(unixFd_, reinterpret_cast<sockaddr*>(&un), sizeof(un)) != 0 || ::listen(unixFd_, 64) != 0) {
+                closeListeners();
+                return false;
+            }
+        }
+
+        running_ = true;
+        acceptThread_ = std::thread([this] { acceptLoop(); });
+        return true;
+    }
+
+    void stop() {
+        if (!running_.exchange(false)) {
+            return;
+        }
+        if (acceptThread_.joinable()) {
+            acceptThread_.join();
+        }
+        closeListeners();
+        if (!options_.unixSocket.empty()) {
+            ::unlink(options_.unixSocket.c_str());
+        }
+        std::vector<std::thread> sessions;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            for (int fd : clientFds_) {
+                ::shutdown(fd, SHUT_RDWR);
+            }
+            sessions.swap(sessions_);
+        }
+        for (auto& t : sessions) {
+            t.join();
+        }
+    }
+
+    uint16_t port() const { return port_; }
+    const std::string& unixSocket() const { return options_.unixSocket; }
+
+    MetricsSnapshot metrics() const {
+        MetricsSnapshot s;
+        s.connections = connections_.load();
+        s.queries = queries_.load();
+        s.prepares = prepares_.load();
+        s.executes = executes_.load();
+        s.bytesSent = bytesSent_.load();
+        return s;
+    }
+
+    // 供 MysqlDriver 使用的连接配置
+    template <typename Json>
+    Json connectionConfig() const {
+        Json cfg;
+        cfg["host"] = "127.0.0.1";
+        cfg["port"] = port_;
+        cfg["user"] = "smartdb";
+        cfg["password"] = "smartdb";
+        cfg["database"] = "fixture";
+        return cfg;
+    }
+
+    // 默认 handler：SELECT 返回合成结果，其余语句返回 OK（影响 1 行）
+    static std::vector<MysqlWireResult> syntheticResponse(const Options& options, const MysqlWireRequest& request) {
+        std::string head;
+        for (char c : request.sql) {
+            if (std::isspace(static_cast<unsigned char>(c))) {
+                if (!head.empty()) {
+                    break;
+                }
+                continue;
+            }
+            head += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        }
+        if (head == "SELECT") {
+            std::vector<MysqlWireColumn> columns{{"id", MysqlWireType::LongLong}};
+            for (size_t c = 0; c < options.columns; ++c) {
+                columns.push_back({"c" + std::to_string(c), MysqlWireType::VarString});
+            }
+            std::vector<std::vector<MysqlWireValue>> rows;
+            if (!request.describeOnly) {
+                rows.reserve(options.rows);
+                const std::string value(options.valueBytes, 'x');
+                for (size_t r = 0; r < options.rows; ++r) {
+                    std::vector<MysqlWireValue> row{std::to_string(r + 1)};
+                    row.insert(row.end(), options.columns, value);
+                    rows.push_back(std::move(row));
+                }
+            }
+            return {MysqlWireResult::table(std::move(columns), std::move(rows))};
+        }
+        const bool modifies = head == "INSERT" || head == "UPDATE" || head == "DELETE" || head == "REPLACE";
+        return {MysqlWireResult::ok(modifies ? 1 : 0)};
+    }
+
+private:
+    // ---- 协议常量 ----
+    static constexpr uint32_t kClientLongPassword = 1u;
+    static constexpr uint32_t kClientFoundRows = 2u;
+    static constexpr uint32_t kClientLongFlag = 4u;
+    static constexpr uint32_t kClientConnectWithDb = 8u;
+    static constexpr uint32_t kClientProtocol41 = 0x200u;
+    static constexpr uint32_t kClientTransactions = 0x2000u;
+    static constexpr uint32_t kClientSecureConnection = 0x8000u;
+    static constexpr uint32_t kClientMultiStatements = 0x10000u;
+    static constexpr uint32_t kClientMultiResults = 0x20000u;
+    static constexpr uint32_t kClientPsMultiResults = 0x40000u;
+    static constexpr uint32_t kClientPluginAuth = 0x80000u;
+    static constexpr uint32_t kClientConnectAttrs = 0x100000u;
+    static constexpr uint32_t kClientPluginAuthLenencData = 0x200000u;
+    static constexpr uint32_t kServerCapabilities =
+        kClientLongPassword | kClientFoundRows | kClientLongFlag | kClientConnectWithDb | kClientProtocol41 |
+        kClientTransactions | kClientSecureConnection | kClientMultiStatements | kClientMultiResults |
+        kClientPsMultiResults | kClientPluginAuth | kClientConnectAttrs | kClientPluginAuthLenencData;
+
+    static constexpr uint16_t kStatusAutocommit = 0x0002;
+    static constexpr uint16_t kStatusMoreResults = 0x0008;
+    static constexpr uint8_t kCharsetUtf8mb4 = 45;
+    static constexpr uint8_t kCharsetBinary = 63;
+
+    static constexpr uint8_t kComQuit = 0x01;
+    static constexpr uint8_t kComInitDb = 0x02;
+    static constexpr uint8_t kComQuery = 0x03;
+    static constexpr uint8_t kComPing = 0x0e;
+    static constexpr uint8_t kComStmtPrepare = 0x16;
+    static constexpr uint8_t kComStmtExecute = 0x17;
+    static constexpr uint8_t kComStmtClose = 0x19;
+    static constexpr uint8_t kComStmtReset = 0x1a;
+    static constexpr uint8_t kComResetConnection = 0x1f;
+
+    // ---- 编码 ----
+    class Writer {
+    public:
+        void u8(uint8_t v) { buf_.push_back(static_cast<char>(v)); }
+        void u16(uint16_t v) { fixed(v, 2); }
+        void u32(uint32_t v) { fixed(v, 4); }
+        void u64(uint64_t v) { fixed(v, 8); }
+        void fixed(uint64_t v, int bytes) {
+            for (int i = 0; i < bytes; ++i) {
+                u8(static_cast<uint8_t>(v >> (8 * i)));
+            }
+        }
+        void lenenc(uint64_t v) {
+            if (v < 251) {
+                u8(static_cast<uint8_t>(v));
+            } else if (v < (1u << 16)) {
+                u8(0xfc);
+                fixed(v, 2);
+            } else if (v < (1u << 24)) {
+                u8(0xfd);
+                fixed(v, 3);
+            } else {
+                u8(0xfe);
+                fixed(v, 8);
+            }
+        }
+        void lenencStr(const std::string& s) {
+            lenenc(s.size());
+            buf_ += s;
+        }
+        void raw(const std::string& s) { buf_ += s; }
+        void zstr(const std::string& s) {
+            buf_ += s;
+            u8(0);
+        }
+        void zeros(size_t n) { buf_.append(n, '\0'); }
+        std::string& str() { return buf_; }
+
+    private:
+        std::string buf_;
+    };
+
+    class Reader {
+    public:
+        explicit Reader(const std::string& data, size_t pos = 0) : data_(data), pos_(pos) {}
+        bool ok() const { return ok_; }
+        size_t remaining() const { return pos_ < data_.size() ? data_.size() - pos_ : 0; }
+        uint64_t fixed(int bytes) {
+            if (remaining() < static_cast<size_t>(bytes)) {
+                ok_ = false;
+                pos_ = data_.size();
+                return 0;
+            }
+            uint64_t v = 0;
+            for (int i = 0; i < bytes; ++i) {
+                v |= static_cast<uint64_t>(static_cast<uint8_t>(data_[pos_ + i])) << (8 * i);
+            }
+            pos_ += static_cast<size_t>(bytes);
+            return v;
+        }
+        uint64_t lenenc() {
+            const auto first = fixed(1);
+            switch (first) {
+                case 0xfc:
+                    return fixed(2);
+                case 0xfd:
+                    return fixed(3);
+                case 0xfe:
+                    return fixed(8);
+                default:
+                    return first;
+            }
+        }
+        std::string bytes(size_t n) {
+            if (remaining() < n) {
+                ok_ = false;
+                pos_ = data_.size();
+                return {};
+            }
+            std::string s = data_.substr(pos_, n);
+            pos_ += n;
+            return s;
+        }
+        std::string lenencStr() { return bytes(static_cast<size_t>(lenenc())); }
+        std::string zstr() {
+            const auto end = data_.find('\0', pos_);
+            if (end == std::string::npos) {
+                return bytes(remaining());
+            }
+            std::string s = data_.substr(pos_, end - pos_);
+            pos_ = end + 1;
+            return s;
+        }
+        void skip(size_t n) { bytes(n); }
+
+    private:
+        const std::string& data_;
+        size_t pos_;
+        bool ok_ = true;
+    };
+
+    struct Session {
+        int fd = -1;
+        uint8_t seq = 0;
+        uint32_t clientCaps = 0;
+    };
+
+    struct PreparedStatement {
+        std::string sql;
+        uint16_t params = 0;
+        std::vector<MysqlWireColumn> columns;
+        // 客户端只在首次执行（或重新绑定）时发送参数类型
+        std::vector<uint16_t> paramTypes;
+    };
+
+    bool sendPacket(Session& s, const std::string& payload) {
+        std::string frame;
+        size_t offset = 0;
+        // 负载 >= 16MiB-1 时拆包；以 0xffffff 结尾时追加空包
+        while (true) {
+            const size_t chunk = std::min<size_t>(payload.size() - offset, 0xffffff);
+            frame.push_back(static_cast<char>(chunk & 0xff));
+            frame.push_back(static_cast<char>((chunk >> 8) & 0xff));
+            frame.push_back(static_cast<char>((chunk >> 16) & 0xff));
+            frame.push_back(static_cast<char>(s.seq++));
+            frame.append(payload, offset, chunk);
+            offset += chunk;
+            if (chunk < 0xffffff) {
+                break;
+            }
+        }
+        return sendAll(s.fd, frame);
+    }
+
+    bool sendAll(int fd, const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            const ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        bytesSent_.fetch_add(data.size(), std::memory_order_relaxed);
+        return true;
+    }
+
+    static bool recvAll(int fd, char* out, size_t n) {
+        size_t got = 0;
+        while (got < n) {
+            const ssize_t r = ::recv(fd, out + got, n - got, 0);
+            if (r <= 0) {
+                return false;
+            }
+            got += static_cast<size_t>(r);
+        }
+        return true;
+    }
+
+    static bool readPacket(Session& s, std::string& payload) {
+        payload.clear();
+        while (true) {
+            unsigned char header[4];
+            if (!recvAll(s.fd, reinterpret_cast<char*>(header), 4)) {
+                return false;
+            }
+            const size_t len = header[0] | (header[1] << 8) | (header[2] << 16);
+            s.seq = static_cast<uint8_t>(header[3] + 1);
+            const size_t old = payload.size();
+            payload.resize(old + len);
+            if (len > 0 && !recvAll(s.fd, payload.data() + old, len)) {
+                return false;
+            }
+            if (len < 0xffffff) {
+                return true;
+            }
+        }
+    }
+
+    static std::string okPacket(uint64_t affected, uint64_t lastInsertId, uint16_t status) {
+        Writer w;
+        w.u8(0x00);
+        w.lenenc(affected);
+        w.lenenc(lastInsertId);
+        w.u16(status);
+        w.u16(0);
+        return w.str();
+    }
+
+    static std::string errPacket(uint16_t code, const std::string& message) {
+        Writer w;
+        w.u8(0xff);
+        w.u16(code);
+        w.raw("#HY000");
+        w.raw(message);
+        return w.str();
+    }
+
+    static std::string eofPacket(uint16_t status) {
+        Writer w;
+        w.u8(0xfe);
+        w.u16(0);
+        w.u16(status);
+        return w.str();
+    }
+
+    static bool isNumeric(MysqlWireType type) {
+        switch (type) {
+            case MysqlWireType::Tiny:
+            case MysqlWireType::Short:
+            case MysqlWireType::Long:
+            case MysqlWireType::Float:
+            case MysqlWireType::Double:
+            case MysqlWireType::LongLong:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    static std::string columnDefinition(const MysqlWireColumn& column) {
+        Writer w;
+        w.lenencStr("def");
+        w.lenencStr("fixture");
+        w.lenencStr("t");
+        w.lenencStr("t");
+        w.lenencStr(column.name);
+        w.lenencStr(column.name);
+        w.lenenc(0x0c);
+        const bool binaryCharset = isNumeric(column.type) || column.type == MysqlWireType::Blob;
+        w.u16(binaryCharset ? kCharsetBinary : kCharsetUtf8mb4);
+        w.u32(column.type == MysqlWireType::LongLong ? 20 : 65535);
+        w.u8(static_cast<uint8_t>(column.type));
+        // BINARY_FLAG | BLOB_FLAG 让客户端把 Blob 列识别为二进制
+        w.u16(column.type == MysqlWireType::Blob ? 0x90 : 0);
+        w.u8(column.type == MysqlWireType::Double || column.type == MysqlWireType::Float ? 31 : 0);
+        w.u16(0);
+        return w.str();
+    }
+
+    // 处理器给出的文本不合法时返回 false；在服务线程中不能抛异常，否则整个测试进程会 terminate
+    static bool binaryValue(Writer& w, MysqlWireType type, const std::string& text) {
+        const char* first = text.data();
+        const char* last = first + text.size();
+        auto parseInt = [&](uint64_t& out) {
+            int64_t v = 0;
+            auto res = std::from_chars(first, last, v);
+            if (res.ec == std::errc() && res.ptr == last) {
+                out = static_cast<uint64_t>(v);
+                return true;
+            }
+            res = std::from_chars(first, last, out);
+            return res.ec == std::errc() && res.ptr == last;
+        };
+        uint64_t i = 0;
+        switch (type) {
+            case MysqlWireType::Tiny:
+                if (!parseInt(i)) {
+                    return false;
+                }
+                w.u8(static_cast<uint8_t>(i));
+                return true;
+            case MysqlWireType::Short:
+                if (!parseInt(i)) {
+                    return false;
+                }
+                w.u16(static_cast<uint16_t>(i));
+                return true;
+            case MysqlWireType::Long:
+                if (!parseInt(i)) {
+                    return false;
+                }
+                w.u32(static_cast<uint32_t>(i));
+                return true;
+            case MysqlWireType::LongLong:
+                if (!parseInt(i)) {
+                    return false;
+                }
+                w.u64(i);
+                return true;
+            case MysqlWireType::Float: {
+                float f = 0;
+                const auto res = std::from_chars(first, last, f);
+                if (res.ec != std::errc() || res.ptr != last) {
+                    return false;
+                }
+                uint32_t bits = 0;
+                std::memcpy(&bits, &f, sizeof(bits));
+                w.u32(bits);
+                return true;
+            }
+            case MysqlWireType::Double: {
+                double d = 0;
+                const auto res = std::from_chars(first, last, d);
+                if (res.ec != std::errc() || res.ptr != last) {
+                    return false;
+                }
+                uint64_t bits = 0;
+                std::memcpy(&bits, &d, sizeof(bits));
+                w.u64(bits);
+                return true;
+            }
+            default:
+                w.lenencStr(text);
+                return true;
+        }
+    }
+
+    bool sendResults(Session& s, const std::vector<MysqlWireResult>& results, bool binary) {
+        if (results.empty()) {
+            return sendPacket(s, okPacket(0, 0, kStatusAutocommit));
+        }
+        for (size_t i = 0; i < results.size(); ++i) {
+            const auto& r = results[i];
+            const uint16_t status = kStatusAutocommit | (i + 1 < results.size() ? kStatusMoreResults : 0);
+            if (r.isError()) {
+                // 错误结束整条命令，其后的结果不再发送
+                return sendPacket(s, errPacket(r.errorCode, r.errorMessage));
+            }
+            if (!r.hasRows()) {
+                if (!sendPacket(s, okPacket(r.affectedRows, r.lastInsertId, status))) {
+                    return false;
+                }
+                continue;
+            }
+            // 先编码全部行：值不合法时以 ERR 包结束命令，而不是发出半个结果集
+            std::vector<std::string> rows;
+            rows.reserve(r.rows.size());
+            for (const auto& row : r.rows) {
+                Writer w;
+                if (binary) {
+                    w.u8(0x00);
+                    // 二进制行的 NULL 位图偏移 2 位
+                    std::string bitmap((r.columns.size() + 7 + 2) / 8, '\0');
+                    for (size_t c = 0; c < r.columns.size(); ++c) {
+                        if (c >= row.size() || !row[c]) {
+                            bitmap[(c + 2) / 8] = static_cast<char>(bitmap[(c + 2) / 8] | (1 << ((c + 2) % 8)));
+                        }
+                    }
+                    w.raw(bitmap);
+                    for (size_t c = 0; c < r.columns.size(); ++c) {
+                        if (c < row.size() && row[c] && !binaryValue(w, r.columns[c].type, *row[c])) {
+                            return sendPacket(s, errPacket(1105, "fixture cannot encode '" + *row[c] + "' for column '" +
+                                                                     r.columns[c].name + "'"));
+                        }
+                    }
+                } else {
+                    for (size_t c = 0; c < r.columns.size(); ++c) {
+                        if (c < row.size() && row[c]) {
+                            w.lenencStr(*row[c]);
+                        } else {
+                            w.u8(0xfb);
+                        }
+                    }
+                }
+                rows.push_back(w.str());
+            }
+            Writer count;
+            count.lenenc(r.columns.size());
+            if (!sendPacket(s, count.str())) {
+                return false;
+            }
+            for (const auto& column : r.columns) {
+                if (!sendPacket(s, columnDefinition(column))) {
+                    return false;
+                }
+            }
+            if (!sendPacket(s, eofPacket(status))) {
+                return false;
+            }
+            for (const auto& row : rows) {
+                if (!sendPacket(s, row)) {
+                    return false;
+                }
+            }
+            if (!sendPacket(s, eofPacket(status))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::vector<MysqlWireResult> handle(const MysqlWireRequest& request) {
+        if (options_.latency.count() > 0) {
+            std::this_thread::sleep_for(options_.latency);
+        }
+        if (options_.handler) {
+            return options_.handler(request);
+        }
+        return syntheticResponse(options_, request);
+    }
+
+    bool handshake(Session& s, uint32_t connectionId) {
+        // 20 字节随机挑战，内容对替身服务器无意义，只需避开 '\0'
+        std::string scramble;
+        for (int i = 0; i < 20; ++i) {
+            scramble.push_back(static_cast<char>('A' + (connectionId * 7 + static_cast<uint32_t>(i) * 13) % 26));
+        }
+        Writer w;
+        w.u8(10);
+        w.zstr("8.0.36-smartdb-fixture");
+        w.u32(connectionId);
+        w.raw(scramble.substr(0, 8));
+        w.u8(0);
+        w.u16(static_cast<uint16_t>(kServerCapabilities & 0xffff));
+        w.u8(kCharsetUtf8mb4);
+        w.u16(kStatusAutocommit);
+        w.u16(static_cast<uint16_t>(kServerCapabilities >> 16));
+        w.u8(21);
+        w.zeros(10);
+        w.raw(scramble.substr(8));
+        w.u8(0);
+        w.zstr("caching_sha2_password");
+        s.seq = 0;
+        if (!sendPacket(s, w.str())) {
+            return false;
+        }
+
+        std::string response;
+        if (!readPacket(s, response)) {
+            return false;
+        }
+        Reader r(response);
+        s.clientCaps = static_cast<uint32_t>(r.fixed(4));
+        r.skip(4 + 1 + 23);
+        r.zstr();
+        if (s.clientCaps & kClientPluginAuthLenencData) {
+            r.lenencStr();
+        } else if (s.clientCaps & kClientSecureConnection) {
+            r.bytes(static_cast<size_t>(r.fixed(1)));
+        } else {
+            r.zstr();
+        }
+        if (s.clientCaps & kClientConnectWithDb) {
+            r.zstr();
+        }
+        const std::string plugin = (s.clientCaps & kClientPluginAuth) ? r.zstr() : std::string("mysql_native_password");
+
+        if (plugin == "caching_sha2_password") {
+            // AuthMoreData(fast_auth_success)，随后是 OK
+            if (!sendPacket(s, std::string("\x01\x03", 2))) {
+                return false;
+            }
+        } else if (plugin != "mysql_native_password") {
+            // 其它插件：切换到 mysql_native_password 并接受任意应答
+            Writer sw;
+            sw.u8(0xfe);
+            sw.zstr("mysql_native_password");
+            sw.raw(scramble);
+            sw.u8(0);
+            std::string ignored;
+            if (!sendPacket(s, sw.str()) || !readPacket(s, ignored)) {
+                return false;
+            }
+        }
+        return sendPacket(s, okPacket(0, 0, kStatusAutocommit));
+    }
+
+    static std::string paramText(Reader& r, uint16_t typeAndFlags) {
+        const auto type = static_cast<uint8_t>(typeAndFlags & 0xff);
+        const bool isUnsigned = (typeAndFlags & 0x8000) != 0;
+        auto integer = [&](int bytes) {
+            const uint64_t raw = r.fixed(bytes);
+            if (isUnsigned) {
+                return std::to_string(raw);
+            }
+            const int shift = 64 - 8 * bytes;
+            return std::to_string(static_cast<int64_t>(raw << shift) >> shift);
+        };
+        char buf[64];
+        switch (type) {
+            case 1:
+                return integer(1);
+            case 2:
+            case 13:
+                return integer(2);
+            case 3:
+            case 9:
+                return integer(4);
+            case 8:
+                return integer(8);
+            case 4: {
+                const auto bits = static_cast<uint32_t>(r.fixed(4));
+                float f = 0;
+                std::memcpy(&f, &bits, sizeof(f));
+                std::snprintf(buf, sizeof(buf), "%.9g", static_cast<double>(f));
+                return buf;
+            }
+            case 5: {
+                const uint64_t bits = r.fixed(8);
+                double d = 0;
+                std::memcpy(&d, &bits, sizeof(d));
+                std::snprintf(buf, sizeof(buf), "%.17g", d);
+                return buf;
+            }
+            case 7:
+            case 10:
+            case 11:
+            case 12: {
+                // 日期时间按长度前缀跳过，替身服务器不解析
+                r.skip(static_cast<size_t>(r.fixed(1)));
+                return {};
+            }
+            default:
+                return r.lenencStr();
+        }
+    }
+
+    void serve(int fd, uint32_t connectionId) {
+        Session s;
+        s.fd = fd;
+        std::map<uint32_t, PreparedStatement> statements;
+        uint32_t nextStatementId = 1;
+
+        if (handshake(s, connectionId)) {
+            std::string packet;
+            while (running_ && readPacket(s, packet) && !packet.empty()) {
+                const auto command = static_cast<uint8_t>(packet[0]);
+                bool alive = true;
+                switch (command) {
+                    case kComQuit:
+                        alive = false;
+                        break;
+                    case kComPing:
+                    case kComInitDb:
+                    case kComResetConnection:
+                        alive = sendPacket(s, okPacket(0, 0, kStatusAutocommit));
+                        break;
+                    case kComQuery: {
+                        queries_.fetch_add(1, std::memory_order_relaxed);
+                        MysqlWireRequest request;
+                        request.sql = packet.substr(1);
+                        alive = sendResults(s, handle(request), false);
+                        break;
+                    }
+                    case kComStmtPrepare: {
+                        prepares_.fetch_add(1, std::memory_order_relaxed);
+                        PreparedStatement stmt;
+                        stmt.sql = packet.substr(1);
+                        stmt.params = static_cast<uint16_t>(std::count(stmt.sql.begin(), stmt.sql.end(), '?'));
+                        MysqlWireRequest request;
+                        request.sql = stmt.sql;
+                        request.prepared = true;
+                        request.describeOnly = true;
+                        const auto described = options_.handler ? options_.handler(request) : syntheticResponse(options_, request);
+                        if (!described.empty() && described.front().isError()) {
+                            alive = sendPacket(s, errPacket(described.front().errorCode, described.front().errorMessage));
+                            break;
+                        }
+                        if (!described.empty()) {
+                            stmt.columns = described.front().columns;
+                        }
+                        const uint32_t id = nextStatementId++;
+                        Writer w;
+                        w.u8(0x00);
+                        w.u32(id);
+                        w.u16(static_cast<uint16_t>(stmt.columns.size()));
+                        w.u16(stmt.params);
+                        w.u8(0);
+                        w.u16(0);
+                        alive = sendPacket(s, w.str());
+                        for (uint16_t i = 0; alive && i < stmt.params; ++i) {
+                            alive = sendPacket(s, columnDefinition({"?", MysqlWireType::VarString}));
+                        }
+                        if (alive && stmt.params > 0) {
+                            alive = sendPacket(s, eofPacket(kStatusAutocommit));
+                        }
+                        for (size_t i = 0; alive && i < stmt.columns.size(); ++i) {
+                            alive = sendPacket(s, columnDefinition(stmt.columns[i]));
+                        }
+                        if (alive && !stmt.columns.empty()) {
+                            alive = sendPacket(s, eofPacket(kStatusAutocommit));
+                        }
+                        statements[id] = std::move(stmt);
+                        break;
+                    }
+                    case kComStmtExecute: {
+                        executes_.fetch_add(1, std::memory_order_relaxed);
+                        Reader r(packet, 1);
+                        const auto id = static_cast<uint32_t>(r.fixed(4));
+                        r.skip(1 + 4);
+                        auto it = statements.find(id);
+                        if (it == statements.end()) {
+                            alive = sendPacket(s, errPacket(1243, "Unknown prepared statement handler"));
+                            break;
+                        }
+                        auto& stmt = it->second;
+                        MysqlWireRequest request;
+                        request.sql = stmt.sql;
+                        request.prepared = true;
+                        if (stmt.params > 0) {
+                            const std::string nulls = r.bytes((stmt.params + 7u) / 8u);
+                            if (r.fixed(1) == 1) {
+                                stmt.paramTypes.clear();
+                                for (uint16_t i = 0; i < stmt.params; ++i) {
+                                    stmt.paramTypes.push_back(static_cast<uint16_t>(r.fixed(2)));
+                                }
+                            }
+                            for (uint16_t i = 0; i < stmt.params; ++i) {
+                                const bool isNull = nulls.size() > i / 8u && (static_cast<uint8_t>(nulls[i / 8u]) >> (i % 8u)) & 1u;
+                                const uint16_t type = i < stmt.paramTypes.size() ? stmt.paramTypes[i] : 6;
+                                if (isNull || (type & 0xff) == 6) {
+                                    request.params.emplace_back(std::nullopt);
+                                } else {
+                                    request.params.emplace_back(paramText(r, type));
+                                }
+                            }
+                        }
+                        if (!r.ok()) {
+                            alive = sendPacket(s, errPacket(1210, "Malformed COM_STMT_EXECUTE"));
+                            break;
+                        }
+                        alive = sendResults(s, handle(request), true);
+                        break;
+                    }
+                    case kComStmtClose: {
+                        Reader r(packet, 1);
+                        statements.erase(static_cast<uint32_t>(r.fixed(4)));
+                        break;
+                    }
+                    case kComStmtReset:
+                        alive = sendPacket(s, okPacket(0, 0, kStatusAutocommit));
+                        break;
+                    default:
+                        alive = sendPacket(s, errPacket(1047, "Unknown command"));
+                        break;
+                }
+                if (!alive) {
+                    break;
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        clientFds_.erase(std::remove(clientFds_.begin(), clientFds_.end(), fd), clientFds_.end());
+        ::close(fd);
+    }
+
+    void acceptLoop() {
+        uint32_t connectionId = 1;
+        while (running_) {
+            pollfd fds[2] = {{tcpFd_, POLLIN, 0}, {unixFd_, POLLIN, 0}};
+            const nfds_t count = unixFd_ >= 0 ? 2 : 1;
+            if (::poll(fds, count, 50) <= 0) {
+                continue;
+            }
+            for (nfds_t i = 0; i < count; ++i) {
+                if (!(fds[i].revents & POLLIN)) {
+                    continue;
+                }
+                const int fd = ::accept(fds[i].fd, nullptr, nullptr);
+                if (fd < 0) {
+                    continue;
+                }
+                if (fds[i].fd == tcpFd_) {
+                    const int one = 1;
+                    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                }
+                connections_.fetch_add(1, std::memory_order_relaxed);
+                std::lock_guard<std::mutex> lock(mtx_);
+                clientFds_.push_back(fd);
+                const uint32_t id = connectionId++;
+                sessions_.emplace_back([this, fd, id] { serve(fd, id); });
+            }
+        }
+    }
+
+    void closeListeners() {
+        if (tcpFd_ >= 0) {
+            ::close(tcpFd_);
+            tcpFd_ = -1;
+        }
+        if (unixFd_ >= 0) {
+            ::close(unixFd_);
+            unixFd_ = -1;
+        }
+    }
+
+    Options options_;
+    std::atomic<bool> running_{false};
+    int tcpFd_ = -1;
+    int unixFd_ = -1;
+    uint16_t port_ = 0;
+    std::thread acceptThread_;
+    std::mutex mtx_;
+    std::vector<int> clientFds_;
+    std::vector<std::thread> sessions_;
+    std::atomic<uint64_t> connections_{0};
+    std::atomic<uint64_t> queries_{0};
+    std::atomic<uint64_t> prepares_{0};
+    std::atomic<uint64_t> executes_{0};
+    std::atomic<uint64_t> bytesSent_{0};
+};
+
+} // namespace sdb::test
+
+#endif // _WIN32
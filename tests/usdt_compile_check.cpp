@@ -0,0 +1,25 @@
+// 以 SMARTDB_USDT 与 tests/usdt_stub 中的 <sys/sdt.h> 替身编译所有放置探针的头文件，
+// 使默认构建（未安装 systemtap-sdt）也能发现 USDT 分支的编译错误。只编译，不链接、不运行
+#include "sdb/probes.hpp"
+
+#include "sdb/connection_pool.hpp"
+#include "sdb/drivers/mysql_driver.hpp"
+#include "sdb/drivers/sqlite_driver.hpp"
+
+#include <string>
+#include <utility>
+
+#if !defined(SMARTDB_USDT)
+#error "usdt_compile_check must be built with SMARTDB_USDT"
+#endif
+
+namespace {
+
+[[maybe_unused]] bool probeQuery(const void* conn, const std::string& sql) {
+    sdb::detail::QueryProbe probe(conn, sql);
+    sdb::detail::QueryProbe moved(std::move(probe));
+    moved.succeeded();
+    return SDB_PROBE_ENABLED(query__start);
+}
+
+} // namespace
@@ -0,0 +1,15 @@
+#pragma once
+// 仅供 usdt_compile_check 使用的最小 <sys/sdt.h> 替身：不生成 .note.stapsdt，只在编译期检查
+// SMARTDB_USDT=ON 分支的写法——探针名要有同名 semaphore，参数必须是可求值的表达式且不超过 12 个。
+// 真正挂载探针请安装 systemtap-sdt-dev / systemtap-sdt-devel。
+
+namespace sdt_stub {
+
+template <typename... Args>
+inline void args(const Args&...) {
+    static_assert(sizeof...(Args) <= 12, "<sys/sdt.h> probes take at most 12 arguments");
+}
+
+} // namespace sdt_stub
+
+#define STAP_PROBEV(provider, name, ...) ((void)provider##_##name##_semaphore, ::sdt_stub::args(__VA_ARGS__))